@@ -20,7 +20,7 @@
 #include <stddef.h>
 #include <unistd.h>
 
-#define LTO_API_VERSION 4
+#define LTO_API_VERSION 5
 
 typedef enum {
     LTO_SYMBOL_ALIGNMENT_MASK              = 0x0000001F, /* log2 of alignment */
@@ -229,6 +229,15 @@ extern void
 lto_codegen_set_cpu(lto_code_gen_t cg, const char *cpu);
 
 
+/**
+ * Sets the number of partitions the merged module is split into by
+ * lto_codegen_compile_to_files().  Each partition is code generated on its own
+ * thread into its own object file.  The default is one.
+ */
+extern void
+lto_codegen_set_num_partitions(lto_code_gen_t cg, unsigned num);
+
+
 /**
  * Sets the location of the assembler tool to run. If not set, libLTO
  * will use gcc to invoke the assembler.
@@ -279,6 +288,17 @@ lto_codegen_compile(lto_code_gen_t cg, size_t* length);
 extern bool
 lto_codegen_compile_to_file(lto_code_gen_t cg, const char** name);
 
+/**
+ * Generates code for all added modules into one native object file per
+ * partition (see lto_codegen_set_num_partitions()).  On success, *names is
+ * set to an array of *count file names, which is owned by the lto_code_gen_t
+ * and is valid until lto_codegen_dispose() or another compile call.
+ * Returns true on error (check lto_get_error_message() for details).
+ */
+extern bool
+lto_codegen_compile_to_files(lto_code_gen_t cg, const char*** names,
+                             unsigned* count);
+
 
 /**
  * Sets options to help debug codegen bugs.
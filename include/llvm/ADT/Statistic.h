@@ -27,6 +27,7 @@
 #define LLVM_ADT_STATISTIC_H
 
 #include "llvm/Support/Atomic.h"
+#include <vector>
 
 namespace llvm {
 class raw_ostream;
@@ -35,88 +36,99 @@ class Statistic {
 public:
   const char *Name;
   const char *Desc;
+  // The part of the value not held by the counters of the threads: what was
+  // assigned, less what the counters held at the time.  Only changed under
+  // the statistics lock.
   volatile llvm::sys::cas_flag Value;
   bool Initialized;
+  // The index of the statistic in the counters of each thread.
+  unsigned Index;
 
-  llvm::sys::cas_flag getValue() const { return Value; }
+  /// getValue - Return the value of the statistic, adding up the counters of
+  /// all of the threads that have updated it.  The counters of other threads
+  /// are read without synchronizing with them, so while they are still
+  /// counting the result may leave out their most recent updates.
+  llvm::sys::cas_flag getValue() const;
   const char *getName() const { return Name; }
   const char *getDesc() const { return Desc; }
 
   /// construct - This should only be called for non-global statistics.
   void construct(const char *name, const char *desc) {
     Name = name; Desc = desc;
-    Value = 0; Initialized = 0;
+    Value = 0; Initialized = 0; Index = 0;
   }
 
   // Allow use of this class as the value itself.
-  operator unsigned() const { return Value; }
+  operator unsigned() const { return getValue(); }
   const Statistic &operator=(unsigned Val) {
-    Value = Val;
-    return init();
+    init().setValue(Val);
+    return *this;
   }
-  
+
+  // Each thread updates its own counter for the statistic, so the counters are
+  // never contended and need no atomic operations.  The postfix operators do
+  // not return the old value, which would mean adding up the counters of all
+  // of the threads under the statistics lock on every update.
   const Statistic &operator++() {
-    // FIXME: This function and all those that follow carefully use an
-    // atomic operation to update the value safely in the presence of
-    // concurrent accesses, but not to read the return value, so the
-    // return value is not thread safe.
-    sys::AtomicIncrement(&Value);
-    return init();
+    ++getCounter();
+    return *this;
   }
-  
-  unsigned operator++(int) {
-    init();
-    unsigned OldValue = Value;
-    sys::AtomicIncrement(&Value);
-    return OldValue;
+
+  void operator++(int) {
+    ++getCounter();
   }
-  
+
   const Statistic &operator--() {
-    sys::AtomicDecrement(&Value);
-    return init();
+    --getCounter();
+    return *this;
   }
-  
-  unsigned operator--(int) {
-    init();
-    unsigned OldValue = Value;
-    sys::AtomicDecrement(&Value);
-    return OldValue;
+
+  void operator--(int) {
+    --getCounter();
   }
-  
+
   const Statistic &operator+=(const unsigned &V) {
-    sys::AtomicAdd(&Value, V);
-    return init();
+    getCounter() += V;
+    return *this;
   }
-  
+
   const Statistic &operator-=(const unsigned &V) {
-    sys::AtomicAdd(&Value, -V);
-    return init();
+    getCounter() -= V;
+    return *this;
   }
-  
+
   const Statistic &operator*=(const unsigned &V) {
-    sys::AtomicMul(&Value, V);
-    return init();
+    init().setValue(getValue() * V);
+    return *this;
   }
-  
+
   const Statistic &operator/=(const unsigned &V) {
-    sys::AtomicDiv(&Value, V);
-    return init();
+    init().setValue(getValue() / V);
+    return *this;
   }
 
 protected:
+  // RegisterStatistic fences before setting Initialized, so once it is seen
+  // set the statistic can be used without one.
   Statistic &init() {
-    bool tmp = Initialized;
-    sys::MemoryFence();
-    if (!tmp) RegisterStatistic();
+    if (!Initialized) RegisterStatistic();
     return *this;
   }
   void RegisterStatistic();
+
+  /// getCounter - Return the counter of the calling thread for this
+  /// statistic, registering it first if needed.
+  unsigned &getCounter();
+
+  /// setValue - Make the value of the statistic Val, whatever the threads
+  /// have counted so far.
+  void setValue(unsigned Val);
 };
 
 // STATISTIC - A macro to make definition of statistics really simple.  This
 // automatically passes the DEBUG_TYPE of the file into the statistic.
 #define STATISTIC(VARNAME, DESC) \
-  static llvm::Statistic VARNAME = { DEBUG_TYPE, DESC, 0, 0 }
+  static llvm::Statistic VARNAME = { DEBUG_TYPE, DESC, 0, 0, 0 }
 
 /// \brief Enable the collection and printing of statistics.
 void EnableStatistics();
@@ -130,6 +142,29 @@ void PrintStatistics();
 /// \brief Print statistics to the given output stream.
 void PrintStatistics(raw_ostream &OS);
 
+/// \brief Print statistics to the given output stream as a JSON array of
+/// objects with the name, description and value of each statistic.
+void PrintStatisticsJSON(raw_ostream &OS);
+
+/// \brief The value of a statistic at the time it was read.
+struct StatisticValue {
+  const char *Name;
+  const char *Desc;
+  unsigned Value;
+};
+
+/// \brief Read the value of every statistic that has been updated so far,
+/// sorted by name.  Like Statistic::getValue, this is only exact once the
+/// threads updating the statistics have stopped.  If \arg Reset is true, the statistics are also set back
+/// to zero, with no update lost in between, so that the next call only
+/// counts what happened since.  Statistics are collected whether or not they
+/// are enabled.
+void GetStatistics(std::vector<StatisticValue> &Values, bool Reset = false);
+
+/// \brief Set every statistic back to zero, for example before the next
+/// compilation in a process that runs many.
+void ResetStatistics();
+
 } // End llvm namespace
 
 #endif
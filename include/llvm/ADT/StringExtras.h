@@ -166,6 +166,12 @@ static inline unsigned HashString(StringRef Str, unsigned Result = 0) {
   return Result;
 }
 
+/// HashStringFast - Hash function for strings that reads the string a word
+/// at a time, rather than a byte at a time like HashString.  The values are
+/// the same on every host, so the iteration order of a StringMap, and any
+/// output written in that order, does not depend on the host.
+unsigned HashStringFast(StringRef Str);
+
 } // End llvm namespace
 
 #endif
@@ -0,0 +1,602 @@
+//===- llvm/ADT/SwissMap.h - Hash table probed by groups --------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the SwissMap class, a drop-in replacement for DenseMap that
+// probes groups of buckets at once.
+//
+// Next to the buckets, the map keeps one control byte per bucket, which says
+// whether the bucket is empty, erased, or full, and for a full bucket holds 7
+// bits of the key's hash.  A lookup compares the control bytes of a group of
+// 16 buckets with the hash bits all at once (with SSE2, where available), and
+// only looks at the keys of the few buckets that match.  Most lookups thus
+// touch one line of control bytes and one key, where DenseMap compares the
+// keys of every bucket along the probe sequence.
+//
+// The hash of each key is scrambled before use, so weak hashes like the one
+// DenseMapInfo uses for pointers still spread over the table.  The empty and
+// tombstone keys of the KeyInfoT are never used, so any key can be stored.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_ADT_SWISSMAP_H
+#define LLVM_ADT_SWISSMAP_H
+
+#include "llvm/Support/DataTypes.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/type_traits.h"
+#include "llvm/ADT/DenseMapInfo.h"
+#include <algorithm>
+#include <iterator>
+#include <new>
+#include <utility>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LLVM_SWISSMAP_SSE2 1
+#endif
+
+namespace llvm {
+
+/// SwissMapGroup - Operations on the control bytes of a group of buckets.
+/// Each returns a mask with bit i set if the i'th bucket of the group
+/// matches.
+struct SwissMapGroup {
+  enum {
+    Width = 16,        // Buckets in a group.
+    Empty = -128,      // Control byte of a bucket that was never filled.
+    Deleted = -2       // Control byte of a bucket whose entry was erased.
+    // The control byte of a full bucket is 7 bits of the hash, so it is
+    // never negative.
+  };
+
+#ifdef LLVM_SWISSMAP_SSE2
+  static unsigned match(const signed char *Ctrl, signed char Hash) {
+    __m128i G = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Ctrl));
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(G, _mm_set1_epi8(Hash)));
+  }
+
+  static unsigned matchEmpty(const signed char *Ctrl) {
+    return match(Ctrl, Empty);
+  }
+
+  static unsigned matchEmptyOrDeleted(const signed char *Ctrl) {
+    // Both have the sign bit set, and full buckets do not.
+    __m128i G = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Ctrl));
+    return _mm_movemask_epi8(G);
+  }
+#else
+  static unsigned match(const signed char *Ctrl, signed char Hash) {
+    unsigned Mask = 0;
+    for (unsigned i = 0; i != Width; ++i)
+      if (Ctrl[i] == Hash)
+        Mask |= 1U << i;
+    return Mask;
+  }
+
+  static unsigned matchEmpty(const signed char *Ctrl) {
+    return match(Ctrl, Empty);
+  }
+
+  static unsigned matchEmptyOrDeleted(const signed char *Ctrl) {
+    unsigned Mask = 0;
+    for (unsigned i = 0; i != Width; ++i)
+      if (Ctrl[i] < 0)
+        Mask |= 1U << i;
+    return Mask;
+  }
+#endif
+};
+
+template<typename KeyT, typename ValueT,
+         typename KeyInfoT = DenseMapInfo<KeyT>,
+         typename ValueInfoT = DenseMapInfo<ValueT>, bool IsConst = false>
+class SwissMapIterator;
+
+template<typename KeyT, typename ValueT,
+         typename KeyInfoT = DenseMapInfo<KeyT>,
+         typename ValueInfoT = DenseMapInfo<ValueT> >
+class SwissMap {
+  typedef std::pair<KeyT, ValueT> BucketT;
+  typedef SwissMapGroup Group;
+  unsigned NumBuckets;
+  BucketT *Buckets;
+  // The control bytes, one per bucket, allocated right after the buckets.
+  signed char *Ctrl;
+
+  unsigned NumEntries;
+  unsigned NumTombstones;
+public:
+  typedef KeyT key_type;
+  typedef ValueT mapped_type;
+  typedef BucketT value_type;
+
+  SwissMap(const SwissMap &other) {
+    init(0);
+    CopyFrom(other);
+  }
+
+  /// SwissMap - Create a map with room for NumInitBuckets buckets, which must
+  /// be zero or a power of two.
+  explicit SwissMap(unsigned NumInitBuckets = 0) {
+    init(NumInitBuckets);
+  }
+
+  template<typename InputIt>
+  SwissMap(const InputIt &I, const InputIt &E) {
+    init(0);
+    // Leave room for the maximum load of 7/8.
+    resize(NextPowerOf2(std::distance(I, E) * 8 / 7));
+    insert(I, E);
+  }
+
+  ~SwissMap() {
+    destroyAll();
+    deallocate(Buckets, NumBuckets);
+  }
+
+  typedef SwissMapIterator<KeyT, ValueT, KeyInfoT> iterator;
+  typedef SwissMapIterator<KeyT, ValueT,
+                           KeyInfoT, ValueInfoT, true> const_iterator;
+  inline iterator begin() {
+    // When the map is empty, avoid the overhead of AdvancePastEmptyBuckets().
+    return empty() ? end() : iterator(Buckets, Buckets+NumBuckets, Ctrl);
+  }
+  inline iterator end() {
+    return iterator(Buckets+NumBuckets, Buckets+NumBuckets, 0);
+  }
+  inline const_iterator begin() const {
+    return empty() ? end()
+                   : const_iterator(Buckets, Buckets+NumBuckets, Ctrl);
+  }
+  inline const_iterator end() const {
+    return const_iterator(Buckets+NumBuckets, Buckets+NumBuckets, 0);
+  }
+
+  bool empty() const { return NumEntries == 0; }
+  unsigned size() const { return NumEntries; }
+
+  /// Grow the map so that it has at least Size buckets.  Does not shrink.
+  void resize(size_t Size) {
+    if (Size > NumBuckets)
+      grow(Size);
+  }
+
+  void clear() {
+    if (NumEntries == 0 && NumTombstones == 0) return;
+
+    // If the capacity of the array is huge, and the # elements used is small,
+    // shrink the array.
+    if (NumEntries * 4 < NumBuckets && NumBuckets > 64) {
+      shrink_and_clear();
+      return;
+    }
+
+    destroyAll();
+    memset(Ctrl, Group::Empty, NumBuckets);
+    NumEntries = 0;
+    NumTombstones = 0;
+  }
+
+  /// count - Return true if the specified key is in the map.
+  bool count(const KeyT &Val) const {
+    return LookupBucketFor(Val, getHash(Val)) != 0;
+  }
+
+  iterator find(const KeyT &Val) {
+    if (BucketT *TheBucket = LookupBucketFor(Val, getHash(Val)))
+      return iterator(TheBucket, Buckets+NumBuckets, getCtrl(TheBucket));
+    return end();
+  }
+  const_iterator find(const KeyT &Val) const {
+    if (BucketT *TheBucket = LookupBucketFor(Val, getHash(Val)))
+      return const_iterator(TheBucket, Buckets+NumBuckets,
+                            getCtrl(TheBucket));
+    return end();
+  }
+
+  /// lookup - Return the entry for the specified key, or a default
+  /// constructed value if no such entry exists.
+  ValueT lookup(const KeyT &Val) const {
+    if (BucketT *TheBucket = LookupBucketFor(Val, getHash(Val)))
+      return TheBucket->second;
+    return ValueT();
+  }
+
+  // Inserts key,value pair into the map if the key isn't already in the map.
+  // If the key is already in the map, it returns false and doesn't update the
+  // value.
+  std::pair<iterator, bool> insert(const std::pair<KeyT, ValueT> &KV) {
+    uint64_t Hash = getHash(KV.first);
+    if (BucketT *TheBucket = LookupBucketFor(KV.first, Hash))
+      return std::make_pair(iterator(TheBucket, Buckets+NumBuckets,
+                                     getCtrl(TheBucket)),
+                            false); // Already in map.
+
+    // Otherwise, insert the new element.
+    BucketT *TheBucket = InsertIntoBucket(KV.first, KV.second, Hash);
+    return std::make_pair(iterator(TheBucket, Buckets+NumBuckets,
+                                   getCtrl(TheBucket)),
+                          true);
+  }
+
+  /// insert - Range insertion of pairs.
+  template<typename InputIt>
+  void insert(InputIt I, InputIt E) {
+    for (; I != E; ++I)
+      insert(*I);
+  }
+
+
+  bool erase(const KeyT &Val) {
+    BucketT *TheBucket = LookupBucketFor(Val, getHash(Val));
+    if (!TheBucket)
+      return false; // not in map.
+
+    EraseBucket(TheBucket);
+    return true;
+  }
+  void erase(iterator I) {
+    EraseBucket(&*I);
+  }
+
+  void swap(SwissMap& RHS) {
+    std::swap(NumBuckets, RHS.NumBuckets);
+    std::swap(Buckets, RHS.Buckets);
+    std::swap(Ctrl, RHS.Ctrl);
+    std::swap(NumEntries, RHS.NumEntries);
+    std::swap(NumTombstones, RHS.NumTombstones);
+  }
+
+  value_type& FindAndConstruct(const KeyT &Key) {
+    uint64_t Hash = getHash(Key);
+    if (BucketT *TheBucket = LookupBucketFor(Key, Hash))
+      return *TheBucket;
+
+    return *InsertIntoBucket(Key, ValueT(), Hash);
+  }
+
+  ValueT &operator[](const KeyT &Key) {
+    return FindAndConstruct(Key).second;
+  }
+
+  SwissMap& operator=(const SwissMap& other) {
+    if (&other != this)
+      CopyFrom(other);
+    return *this;
+  }
+
+  /// isPointerIntoBucketsArray - Return true if the specified pointer points
+  /// somewhere into the SwissMap's array of buckets (i.e. either to a key or
+  /// value in the SwissMap).
+  bool isPointerIntoBucketsArray(const void *Ptr) const {
+    return Ptr >= Buckets && Ptr < Buckets+NumBuckets;
+  }
+
+  /// getPointerIntoBucketsArray() - Return an opaque pointer into the buckets
+  /// array.  In conjunction with the previous method, this can be used to
+  /// determine whether an insertion caused the SwissMap to reallocate.
+  const void *getPointerIntoBucketsArray() const { return Buckets; }
+
+  /// getMemorySize - Return the number of bytes the buckets and control bytes
+  /// take up.
+  size_t getMemorySize() const {
+    return NumBuckets * (sizeof(BucketT) + 1);
+  }
+
+private:
+  /// getHash - Scramble the hash of Val with a multiplication by the golden
+  /// ratio, so that the bits used to pick the group and the bits kept in the
+  /// control byte all depend on every bit of the hash.
+  static uint64_t getHash(const KeyT &Val) {
+    return KeyInfoT::getHashValue(Val) * 0x9E3779B97F4A7C15ULL;
+  }
+
+  /// getControlHash - The 7 bits of the hash kept in the control byte.
+  static signed char getControlHash(uint64_t Hash) {
+    return (signed char)(Hash >> 57);
+  }
+
+  /// getFirstGroup - The group the probe sequence for Hash starts at.  These
+  /// bits do not overlap those of the control byte.
+  unsigned getFirstGroup(uint64_t Hash) const {
+    return (unsigned)(Hash >> 25) & (NumBuckets / Group::Width - 1);
+  }
+
+  signed char *getCtrl(const BucketT *B) const {
+    return Ctrl + (B - Buckets);
+  }
+
+  static BucketT *allocate(unsigned N, signed char *&NewCtrl) {
+    char *Mem = static_cast<char*>(operator new(N * (sizeof(BucketT) + 1)));
+    NewCtrl = reinterpret_cast<signed char*>(Mem + N * sizeof(BucketT));
+    memset(NewCtrl, Group::Empty, N);
+    return reinterpret_cast<BucketT*>(Mem);
+  }
+
+  static void deallocate(BucketT *B, unsigned N) {
+    if (N == 0) return;
+#ifndef NDEBUG
+    memset(B, 0x5a, N * (sizeof(BucketT) + 1));
+#endif
+    operator delete(B);
+  }
+
+  /// destroyAll - Destroy the keys and values of all of the full buckets.
+  void destroyAll() {
+    if (isPodLike<KeyT>::value && isPodLike<ValueT>::value)
+      return;
+    for (unsigned i = 0; i != NumBuckets; ++i)
+      if (Ctrl[i] >= 0) {
+        Buckets[i].second.~ValueT();
+        Buckets[i].first.~KeyT();
+      }
+  }
+
+  void CopyFrom(const SwissMap& other) {
+    destroyAll();
+    if (NumBuckets != other.NumBuckets) {
+      deallocate(Buckets, NumBuckets);
+      NumBuckets = other.NumBuckets;
+      if (NumBuckets)
+        Buckets = allocate(NumBuckets, Ctrl);
+      else {
+        Buckets = 0;
+        Ctrl = 0;
+      }
+    }
+
+    NumEntries = other.NumEntries;
+    NumTombstones = other.NumTombstones;
+    if (NumBuckets == 0)
+      return;
+
+    memcpy(Ctrl, other.Ctrl, NumBuckets);
+    if (isPodLike<KeyT>::value && isPodLike<ValueT>::value)
+      memcpy(Buckets, other.Buckets, NumBuckets * sizeof(BucketT));
+    else
+      for (unsigned i = 0; i != NumBuckets; ++i)
+        if (Ctrl[i] >= 0) {
+          new (&Buckets[i].first) KeyT(other.Buckets[i].first);
+          new (&Buckets[i].second) ValueT(other.Buckets[i].second);
+        }
+  }
+
+  /// LookupBucketFor - Return the bucket that holds Val, whose scrambled hash
+  /// is Hash, or null if it is not in the map.
+  BucketT *LookupBucketFor(const KeyT &Val, uint64_t Hash) const {
+    if (NumBuckets == 0)
+      return 0;
+
+    signed char CtrlHash = getControlHash(Hash);
+    unsigned GroupMask = NumBuckets / Group::Width - 1;
+    unsigned GroupNo = getFirstGroup(Hash);
+    for (unsigned ProbeAmt = 1; ; ++ProbeAmt) {
+      unsigned First = GroupNo * Group::Width;
+      for (unsigned Mask = Group::match(Ctrl + First, CtrlHash); Mask;
+           Mask &= Mask - 1) {
+        BucketT *ThisBucket = Buckets + First + CountTrailingZeros_32(Mask);
+        if (KeyInfoT::isEqual(ThisBucket->first, Val))
+          return ThisBucket;
+      }
+
+      // A key is never placed beyond a group that has an empty bucket, so
+      // the key is not in the map.
+      if (Group::matchEmpty(Ctrl + First))
+        return 0;
+
+      // Otherwise, continue quadratic probing over the groups.  With a power
+      // of two number of groups, this visits all of them.
+      GroupNo = (GroupNo + ProbeAmt) & GroupMask;
+    }
+  }
+
+  /// FindInsertSlot - Return the index of the first empty or erased bucket
+  /// along the probe sequence for Hash.
+  unsigned FindInsertSlot(uint64_t Hash) const {
+    unsigned GroupMask = NumBuckets / Group::Width - 1;
+    unsigned GroupNo = getFirstGroup(Hash);
+    for (unsigned ProbeAmt = 1; ; ++ProbeAmt) {
+      unsigned First = GroupNo * Group::Width;
+      if (unsigned Mask = Group::matchEmptyOrDeleted(Ctrl + First))
+        return First + CountTrailingZeros_32(Mask);
+      GroupNo = (GroupNo + ProbeAmt) & GroupMask;
+    }
+  }
+
+  BucketT *InsertIntoBucket(const KeyT &Key, const ValueT &Value,
+                            uint64_t Hash) {
+    unsigned Slot = NumBuckets ? FindInsertSlot(Hash) : 0;
+
+    // Grow the table when a new bucket would take it past 7/8 full, counting
+    // the erased ones, so that lookups always reach a group with an empty
+    // bucket.  Reusing an erased bucket does not change how full it is.  If
+    // much of it is erased, rebuilding it at the same size is enough.
+    if (NumBuckets == 0 ||
+        (Ctrl[Slot] == Group::Empty &&
+         (NumEntries + NumTombstones + 1) * 8 > NumBuckets * 7)) {
+      if (NumBuckets != 0 && (NumEntries + 1) * 16 <= NumBuckets * 7)
+        rehash(NumBuckets);
+      else
+        grow(NumBuckets * 2);
+      Slot = FindInsertSlot(Hash);
+    }
+
+    if (Ctrl[Slot] == Group::Deleted)
+      --NumTombstones;
+    ++NumEntries;
+    Ctrl[Slot] = getControlHash(Hash);
+
+    BucketT *TheBucket = Buckets + Slot;
+    new (&TheBucket->first) KeyT(Key);
+    new (&TheBucket->second) ValueT(Value);
+    return TheBucket;
+  }
+
+  void EraseBucket(BucketT *TheBucket) {
+    TheBucket->second.~ValueT();
+    TheBucket->first.~KeyT();
+    --NumEntries;
+
+    // If the group still has an empty bucket, it has never been full since
+    // the table was last rebuilt, so no probe went past it and the bucket can
+    // simply become empty.  Otherwise a later lookup has to know to go on.
+    unsigned Slot = TheBucket - Buckets;
+    if (Group::matchEmpty(Ctrl + (Slot & ~(Group::Width - 1)))) {
+      Ctrl[Slot] = Group::Empty;
+    } else {
+      Ctrl[Slot] = Group::Deleted;
+      ++NumTombstones;
+    }
+  }
+
+  void init(unsigned InitBuckets) {
+    NumEntries = 0;
+    NumTombstones = 0;
+    NumBuckets = 0;
+    Buckets = 0;
+    Ctrl = 0;
+
+    if (InitBuckets == 0)
+      return;
+
+    assert((InitBuckets & (InitBuckets-1)) == 0 &&
+           "# initial buckets must be a power of two!");
+    NumBuckets = std::max(InitBuckets, (unsigned)Group::Width);
+    Buckets = allocate(NumBuckets, Ctrl);
+  }
+
+  void grow(unsigned AtLeast) {
+    unsigned NewNumBuckets = std::max(NumBuckets, 64U);
+
+    // Double the number of buckets.
+    while (NewNumBuckets < AtLeast)
+      NewNumBuckets <<= 1;
+    rehash(NewNumBuckets);
+  }
+
+  /// rehash - Move all of the entries into a new table with NewNumBuckets
+  /// buckets, leaving the erased buckets behind.
+  void rehash(unsigned NewNumBuckets) {
+    unsigned OldNumBuckets = NumBuckets;
+    BucketT *OldBuckets = Buckets;
+    signed char *OldCtrl = Ctrl;
+
+    NumBuckets = NewNumBuckets;
+    NumTombstones = 0;
+    Buckets = allocate(NumBuckets, Ctrl);
+
+    // Insert all the old elements.
+    for (unsigned i = 0; i != OldNumBuckets; ++i) {
+      if (OldCtrl[i] < 0)
+        continue;
+      BucketT *B = OldBuckets + i;
+      uint64_t Hash = getHash(B->first);
+      unsigned Slot = FindInsertSlot(Hash);
+      Ctrl[Slot] = OldCtrl[i];
+      if (isPodLike<KeyT>::value && isPodLike<ValueT>::value) {
+        memcpy(Buckets + Slot, B, sizeof(BucketT));
+        continue;
+      }
+      new (&Buckets[Slot].first) KeyT(B->first);
+      new (&Buckets[Slot].second) ValueT(B->second);
+
+      // Free the old entry.
+      B->second.~ValueT();
+      B->first.~KeyT();
+    }
+
+    // Free the old table.
+    deallocate(OldBuckets, OldNumBuckets);
+  }
+
+  void shrink_and_clear() {
+    destroyAll();
+    deallocate(Buckets, NumBuckets);
+
+    // Reduce the number of buckets.
+    NumBuckets = NumEntries > 32 ? 1 << (Log2_32_Ceil(NumEntries) + 1)
+                                 : 64;
+    NumEntries = 0;
+    NumTombstones = 0;
+    Buckets = allocate(NumBuckets, Ctrl);
+  }
+};
+
+template<typename KeyT, typename ValueT,
+         typename KeyInfoT, typename ValueInfoT, bool IsConst>
+class SwissMapIterator {
+  typedef std::pair<KeyT, ValueT> Bucket;
+  typedef SwissMapIterator<KeyT, ValueT,
+                           KeyInfoT, ValueInfoT, true> ConstIterator;
+  friend class SwissMapIterator<KeyT, ValueT, KeyInfoT, ValueInfoT, true>;
+public:
+  typedef ptrdiff_t difference_type;
+  typedef typename conditional<IsConst, const Bucket, Bucket>::type value_type;
+  typedef value_type *pointer;
+  typedef value_type &reference;
+  typedef std::forward_iterator_tag iterator_category;
+private:
+  pointer Ptr, End;
+  // The control byte of the bucket Ptr points to.
+  const signed char *Ctrl;
+public:
+  SwissMapIterator() : Ptr(0), End(0), Ctrl(0) {}
+
+  SwissMapIterator(pointer Pos, pointer E, const signed char *C)
+    : Ptr(Pos), End(E), Ctrl(C) {
+    AdvancePastEmptyBuckets();
+  }
+
+  // If IsConst is true this is a converting constructor from iterator to
+  // const_iterator and the default copy constructor is used.
+  // Otherwise this is a copy constructor for iterator.
+  SwissMapIterator(const SwissMapIterator<KeyT, ValueT,
+                                          KeyInfoT, ValueInfoT, false>& I)
+    : Ptr(I.Ptr), End(I.End), Ctrl(I.Ctrl) {}
+
+  reference operator*() const {
+    return *Ptr;
+  }
+  pointer operator->() const {
+    return Ptr;
+  }
+
+  bool operator==(const ConstIterator &RHS) const {
+    return Ptr == RHS.operator->();
+  }
+  bool operator!=(const ConstIterator &RHS) const {
+    return Ptr != RHS.operator->();
+  }
+
+  inline SwissMapIterator& operator++() {  // Preincrement
+    ++Ptr;
+    ++Ctrl;
+    AdvancePastEmptyBuckets();
+    return *this;
+  }
+  SwissMapIterator operator++(int) {  // Postincrement
+    SwissMapIterator tmp = *this; ++*this; return tmp;
+  }
+
+private:
+  void AdvancePastEmptyBuckets() {
+    while (Ptr != End && *Ctrl < 0) {
+      ++Ptr;
+      ++Ctrl;
+    }
+  }
+};
+
+} // end namespace llvm
+
+#endif
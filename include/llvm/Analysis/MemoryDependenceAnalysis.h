@@ -317,9 +317,14 @@ namespace llvm {
     /// set of instructions that either define or clobber the value.
     ///
     /// This method assumes the pointer has a "NonLocal" dependency within BB.
+    ///
+    /// If MaxBlocks is nonzero, the query gives up once it has visited more
+    /// than MaxBlocks blocks, and returns a single clobber of the first
+    /// instruction in BB, as it does when phi translation fails.
     void getNonLocalPointerDependency(const AliasAnalysis::Location &Loc,
                                       bool isLoad, BasicBlock *BB,
-                                    SmallVectorImpl<NonLocalDepResult> &Result);
+                                    SmallVectorImpl<NonLocalDepResult> &Result,
+                                      unsigned MaxBlocks = 0);
 
     /// removeInstruction - Remove an instruction from the dependence analysis,
     /// updating the dependence of instructions that previously depended on it.
@@ -359,6 +364,7 @@ namespace llvm {
                                      bool isLoad, BasicBlock *BB,
                                      SmallVectorImpl<NonLocalDepResult> &Result,
                                      DenseMap<BasicBlock*, Value*> &Visited,
+                                     unsigned MaxBlocks,
                                      bool SkipFirstBlock = false);
     MemDepResult GetNonLocalInfoForBlock(const AliasAnalysis::Location &Loc,
                                          bool isLoad, BasicBlock *BB,
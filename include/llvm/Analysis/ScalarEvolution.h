@@ -31,6 +31,7 @@
 #include "llvm/Support/ConstantRange.h"
 #include "llvm/ADT/FoldingSet.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
 #include <map>
 
 namespace llvm {
@@ -270,7 +271,7 @@ namespace llvm {
 
     /// BackedgeTakenCounts - Cache the backedge-taken count of the loops for
     /// this function as they are computed.
-    std::map<const Loop*, BackedgeTakenInfo> BackedgeTakenCounts;
+    DenseMap<const Loop*, BackedgeTakenInfo> BackedgeTakenCounts;
 
     /// ConstantEvolutionLoopExitValue - This map contains entries for all of
     /// the PHI instructions that we attempt to compute constant evolutions for.
@@ -281,20 +282,25 @@ namespace llvm {
 
     /// ValuesAtScopes - This map contains entries for all the expressions
     /// that we attempt to compute getSCEVAtScope information for, which can
-    /// be expensive in extreme cases.
-    std::map<const SCEV *,
-             std::map<const Loop *, const SCEV *> > ValuesAtScopes;
+    /// be expensive in extreme cases.  An expression is only ever asked about
+    /// at the few loops that enclose it, so the scopes of each expression are
+    /// kept in a small vector that is searched linearly.
+    DenseMap<const SCEV *,
+             SmallVector<std::pair<const Loop *, const SCEV *>, 2> >
+      ValuesAtScopes;
 
     /// LoopDispositions - Memoized computeLoopDisposition results.
-    std::map<const SCEV *,
-             std::map<const Loop *, LoopDisposition> > LoopDispositions;
+    DenseMap<const SCEV *,
+             SmallVector<std::pair<const Loop *, LoopDisposition>, 2> >
+      LoopDispositions;
 
     /// computeLoopDisposition - Compute a LoopDisposition value.
     LoopDisposition computeLoopDisposition(const SCEV *S, const Loop *L);
 
     /// BlockDispositions - Memoized computeBlockDisposition results.
-    std::map<const SCEV *,
-             std::map<const BasicBlock *, BlockDisposition> > BlockDispositions;
+    DenseMap<const SCEV *,
+             SmallVector<std::pair<const BasicBlock *, BlockDisposition>, 2> >
+      BlockDispositions;
 
     /// computeBlockDisposition - Compute a BlockDisposition value.
     BlockDisposition computeBlockDisposition(const SCEV *S, const BasicBlock *BB);
@@ -346,9 +346,12 @@ class Archive {
     /// there is purposefully no interface provided by Archive to look up
     /// members by their offset. Use the findModulesDefiningSymbols and
     /// findModuleDefiningSymbol methods instead.
+    /// If the archive was written with a hashed symbol table, lookups are
+    /// done directly in the mapped file and the std::map is only built the
+    /// first time this method is called.
     /// @returns the Archive's symbol table.
     /// @brief Get the archive's symbol table
-    const SymTabType& getSymbolTable() { return symTab; }
+    const SymTabType& getSymbolTable();
 
     /// This method returns the offset in the archive file to the first "real"
     /// file member. Archive files, on disk, have a signature and might have a
@@ -481,6 +484,18 @@ class Archive {
     /// @brief Load just the symbol table.
     bool loadSymbolTable(std::string* ErrMessage);
 
+    /// @param symbol The symbol to look up
+    /// @param offset Set to the symbol's offset from the first file member
+    /// @returns true if the symbol was found
+    /// @brief Look up \p symbol in whichever symbol table is loaded.
+    bool lookupSymbol(const std::string& symbol, unsigned& offset);
+
+    /// @returns true if a symbol table with at least one symbol is loaded.
+    /// @brief Determine if there are any symbols to look up.
+    bool hasSymbols() const {
+      return hashedSymTabSymbols != 0 || !symTab.empty();
+    }
+
     /// @brief Write the symbol table to an ofstream.
     void writeSymbolTable(std::ofstream& ARFile);
 
@@ -527,6 +542,9 @@ class Archive {
     SymTabType symTab;        ///< The symbol table
     std::string strtab;       ///< The string table for long file names
     unsigned symTabSize;      ///< Size in bytes of symbol table
+    const char* hashedSymTab; ///< Hashed symbol table in the mapped file
+    unsigned hashedSymTabBuckets; ///< Number of buckets in hashedSymTab
+    unsigned hashedSymTabSymbols; ///< Number of symbols in hashedSymTab
     unsigned firstFileOffset; ///< Offset to first normal file.
     ModuleMap modules;        ///< The modules loaded via symbol lookup.
     ArchiveMember* foreignST; ///< This holds the foreign symbol table.
@@ -15,7 +15,9 @@
 #ifndef BITSTREAM_READER_H
 #define BITSTREAM_READER_H
 
+#include "llvm/ADT/OwningPtr.h"
 #include "llvm/Bitcode/BitCodes.h"
+#include "llvm/Support/StreamableMemoryObject.h"
 #include <climits>
 #include <string>
 #include <vector>
@@ -36,8 +38,12 @@ public:
     std::vector<std::pair<unsigned, std::string> > RecordNames;
   };
 private:
-  /// FirstChar/LastChar - This remembers the first and last bytes of the
-  /// stream.
+  /// BitcodeBytes - The bytes of the stream, which may be fetched lazily.
+  OwningPtr<StreamableMemoryObject> BitcodeBytes;
+
+  /// FirstChar/LastChar - If the whole stream is in memory, this remembers the
+  /// first and last bytes of it so that cursors can read it directly.  Both
+  /// are null for a streamed object.
   const unsigned char *FirstChar, *LastChar;
   
   std::vector<BlockInfo> BlockInfoRecords;
@@ -58,10 +64,23 @@ public:
     init(Start, End);
   }
 
+  /// BitstreamReader - Read from a possibly streamed object, taking ownership
+  /// of it.
+  explicit BitstreamReader(StreamableMemoryObject *Bytes) {
+    IgnoreBlockInfoNames = true;
+    init(Bytes);
+  }
+
   void init(const unsigned char *Start, const unsigned char *End) {
     FirstChar = Start;
     LastChar = End;
     assert(((End-Start) & 3) == 0 &&"Bitcode stream not a multiple of 4 bytes");
+    BitcodeBytes.reset(getNonStreamedMemoryObject(Start, End));
+  }
+
+  void init(StreamableMemoryObject *Bytes) {
+    FirstChar = LastChar = 0;
+    BitcodeBytes.reset(Bytes);
   }
 
   ~BitstreamReader() {
@@ -76,9 +95,44 @@ public:
     }
   }
   
+  StreamableMemoryObject &getBitcodeBytes() const { return *BitcodeBytes; }
+
+  /// isInMemory - Return true if the whole stream is available in memory, in
+  /// which case getFirstChar/getLastChar delimit it.
+  bool isInMemory() const { return FirstChar != 0; }
   const unsigned char *getFirstChar() const { return FirstChar; }
   const unsigned char *getLastChar() const { return LastChar; }
 
+  /// isEndPos - Return true if Pos is one past the last byte of the stream.
+  bool isEndPos(size_t Pos) const {
+    if (FirstChar)
+      return FirstChar + Pos == LastChar;
+    return BitcodeBytes->isObjectEnd(static_cast<uint64_t>(Pos));
+  }
+
+  /// canSkipToPos - Return true if Pos is within the stream or one byte past
+  /// its end.  For a streamed object this may block until Pos has arrived.
+  bool canSkipToPos(size_t Pos) const {
+    if (FirstChar)
+      return Pos <= size_t(LastChar - FirstChar);
+    return Pos == 0 ||
+           BitcodeBytes->isValidAddress(static_cast<uint64_t>(Pos - 1));
+  }
+
+  /// getWord - Return the little-endian 32-bit word at byte offset Pos.
+  uint32_t getWord(size_t Pos) const {
+    const unsigned char *P;
+    unsigned char Buf[4];
+    if (FirstChar) {
+      P = FirstChar + Pos;
+    } else {
+      Buf[0] = Buf[1] = Buf[2] = Buf[3] = 0xFF;
+      BitcodeBytes->readBytes(Pos, sizeof(Buf), Buf, 0);
+      P = Buf;
+    }
+    return (P[0] << 0) | (P[1] << 8) | (P[2] << 16) | (P[3] << 24);
+  }
+
   /// CollectBlockInfoNames - This is called by clients that want block/record
   /// name information.
   void CollectBlockInfoNames() { IgnoreBlockInfoNames = false; }
@@ -122,7 +176,9 @@ public:
 class BitstreamCursor {
   friend class Deserializer;
   BitstreamReader *BitStream;
-  const unsigned char *NextChar;
+
+  /// NextChar - The byte offset of the next word to read from the stream.
+  size_t NextChar;
   
   /// CurWord - This is the current data we have pulled from the stream but have
   /// not returned to the client.
@@ -156,8 +212,7 @@ public:
   }
   
   explicit BitstreamCursor(BitstreamReader &R) : BitStream(&R) {
-    NextChar = R.getFirstChar();
-    assert(NextChar && "Bitstream not initialized yet");
+    NextChar = 0;
     CurWord = 0;
     BitsInCurWord = 0;
     CurCodeSize = 2;
@@ -167,8 +222,7 @@ public:
     freeState();
     
     BitStream = &R;
-    NextChar = R.getFirstChar();
-    assert(NextChar && "Bitstream not initialized yet");
+    NextChar = 0;
     CurWord = 0;
     BitsInCurWord = 0;
     CurCodeSize = 2;
@@ -225,12 +279,18 @@ public:
   unsigned GetAbbrevIDWidth() const { return CurCodeSize; }
   
   bool AtEndOfStream() const {
-    return NextChar == BitStream->getLastChar() && BitsInCurWord == 0;
+    return BitsInCurWord == 0 && BitStream->isEndPos(NextChar);
   }
   
   /// GetCurrentBitNo - Return the bit # of the bit we are reading.
   uint64_t GetCurrentBitNo() const {
-    return (NextChar-BitStream->getFirstChar())*CHAR_BIT - BitsInCurWord;
+    return NextChar*CHAR_BIT - BitsInCurWord;
+  }
+
+  /// canSkipToPos - Return true if the specified byte offset is within the
+  /// stream or one byte past its end.
+  bool canSkipToPos(size_t Pos) const {
+    return BitStream->canSkipToPos(Pos);
   }
   
   BitstreamReader *getBitStreamReader() {
@@ -245,12 +305,10 @@ public:
   void JumpToBit(uint64_t BitNo) {
     uintptr_t ByteNo = uintptr_t(BitNo/8) & ~3;
     uintptr_t WordBitNo = uintptr_t(BitNo) & 31;
-    assert(ByteNo <= (uintptr_t)(BitStream->getLastChar()-
-                                 BitStream->getFirstChar()) &&
-           "Invalid location");
+    assert(canSkipToPos(ByteNo) && "Invalid location");
     
     // Move the cursor to the right word.
-    NextChar = BitStream->getFirstChar()+ByteNo;
+    NextChar = ByteNo;
     BitsInCurWord = 0;
     CurWord = 0;
     
@@ -271,7 +329,7 @@ public:
     }
 
     // If we run out of data, stop at the end of the stream.
-    if (NextChar == BitStream->getLastChar()) {
+    if (BitStream->isEndPos(NextChar)) {
       CurWord = 0;
       BitsInCurWord = 0;
       return 0;
@@ -280,8 +338,7 @@ public:
     unsigned R = CurWord;
 
     // Read the next word from the stream.
-    CurWord = (NextChar[0] <<  0) | (NextChar[1] << 8) |
-              (NextChar[2] << 16) | (NextChar[3] << 24);
+    CurWord = BitStream->getWord(NextChar);
     NextChar += 4;
 
     // Extract NumBits-BitsInCurWord from what we just read.
@@ -375,10 +432,11 @@ public:
 
     // Check that the block wasn't partially defined, and that the offset isn't
     // bogus.
-    if (AtEndOfStream() || NextChar+NumWords*4 > BitStream->getLastChar())
+    size_t SkipTo = NextChar + NumWords*4;
+    if (AtEndOfStream() || !canSkipToPos(SkipTo))
       return true;
 
-    NextChar += NumWords*4;
+    NextChar = SkipTo;
     return false;
   }
 
@@ -407,7 +465,7 @@ public:
 
     // Validate that this block is sane.
     if (CurCodeSize == 0 || AtEndOfStream() ||
-        NextChar+NumWords*4 > BitStream->getLastChar())
+        !canSkipToPos(NextChar + NumWords*4))
       return true;
 
     return false;
@@ -509,24 +567,28 @@ public:
         SkipToWord();  // 32-bit alignment
 
         // Figure out where the end of this blob will be including tail padding.
-        const unsigned char *NewEnd = NextChar+((NumElts+3)&~3);
+        size_t NewEnd = NextChar+((NumElts+3)&~3);
         
         // If this would read off the end of the bitcode file, just set the
         // record to empty and return.
-        if (NewEnd > BitStream->getLastChar()) {
+        if (!canSkipToPos(NewEnd)) {
           Vals.append(NumElts, 0);
-          NextChar = BitStream->getLastChar();
+          NextChar = BitStream->getBitcodeBytes().getExtent();
           break;
         }
         
         // Otherwise, read the number of bytes.  If we can return a reference to
         // the data, do so to avoid copying it.
         if (BlobStart) {
-          *BlobStart = (const char*)NextChar;
+          *BlobStart = (const char*)BitStream->getBitcodeBytes().getPointer(
+              NextChar, NumElts);
           *BlobLen = NumElts;
         } else {
-          for (; NumElts; ++NextChar, --NumElts)
-            Vals.push_back(*NextChar);
+          for (; NumElts; ++NextChar, --NumElts) {
+            uint8_t Byte;
+            BitStream->getBitcodeBytes().readByte(NextChar, &Byte);
+            Vals.push_back(Byte);
+          }
         }
         // Skip over tail padding.
         NextChar = NewEnd;
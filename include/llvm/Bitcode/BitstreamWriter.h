@@ -173,6 +173,19 @@ public:
     Out[ByteNo  ] = (unsigned char)(NewWord >> 24);
   }
 
+  // BackpatchWordAtBit - Backpatch a 32-bit field that starts at an arbitrary
+  // bit position.  The field must already have been flushed to the output.
+  void BackpatchWordAtBit(uint64_t BitNo, uint32_t NewWord) {
+    assert(BitNo + 32 <= Out.size() * 8 && "Field not flushed yet!");
+    for (unsigned i = 0; i != 32; ++i, ++BitNo) {
+      unsigned char Mask = (unsigned char)(1 << (BitNo & 7));
+      if (NewWord & (1U << i))
+        Out[BitNo / 8] |= Mask;
+      else
+        Out[BitNo / 8] &= ~Mask;
+    }
+  }
+
   //===--------------------------------------------------------------------===//
   // Block Manipulation
   //===--------------------------------------------------------------------===//
@@ -251,6 +264,42 @@ public:
     BlockScope.pop_back();
   }
 
+  /// EmitEncodedBlock - Emit a block that was encoded by another
+  /// BitstreamWriter with the same BLOCKINFO abbrevs.  [Begin, End) holds
+  /// that block from its size word through its END_BLOCK; none of this depends
+  /// on where the block is placed.  The header in front of it depends on the
+  /// enclosing block's code size, so it is emitted again here.
+  void EmitEncodedBlock(unsigned BlockID, unsigned CodeLen,
+                        const unsigned char *Begin, const unsigned char *End) {
+    assert(((End-Begin) & 3) == 0 && "Encoded block is not word aligned!");
+    EmitCode(bitc::ENTER_SUBBLOCK);
+    EmitVBR(BlockID, bitc::BlockIDWidth);
+    EmitVBR(CodeLen, bitc::CodeLenWidth);
+    FlushToWord();
+    Out.insert(Out.end(), Begin, End);
+  }
+
+  /// CopyBlockInfo - Take on the BLOCKINFO abbrevs of another writer without
+  /// emitting a BLOCKINFO_BLOCK, so that the blocks encoded here can be passed
+  /// to its EmitEncodedBlock.  The abbrevs are cloned rather than shared, as
+  /// their reference counts are not thread safe.
+  void CopyBlockInfo(const BitstreamWriter &From) {
+    assert(BlockInfoRecords.empty() && "Already have blockinfo!");
+    for (unsigned i = 0,
+         e = static_cast<unsigned>(From.BlockInfoRecords.size()); i != e; ++i) {
+      const BlockInfo &FromInfo = From.BlockInfoRecords[i];
+      BlockInfo &Info = getOrCreateBlockInfo(FromInfo.BlockID);
+      for (unsigned j = 0, je = static_cast<unsigned>(FromInfo.Abbrevs.size());
+           j != je; ++j) {
+        const BitCodeAbbrev *Abbv = FromInfo.Abbrevs[j];
+        BitCodeAbbrev *Copy = new BitCodeAbbrev();
+        for (unsigned k = 0, ke = Abbv->getNumOperandInfos(); k != ke; ++k)
+          Copy->Add(Abbv->getOperandInfo(k));
+        Info.Abbrevs.push_back(Copy);
+      }
+    }
+  }
+
   //===--------------------------------------------------------------------===//
   // Record Emission
   //===--------------------------------------------------------------------===//
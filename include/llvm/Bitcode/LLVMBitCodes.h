@@ -35,7 +35,8 @@ namespace bitc {
     TYPE_SYMTAB_BLOCK_ID,
     VALUE_SYMTAB_BLOCK_ID,
     METADATA_BLOCK_ID,
-    METADATA_ATTACHMENT_ID
+    METADATA_ATTACHMENT_ID,
+    FUNCTION_INDEX_BLOCK_ID
   };
 
 
@@ -62,7 +63,23 @@ namespace bitc {
     /// MODULE_CODE_PURGEVALS: [numvals]
     MODULE_CODE_PURGEVALS   = 10,
 
-    MODULE_CODE_GCNAME      = 11   // GCNAME: [strchr x N]
+    MODULE_CODE_GCNAME      = 11,  // GCNAME: [strchr x N]
+
+    /// MODULE_CODE_FUNCINDEX: [offset_lo32, offset_hi32]
+    /// Distance in bits from the end of this record to the start of the
+    /// FUNCTION_INDEX block.  Both fields are fixed-width so the writer can
+    /// backpatch them once the function bodies have been emitted.
+    MODULE_CODE_FUNCINDEX   = 12
+  };
+
+  /// FUNCTION_INDEX blocks record where each function body starts, so that a
+  /// lazy reader does not have to walk every FUNCTION_BLOCK to find them.
+  enum FunctionIndexCodes {
+    // OFFSETS: [bitdelta x N]  One entry per function body, in the order the
+    // bodies appear.  The first entry is the distance from the end of the
+    // MODULE_CODE_FUNCINDEX record to the first FUNCTION_BLOCK, and each
+    // subsequent entry is the distance from the previous FUNCTION_BLOCK.
+    FUNCINDEX_CODE_OFFSETS = 1
   };
 
   /// PARAMATTR blocks have code for defining a parameter attribute set.
@@ -21,6 +21,7 @@ namespace llvm {
   class MemoryBuffer;
   class ModulePass;
   class BitstreamWriter;
+  class DataStreamer;
   class LLVMContext;
   class raw_ostream;
   
@@ -33,6 +34,17 @@ namespace llvm {
                                LLVMContext& Context,
                                std::string *ErrMsg = 0);
 
+  /// getStreamedBitcodeModule - Read the module header from a streamer which
+  /// supplies the bitcode incrementally, and prepare for lazy deserialization
+  /// of function bodies.  Parsing starts before all of the bytes have
+  /// arrived.  This always takes ownership of the streamer.  On error, this
+  /// returns null and fills in *ErrMsg with an error description if ErrMsg is
+  /// non-null.
+  Module *getStreamedBitcodeModule(const std::string &name,
+                                   DataStreamer *streamer,
+                                   LLVMContext &Context,
+                                   std::string *ErrMsg = 0);
+
   /// getBitcodeTargetTriple - Read the header of the specified bitcode
   /// buffer and extract just the triple information. If successful,
   /// this returns a string and *does not* take ownership
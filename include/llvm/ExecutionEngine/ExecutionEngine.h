@@ -34,6 +34,7 @@ class ExecutionEngine;
 class Function;
 class GlobalVariable;
 class GlobalValue;
+class JITCodeCache;
 class JITEventListener;
 class JITMemoryManager;
 class MachineCodeInfo;
@@ -105,6 +106,9 @@ class ExecutionEngine {
   /// Whether lazy JIT compilation is enabled.
   bool CompilingLazily;
 
+  /// Whether the JIT compiles predicted callees on a background thread.
+  bool CompilingInBackground;
+
   /// Whether JIT compilation of external global variables is allowed.
   bool GVCompilationDisabled;
 
@@ -375,6 +379,40 @@ public:
     return !CompilingLazily;
   }
 
+  /// EnableBackgroundCompilation - When background compilation is on and the
+  /// JIT is compiling lazily, every function the JIT compiles has its direct
+  /// callees queued up for compilation on a background thread, and their lazy
+  /// stubs are rewritten to jump straight to the new code.  A call through a
+  /// stub then only waits for the compiler if the background thread has not
+  /// got to the callee yet.  The same threading rules as for lazy compilation
+  /// apply.
+  void EnableBackgroundCompilation(bool Enabled = true) {
+    CompilingInBackground = Enabled;
+  }
+  bool isCompilingInBackground() const {
+    return CompilingInBackground;
+  }
+
+  /// EnableTieredCompilation - When tiered compilation is on, the JIT first
+  /// compiles each function quickly at CodeGenOpt::None, with a counter on
+  /// its entry.  Once a function has been entered Threshold times, it is
+  /// recompiled at the engine's optimization level on a background thread,
+  /// and the old code is patched to jump to the new code.  This must be
+  /// called before any code is generated.  Engines that do not support it
+  /// ignore it.
+  ///
+  /// Because the recompilation runs on another thread while the program
+  /// runs, a threaded program must follow the same rules as for lazy
+  /// compilation: any thread modifying LLVM IR must hold the JIT's lock.
+  virtual void EnableTieredCompilation(unsigned Threshold) {}
+
+  /// setCodeCache - Use Cache to look up the machine code for the engine's
+  /// module before generating it, and to save newly generated code for later
+  /// processes.  The engine does not take ownership of the cache.  This must
+  /// be called before any code is generated.  Only engines that produce
+  /// relocatable objects (the MCJIT) support it; the others ignore it.
+  virtual void setCodeCache(JITCodeCache *Cache) {}
+
   /// DisableGVCompilation - If called, the JIT will abort if it's asked to
   /// allocate space and populate a GlobalVariable that is not internal to
   /// the module.
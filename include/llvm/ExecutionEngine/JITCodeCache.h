@@ -0,0 +1,95 @@
+//===-- JITCodeCache.h - Persistent cache of JIT'd object files -*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the JITCodeCache class, which stores the relocatable
+// object files produced by a JIT in a directory on disk so that a later
+// process compiling the same module for the same target can load them
+// through the RuntimeDyld instead of running code generation again.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_EXECUTION_ENGINE_JIT_CODE_CACHE_H
+#define LLVM_EXECUTION_ENGINE_JIT_CODE_CACHE_H
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/DataTypes.h"
+#include "llvm/Target/TargetMachine.h"
+#include <string>
+
+namespace llvm {
+
+class MemoryBuffer;
+class Module;
+
+/// JITCodeCache - A directory of cached object files, one per key.  Each
+/// entry starts with a small header holding a magic number, a format version,
+/// the full key and the size and checksum of the object that follows, so that
+/// truncated, corrupted or colliding entries are detected and thrown away
+/// instead of being handed to the dynamic linker.  The total size of the
+/// directory is kept under a limit by removing the least recently written
+/// entries whenever a new one is stored.
+///
+/// A cache may be shared by several processes: entries are written to a
+/// temporary file and renamed into place, so readers never see a partially
+/// written entry.
+class JITCodeCache {
+  std::string Dir;
+  uint64_t MaxSize;
+
+  JITCodeCache(const JITCodeCache &);  // DO NOT IMPLEMENT
+  void operator=(const JITCodeCache &); // DO NOT IMPLEMENT
+
+  /// getPathForKey - Return the file name of the entry for Key.
+  std::string getPathForKey(StringRef Key) const;
+
+  /// pruneExcept - Like prune, but never removes the entry at path Keep.
+  void pruneExcept(StringRef Keep);
+
+public:
+  /// JITCodeCache - Create a cache in directory Dir, which is created if it
+  /// does not exist.  If MaxSize is nonzero, the entries in the directory are
+  /// pruned to at most MaxSize bytes in total after each store.
+  explicit JITCodeCache(StringRef Dir, uint64_t MaxSize = 0);
+
+  /// getKey - Compute the cache key for compiling M with the given target
+  /// options.  The key covers the contents of the module as well as
+  /// everything that affects the generated code, including the options in
+  /// TargetOptions.h and the version of LLVM, so any change to either
+  /// results in a miss.
+  static std::string getKey(const Module &M, StringRef Triple, StringRef CPU,
+                            const SmallVectorImpl<std::string> &Attrs,
+                            CodeGenOpt::Level OptLevel,
+                            CodeModel::Model CMModel);
+
+  /// lookup - Return the object stored under Key, or null if there is none.
+  /// An entry that fails validation is removed from the cache and treated as
+  /// a miss.  The caller takes ownership of the returned buffer.
+  MemoryBuffer *lookup(StringRef Key);
+
+  /// store - Save Object under Key, replacing any existing entry, and prune
+  /// the cache if it has grown past its size limit.  Returns true on error,
+  /// in which case ErrMsg (if non-null) describes it.  Failing to store an
+  /// entry is never fatal to the JIT; the object is simply not cached.
+  bool store(StringRef Key, StringRef Object, std::string *ErrMsg = 0);
+
+  /// prune - Remove the least recently written entries until the cache is
+  /// no larger than its size limit.
+  void prune();
+
+  /// getSize - Return the total size in bytes of the entries in the cache.
+  uint64_t getSize() const;
+
+  StringRef getDirectory() const { return Dir; }
+  uint64_t getMaxSize() const { return MaxSize; }
+};
+
+} // End llvm namespace
+
+#endif
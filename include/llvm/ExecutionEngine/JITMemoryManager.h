@@ -18,6 +18,41 @@ namespace llvm {
   class Function;
   class GlobalValue;
 
+/// JITMemoryStats - A snapshot of the memory held by a JITMemoryManager.
+struct JITMemoryStats {
+  /// CodeBytes - Bytes mapped for function bodies and exception tables.
+  uint64_t CodeBytes;
+
+  /// LiveCodeBytes - The part of CodeBytes used by functions and exception
+  /// tables that have not been freed.
+  uint64_t LiveCodeBytes;
+
+  /// StubBytes - Bytes mapped for function stubs.
+  uint64_t StubBytes;
+
+  /// DataBytes - Bytes allocated for globals and other data.
+  uint64_t DataBytes;
+
+  /// NumRegions - The number of separately freeable regions code is grouped
+  /// into.
+  unsigned NumRegions;
+
+  JITMemoryStats()
+    : CodeBytes(0), LiveCodeBytes(0), StubBytes(0), DataBytes(0),
+      NumRegions(0) {}
+
+  /// getResidentBytes - Total bytes held by the memory manager.
+  uint64_t getResidentBytes() const {
+    return CodeBytes + StubBytes + DataBytes;
+  }
+
+  /// getFragmentation - The fraction of code memory that holds no live code,
+  /// either because it was freed or because it is lost to page rounding.
+  double getFragmentation() const {
+    return CodeBytes ? double(CodeBytes - LiveCodeBytes) / CodeBytes : 0.0;
+  }
+};
+
 /// JITMemoryManager - This interface is used by the JIT to allocate and manage
 /// memory for the code generated by the JIT.  This can be reimplemented by
 /// clients that have a strong desire to control how the layout of JIT'd memory
@@ -34,6 +69,15 @@ public:
   /// JIT Memory Manager if the client does not provide one to the JIT.
   static JITMemoryManager *CreateDefaultMemManager();
 
+  /// CreateRegionMemManager - Create a memory manager that allocates the code
+  /// of each module from its own page-aligned regions.  Code pages are
+  /// writable while a function is emitted into them and executable once it
+  /// is finished, never both, and a module's regions are returned to the OS
+  /// as soon as all of its functions have been freed.  Function stubs, which
+  /// the JIT rewrites while the program runs, are kept in separate writable
+  /// and executable memory.  Globals must not be allocated with code.
+  static JITMemoryManager *CreateRegionMemManager();
+
   /// setMemoryWritable - When code generation is in progress,
   /// the code pages may need permissions changed.
   virtual void setMemoryWritable() = 0;
@@ -42,6 +86,21 @@ public:
   /// start execution, the code pages may need permissions changed.
   virtual void setMemoryExecutable() = 0;
 
+  /// allowsCodePatching - Return false if emitted code is not writable, in
+  /// which case the JIT does not rewrite already-emitted functions in place
+  /// (for example to forward an old version of a recompiled function to the
+  /// new one) and only redirects future calls to them.
+  virtual bool allowsCodePatching() const {
+    return true;
+  }
+
+  /// getMemoryStats - Fill in Stats with the memory currently held by the
+  /// memory manager.  Returns false if the memory manager does not keep
+  /// track of it.
+  virtual bool getMemoryStats(JITMemoryStats &Stats) {
+    return false;
+  }
+
   /// setPoisonMemory - Setting this flag to true makes the memory manager
   /// garbage values over freed memory.  This is useful for testing and
   /// debugging, and may be turned on by default in debug mode.
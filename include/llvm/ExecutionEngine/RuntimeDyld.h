@@ -16,6 +16,7 @@
 
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/Memory.h"
+#include <string>
 
 namespace llvm {
 
@@ -44,6 +45,14 @@ public:
   // memory was actually used.
   virtual void endFunctionBody(const char *Name, uint8_t *FunctionStart,
                                uint8_t *FunctionEnd) = 0;
+
+  // Return the address of the named symbol, which the loaded objects refer to
+  // but do not define. If AbortOnFailure is false, return null if the symbol
+  // cannot be found.
+  virtual void *getPointerToNamedFunction(const std::string &Name,
+                                          bool AbortOnFailure = true) {
+    return 0;
+  }
 };
 
 class RuntimeDyld {
@@ -62,7 +71,8 @@ public:
   // be the address used for relocation (clients can copy the data around
   // and resolve relocatons based on where they put it).
   void *getSymbolAddress(StringRef Name);
-  // Resolve the relocations for all symbols we currently know about.
+  // Resolve the relocations that have not been resolved yet. Symbols that no
+  // loaded object defines are looked up with the memory manager.
   void resolveRelocations();
   // Change the address associated with a symbol when resolving relocations.
   // Any relocations already associated with the symbol will be re-resolved.
@@ -106,6 +106,27 @@ private:
   Module *M;
 };
 
+/// runFunctionPassesInParallel - Run a pipeline of function passes over every
+/// function definition in M, on up to NumThreads threads at once.  Populate is
+/// called on the calling thread once for each thread, and must add the same
+/// pipeline to the (empty) FunctionPassManager it is given each time; Data is
+/// passed through to it.  The initializers and finalizers of the passes run
+/// on the calling thread, and the functions are handed out to the threads in
+/// module order as they become free.
+///
+/// The passes may create and use constants, types, metadata and declarations,
+/// but must not walk the use lists of values shared between functions or
+/// change anything outside the function they run on.  Many passes do walk
+/// them, for instance to see whether a global has a single use, so only
+/// pipelines which have been checked for this may be run here.  This calls
+/// llvm_start_multithreaded() if needed; if it fails or NumThreads is at most
+/// one, the pipeline runs on the calling thread.  Returns true if any pass
+/// changed the module.
+bool runFunctionPassesInParallel(Module &M, unsigned NumThreads,
+                                 void (*Populate)(FunctionPassManager &FPM,
+                                                  void *Data),
+                                 void *Data);
+
 } // End llvm namespace
 
 #endif
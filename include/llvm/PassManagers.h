@@ -15,6 +15,7 @@
 #define LLVM_PASSMANAGERS_H
 
 #include "llvm/Pass.h"
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/DenseMap.h"
@@ -91,6 +92,7 @@
 #include "llvm/Support/PrettyStackTrace.h"
 
 namespace llvm {
+  class Function;
   class Module;
   class Pass;
   class StringRef;
@@ -455,6 +457,33 @@ public:
 
 Timer *getPassTimer(Pass *);
 
+class PassReportRun;
+
+/// PassReportRegion - Record one run of a pass over a module, a function or
+/// the functions of a call graph SCC in the report requested with
+/// -pass-report: the time it takes, how much the heap grows, and the number
+/// of instructions in the unit before and after.  This does nothing if no
+/// report was requested, or if the pass is a pass manager.
+class PassReportRegion {
+  PassReportRun *Run;
+  PassReportRegion(const PassReportRegion &);   // DO NOT IMPLEMENT
+  void operator=(const PassReportRegion &);     // DO NOT IMPLEMENT
+public:
+  PassReportRegion(Pass *P, Module &M);
+  PassReportRegion(Pass *P, Function &F);
+  PassReportRegion(Pass *P, ArrayRef<Function*> SCC);
+  ~PassReportRegion();
+
+  /// setSCCFunctions - Set the functions of the SCC to count the instructions
+  /// of at the end of the run, since the pass may have replaced some of them.
+  void setSCCFunctions(ArrayRef<Function*> SCC);
+};
+
+/// writePassReport - Write out the report requested with -pass-report, if
+/// any, with every pass run recorded so far.  The pass managers do this when
+/// they finish running over a module, so there is usually no need to call it.
+void writePassReport();
+
 }
 
 #endif
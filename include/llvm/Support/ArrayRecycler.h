@@ -0,0 +1,126 @@
+//==- llvm/Support/ArrayRecycler.h - Recycling of Arrays ---------*- C++ -*-==//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the ArrayRecycler class template which can recycle small
+// arrays allocated from one of the allocators in Allocator.h
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_ARRAYRECYCLER_H
+#define LLVM_SUPPORT_ARRAYRECYCLER_H
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/AlignOf.h"
+#include "llvm/Support/DataTypes.h"
+#include "llvm/Support/MathExtras.h"
+#include <cassert>
+
+namespace llvm {
+
+/// ArrayRecycler - Recycle arrays of T whose capacity is a power of two.
+/// Freed arrays are kept on one free list per capacity, so allocating an
+/// array only goes to the allocator when no array of the same capacity has
+/// been freed.
+///
+/// Arrays are allocated uninitialized; the caller constructs and destroys
+/// the elements.
+///
+template<class T, size_t Align = AlignOf<T>::Alignment>
+class ArrayRecycler {
+  /// FreeList - A freed array is threaded onto the free list for its
+  /// capacity through its first element.
+  struct FreeList {
+    FreeList *Next;
+  };
+
+  /// Bucket - The free list for each capacity, indexed by log2(capacity).
+  SmallVector<FreeList*, 8> Bucket;
+
+  /// pop - Remove an array from free list Idx, or return null.
+  T *pop(unsigned Idx) {
+    if (Idx >= Bucket.size())
+      return 0;
+    FreeList *Entry = Bucket[Idx];
+    if (!Entry)
+      return 0;
+    Bucket[Idx] = Entry->Next;
+    return reinterpret_cast<T*>(Entry);
+  }
+
+  /// push - Add an array to free list Idx.
+  void push(unsigned Idx, T *Ptr) {
+    assert(Ptr && "Cannot recycle a null array");
+    FreeList *Entry = reinterpret_cast<FreeList*>(Ptr);
+    if (Idx >= Bucket.size())
+      Bucket.resize(size_t(Idx) + 1);
+    Entry->Next = Bucket[Idx];
+    Bucket[Idx] = Entry;
+  }
+
+public:
+  /// Capacity - The capacity of an allocated array. It is stored as a single
+  /// byte, which callers can keep next to their array pointer.
+  class Capacity {
+    uint8_t Index;
+    explicit Capacity(uint8_t idx) : Index(idx) {}
+
+  public:
+    Capacity() : Index(0) {}
+
+    /// get - Return the smallest capacity that can hold N elements.
+    static Capacity get(size_t N) {
+      return Capacity(N ? Log2_64_Ceil(N) : 0);
+    }
+
+    /// getSize - Return the number of elements this capacity can hold.
+    size_t getSize() const { return size_t(1u) << Index; }
+
+    /// getBucket - Return the free list index for this capacity.
+    unsigned getBucket() const { return Index; }
+
+    /// getNext - Return the next larger capacity, twice as large.
+    Capacity getNext() const { return Capacity(Index + 1); }
+  };
+
+  ~ArrayRecycler() {
+    // The free lists only hold on to memory owned by the allocator, so if
+    // this fails, clear() was not called before the allocator went away.
+    assert(Bucket.empty() && "Non-empty ArrayRecycler deleted!");
+  }
+
+  /// clear - Release all the tracked allocations to the allocator. The
+  /// recycler must be free of any tracked allocations before being deleted.
+  template<class AllocatorType>
+  void clear(AllocatorType &Allocator) {
+    for (; !Bucket.empty(); Bucket.pop_back())
+      while (T *Ptr = pop(Bucket.size() - 1))
+        Allocator.Deallocate(Ptr);
+  }
+
+  /// allocate - Return an uninitialized array of Cap.getSize() elements,
+  /// either recycled or fresh from the allocator.
+  template<class AllocatorType>
+  T *allocate(Capacity Cap, AllocatorType &Allocator) {
+    assert(sizeof(T) >= sizeof(FreeList) &&
+           "Element type is too small to thread the free lists through");
+    if (T *Ptr = pop(Cap.getBucket()))
+      return Ptr;
+    return static_cast<T*>(Allocator.Allocate(sizeof(T)*Cap.getSize(), Align));
+  }
+
+  /// deallocate - Recycle an array of Cap.getSize() elements. The elements
+  /// must already have been destroyed.
+  void deallocate(Capacity Cap, T *Ptr) {
+    push(Cap.getBucket(), Ptr);
+  }
+};
+
+} // end llvm namespace
+
+#endif
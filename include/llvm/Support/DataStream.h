@@ -0,0 +1,41 @@
+//===---- llvm/Support/DataStream.h - Lazy bitcode streaming ----*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This header defines DataStreamer, which fetches bytes of data from a stream
+// source.  It provides support for streaming (lazy reading) of bitcode.  An
+// example implementation of streaming from a file or stdin follows.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_DATASTREAM_H
+#define LLVM_SUPPORT_DATASTREAM_H
+
+#include <string>
+
+namespace llvm {
+
+class DataStreamer {
+public:
+  /// GetBytes - Fetch up to len bytes from the stream into buf, returning the
+  /// number of bytes actually written.  A short count means the end of the
+  /// stream has been reached; implementations must not return short counts
+  /// otherwise.
+  virtual size_t GetBytes(unsigned char *buf, size_t len) = 0;
+
+  virtual ~DataStreamer();
+};
+
+/// getDataFileStreamer - Return a DataStreamer which reads the named file, or
+/// stdin if Filename is "-".  On error, return null and fill in *Err.
+DataStreamer *getDataFileStreamer(const std::string &Filename,
+                                  std::string *Err);
+
+}
+
+#endif // LLVM_SUPPORT_DATASTREAM_H
@@ -89,6 +89,25 @@ namespace sys {
     /// setRangeWritable - Mark the page containing a range of addresses
     /// as writable.
     static bool setRangeWritable(const void *Addr, size_t Size);
+
+    /// Page protections for protectBlock.
+    enum ProtectionFlags {
+      MF_READ  = 1,
+      MF_WRITE = 2,
+      MF_EXEC  = 4
+    };
+
+    /// protectBlock - Set the protection of the pages of a block allocated
+    /// with AllocateRWX to the given combination of ProtectionFlags.  Unlike
+    /// setWritable and setExecutable, which only change permissions where the
+    /// platform requires it, this always does, so a JIT can use it to make
+    /// sure no page is ever writable and executable at the same time.  The
+    /// block must start on a page boundary.
+    ///
+    /// On success, this returns false, otherwise it returns true and fills
+    /// in *ErrMsg.
+    static bool protectBlock(const MemoryBlock &M, unsigned Flags,
+                             std::string *ErrMsg = 0);
   };
 }
 }
@@ -24,7 +24,11 @@ namespace llvm {
     class ThreadLocalImpl {
       void* data;
     public:
-      ThreadLocalImpl();
+      /// If Destructor is not null, it is called with the pointer held for a
+      /// thread when that thread exits, if the pointer is not null.  This is
+      /// only done where the host's thread-local storage supports it, and
+      /// never for the main thread.
+      explicit ThreadLocalImpl(void (*Destructor)(void*) = 0);
       virtual ~ThreadLocalImpl();
       void setInstance(const void* d);
       const void* getInstance();
@@ -37,6 +41,8 @@ namespace llvm {
     class ThreadLocal : public ThreadLocalImpl {
     public:
       ThreadLocal() : ThreadLocalImpl() { }
+      explicit ThreadLocal(void (*Destructor)(void*))
+        : ThreadLocalImpl(Destructor) { }
 
       /// get - Fetches a pointer to the object associated with the current
       /// thread.  If no object has yet been associated, it returns NULL;
@@ -54,6 +54,22 @@ namespace llvm {
   /// the thread stack.
   void llvm_execute_on_thread(void (*UserFn)(void*), void *UserData,
                               unsigned RequestedStackSize = 0);
+
+  /// llvm_thread - An opaque handle for a thread started by llvm_start_thread.
+  struct llvm_thread;
+
+  /// llvm_start_thread - Start executing the given \arg UserFn on a separate
+  /// thread, passing it the provided \arg UserData, and return without waiting
+  /// for it to finish.  The result must be passed to llvm_join_thread.
+  ///
+  /// If threads are not available, or the thread cannot be created, UserFn is
+  /// run to completion on the calling thread before this returns.
+  llvm_thread *llvm_start_thread(void (*UserFn)(void*), void *UserData,
+                                 unsigned RequestedStackSize = 0);
+
+  /// llvm_join_thread - Wait for a thread started by llvm_start_thread to
+  /// finish, and release it.
+  void llvm_join_thread(llvm_thread *Thread);
 }
 
 #endif
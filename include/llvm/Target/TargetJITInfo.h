@@ -40,6 +40,22 @@ namespace llvm {
     ///
     virtual void replaceMachineCodeForFunction(void *Old, void *New) = 0;
 
+    /// emitPatchableEntry - Emit, at the entry of a function, an instruction
+    /// that patchFunctionEntry can later overwrite.  The JITCodeEmitter is
+    /// positioned at the function's entry, which is at least 8-byte aligned.
+    /// Targets that don't implement patchFunctionEntry emit nothing.
+    virtual void emitPatchableEntry(JITCodeEmitter &JCE) {}
+
+    /// patchFunctionEntry - Make the function at Old, which starts with the
+    /// instruction emitted by emitPatchableEntry, jump to New.  Unlike
+    /// replaceMachineCodeForFunction, this is done with a single atomic store
+    /// over that one instruction, so other threads may be running the old
+    /// code meanwhile.  Return false if the target can't do that, or if Old
+    /// doesn't start with a patchable entry.
+    virtual bool patchFunctionEntry(void *Old, void *New) {
+      return false;
+    }
+
     /// emitGlobalValueIndirectSym - Use the specified JITCodeEmitter object
     /// to emit an indirect symbol which contains the address of the specified
     /// ptr.
@@ -72,6 +88,15 @@ namespace llvm {
       return 0;
     }
 
+    /// updateFunctionStub - Point the stub at Stub, which was emitted by
+    /// emitFunctionStub, at Target with a single atomic store, so that other
+    /// threads may call through the stub meanwhile.  Return false if the
+    /// target's stubs can't be updated that way; the JIT then emits the stub
+    /// again in place, which is only safe while no other thread can run it.
+    virtual bool updateFunctionStub(void *Stub, void *Target) {
+      return false;
+    }
+
     /// getPICJumpTableEntry - Returns the value of the jumptable entry for the
     /// specific basic block.
     virtual uintptr_t getPICJumpTableEntry(uintptr_t BB, uintptr_t JTBase) {
@@ -141,6 +141,22 @@ Pass *createLoopRotatePass();
 // LoopIdiom - This pass recognizes and replaces idioms in loops.
 //
 Pass *createLoopIdiomPass();
+
+//===----------------------------------------------------------------------===//
+//
+// LoopVectorize - This pass widens innermost loops so that each iteration
+// executes several iterations of the original loop with vector instructions.
+//
+Pass *createLoopVectorizePass();
+
+//===----------------------------------------------------------------------===//
+//
+// SLPVectorizer - This pass packs isomorphic scalar operations feeding stores
+// to consecutive addresses into vector operations.  It takes an optional
+// parameter used to consult the target machine about the cost of vector
+// operations.
+//
+FunctionPass *createSLPVectorizerPass(const TargetLowering *TLI = 0);
   
 //===----------------------------------------------------------------------===//
 //
@@ -0,0 +1,46 @@
+//===- SplitModule.h - Split a module into partitions -----------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines functions which split a module into several modules that
+// can be code generated independently and linked back together, as done by
+// libLTO to generate code on several threads.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TRANSFORMS_UTILS_SPLITMODULE_H
+#define LLVM_TRANSFORMS_UTILS_SPLITMODULE_H
+
+#include "llvm/ADT/DenseMap.h"
+
+namespace llvm {
+  class GlobalValue;
+  class Module;
+
+  /// ModulePartitionMap - The partition which defines each global value.
+  typedef DenseMap<const GlobalValue*, unsigned> ModulePartitionMap;
+
+  /// AssignModulePartitions - Decide which of NumPartitions partitions
+  /// defines each global value in M, keeping callers and callees together
+  /// where possible.  Returns false if M can't be split, which is the case
+  /// when it takes the address of a basic block.
+  bool AssignModulePartitions(Module &M, unsigned NumPartitions,
+                              ModulePartitionMap &Owner);
+
+  /// PromoteCrossPartitionLocals - Give the local symbols of M which are
+  /// referenced from a partition other than their own hidden external
+  /// linkage, under a name ending in ".lto_priv".
+  void PromoteCrossPartitionLocals(Module &M, const ModulePartitionMap &Owner);
+
+  /// ExtractModulePartition - Return a copy of M which defines what partition
+  /// Part owns and declares everything else.
+  Module *ExtractModulePartition(const Module &M, unsigned Part,
+                                 const ModulePartitionMap &Owner);
+}
+
+#endif
@@ -130,11 +130,21 @@ private:
     *List = this;
   }
   void removeFromList() {
+    if (hasSharedValue()) return removeFromSharedList();
     Use **StrippedPrev = Prev.getPointer();
     *StrippedPrev = Next;
     if (Next) Next->setPrev(StrippedPrev);
   }
 
+  /// hasSharedValue - Return true if Val's use list may be modified from more
+  /// than one function at a time, see Value::hasSharedUseList.
+  inline bool hasSharedValue() const;
+
+  /// addToSharedList/removeFromSharedList - Variants of addToList and
+  /// removeFromList which hold the context's UseListLock.
+  void addToSharedList(Use **List);
+  void removeFromSharedList();
+
   friend class Value;
   friend class User;
 };
@@ -195,7 +195,21 @@ public:
 
   /// addUse - This method should only be used by the Use class.
   ///
-  void addUse(Use &U) { U.addToList(&UseList); }
+  void addUse(Use &U) {
+    if (hasSharedUseList())
+      U.addToSharedList(&UseList);
+    else
+      U.addToList(&UseList);
+  }
+
+  /// hasSharedUseList - Return true if this is a constant, global value,
+  /// metadata or inline asm.  Instructions in any function may use these, so
+  /// their use lists are updated under a lock when functions are being
+  /// transformed in parallel.  Walking such a use list is still only safe
+  /// when no other thread is transforming the module.
+  bool hasSharedUseList() const {
+    return SubclassID >= FunctionVal && SubclassID <= InlineAsmVal;
+  }
 
   /// An enumeration for keeping track of the concrete subclass of Value that
   /// is actually instantiated. Values of this enumeration are kept in the 
@@ -320,6 +334,10 @@ inline raw_ostream &operator<<(raw_ostream &OS, const Value &V) {
   return OS;
 }
   
+bool Use::hasSharedValue() const {
+  return Val->hasSharedUseList();
+}
+
 void Use::set(Value *V) {
   if (Val) removeFromList();
   Val = V;
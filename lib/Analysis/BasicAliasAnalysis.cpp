@@ -13,6 +13,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#define DEBUG_TYPE "basicaa"
 #include "llvm/Analysis/AliasAnalysis.h"
 #include "llvm/Analysis/Passes.h"
 #include "llvm/Constants.h"
@@ -30,13 +31,24 @@
 #include "llvm/Analysis/InstructionSimplify.h"
 #include "llvm/Analysis/ValueTracking.h"
 #include "llvm/Target/TargetData.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/GetElementPtrTypeIterator.h"
 #include <algorithm>
 using namespace llvm;
 
+STATISTIC(NumCacheHits,   "Number of alias sub-queries answered from cache");
+STATISTIC(NumCacheMisses, "Number of alias sub-queries computed and cached");
+
+static cl::opt<bool>
+EnableAliasCache("basicaa-cache", cl::init(true), cl::Hidden,
+                 cl::desc("Memoize the sub-queries of each BasicAliasAnalysis "
+                          "alias query"));
+
 //===----------------------------------------------------------------------===//
 // Useful predicates
 //===----------------------------------------------------------------------===//
@@ -463,11 +475,13 @@ namespace {
     virtual AliasResult alias(const Location &LocA,
                               const Location &LocB) {
       assert(Visited.empty() && "Visited must be cleared after use!");
+      assert(AliasCache.empty() && "AliasCache must be cleared after use!");
       assert(notDifferentParent(LocA.Ptr, LocB.Ptr) &&
              "BasicAliasAnalysis doesn't support interprocedural queries.");
       AliasResult Alias = aliasCheck(LocA.Ptr, LocA.Size, LocA.TBAATag,
                                      LocB.Ptr, LocB.Size, LocB.TBAATag);
       Visited.clear();
+      AliasCache.clear();
       return Alias;
     }
 
@@ -506,6 +520,14 @@ namespace {
     // Visited - Track instructions visited by a aliasPHI, aliasSelect(), and aliasGEP().
     SmallPtrSet<const Value*, 16> Visited;
 
+    // AliasCache - The results of the sub-queries made while answering the
+    // current alias() query.  PHIs and selects whose operands share GEPs ask
+    // about the same pairs of pointers many times over.  The cache is cleared
+    // when the query returns, so it never outlives the IR it describes.
+    typedef std::pair<Location, Location> LocPair;
+    typedef DenseMap<LocPair, AliasResult> AliasCacheTy;
+    AliasCacheTy AliasCache;
+
     // aliasGEP - Provide a bunch of ad-hoc rules to disambiguate a GEP
     // instruction against another.
     AliasResult aliasGEP(const GEPOperator *V1, uint64_t V1Size,
@@ -530,6 +552,14 @@ namespace {
                            const MDNode *V1TBAATag,
                            const Value *V2, uint64_t V2Size,
                            const MDNode *V2TBAATag);
+
+    // aliasCheckRecursive - The part of aliasCheck that recurses through GEPs,
+    // PHIs and selects, whose results aliasCheck memoizes.
+    AliasResult aliasCheckRecursive(const Value *V1, uint64_t V1Size,
+                                    const MDNode *V1TBAATag,
+                                    const Value *V2, uint64_t V2Size,
+                                    const MDNode *V2TBAATag,
+                                    const Value *O1, const Value *O2);
   };
 }  // End of anonymous namespace
 
@@ -1125,6 +1155,36 @@ BasicAliasAnalysis::aliasCheck(const Value *V1, uint64_t V1Size,
         (V2Size != UnknownSize && isObjectSmallerThan(O1, V2Size, *TD)))
       return NoAlias;
   
+  if (!EnableAliasCache)
+    return aliasCheckRecursive(V1, V1Size, V1TBAAInfo, V2, V2Size, V2TBAAInfo,
+                               O1, O2);
+
+  // The pair is looked up in either order.  A result computed while part of
+  // a use-def cycle was being visited may be a conservative MayAlias, which
+  // is still a correct answer for the rest of the query.
+  LocPair Locs(Location(V1, V1Size, V1TBAAInfo),
+               Location(V2, V2Size, V2TBAAInfo));
+  if (V1 > V2)
+    std::swap(Locs.first, Locs.second);
+  AliasCacheTy::iterator I = AliasCache.find(Locs);
+  if (I != AliasCache.end()) {
+    ++NumCacheHits;
+    return I->second;
+  }
+
+  ++NumCacheMisses;
+  AliasResult Result = aliasCheckRecursive(V1, V1Size, V1TBAAInfo,
+                                           V2, V2Size, V2TBAAInfo, O1, O2);
+  AliasCache[Locs] = Result;
+  return Result;
+}
+
+AliasAnalysis::AliasResult
+BasicAliasAnalysis::aliasCheckRecursive(const Value *V1, uint64_t V1Size,
+                                        const MDNode *V1TBAAInfo,
+                                        const Value *V2, uint64_t V2Size,
+                                        const MDNode *V2TBAAInfo,
+                                        const Value *O1, const Value *O2) {
   // FIXME: This isn't aggressively handling alias(GEP, PHI) for example: if the
   // GEP can't simplify, we don't even look at the PHI cases.
   if (!isa<GEPOperator>(V1) && isa<GEPOperator>(V2)) {
@@ -102,6 +102,15 @@ private:
 
 char CGPassManager::ID = 0;
 
+/// getSCCFunctions - Fill in Fns with the functions in SCC.
+static void getSCCFunctions(CallGraphSCC &SCC,
+                            SmallVectorImpl<Function*> &Fns) {
+  Fns.clear();
+  for (CallGraphSCC::iterator I = SCC.begin(), E = SCC.end(); I != E; ++I)
+    if (Function *F = (*I)->getFunction())
+      Fns.push_back(F);
+}
+
 
 bool CGPassManager::RunPassOnSCC(Pass *P, CallGraphSCC &CurSCC,
                                  CallGraph &CG, bool &CallGraphUpToDate,
@@ -117,8 +126,16 @@ bool CGPassManager::RunPassOnSCC(Pass *P, CallGraphSCC &CurSCC,
     }
 
     {
+      SmallVector<Function*, 4> SCCFunctions;
+      getSCCFunctions(CurSCC, SCCFunctions);
+
       TimeRegion PassTimer(getPassTimer(CGSP));
+      PassReportRegion Report(CGSP, SCCFunctions);
       Changed = CGSP->runOnSCC(CurSCC);
+
+      // The pass may have replaced some of the functions.
+      getSCCFunctions(CurSCC, SCCFunctions);
+      Report.setSCCFunctions(SCCFunctions);
     }
     
     // After the CGSCCPass is done, when assertions are enabled, use
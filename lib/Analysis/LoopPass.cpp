@@ -281,6 +281,7 @@ bool LPPassManager::runOnFunction(Function &F) {
       {
         PassManagerPrettyStackEntry X(P, *CurrentLoop->getHeader());
         TimeRegion PassTimer(getPassTimer(P));
+        PassReportRegion Report(P, F);
 
         Changed |= P->runOnLoop(CurrentLoop, *this);
       }
@@ -45,6 +45,8 @@ STATISTIC(NumUncacheNonLocalPtr,
           "Number of uncached non-local ptr responses");
 STATISTIC(NumCacheCompleteNonLocalPtr,
           "Number of block queries that were completely cached");
+STATISTIC(NumBudgetNonLocalPtr,
+          "Number of non-local ptr walks stopped by the block budget");
 
 char MemoryDependenceAnalysis::ID = 0;
   
@@ -595,12 +597,14 @@ MemoryDependenceAnalysis::getNonLocalCallDependency(CallSite QueryCS) {
 /// set of instructions that either define or clobber the value.
 ///
 /// This method assumes the pointer has a "NonLocal" dependency within its
-/// own block.
+/// own block.  A nonzero MaxBlocks bounds the number of blocks the query may
+/// visit before it conservatively gives up.
 ///
 void MemoryDependenceAnalysis::
 getNonLocalPointerDependency(const AliasAnalysis::Location &Loc, bool isLoad,
                              BasicBlock *FromBB,
-                             SmallVectorImpl<NonLocalDepResult> &Result) {
+                             SmallVectorImpl<NonLocalDepResult> &Result,
+                             unsigned MaxBlocks) {
   assert(Loc.Ptr->getType()->isPointerTy() &&
          "Can't get pointer deps of a non-pointer!");
   Result.clear();
@@ -613,7 +617,7 @@ getNonLocalPointerDependency(const AliasAnalysis::Location &Loc, bool isLoad,
   // translation.
   DenseMap<BasicBlock*, Value*> Visited;
   if (!getNonLocalPointerDepFromBB(Address, Loc, isLoad, FromBB,
-                                   Result, Visited, true))
+                                   Result, Visited, MaxBlocks, true))
     return;
   Result.clear();
   Result.push_back(NonLocalDepResult(FromBB,
@@ -739,12 +743,15 @@ SortNonLocalDepInfoCache(MemoryDependenceAnalysis::NonLocalDepInfo &Cache,
 /// This function returns false on success, or true to indicate that it could
 /// not compute dependence information for some reason.  This should be treated
 /// as a clobber dependence on the first instruction in the predecessor block.
+/// This includes running out of budget: if MaxBlocks is nonzero, the walk
+/// stops once Visited holds more than MaxBlocks blocks.
 bool MemoryDependenceAnalysis::
 getNonLocalPointerDepFromBB(const PHITransAddr &Pointer,
                             const AliasAnalysis::Location &Loc,
                             bool isLoad, BasicBlock *StartBB,
                             SmallVectorImpl<NonLocalDepResult> &Result,
                             DenseMap<BasicBlock*, Value*> &Visited,
+                            unsigned MaxBlocks,
                             bool SkipFirstBlock) {
   
   // Look up the cached info for Pointer.
@@ -783,7 +790,7 @@ getNonLocalPointerDepFromBB(const PHITransAddr &Pointer,
       return getNonLocalPointerDepFromBB(Pointer,
                                          Loc.getWithNewSize(CacheInfo->Size),
                                          isLoad, StartBB, Result, Visited,
-                                         SkipFirstBlock);
+                                         MaxBlocks, SkipFirstBlock);
     }
 
     // If the query's TBAATag is inconsistent with the cached one,
@@ -802,7 +809,7 @@ getNonLocalPointerDepFromBB(const PHITransAddr &Pointer,
       if (Loc.TBAATag)
         return getNonLocalPointerDepFromBB(Pointer, Loc.getWithoutTBAATag(),
                                            isLoad, StartBB, Result, Visited,
-                                           SkipFirstBlock);
+                                           MaxBlocks, SkipFirstBlock);
     }
   }
 
@@ -862,6 +869,16 @@ getNonLocalPointerDepFromBB(const PHITransAddr &Pointer,
   DEBUG(AssertSorted(*Cache));
   
   while (!Worklist.empty()) {
+    // If the query has already looked at more blocks than it may, give up.
+    // The entries cached so far are still correct for their blocks, but the
+    // cache no longer holds the complete result for this query.
+    if (MaxBlocks && Visited.size() > MaxBlocks) {
+      ++NumBudgetNonLocalPtr;
+      CacheInfo->Pair = BBSkipFirstBlockPair();
+      SortNonLocalDepInfoCache(*Cache, NumSortedEntries);
+      return true;
+    }
+
     BasicBlock *BB = Worklist.pop_back_val();
     
     // Skip the first block if we have it.
@@ -985,7 +1002,7 @@ getNonLocalPointerDepFromBB(const PHITransAddr &Pointer,
       if (getNonLocalPointerDepFromBB(PredPointer,
                                       Loc.getWithNewPtr(PredPointer.getAddr()),
                                       isLoad, Pred,
-                                      Result, Visited))
+                                      Result, Visited, MaxBlocks))
         goto PredTranslationFailure;
     }
     
@@ -3783,27 +3783,22 @@ ScalarEvolution::getBackedgeTakenInfo(const Loop *L) {
   // update the value. The temporary CouldNotCompute value tells SCEV
   // code elsewhere that it shouldn't attempt to request a new
   // backedge-taken count, which could result in infinite recursion.
-  std::pair<std::map<const Loop *, BackedgeTakenInfo>::iterator, bool> Pair =
+  std::pair<DenseMap<const Loop *, BackedgeTakenInfo>::iterator, bool> Pair =
     BackedgeTakenCounts.insert(std::make_pair(L, getCouldNotCompute()));
   if (!Pair.second)
     return Pair.first->second;
 
+  // ComputeBackedgeTakenCount may recursively call getBackedgeTakenInfo for
+  // other loops, which can grow the map, so don't hold on to Pair.first.
   BackedgeTakenInfo BECount = ComputeBackedgeTakenCount(L);
   if (BECount.Exact != getCouldNotCompute()) {
     assert(isLoopInvariant(BECount.Exact, L) &&
            isLoopInvariant(BECount.Max, L) &&
            "Computed backedge-taken count isn't loop invariant for loop!");
     ++NumTripCountsComputed;
-
-    // Update the value in the map.
-    Pair.first->second = BECount;
-  } else {
-    if (BECount.Max != getCouldNotCompute())
-      // Update the value in the map.
-      Pair.first->second = BECount;
-    if (isa<PHINode>(L->getHeader()->begin()))
-      // Only count loops that have phi nodes as not being computable.
-      ++NumTripCountsNotComputed;
+  } else if (isa<PHINode>(L->getHeader()->begin())) {
+    // Only count loops that have phi nodes as not being computable.
+    ++NumTripCountsNotComputed;
   }
 
   // Now that we know more about the trip count for this loop, forget any
@@ -3842,7 +3837,9 @@ ScalarEvolution::getBackedgeTakenInfo(const Loop *L) {
       PushDefUseChildren(I, Worklist);
     }
   }
-  return Pair.first->second;
+
+  // Update the value in the map.
+  return BackedgeTakenCounts.find(L)->second = BECount;
 }
 
 /// forgetLoop - This method should be called by the client when it has
@@ -4527,6 +4524,22 @@ ScalarEvolution::ComputeBackedgeTakenCountExhaustively(const Loop *L,
   return getCouldNotCompute();
 }
 
+/// setCachedResult - Record Result for Key in one of the small vectors of the
+/// ValuesAtScopes, LoopDispositions or BlockDispositions maps.  A placeholder
+/// for Key was pushed before the result was computed, so it is usually the
+/// last entry.  If the expression was forgotten in the meantime, the vector is
+/// new and the entry is added again.
+template<typename KeyT, typename ResultT>
+static void setCachedResult(SmallVectorImpl<std::pair<KeyT, ResultT> > &Values,
+                            KeyT Key, ResultT Result) {
+  for (unsigned i = Values.size(); i != 0; --i)
+    if (Values[i - 1].first == Key) {
+      Values[i - 1].second = Result;
+      return;
+    }
+  Values.push_back(std::make_pair(Key, Result));
+}
+
 /// getSCEVAtScope - Return a SCEV expression for the specified value
 /// at the specified scope in the program.  The L value specifies a loop
 /// nest to evaluate the expression at, where null is the top-level or a
@@ -4539,15 +4552,17 @@ ScalarEvolution::ComputeBackedgeTakenCountExhaustively(const Loop *L,
 /// original value V is returned.
 const SCEV *ScalarEvolution::getSCEVAtScope(const SCEV *V, const Loop *L) {
   // Check to see if we've folded this expression at this loop before.
-  std::map<const Loop *, const SCEV *> &Values = ValuesAtScopes[V];
-  std::pair<std::map<const Loop *, const SCEV *>::iterator, bool> Pair =
-    Values.insert(std::make_pair(L, static_cast<const SCEV *>(0)));
-  if (!Pair.second)
-    return Pair.first->second ? Pair.first->second : V;
-
-  // Otherwise compute it.
+  SmallVectorImpl<std::pair<const Loop *, const SCEV *> > &Values =
+    ValuesAtScopes[V];
+  for (unsigned i = 0, e = Values.size(); i != e; ++i)
+    if (Values[i].first == L)
+      return Values[i].second ? Values[i].second : V;
+  Values.push_back(std::make_pair(L, static_cast<const SCEV *>(0)));
+
+  // Otherwise compute it.  This recurses into getSCEVAtScope, which can grow
+  // the map, so look the entry up again afterwards.
   const SCEV *C = computeSCEVAtScope(V, L);
-  ValuesAtScopes[V][L] = C;
+  setCachedResult(ValuesAtScopes[V], L, C);
   return C;
 }
 
@@ -6111,14 +6126,16 @@ void ScalarEvolution::print(raw_ostream &OS, const Module *) const {
 
 ScalarEvolution::LoopDisposition
 ScalarEvolution::getLoopDisposition(const SCEV *S, const Loop *L) {
-  std::map<const Loop *, LoopDisposition> &Values = LoopDispositions[S];
-  std::pair<std::map<const Loop *, LoopDisposition>::iterator, bool> Pair =
-    Values.insert(std::make_pair(L, LoopVariant));
-  if (!Pair.second)
-    return Pair.first->second;
+  SmallVectorImpl<std::pair<const Loop *, LoopDisposition> > &Values =
+    LoopDispositions[S];
+  for (unsigned i = 0, e = Values.size(); i != e; ++i)
+    if (Values[i].first == L)
+      return Values[i].second;
+  Values.push_back(std::make_pair(L, LoopVariant));
 
   LoopDisposition D = computeLoopDisposition(S, L);
-  return LoopDispositions[S][L] = D;
+  setCachedResult(LoopDispositions[S], L, D);
+  return D;
 }
 
 ScalarEvolution::LoopDisposition
@@ -6213,14 +6230,16 @@ bool ScalarEvolution::hasComputableLoopEvolution(const SCEV *S, const Loop *L) {
 
 ScalarEvolution::BlockDisposition
 ScalarEvolution::getBlockDisposition(const SCEV *S, const BasicBlock *BB) {
-  std::map<const BasicBlock *, BlockDisposition> &Values = BlockDispositions[S];
-  std::pair<std::map<const BasicBlock *, BlockDisposition>::iterator, bool>
-    Pair = Values.insert(std::make_pair(BB, DoesNotDominateBlock));
-  if (!Pair.second)
-    return Pair.first->second;
+  SmallVectorImpl<std::pair<const BasicBlock *, BlockDisposition> > &Values =
+    BlockDispositions[S];
+  for (unsigned i = 0, e = Values.size(); i != e; ++i)
+    if (Values[i].first == BB)
+      return Values[i].second;
+  Values.push_back(std::make_pair(BB, DoesNotDominateBlock));
 
   BlockDisposition D = computeBlockDisposition(S, BB);
-  return BlockDispositions[S][BB] = D;
+  setCachedResult(BlockDispositions[S], BB, D);
+  return D;
 }
 
 ScalarEvolution::BlockDisposition
@@ -144,7 +144,9 @@ bool ArchiveMember::replaceWith(const sys::Path& newFile, std::string* ErrMsg) {
 // initializes and maps the file into memory, if requested.
 Archive::Archive(const sys::Path& filename, LLVMContext& C)
   : archPath(filename), members(), mapfile(0), base(0), symTab(), strtab(),
-    symTabSize(0), firstFileOffset(0), modules(), foreignST(0), Context(C) {
+    symTabSize(0), hashedSymTab(0), hashedSymTabBuckets(0),
+    hashedSymTabSymbols(0), firstFileOffset(0), modules(), foreignST(0),
+    Context(C) {
 }
 
 bool
@@ -169,6 +171,8 @@ void Archive::cleanUpMemory() {
   // Forget the entire symbol table
   symTab.clear();
   symTabSize = 0;
+  hashedSymTab = 0;
+  hashedSymTabBuckets = hashedSymTabSymbols = 0;
 
   firstFileOffset = 0;
 
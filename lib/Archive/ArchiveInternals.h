@@ -29,6 +29,25 @@
 #define ARFILE_PAD "\n"                            ///< inter-file align padding
 #define ARFILE_MEMBER_MAGIC "`\n"                  ///< fmag field magic #
 
+/// The LLVM symbol table member may hold a hashed symbol table instead of the
+/// original sequence of VBR encoded (offset, length, name) triplets. A hashed
+/// table starts with this signature, which can't begin a triplet table since
+/// it would describe a symbol with an empty name. The signature is followed
+/// by 32-bit little-endian fields:
+///
+///   NumBuckets, NumSymbols, StringsSize
+///   Buckets[NumBuckets]   - 1-based entry index, or 0 for an empty bucket
+///   Entries[NumSymbols]   - {Hash, MemberOffset, NameOffset, NameLength}
+///   Strings[StringsSize]  - symbol names, not terminated
+///
+/// NumBuckets is a power of two and collisions are resolved by linear
+/// probing, so a lookup reads the table straight out of the mapped archive.
+#define ARFILE_LLVM_HASHED_SYMTAB_MAGIC "\0\0LLVMHS"
+#define ARFILE_LLVM_HASHED_SYMTAB_MAGIC_LEN 8
+#define ARFILE_LLVM_HASHED_SYMTAB_HEADER_LEN \
+  (ARFILE_LLVM_HASHED_SYMTAB_MAGIC_LEN + 12)
+#define ARFILE_LLVM_HASHED_SYMTAB_ENTRY_LEN 16
+
 namespace llvm {
 
   class LLVMContext;
@@ -71,6 +90,22 @@ namespace llvm {
     }
   };
   
+  /// The hash function used by the hashed LLVM symbol table. This is part of
+  /// the on-disk format, so it must not change, and it hashes bytes as
+  /// unsigned values so that it gives the same answer on every host.
+  static inline unsigned hashSymbolName(StringRef Name) {
+    unsigned Result = 0;
+    for (unsigned i = 0, e = Name.size(); i != e; ++i)
+      Result = Result * 33 + (unsigned char)Name[i];
+    return Result;
+  }
+
+  /// Read a 32-bit little-endian value from a possibly unaligned address.
+  static inline unsigned readLE32(const char* At) {
+    const unsigned char* P = (const unsigned char*)At;
+    return P[0] | (P[1] << 8) | (P[2] << 16) | ((unsigned)P[3] << 24);
+  }
+
   // Get just the externally visible defined symbols from the bitcode
   bool GetBitcodeSymbols(const sys::Path& fName,
                           LLVMContext& Context,
@@ -33,11 +33,62 @@ static inline unsigned readInteger(const char*&At, const char*End) {
   return Result;
 }
 
-// Completely parse the Archive's symbol table and populate symTab member var.
+// Parse the Archive's symbol table. A hashed table is only validated here and
+// is then probed in place by lookupSymbol. An old style table is completely
+// parsed to populate the symTab member var.
 bool
 Archive::parseSymbolTable(const void* data, unsigned size, std::string* error) {
   const char* At = (const char*) data;
   const char* End = At + size;
+  hashedSymTab = 0;
+  hashedSymTabBuckets = hashedSymTabSymbols = 0;
+
+  if (size >= ARFILE_LLVM_HASHED_SYMTAB_MAGIC_LEN &&
+      0 == memcmp(At, ARFILE_LLVM_HASHED_SYMTAB_MAGIC,
+                  ARFILE_LLVM_HASHED_SYMTAB_MAGIC_LEN)) {
+    if (size < ARFILE_LLVM_HASHED_SYMTAB_HEADER_LEN) {
+      if (error)
+        *error = "Malformed hashed symbol table: truncated header";
+      return false;
+    }
+    At += ARFILE_LLVM_HASHED_SYMTAB_MAGIC_LEN;
+    uint64_t NumBuckets = readLE32(At);
+    uint64_t NumSymbols = readLE32(At + 4);
+    uint64_t StringsSize = readLE32(At + 8);
+    if (NumBuckets == 0 || (NumBuckets & (NumBuckets - 1)) != 0 ||
+        NumSymbols >= NumBuckets) {
+      if (error)
+        *error = "Malformed hashed symbol table: bad bucket count";
+      return false;
+    }
+    if (ARFILE_LLVM_HASHED_SYMTAB_HEADER_LEN + 4 * NumBuckets +
+        ARFILE_LLVM_HASHED_SYMTAB_ENTRY_LEN * NumSymbols + StringsSize !=
+        size) {
+      if (error)
+        *error = "Malformed hashed symbol table: size not consistent";
+      return false;
+    }
+
+    // Check that every entry refers to a valid string so that lookups don't
+    // need to.
+    const char* Entries = (const char*)data +
+      ARFILE_LLVM_HASHED_SYMTAB_HEADER_LEN + 4 * NumBuckets;
+    for (uint64_t i = 0; i != NumSymbols; ++i) {
+      const char* Entry = Entries + i * ARFILE_LLVM_HASHED_SYMTAB_ENTRY_LEN;
+      if (uint64_t(readLE32(Entry + 8)) + readLE32(Entry + 12) > StringsSize) {
+        if (error)
+          *error = "Malformed hashed symbol table: bad symbol name";
+        return false;
+      }
+    }
+
+    hashedSymTab = (const char*)data;
+    hashedSymTabBuckets = NumBuckets;
+    hashedSymTabSymbols = NumSymbols;
+    symTabSize = size;
+    return true;
+  }
+
   while (At < End) {
     unsigned offset = readInteger(At, End);
     if (At == End) {
@@ -64,6 +115,64 @@ Archive::parseSymbolTable(const void* data, unsigned size, std::string* error) {
   return true;
 }
 
+// Look up a symbol in the loaded symbol table. Hashed tables are probed
+// directly in the mapped archive without building symTab.
+bool
+Archive::lookupSymbol(const std::string& symbol, unsigned& offset) {
+  if (!hashedSymTab) {
+    SymTabType::iterator SI = symTab.find(symbol);
+    if (SI == symTab.end())
+      return false;
+    offset = SI->second;
+    return true;
+  }
+
+  const char* Buckets = hashedSymTab + ARFILE_LLVM_HASHED_SYMTAB_HEADER_LEN;
+  const char* Entries = Buckets + 4 * hashedSymTabBuckets;
+  const char* Strings =
+    Entries + ARFILE_LLVM_HASHED_SYMTAB_ENTRY_LEN * hashedSymTabSymbols;
+  unsigned Hash = hashSymbolName(symbol);
+  unsigned Mask = hashedSymTabBuckets - 1;
+
+  // The table always has an empty bucket, but bound the probe anyway in case
+  // the file is corrupt.
+  for (unsigned Bucket = Hash & Mask, Probes = 0;
+       Probes != hashedSymTabBuckets; Bucket = (Bucket + 1) & Mask, ++Probes) {
+    unsigned Index = readLE32(Buckets + 4 * Bucket);
+    if (Index == 0)
+      return false;
+    if (Index > hashedSymTabSymbols)
+      continue;
+    const char* Entry =
+      Entries + (Index - 1) * ARFILE_LLVM_HASHED_SYMTAB_ENTRY_LEN;
+    if (readLE32(Entry) != Hash || readLE32(Entry + 12) != symbol.size() ||
+        memcmp(Strings + readLE32(Entry + 8), symbol.data(), symbol.size()))
+      continue;
+    offset = readLE32(Entry + 4);
+    return true;
+  }
+  return false;
+}
+
+// Get the symbol table as a std::map, building it from the hashed symbol table
+// the first time it is requested.
+const Archive::SymTabType&
+Archive::getSymbolTable() {
+  if (hashedSymTab && symTab.empty()) {
+    const char* Entries = hashedSymTab + ARFILE_LLVM_HASHED_SYMTAB_HEADER_LEN +
+      4 * hashedSymTabBuckets;
+    const char* Strings =
+      Entries + ARFILE_LLVM_HASHED_SYMTAB_ENTRY_LEN * hashedSymTabSymbols;
+    for (unsigned i = 0; i != hashedSymTabSymbols; ++i) {
+      const char* Entry = Entries + i * ARFILE_LLVM_HASHED_SYMTAB_ENTRY_LEN;
+      symTab.insert(std::make_pair(
+        std::string(Strings + readLE32(Entry + 8), readLE32(Entry + 12)),
+        readLE32(Entry + 4)));
+    }
+  }
+  return symTab;
+}
+
 // This member parses an ArchiveMemberHeader that is presumed to be pointed to
 // by At. The At pointer is updated to the byte just after the header, which
 // can be variable in size.
@@ -255,6 +364,8 @@ Archive::loadArchive(std::string* error) {
   // Set up parsing
   members.clear();
   symTab.clear();
+  hashedSymTab = 0;
+  hashedSymTabBuckets = hashedSymTabSymbols = 0;
   const char *At = base;
   const char *End = mapfile->getBufferEnd();
 
@@ -369,6 +480,8 @@ Archive::loadSymbolTable(std::string* ErrorMsg) {
   // Set up parsing
   members.clear();
   symTab.clear();
+  hashedSymTab = 0;
+  hashedSymTabBuckets = hashedSymTabSymbols = 0;
   const char *At = base;
   const char *End = mapfile->getBufferEnd();
 
@@ -458,8 +571,8 @@ Archive* Archive::OpenAndLoadSymbols(const sys::Path& file,
 Module*
 Archive::findModuleDefiningSymbol(const std::string& symbol, 
                                   std::string* ErrMsg) {
-  SymTabType::iterator SI = symTab.find(symbol);
-  if (SI == symTab.end())
+  unsigned symOffset;
+  if (!lookupSymbol(symbol, symOffset))
     return 0;
 
   // The symbol table was previously constructed assuming that the members were
@@ -469,7 +582,7 @@ Archive::findModuleDefiningSymbol(const std::string& symbol,
   // We now have to account for this by adjusting the offset by the size of the
   // symbol table and its header.
   unsigned fileOffset =
-    SI->second +                // offset in symbol-table-less file
+    symOffset +                 // offset in symbol-table-less file
     firstFileOffset;            // add offset to first "real" file in archive
 
   // See if the module is already loaded
@@ -512,7 +625,7 @@ Archive::findModulesDefiningSymbols(std::set<std::string>& symbols,
     return false;
   }
 
-  if (symTab.empty()) {
+  if (!hasSymbols()) {
     // We don't have a symbol table, so we must build it now but lets also
     // make sure that we populate the modules table as we do this to ensure
     // that we don't load them twice when findModuleDefiningSymbol is called
@@ -591,13 +704,13 @@ Archive::findModulesDefiningSymbols(std::set<std::string>& symbols,
 bool Archive::isBitcodeArchive() {
   // Make sure the symTab has been loaded. In most cases this should have been
   // done when the archive was constructed, but still,  this is just in case.
-  if (symTab.empty())
+  if (!hasSymbols())
     if (!loadSymbolTable(0))
       return false;
 
   // Now that we know it's been loaded, return true
   // if it has a size
-  if (symTab.size()) return true;
+  if (hasSymbols()) return true;
 
   // We still can't be sure it isn't a bitcode archive
   if (!loadArchive(0))
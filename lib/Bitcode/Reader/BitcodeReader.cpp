@@ -31,6 +31,10 @@ void BitcodeReader::FreeState() {
   if (BufferOwned)
     delete Buffer;
   Buffer = 0;
+  // Once the stream is set up it owns the streamer; this only frees one that
+  // was never handed off.
+  delete LazyStreamer;
+  LazyStreamer = 0;
   std::vector<PATypeHolder>().swap(TypeList);
   ValueList.clear();
   MDValueList.clear();
@@ -1275,6 +1279,83 @@ bool BitcodeReader::RememberAndSkipFunctionBody() {
   return false;
 }
 
+/// ParseFunctionIndex - When we see the first function body in a module that
+/// has a function index, use the index to record where every body is and
+/// skip all of them at once.  The stream is left just past the index block.
+bool BitcodeReader::ParseFunctionIndex() {
+  // The first body's entry in the index is its block start; we have already
+  // read past that block's ID.  The difference applies to every body.
+  uint64_t FirstBodyBit = Stream.GetCurrentBitNo();
+
+  if (!Stream.canSkipToPos(FunctionIndexBit / 8 + 4))
+    return Error("Invalid function index offset");
+
+  Stream.JumpToBit(FunctionIndexBit);
+  if (Stream.ReadCode() != bitc::ENTER_SUBBLOCK ||
+      Stream.ReadSubBlockID() != bitc::FUNCTION_INDEX_BLOCK_ID ||
+      Stream.EnterSubBlock(bitc::FUNCTION_INDEX_BLOCK_ID))
+    return Error("Malformed function index");
+
+  SmallVector<uint64_t, 64> Record;
+  bool SeenOffsets = false;
+  while (1) {
+    if (Stream.AtEndOfStream())
+      return Error("Premature end of bitstream");
+
+    unsigned Code = Stream.ReadCode();
+    if (Code == bitc::END_BLOCK) {
+      if (Stream.ReadBlockEnd())
+        return Error("Error at end of function index block");
+      break;
+    }
+
+    if (Code == bitc::ENTER_SUBBLOCK) {
+      // No known subblocks, always skip them.
+      Stream.ReadSubBlockID();
+      if (Stream.SkipBlock())
+        return Error("Malformed block record");
+      continue;
+    }
+
+    if (Code == bitc::DEFINE_ABBREV) {
+      Stream.ReadAbbrevRecord();
+      continue;
+    }
+
+    // Read a record.
+    Record.clear();
+    switch (Stream.ReadRecord(Code, Record)) {
+    default: break;  // Default behavior, ignore unknown content.
+    case bitc::FUNCINDEX_CODE_OFFSETS: { // OFFSETS: [bitdelta x N]
+      if (SeenOffsets || Record.empty() ||
+          Record.size() != FunctionsWithBodies.size())
+        return Error("Invalid FUNCINDEX_CODE_OFFSETS record");
+      SeenOffsets = true;
+
+      uint64_t BodyBit = FunctionIndexOrigin + Record[0];
+      if (BodyBit > FirstBodyBit)
+        return Error("Invalid FUNCINDEX_CODE_OFFSETS record");
+      uint64_t HeaderBits = FirstBodyBit - BodyBit;
+
+      // FunctionsWithBodies is reversed, so the first body is at the back.
+      for (unsigned i = 0, e = Record.size(); i != e; ++i) {
+        if (i != 0)
+          BodyBit += Record[i];
+        if (BodyBit + HeaderBits >= FunctionIndexBit)
+          return Error("Invalid FUNCINDEX_CODE_OFFSETS record");
+        DeferredFunctionInfo[FunctionsWithBodies.back()] = BodyBit + HeaderBits;
+        FunctionsWithBodies.pop_back();
+      }
+      break;
+    }
+    }
+  }
+
+  if (!SeenOffsets)
+    return Error("Function index has no offsets");
+  return false;
+}
+
 bool BitcodeReader::ParseModule() {
   if (Stream.EnterSubBlock(bitc::MODULE_BLOCK_ID))
     return Error("Malformed block record");
@@ -1361,6 +1442,15 @@ bool BitcodeReader::ParseModule() {
           HasReversedFunctionsWithBodies = true;
         }
 
+        // If the module has a function index, consult it to find all of the
+        // bodies instead of skipping them one at a time.
+        if (FunctionIndexBit) {
+          if (ParseFunctionIndex())
+            return true;
+          FunctionIndexBit = 0;
+          break;
+        }
+
         if (RememberAndSkipFunctionBody())
           return true;
         break;
@@ -1404,6 +1494,13 @@ bool BitcodeReader::ParseModule() {
       TheModule->setModuleInlineAsm(S);
       break;
     }
+    case bitc::MODULE_CODE_FUNCINDEX: { // FUNCINDEX: [offset_lo32, offset_hi32]
+      if (Record.size() < 2)
+        return Error("Invalid MODULE_CODE_FUNCINDEX record");
+      FunctionIndexOrigin = Stream.GetCurrentBitNo();
+      FunctionIndexBit = FunctionIndexOrigin + (Record[0] | (Record[1] << 32));
+      break;
+    }
     case bitc::MODULE_CODE_DEPLIB: {  // DEPLIB: [strchr x N]
       std::string S;
       if (ConvertToString(Record, 0, S))
@@ -1554,9 +1651,15 @@ bool BitcodeReader::ParseModule() {
   return Error("Premature end of bitstream");
 }
 
-bool BitcodeReader::ParseBitcodeInto(Module *M) {
-  TheModule = 0;
+/// InitStream - Set up the stream over either the memory buffer or the
+/// streamer this reader was created with, skipping any wrapper header.
+bool BitcodeReader::InitStream() {
+  if (LazyStreamer)
+    return InitLazyStream();
+  return InitStreamFromBuffer();
+}
 
+bool BitcodeReader::InitStreamFromBuffer() {
   unsigned char *BufPtr = (unsigned char *)Buffer->getBufferStart();
   unsigned char *BufEnd = BufPtr+Buffer->getBufferSize();
 
@@ -1575,6 +1678,44 @@ bool BitcodeReader::ParseBitcodeInto(Module *M) {
 
   StreamFile.init(BufPtr, BufEnd);
   Stream.init(StreamFile);
+  return false;
+}
+
+bool BitcodeReader::InitLazyStream() {
+  // The stream takes ownership of the streamer.
+  StreamingMemoryObject *Bytes = new StreamingMemoryObject(LazyStreamer);
+  LazyStreamer = 0;
+  StreamFile.init(Bytes);
+  Stream.init(StreamFile);
+
+  // We can't look ahead in a stream, so read enough of the start to recognize
+  // a wrapper header and strip it off; BitstreamReader never sees it.
+  unsigned char Buf[16];
+  if (Bytes->readBytes(0, 16, Buf, 0) == -1)
+    return Error("Bitcode stream must be at least 16 bytes in length");
+
+  if (!isBitcode(Buf, Buf + 16))
+    return Error("Invalid bitcode signature");
+
+  if (isBitcodeWrapper(Buf, Buf + 4)) {
+    unsigned Offset = Buf[8] | (Buf[9] << 8) | (Buf[10] << 16) | (Buf[11] << 24);
+    unsigned Size = Buf[12] | (Buf[13] << 8) | (Buf[14] << 16) | (Buf[15] << 24);
+    if (Size & 3)
+      return Error("Bitcode stream should be a multiple of 4 bytes in length");
+    // Make sure the wrapped bitcode is really there before committing to it.
+    if (Size == 0 || !Bytes->isValidAddress(uint64_t(Offset) + Size - 1) ||
+        Bytes->dropLeadingBytes(Offset))
+      return Error("Invalid bitcode wrapper header");
+    Bytes->setKnownObjectSize(Size);
+  }
+  return false;
+}
+
+bool BitcodeReader::ParseBitcodeInto(Module *M) {
+  TheModule = 0;
+
+  if (InitStream())
+    return true;
 
   // Sniff for the signature.
   if (Stream.Read(8) != 'B' ||
@@ -1675,20 +1816,8 @@ bool BitcodeReader::ParseModuleTriple(std::string &Triple) {
 }
 
 bool BitcodeReader::ParseTriple(std::string &Triple) {
-  if (Buffer->getBufferSize() & 3)
-    return Error("Bitcode stream should be a multiple of 4 bytes in length");
-
-  unsigned char *BufPtr = (unsigned char *)Buffer->getBufferStart();
-  unsigned char *BufEnd = BufPtr+Buffer->getBufferSize();
-
-  // If we have a wrapper header, parse it and ignore the non-bc file contents.
-  // The magic number is 0x0B17C0DE stored in little endian.
-  if (isBitcodeWrapper(BufPtr, BufEnd))
-    if (SkipBitcodeWrapperHeader(BufPtr, BufEnd))
-      return Error("Invalid bitcode wrapper header");
-
-  StreamFile.init(BufPtr, BufEnd);
-  Stream.init(StreamFile);
+  if (InitStream())
+    return true;
 
   // Sniff for the signature.
   if (Stream.Read(8) != 'B' ||
@@ -2651,6 +2780,24 @@ Module *llvm::getLazyBitcodeModule(MemoryBuffer *Buffer,
   return M;
 }
 
+/// getStreamedBitcodeModule - Read the bitcode from a streamer as its bytes
+/// arrive, preparing for lazy deserialization of function bodies.
+Module *llvm::getStreamedBitcodeModule(const std::string &name,
+                                       DataStreamer *streamer,
+                                       LLVMContext &Context,
+                                       std::string *ErrMsg) {
+  Module *M = new Module(name, Context);
+  BitcodeReader *R = new BitcodeReader(streamer, Context);
+  M->setMaterializer(R);
+  if (R->ParseBitcodeInto(M)) {
+    if (ErrMsg)
+      *ErrMsg = R->getErrorString();
+    delete M;  // Also deletes R.
+    return 0;
+  }
+  return M;
+}
+
 /// ParseBitcodeFile - Read the specified bitcode file, returning the module.
 /// If an error occurs, return null and fill in *ErrMsg if non-null.
 Module *llvm::ParseBitcodeFile(MemoryBuffer *Buffer, LLVMContext& Context,
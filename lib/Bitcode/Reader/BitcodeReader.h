@@ -126,6 +126,7 @@ class BitcodeReader : public GVMaterializer {
   Module *TheModule;
   MemoryBuffer *Buffer;
   bool BufferOwned;
+  DataStreamer *LazyStreamer;
   BitstreamReader StreamFile;
   BitstreamCursor Stream;
   
@@ -168,6 +169,12 @@ class BitcodeReader : public GVMaterializer {
   /// map contains info about where to find deferred function body in the
   /// stream.
   DenseMap<Function*, uint64_t> DeferredFunctionInfo;
+
+  /// FunctionIndexOrigin/FunctionIndexBit - If the module has a function index,
+  /// these are the stream positions its offsets are relative to and of the
+  /// FUNCTION_INDEX block itself.  Both are zero when there is no index.
+  uint64_t FunctionIndexOrigin;
+  uint64_t FunctionIndexBit;
   
   /// BlockAddrFwdRefs - These are blockaddr references to basic blocks.  These
   /// are resolved lazily when functions are loaded.
@@ -183,9 +190,19 @@ class BitcodeReader : public GVMaterializer {
 public:
   explicit BitcodeReader(MemoryBuffer *buffer, LLVMContext &C)
     : Context(C), TheModule(0), Buffer(buffer), BufferOwned(false),
-      ErrorString(0), ValueList(C), MDValueList(C),
+      LazyStreamer(0), ErrorString(0), ValueList(C), MDValueList(C),
+      LLVM2_7MetadataDetected(false) {
+    HasReversedFunctionsWithBodies = false;
+    FunctionIndexOrigin = FunctionIndexBit = 0;
+  }
+  /// BitcodeReader - Read from a stream of bytes that arrive incrementally.
+  /// The reader takes ownership of the streamer.
+  explicit BitcodeReader(DataStreamer *streamer, LLVMContext &C)
+    : Context(C), TheModule(0), Buffer(0), BufferOwned(false),
+      LazyStreamer(streamer), ErrorString(0), ValueList(C), MDValueList(C),
       LLVM2_7MetadataDetected(false) {
     HasReversedFunctionsWithBodies = false;
+    FunctionIndexOrigin = FunctionIndexBit = 0;
   }
   ~BitcodeReader() {
     FreeState();
@@ -270,11 +287,15 @@ private:
   bool ParseValueSymbolTable();
   bool ParseConstants();
   bool RememberAndSkipFunctionBody();
+  bool ParseFunctionIndex();
   bool ParseFunctionBody(Function *F);
   bool ResolveGlobalAndAliasInits();
   bool ParseMetadata();
   bool ParseMetadataAttachment();
   bool ParseModuleTriple(std::string &Triple);
+  bool InitStream();
+  bool InitStreamFromBuffer();
+  bool InitLazyStream();
 };
   
 } // End llvm namespace
@@ -23,13 +23,19 @@
 #include "llvm/Operator.h"
 #include "llvm/TypeSymbolTable.h"
 #include "llvm/ValueSymbolTable.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/Program.h"
+#include "llvm/Support/Threading.h"
 #include <cctype>
 using namespace llvm;
 
+static cl::opt<unsigned>
+WriterThreads("bitcode-writer-threads", cl::Hidden, cl::init(1),
+              cl::desc("Number of threads used to encode function bodies"));
+
 /// These are manifest constants used by the bitcode writer. They do not need to
 /// be kept in sync with the reader, but need to be consistent within this file.
 enum {
@@ -1206,10 +1212,10 @@ static void WriteValueSymbolTable(const ValueSymbolTable &VST,
   Stream.ExitBlock();
 }
 
-/// WriteFunction - Emit a function body to the module stream.
-static void WriteFunction(const Function &F, ValueEnumerator &VE,
-                          BitstreamWriter &Stream) {
-  Stream.EnterSubblock(bitc::FUNCTION_BLOCK_ID, 4);
+/// WriteFunctionBlockContents - Emit the records and sub-blocks of a function
+/// block.
+static void WriteFunctionBlockContents(const Function &F, ValueEnumerator &VE,
+                                       BitstreamWriter &Stream) {
   VE.incorporateFunction(F);
 
   SmallVector<unsigned, 64> Vals;
@@ -1275,6 +1281,13 @@ static void WriteFunction(const Function &F, ValueEnumerator &VE,
   if (NeedsMetadataAttachment)
     WriteMetadataAttachment(F, VE, Stream);
   VE.purgeFunction();
+}
+
+/// WriteFunction - Emit a function body to the module stream.
+static void WriteFunction(const Function &F, ValueEnumerator &VE,
+                          BitstreamWriter &Stream) {
+  Stream.EnterSubblock(bitc::FUNCTION_BLOCK_ID, 4);
+  WriteFunctionBlockContents(F, VE, Stream);
   Stream.ExitBlock();
 }
 
@@ -1480,6 +1493,139 @@ static void WriteBlockInfo(const ValueEnumerator &VE, BitstreamWriter &Stream) {
 }
 
 
+namespace {
+/// FunctionEncoder - A run of consecutive function bodies which is encoded
+/// into a private buffer, possibly on another thread.
+struct FunctionEncoder {
+  const ValueEnumerator *ModuleVE;
+  const BitstreamWriter *ModuleStream;
+  std::vector<const Function*> Functions;
+  std::vector<unsigned char> Buffer;
+
+  /// Blocks - The range of Buffer holding each function's block, starting at
+  /// its size word.
+  std::vector<std::pair<size_t, size_t> > Blocks;
+};
+}
+
+/// EncodeFunctions - Encode the function blocks for a FunctionEncoder.
+static void EncodeFunctions(void *Arg) {
+  FunctionEncoder &FE = *static_cast<FunctionEncoder*>(Arg);
+  if (FE.Functions.empty())
+    return;
+
+  // Starting from copies of the module stream's enumerator and blockinfo
+  // abbrevs, the function blocks come out exactly as they would there.  Both
+  // are only read while the encoders run.
+  ValueEnumerator VE(*FE.ModuleVE);
+  BitstreamWriter Stream(FE.Buffer);
+  Stream.CopyBlockInfo(*FE.ModuleStream);
+
+  for (unsigned i = 0, e = FE.Functions.size(); i != e; ++i) {
+    Stream.EnterSubblock(bitc::FUNCTION_BLOCK_ID, 4);
+    size_t Begin = FE.Buffer.size() - 4;
+    WriteFunctionBlockContents(*FE.Functions[i], VE, Stream);
+    Stream.ExitBlock();
+    FE.Blocks.push_back(std::make_pair(Begin, FE.Buffer.size()));
+  }
+}
+
+/// WriteFunctionsInParallel - Split the function bodies into runs of roughly
+/// equal size, encode each run on its own thread, and then copy the blocks
+/// into the module stream in order.  The output is identical to emitting each
+/// function with WriteFunction.
+static void WriteFunctionsInParallel(const ValueEnumerator &VE,
+                                 const std::vector<const Function*> &Bodies,
+                                 unsigned NumThreads,
+                                 SmallVectorImpl<uint64_t> &BodyStarts,
+                                 BitstreamWriter &Stream) {
+  std::vector<size_t> Sizes;
+  size_t TotalSize = 0;
+  for (unsigned i = 0, e = Bodies.size(); i != e; ++i) {
+    size_t Size = 0;
+    for (Function::const_iterator BB = Bodies[i]->begin(),
+         E = Bodies[i]->end(); BB != E; ++BB)
+      Size += BB->size();
+    Sizes.push_back(Size);
+    TotalSize += Size;
+  }
+
+  std::vector<FunctionEncoder> Encoders(NumThreads);
+  size_t SizeSoFar = 0;
+  for (unsigned i = 0, e = Bodies.size(); i != e; ++i) {
+    unsigned Idx = unsigned(SizeSoFar * NumThreads / (TotalSize + 1));
+    Encoders[Idx].Functions.push_back(Bodies[i]);
+    SizeSoFar += Sizes[i];
+  }
+
+  // The calling thread takes the last run rather than sitting idle.
+  std::vector<llvm_thread*> Threads;
+  for (unsigned i = 0; i != NumThreads; ++i) {
+    Encoders[i].ModuleVE = &VE;
+    Encoders[i].ModuleStream = &Stream;
+    if (i + 1 != NumThreads)
+      Threads.push_back(llvm_start_thread(EncodeFunctions, &Encoders[i]));
+    else
+      EncodeFunctions(&Encoders[i]);
+  }
+  for (unsigned i = 0, e = Threads.size(); i != e; ++i)
+    llvm_join_thread(Threads[i]);
+
+  for (unsigned i = 0; i != NumThreads; ++i) {
+    FunctionEncoder &FE = Encoders[i];
+    const unsigned char *Buf = FE.Buffer.empty() ? 0 : &FE.Buffer[0];
+    for (unsigned j = 0, e = FE.Blocks.size(); j != e; ++j) {
+      BodyStarts.push_back(Stream.GetCurrentBitNo());
+      Stream.EmitEncodedBlock(bitc::FUNCTION_BLOCK_ID, 4,
+                              Buf + FE.Blocks[j].first,
+                              Buf + FE.Blocks[j].second);
+    }
+    // Release each buffer once it has been copied.
+    std::vector<unsigned char>().swap(FE.Buffer);
+  }
+}
+
+/// WriteFunctionIndexPlaceholder - Emit a MODULE_CODE_FUNCINDEX record with a
+/// zero offset and return the bit position just past it.  All offsets in the
+/// function index are relative to that position, and WriteFunctionIndex fills
+/// in the real offset once the function bodies have been written.
+static uint64_t WriteFunctionIndexPlaceholder(BitstreamWriter &Stream) {
+  BitCodeAbbrev *Abbv = new BitCodeAbbrev();
+  Abbv->Add(BitCodeAbbrevOp(bitc::MODULE_CODE_FUNCINDEX));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 32));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 32));
+  unsigned FuncIndexAbbrev = Stream.EmitAbbrev(Abbv);
+
+  SmallVector<unsigned, 2> Vals;
+  Vals.push_back(0);
+  Vals.push_back(0);
+  Stream.EmitRecord(bitc::MODULE_CODE_FUNCINDEX, Vals, FuncIndexAbbrev);
+  return Stream.GetCurrentBitNo();
+}
+
+/// WriteFunctionIndex - Emit the FUNCTION_INDEX block describing where each
+/// function body starts, and point the placeholder record at it.
+static void WriteFunctionIndex(uint64_t IndexOrigin,
+                               const SmallVectorImpl<uint64_t> &BodyStarts,
+                               BitstreamWriter &Stream) {
+  // The two fixed-width fields are the last 64 bits of the placeholder.
+  uint64_t IndexOffset = Stream.GetCurrentBitNo() - IndexOrigin;
+  Stream.BackpatchWordAtBit(IndexOrigin - 64, (uint32_t)IndexOffset);
+  Stream.BackpatchWordAtBit(IndexOrigin - 32, (uint32_t)(IndexOffset >> 32));
+
+  Stream.EnterSubblock(bitc::FUNCTION_INDEX_BLOCK_ID, 3);
+
+  SmallVector<uint64_t, 64> Vals;
+  uint64_t Prev = IndexOrigin;
+  for (unsigned i = 0, e = BodyStarts.size(); i != e; ++i) {
+    Vals.push_back(BodyStarts[i] - Prev);
+    Prev = BodyStarts[i];
+  }
+  Stream.EmitRecord(bitc::FUNCINDEX_CODE_OFFSETS, Vals);
+
+  Stream.ExitBlock();
+}
+
 /// WriteModule - Emit the specified module to the bitstream.
 static void WriteModule(const Module *M, BitstreamWriter &Stream) {
   Stream.EnterSubblock(bitc::MODULE_BLOCK_ID, 3);
@@ -1513,10 +1659,32 @@ static void WriteModule(const Module *M, BitstreamWriter &Stream) {
   // Emit metadata.
   WriteModuleMetadata(M, VE, Stream);
 
-  // Emit function bodies.
+  // Emit function bodies, remembering where each one starts so that the
+  // reader can find them without walking every function block.
+  std::vector<const Function*> Bodies;
   for (Module::const_iterator I = M->begin(), E = M->end(); I != E; ++I)
     if (!I->isDeclaration())
-      WriteFunction(*I, VE, Stream);
+      Bodies.push_back(I);
+
+  if (!Bodies.empty()) {
+    SmallVector<uint64_t, 64> BodyStarts;
+    uint64_t IndexOrigin = WriteFunctionIndexPlaceholder(Stream);
+
+    // Function blocks only refer to IDs assigned by the module-level
+    // enumeration, so they can be encoded independently of each other.
+    unsigned NumThreads = std::min<size_t>(WriterThreads, Bodies.size());
+    if (NumThreads > 1) {
+      WriteFunctionsInParallel(VE, Bodies, NumThreads, BodyStarts, Stream);
+    } else {
+      for (unsigned i = 0, e = Bodies.size(); i != e; ++i) {
+        BodyStarts.push_back(Stream.GetCurrentBitNo());
+        WriteFunction(*Bodies[i], VE, Stream);
+      }
+    }
+
+    // Emit the function index.
+    WriteFunctionIndex(IndexOrigin, BodyStarts, Stream);
+  }
 
   // Emit metadata.
   WriteModuleMetadataStore(M, Stream);
@@ -79,11 +79,14 @@ private:
   unsigned FirstFuncConstantID;
   unsigned FirstInstID;
   
-  ValueEnumerator(const ValueEnumerator &);  // DO NOT IMPLEMENT
   void operator=(const ValueEnumerator &);   // DO NOT IMPLEMENT
 public:
   ValueEnumerator(const Module *M);
 
+  // The implicit copy constructor is used by the parallel writer, which gives
+  // each thread a copy of the module-level enumeration to incorporate its
+  // functions into.
+
   unsigned getValueID(const Value *V) const;
 
   unsigned getTypeID(const Type *T) const {
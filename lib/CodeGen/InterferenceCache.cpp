@@ -14,9 +14,14 @@
 #define DEBUG_TYPE "regalloc"
 #include "InterferenceCache.h"
 #include "llvm/Target/TargetRegisterInfo.h"
+#include "llvm/ADT/Statistic.h"
 
 using namespace llvm;
 
+STATISTIC(NumCacheHits,     "Number of interference cache entry hits");
+STATISTIC(NumCacheMisses,   "Number of interference cache entry misses");
+STATISTIC(NumRevalidations, "Number of interference cache revalidations");
+
 void InterferenceCache::init(MachineFunction *mf,
                              LiveIntervalUnion *liuarray,
                              SlotIndexes *indexes,
@@ -25,6 +30,7 @@ void InterferenceCache::init(MachineFunction *mf,
   LIUArray = liuarray;
   TRI = tri;
   PhysRegEntries.assign(TRI->getNumRegs(), 0);
+  Hits = Misses = 0;
   for (unsigned i = 0; i != CacheEntries; ++i)
     Entries[i].clear(mf, indexes);
 }
@@ -32,10 +38,16 @@ void InterferenceCache::init(MachineFunction *mf,
 InterferenceCache::Entry *InterferenceCache::get(unsigned PhysReg) {
   unsigned E = PhysRegEntries[PhysReg];
   if (E < CacheEntries && Entries[E].getPhysReg() == PhysReg) {
-    if (!Entries[E].valid(LIUArray, TRI))
+    ++NumCacheHits;
+    ++Hits;
+    if (!Entries[E].valid(LIUArray, TRI)) {
+      ++NumRevalidations;
       Entries[E].revalidate();
+    }
     return &Entries[E];
   }
+  ++NumCacheMisses;
+  ++Misses;
   // No valid entry exists, pick the next round-robin entry.
   E = RoundRobin;
   if (++RoundRobin == CacheEntries)
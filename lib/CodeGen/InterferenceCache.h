@@ -109,6 +109,9 @@ class InterferenceCache {
   // Next round-robin entry to be picked.
   unsigned RoundRobin;
 
+  // Entry hits and misses in the current function.
+  unsigned Hits, Misses;
+
   // The actual cache entries.
   Entry Entries[CacheEntries];
 
@@ -116,12 +119,21 @@ class InterferenceCache {
   Entry *get(unsigned PhysReg);
 
 public:
-  InterferenceCache() : TRI(0), LIUArray(0), Indexes(0), MF(0), RoundRobin(0) {}
+  InterferenceCache() : TRI(0), LIUArray(0), Indexes(0), MF(0), RoundRobin(0),
+    Hits(0), Misses(0) {}
 
   /// init - Prepare cache for a new function.
   void init(MachineFunction*, LiveIntervalUnion*, SlotIndexes*,
             const TargetRegisterInfo *);
 
+  /// getNumHits - Return the number of cursors created for a physreg that
+  /// already had a cache entry since the last init().
+  unsigned getNumHits() const { return Hits; }
+
+  /// getNumMisses - Return the number of cache entries that had to be reset
+  /// for a new physreg since the last init().
+  unsigned getNumMisses() const { return Misses; }
+
   /// Cursor - The primary query interface for the block interference cache.
   class Cursor {
     Entry *CacheEntry;
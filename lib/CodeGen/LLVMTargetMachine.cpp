@@ -60,6 +60,8 @@ static cl::opt<bool> DisableMachineSink("disable-machine-sink", cl::Hidden,
     cl::desc("Disable Machine Sinking"));
 static cl::opt<bool> DisableLSR("disable-lsr", cl::Hidden,
     cl::desc("Disable Loop Strength Reduction Pass"));
+static cl::opt<bool> DisableSLP("disable-slp-vectorizer", cl::Hidden,
+    cl::desc("Disable the SLP vectorizer at -O3"));
 static cl::opt<bool> DisableCGP("disable-cgp", cl::Hidden,
     cl::desc("Disable Codegen Prepare"));
 static cl::opt<bool> PrintLSR("print-lsr-output", cl::Hidden,
@@ -298,7 +300,12 @@ bool LLVMTargetMachine::addCommonCodeGenPasses(PassManagerBase &PM,
   if (!DisableVerify)
     PM.add(createVerifierPass());
 
-  // Run loop strength reduction before anything else.
+  // Pack isomorphic straight-line code into vector operations the target
+  // supports.
+  if (OptLevel == CodeGenOpt::Aggressive && !DisableSLP)
+    PM.add(createSLPVectorizerPass(getTargetLowering()));
+
+  // Run loop strength reduction before any lowering.
   if (OptLevel != CodeGenOpt::None && !DisableLSR) {
     PM.add(createLoopStrengthReducePass(getTargetLowering()));
     if (PrintLSR)
@@ -452,6 +452,7 @@ raw_ostream &llvm::operator<<(raw_ostream &OS, const MachineMemOperand &MMO) {
 /// TID NULL and no operands.
 MachineInstr::MachineInstr()
   : TID(0), NumImplicitOps(0), Flags(0), AsmPrinterFlags(0),
+    NumOperands(0), Operands(0), MF(0),
     MemRefs(0), MemRefsEnd(0),
     Parent(0) {
   // Make sure that we get added to a machine basicblock
@@ -470,69 +471,34 @@ void MachineInstr::addImplicitDefUseOperands() {
 /// MachineInstr ctor - This constructor creates a MachineInstr and adds the
 /// implicit operands. It reserves space for the number of operands specified by
 /// the TargetInstrDesc.
-MachineInstr::MachineInstr(const TargetInstrDesc &tid, bool NoImp)
-  : TID(&tid), NumImplicitOps(0), Flags(0), AsmPrinterFlags(0),
-    MemRefs(0), MemRefsEnd(0), Parent(0) {
-  if (!NoImp)
-    NumImplicitOps = TID->getNumImplicitDefs() + TID->getNumImplicitUses();
-  Operands.reserve(NumImplicitOps + TID->getNumOperands());
-  if (!NoImp)
-    addImplicitDefUseOperands();
-  // Make sure that we get added to a machine basicblock
-  LeakDetector::addGarbageObject(this);
-}
-
-/// MachineInstr ctor - As above, but with a DebugLoc.
-MachineInstr::MachineInstr(const TargetInstrDesc &tid, const DebugLoc dl,
-                           bool NoImp)
+MachineInstr::MachineInstr(MachineFunction &mf, const TargetInstrDesc &tid,
+                           const DebugLoc dl, bool NoImp)
   : TID(&tid), NumImplicitOps(0), Flags(0), AsmPrinterFlags(0),
+    NumOperands(0), Operands(0), MF(&mf),
     MemRefs(0), MemRefsEnd(0), Parent(0), debugLoc(dl) {
   if (!NoImp)
     NumImplicitOps = TID->getNumImplicitDefs() + TID->getNumImplicitUses();
-  Operands.reserve(NumImplicitOps + TID->getNumOperands());
+  if (unsigned NumOps = NumImplicitOps + TID->getNumOperands()) {
+    CapOperands = OperandCapacity::get(NumOps);
+    Operands = MF->allocateOperandArray(CapOperands);
+  }
   if (!NoImp)
     addImplicitDefUseOperands();
   // Make sure that we get added to a machine basicblock
   LeakDetector::addGarbageObject(this);
 }
 
-/// MachineInstr ctor - Work exactly the same as the ctor two above, except
-/// that the MachineInstr is created and added to the end of the specified 
-/// basic block.
-MachineInstr::MachineInstr(MachineBasicBlock *MBB, const TargetInstrDesc &tid)
-  : TID(&tid), NumImplicitOps(0), Flags(0), AsmPrinterFlags(0),
-    MemRefs(0), MemRefsEnd(0), Parent(0) {
-  assert(MBB && "Cannot use inserting ctor with null basic block!");
-  NumImplicitOps = TID->getNumImplicitDefs() + TID->getNumImplicitUses();
-  Operands.reserve(NumImplicitOps + TID->getNumOperands());
-  addImplicitDefUseOperands();
-  // Make sure that we get added to a machine basicblock
-  LeakDetector::addGarbageObject(this);
-  MBB->push_back(this);  // Add instruction to end of basic block!
-}
-
-/// MachineInstr ctor - As above, but with a DebugLoc.
-///
-MachineInstr::MachineInstr(MachineBasicBlock *MBB, const DebugLoc dl,
-                           const TargetInstrDesc &tid)
-  : TID(&tid), NumImplicitOps(0), Flags(0), AsmPrinterFlags(0),
-    MemRefs(0), MemRefsEnd(0), Parent(0), debugLoc(dl) {
-  assert(MBB && "Cannot use inserting ctor with null basic block!");
-  NumImplicitOps = TID->getNumImplicitDefs() + TID->getNumImplicitUses();
-  Operands.reserve(NumImplicitOps + TID->getNumOperands());
-  addImplicitDefUseOperands();
-  // Make sure that we get added to a machine basicblock
-  LeakDetector::addGarbageObject(this);
-  MBB->push_back(this);  // Add instruction to end of basic block!
-}
-
 /// MachineInstr ctor - Copies MachineInstr arg exactly
 ///
-MachineInstr::MachineInstr(MachineFunction &MF, const MachineInstr &MI)
+MachineInstr::MachineInstr(MachineFunction &mf, const MachineInstr &MI)
   : TID(&MI.getDesc()), NumImplicitOps(0), Flags(0), AsmPrinterFlags(0),
+    NumOperands(0), Operands(0), MF(&mf),
     MemRefs(MI.MemRefs), MemRefsEnd(MI.MemRefsEnd),
     Parent(0), debugLoc(MI.getDebugLoc()) {
-  Operands.reserve(MI.getNumOperands());
+  if (unsigned NumOps = MI.getNumOperands()) {
+    CapOperands = OperandCapacity::get(NumOps);
+    Operands = MF->allocateOperandArray(CapOperands);
+  }
 
   // Add operands
   for (unsigned i = 0; i != MI.getNumOperands(); ++i)
@@ -551,12 +517,14 @@ MachineInstr::MachineInstr(MachineFunction &MF, const MachineInstr &MI)
 MachineInstr::~MachineInstr() {
   LeakDetector::removeGarbageObject(this);
 #ifndef NDEBUG
-  for (unsigned i = 0, e = Operands.size(); i != e; ++i) {
+  for (unsigned i = 0, e = NumOperands; i != e; ++i) {
     assert(Operands[i].ParentMI == this && "ParentMI mismatch!");
     assert((!Operands[i].isReg() || !Operands[i].isOnRegUseList()) &&
            "Reg operand def/use list corrupted");
   }
 #endif
+  if (Operands)
+    MF->deallocateOperandArray(CapOperands, Operands);
 }
 
 /// getRegInfo - If this instruction is embedded into a MachineFunction,
@@ -572,7 +540,7 @@ MachineRegisterInfo *MachineInstr::getRegInfo() {
 /// this instruction from their respective use lists.  This requires that the
 /// operands already be on their use lists.
 void MachineInstr::RemoveRegOperandsFromUseLists() {
-  for (unsigned i = 0, e = Operands.size(); i != e; ++i) {
+  for (unsigned i = 0, e = NumOperands; i != e; ++i) {
     if (Operands[i].isReg())
       Operands[i].RemoveRegOperandFromRegInfo();
   }
@@ -582,7 +550,7 @@ void MachineInstr::RemoveRegOperandsFromUseLists() {
 /// this instruction from their respective use lists.  This requires that the
 /// operands not be on their use lists yet.
 void MachineInstr::AddRegOperandsToUseLists(MachineRegisterInfo &RegInfo) {
-  for (unsigned i = 0, e = Operands.size(); i != e; ++i) {
+  for (unsigned i = 0, e = NumOperands; i != e; ++i) {
     if (Operands[i].isReg())
       Operands[i].AddRegOperandToRegInfo(&RegInfo);
   }
@@ -597,113 +565,85 @@ void MachineInstr::addOperand(const MachineOperand &Op) {
   bool isImpReg = Op.isReg() && Op.isImplicit();
   assert((isImpReg || !OperandsComplete()) &&
          "Trying to add an operand to a machine instr that is already done!");
+  assert(MF && "Cannot add operands to a dummy instruction!");
+
+  // Op may be one of this instruction's own operands, as in
+  // MI->addOperand(MI->getOperand(i)).  The operands are about to be moved
+  // and unlinked from their use lists, so add a copy instead.
+  if (&Op >= Operands && &Op < Operands + NumOperands) {
+    MachineOperand CopyOp(Op);
+    return addOperand(CopyOp);
+  }
 
   MachineRegisterInfo *RegInfo = getRegInfo();
 
-  // If we are adding the operand to the end of the list, our job is simpler.
-  // This is true most of the time, so this is a reasonable optimization.
-  if (isImpReg || NumImplicitOps == 0) {
-    // We can only do this optimization if we know that the operand list won't
-    // reallocate.
-    if (Operands.empty() || Operands.size()+1 <= Operands.capacity()) {
-      Operands.push_back(Op);
-    
-      // Set the parent of the operand.
-      Operands.back().ParentMI = this;
-  
-      // If the operand is a register, update the operand's use list.
-      if (Op.isReg()) {
-        Operands.back().AddRegOperandToRegInfo(RegInfo);
-        // If the register operand is flagged as early, mark the operand as such
-        unsigned OpNo = Operands.size() - 1;
-        if (TID->getOperandConstraint(OpNo, TOI::EARLY_CLOBBER) != -1)
-          Operands[OpNo].setIsEarlyClobber(true);
-      }
-      return;
-    }
-  }
-  
-  // Otherwise, we have to insert a real operand before any implicit ones.
-  unsigned OpNo = Operands.size()-NumImplicitOps;
-
-  // If this instruction isn't embedded into a function, then we don't need to
-  // update any operand lists.
-  if (RegInfo == 0) {
-    // Simple insertion, no reginfo update needed for other register operands.
-    Operands.insert(Operands.begin()+OpNo, Op);
-    Operands[OpNo].ParentMI = this;
-
-    // Do explicitly set the reginfo for this operand though, to ensure the
-    // next/prev fields are properly nulled out.
-    if (Operands[OpNo].isReg()) {
-      Operands[OpNo].AddRegOperandToRegInfo(0);
-      // If the register operand is flagged as early, mark the operand as such
-      if (TID->getOperandConstraint(OpNo, TOI::EARLY_CLOBBER) != -1)
-        Operands[OpNo].setIsEarlyClobber(true);
-    }
+  // Implicit operands go at the end of the list. Explicit operands are
+  // inserted before the first implicit one.
+  unsigned OpNo = NumOperands;
+  if (!isImpReg)
+    OpNo -= NumImplicitOps;
+
+  // If the operand list is full, it is moved to an array of twice the
+  // capacity. Register operands are linked into their use lists by address,
+  // so every operand that moves must be unlinked first and relinked after.
+  MachineOperand *OldOperands = Operands;
+  OperandCapacity OldCap = CapOperands;
+  bool Reallocate = !Operands || NumOperands == CapOperands.getSize();
+  unsigned FirstMoved = Reallocate ? 0 : OpNo;
+
+  if (RegInfo)
+    for (unsigned i = FirstMoved; i != NumOperands; ++i)
+      if (Operands[i].isReg())
+        Operands[i].RemoveRegOperandFromRegInfo();
 
-  } else if (Operands.size()+1 <= Operands.capacity()) {
-    // Otherwise, we have to remove register operands from their register use
-    // list, add the operand, then add the register operands back to their use
-    // list.  This also must handle the case when the operand list reallocates
-    // to somewhere else.
-  
-    // If insertion of this operand won't cause reallocation of the operand
-    // list, just remove the implicit operands, add the operand, then re-add all
-    // the rest of the operands.
-    for (unsigned i = OpNo, e = Operands.size(); i != e; ++i) {
-      assert(Operands[i].isReg() && "Should only be an implicit reg!");
-      Operands[i].RemoveRegOperandFromRegInfo();
-    }
-    
-    // Add the operand.  If it is a register, add it to the reg list.
-    Operands.insert(Operands.begin()+OpNo, Op);
-    Operands[OpNo].ParentMI = this;
-
-    if (Operands[OpNo].isReg()) {
-      Operands[OpNo].AddRegOperandToRegInfo(RegInfo);
-      // If the register operand is flagged as early, mark the operand as such
-      if (TID->getOperandConstraint(OpNo, TOI::EARLY_CLOBBER) != -1)
-        Operands[OpNo].setIsEarlyClobber(true);
-    }
-    
-    // Re-add all the implicit ops.
-    for (unsigned i = OpNo+1, e = Operands.size(); i != e; ++i) {
-      assert(Operands[i].isReg() && "Should only be an implicit reg!");
-      Operands[i].AddRegOperandToRegInfo(RegInfo);
-    }
-  } else {
-    // Otherwise, we will be reallocating the operand list.  Remove all reg
-    // operands from their list, then readd them after the operand list is
-    // reallocated.
-    RemoveRegOperandsFromUseLists();
-    
-    Operands.insert(Operands.begin()+OpNo, Op);
-    Operands[OpNo].ParentMI = this;
-  
-    // Re-add all the operands.
-    AddRegOperandsToUseLists(*RegInfo);
+  if (Reallocate) {
+    CapOperands = Operands ? CapOperands.getNext() : OperandCapacity::get(1);
+    Operands = MF->allocateOperandArray(CapOperands);
+    for (unsigned i = 0; i != OpNo; ++i)
+      new (&Operands[i]) MachineOperand(OldOperands[i]);
+  }
 
-      // If the register operand is flagged as early, mark the operand as such
-    if (Operands[OpNo].isReg()
-        && TID->getOperandConstraint(OpNo, TOI::EARLY_CLOBBER) != -1)
+  // Shift the operands after OpNo up by one, starting from the end.
+  for (unsigned i = NumOperands; i != OpNo; --i)
+    new (&Operands[i]) MachineOperand(
+      Reallocate ? OldOperands[i - 1] : Operands[i - 1]);
+
+  if (Reallocate && OldOperands)
+    MF->deallocateOperandArray(OldCap, OldOperands);
+
+  // Add the operand.  If it is a register, add it to the reg list. This also
+  // makes sure the next/prev fields are properly nulled out when there is no
+  // reg info.
+  new (&Operands[OpNo]) MachineOperand(Op);
+  Operands[OpNo].ParentMI = this;
+  ++NumOperands;
+  if (Operands[OpNo].isReg()) {
+    Operands[OpNo].AddRegOperandToRegInfo(RegInfo);
+    // If the register operand is flagged as early, mark the operand as such
+    if (TID->getOperandConstraint(OpNo, TOI::EARLY_CLOBBER) != -1)
       Operands[OpNo].setIsEarlyClobber(true);
   }
+
+  // Re-add all the operands that moved.
+  if (RegInfo)
+    for (unsigned i = FirstMoved; i != NumOperands; ++i)
+      if (i != OpNo && Operands[i].isReg())
+        Operands[i].AddRegOperandToRegInfo(RegInfo);
 }
 
 /// RemoveOperand - Erase an operand  from an instruction, leaving it with one
 /// fewer operand than it started with.
 ///
 void MachineInstr::RemoveOperand(unsigned OpNo) {
-  assert(OpNo < Operands.size() && "Invalid operand number");
+  assert(OpNo < NumOperands && "Invalid operand number");
   
   // Special case removing the last one.
-  if (OpNo == Operands.size()-1) {
+  if (OpNo == NumOperands-1) {
     // If needed, remove from the reg def/use list.
-    if (Operands.back().isReg() && Operands.back().isOnRegUseList())
-      Operands.back().RemoveRegOperandFromRegInfo();
+    if (Operands[OpNo].isReg() && Operands[OpNo].isOnRegUseList())
+      Operands[OpNo].RemoveRegOperandFromRegInfo();
     
-    Operands.pop_back();
+    --NumOperands;
     return;
   }
 
@@ -712,16 +652,18 @@ void MachineInstr::RemoveOperand(unsigned OpNo) {
   // move everything down, then re-add them.
   MachineRegisterInfo *RegInfo = getRegInfo();
   if (RegInfo) {
-    for (unsigned i = OpNo, e = Operands.size(); i != e; ++i) {
+    for (unsigned i = OpNo, e = NumOperands; i != e; ++i) {
       if (Operands[i].isReg())
         Operands[i].RemoveRegOperandFromRegInfo();
     }
   }
   
-  Operands.erase(Operands.begin()+OpNo);
+  for (unsigned i = OpNo + 1; i != NumOperands; ++i)
+    Operands[i - 1] = Operands[i];
+  --NumOperands;
 
   if (RegInfo) {
-    for (unsigned i = OpNo, e = Operands.size(); i != e; ++i) {
+    for (unsigned i = OpNo, e = NumOperands; i != e; ++i) {
       if (Operands[i].isReg())
         Operands[i].AddRegOperandToRegInfo(RegInfo);
     }
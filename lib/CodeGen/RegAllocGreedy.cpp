@@ -39,8 +39,10 @@
 #include "llvm/CodeGen/RegAllocRegistry.h"
 #include "llvm/CodeGen/RegisterCoalescer.h"
 #include "llvm/Target/TargetOptions.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/Format.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/Timer.h"
 
@@ -51,6 +53,22 @@ using namespace llvm;
 STATISTIC(NumGlobalSplits, "Number of split global live ranges");
 STATISTIC(NumLocalSplits,  "Number of split local live ranges");
 STATISTIC(NumEvicted,      "Number of interferences evicted");
+STATISTIC(NumEvictTries,   "Number of live ranges tried for eviction");
+STATISTIC(NumRegionCands,  "Number of region split candidates examined");
+STATISTIC(NumRegionCosts,  "Number of region split candidates grown");
+STATISTIC(NumLocalTries,   "Number of live ranges tried for local splitting");
+STATISTIC(NumSpilled,      "Number of live ranges spilled");
+STATISTIC(NumOverBudget,   "Number of region splits cut short by the budget");
+
+static cl::opt<int>
+ReportThreshold("greedy-report-ms", cl::Hidden, cl::init(-1),
+  cl::desc("Print a one line allocation report to stderr for each function "
+           "that takes at least this many milliseconds (-1 = never)"));
+
+static cl::opt<unsigned>
+RegionSplitBudget("greedy-region-split-budget", cl::Hidden, cl::init(0),
+  cl::desc("Maximum number of basic blocks visited while evaluating region "
+           "split candidates for one live range (0 = unlimited)"));
 
 static RegisterRegAlloc greedyRegAlloc("greedy", "greedy register allocator",
                                        createGreedyRegisterAllocator);
@@ -147,6 +165,17 @@ class RAGreedy : public MachineFunctionPass,
   /// instruction.
   SmallVector<SlotIndex, 8> PrevSlot;
 
+  /// Per-function counters for the greedy-report-ms report. These mirror
+  /// the STATISTICs above, but are reset for every function so that
+  /// pathological functions can be identified.
+  struct FunctionCounters {
+    unsigned EvictTries, Evicted;
+    unsigned RegionCands, RegionCosts, RegionSplits, OverBudget;
+    unsigned LocalTries, LocalSplits;
+    unsigned Spilled;
+  };
+  FunctionCounters Counters;
+
 public:
   RAGreedy();
 
@@ -174,6 +203,7 @@ private:
   bool LRE_CanEraseVirtReg(unsigned);
   void LRE_WillShrinkVirtReg(unsigned);
   void LRE_DidCloneVirtReg(unsigned, unsigned);
+  void printReport(double Seconds);
 
   bool addSplitConstraints(InterferenceCache::Cursor, float&);
   void addThroughConstraints(InterferenceCache::Cursor, ArrayRef<unsigned>);
@@ -373,6 +403,8 @@ unsigned RAGreedy::tryEvict(LiveInterval &VirtReg,
                             AllocationOrder &Order,
                             SmallVectorImpl<LiveInterval*> &NewVRegs){
   NamedRegionTimer T("Evict", TimerGroupName, TimePassesIsEnabled);
+  ++NumEvictTries;
+  ++Counters.EvictTries;
 
   // Keep track of the lightest single interference seen so far.
   float BestWeight = VirtReg.weight;
@@ -409,6 +441,7 @@ unsigned RAGreedy::tryEvict(LiveInterval &VirtReg,
       LiveInterval *Intf = Q.interferingVRegs()[i];
       unassign(*Intf, VRM->getPhys(Intf->reg));
       ++NumEvicted;
+      ++Counters.Evicted;
       NewVRegs.push_back(Intf);
     }
   }
@@ -848,6 +881,7 @@ void RAGreedy::splitAroundRegion(LiveInterval &VirtReg,
   // separate into connected components. Some components may be allocatable.
   SE->finish();
   ++NumGlobalSplits;
+  ++Counters.RegionSplits;
 
   if (VerifyEnabled)
     MF->verify(this, "After splitting live range around region");
@@ -855,15 +889,37 @@ void RAGreedy::splitAroundRegion(LiveInterval &VirtReg,
 
 unsigned RAGreedy::tryRegionSplit(LiveInterval &VirtReg, AllocationOrder &Order,
                                   SmallVectorImpl<LiveInterval*> &NewVRegs) {
+  NamedRegionTimer T("Region Splitting", TimerGroupName, TimePassesIsEnabled);
   float BestCost = 0;
   const unsigned NoCand = ~0u;
   unsigned BestCand = NoCand;
 
+  // Evaluating a candidate visits every block with a use to compute the
+  // static cost, and growing its region visits every live block. In huge
+  // functions, doing that for every physreg in the allocation order for every
+  // live range is superlinear, so the budget caps the blocks visited per live
+  // range. When it runs out, the best candidate so far is used, or, if there
+  // is none, trySplit falls back to splitting around single blocks.
+  unsigned UseBlocks = SA->getUseBlocks().size();
+  unsigned LiveBlocks = UseBlocks + SA->getNumThroughBlocks();
+  unsigned Visited = 0;
+
   Order.rewind();
   for (unsigned Cand = 0; unsigned PhysReg = Order.next(); ++Cand) {
+    if (RegionSplitBudget && Visited >= RegionSplitBudget) {
+      DEBUG(dbgs() << "Region split budget exhausted after " << Cand
+                   << " candidates.\n");
+      ++NumOverBudget;
+      ++Counters.OverBudget;
+      break;
+    }
+    Visited += UseBlocks;
+
     if (GlobalCand.size() <= Cand)
       GlobalCand.resize(Cand+1);
     GlobalCand[Cand].reset(PhysReg);
+    ++NumRegionCands;
+    ++Counters.RegionCands;
 
     SpillPlacer->prepare(GlobalCand[Cand].LiveBundles);
     float Cost;
@@ -878,6 +934,9 @@ unsigned RAGreedy::tryRegionSplit(LiveInterval &VirtReg, AllocationOrder &Order,
                    << PrintReg(GlobalCand[BestCand].PhysReg, TRI) << '\n');
       continue;
     }
+    ++NumRegionCosts;
+    ++Counters.RegionCosts;
+    Visited += LiveBlocks;
     growRegion(GlobalCand[Cand], Intf);
 
     SpillPlacer->finish();
@@ -1017,6 +1076,8 @@ unsigned RAGreedy::tryLocalSplit(LiveInterval &VirtReg, AllocationOrder &Order,
                                  SmallVectorImpl<LiveInterval*> &NewVRegs) {
   assert(SA->getUseBlocks().size() == 1 && "Not a local interval");
   const SplitAnalysis::BlockInfo &BI = SA->getUseBlocks().front();
+  ++NumLocalTries;
+  ++Counters.LocalTries;
 
   // Note that it is possible to have an interval that is live-in or live-out
   // while only covering a single block - A phi-def can use undef values from
@@ -1172,6 +1233,7 @@ unsigned RAGreedy::tryLocalSplit(LiveInterval &VirtReg, AllocationOrder &Order,
   SE->finish();
   setStage(NewVRegs.begin(), NewVRegs.end(), RS_Local);
   ++NumLocalSplits;
+  ++Counters.LocalSplits;
 
   return 0;
 }
@@ -1260,6 +1322,8 @@ unsigned RAGreedy::selectOrSplit(LiveInterval &VirtReg,
 
   // Finally spill VirtReg itself.
   NamedRegionTimer T("Spiller", TimerGroupName, TimePassesIsEnabled);
+  ++NumSpilled;
+  ++Counters.Spilled;
   LiveRangeEdit LRE(VirtReg, NewVRegs, this);
   spiller().spill(LRE);
   setStage(NewVRegs.begin(), NewVRegs.end(), RS_Spill);
@@ -1272,11 +1336,38 @@ unsigned RAGreedy::selectOrSplit(LiveInterval &VirtReg,
   return 0;
 }
 
+/// printReport - Print the per-function counters as a single line of
+/// space separated key=value pairs, so reports from a whole build can be
+/// collected and sorted by any field.
+void RAGreedy::printReport(double Seconds) {
+  errs() << "greedy-report:"
+         << " function=" << MF->getFunction()->getName()
+         << " seconds=" << format("%.6f", Seconds)
+         << " blocks=" << MF->getNumBlockIDs()
+         << " vregs=" << MRI->getNumVirtRegs()
+         << " evict-tries=" << Counters.EvictTries
+         << " evicted=" << Counters.Evicted
+         << " region-candidates=" << Counters.RegionCands
+         << " region-costs=" << Counters.RegionCosts
+         << " region-splits=" << Counters.RegionSplits
+         << " over-budget=" << Counters.OverBudget
+         << " local-tries=" << Counters.LocalTries
+         << " local-splits=" << Counters.LocalSplits
+         << " spilled=" << Counters.Spilled
+         << " cache-hits=" << IntfCache.getNumHits()
+         << " cache-misses=" << IntfCache.getNumMisses() << '\n';
+}
+
 bool RAGreedy::runOnMachineFunction(MachineFunction &mf) {
   DEBUG(dbgs() << "********** GREEDY REGISTER ALLOCATION **********\n"
                << "********** Function: "
                << ((Value*)mf.getFunction())->getName() << '\n');
 
+  double StartTime = 0;
+  if (ReportThreshold >= 0)
+    StartTime = TimeRecord::getCurrentTime(true).getWallTime();
+  memset(&Counters, 0, sizeof(Counters));
+
   MF = &mf;
   if (VerifyEnabled)
     MF->verify(this, "Before greedy register allocator");
@@ -1310,6 +1401,13 @@ bool RAGreedy::runOnMachineFunction(MachineFunction &mf) {
   // Write out new DBG_VALUE instructions.
   getAnalysis<LiveDebugVariables>().emitDebugValues(VRM);
 
+  if (ReportThreshold >= 0) {
+    double Seconds =
+      TimeRecord::getCurrentTime(false).getWallTime() - StartTime;
+    if (Seconds * 1000 >= ReportThreshold)
+      printReport(Seconds);
+  }
+
   // The pass output is in VirtRegMap. Release all the transient data.
   releaseMemory();
 
@@ -65,6 +65,7 @@ ExecutionEngine::ExecutionEngine(Module *M)
     ExceptionTableRegister(0),
     ExceptionTableDeregister(0) {
   CompilingLazily         = false;
+  CompilingInBackground   = false;
   GVCompilationDisabled   = false;
   SymbolSearchingDisabled = false;
   Modules.push_back(M);
@@ -19,6 +19,7 @@
 #include "llvm/CodeGen/IntrinsicLowering.h"
 #include "llvm/Support/GetElementPtrTypeIterator.h"
 #include "llvm/ADT/APInt.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
@@ -37,8 +38,9 @@ static cl::opt<bool> PrintVolatile("interpreter-print-volatile", cl::Hidden,
 //                     Various Helper Functions
 //===----------------------------------------------------------------------===//
 
-static void SetValue(Value *V, GenericValue Val, ExecutionContext &SF) {
-  SF.Values[V] = Val;
+static void SetValue(const InstInfo *I, const GenericValue &Val,
+                     ExecutionContext &SF) {
+  SF.Values[I->Dest] = Val;
 }
 
 //===----------------------------------------------------------------------===//
@@ -257,8 +259,8 @@ static GenericValue executeICMP_SGE(GenericValue Src1, GenericValue Src2,
 void Interpreter::visitICmpInst(ICmpInst &I) {
   ExecutionContext &SF = ECStack.back();
   const Type *Ty    = I.getOperand(0)->getType();
-  GenericValue Src1 = getOperandValue(I.getOperand(0), SF);
-  GenericValue Src2 = getOperandValue(I.getOperand(1), SF);
+  const GenericValue &Src1 = getOperandValue(0, SF);
+  const GenericValue &Src2 = getOperandValue(1, SF);
   GenericValue R;   // Result
   
   switch (I.getPredicate()) {
@@ -277,7 +279,7 @@ void Interpreter::visitICmpInst(ICmpInst &I) {
     llvm_unreachable(0);
   }
  
-  SetValue(&I, R, SF);
+  SetValue(SF.CurInst, R, SF);
 }
 
 #define IMPLEMENT_FCMP(OP, TY) \
@@ -445,8 +447,8 @@ static GenericValue executeFCMP_UNO(GenericValue Src1, GenericValue Src2,
 void Interpreter::visitFCmpInst(FCmpInst &I) {
   ExecutionContext &SF = ECStack.back();
   const Type *Ty    = I.getOperand(0)->getType();
-  GenericValue Src1 = getOperandValue(I.getOperand(0), SF);
-  GenericValue Src2 = getOperandValue(I.getOperand(1), SF);
+  const GenericValue &Src1 = getOperandValue(0, SF);
+  const GenericValue &Src2 = getOperandValue(1, SF);
   GenericValue R;   // Result
   
   switch (I.getPredicate()) {
@@ -471,7 +473,7 @@ void Interpreter::visitFCmpInst(FCmpInst &I) {
     llvm_unreachable(0);
   }
  
-  SetValue(&I, R, SF);
+  SetValue(SF.CurInst, R, SF);
 }
 
 static GenericValue executeCmpInst(unsigned predicate, GenericValue Src1, 
@@ -521,8 +523,8 @@ static GenericValue executeCmpInst(unsigned predicate, GenericValue Src1,
 void Interpreter::visitBinaryOperator(BinaryOperator &I) {
   ExecutionContext &SF = ECStack.back();
   const Type *Ty    = I.getOperand(0)->getType();
-  GenericValue Src1 = getOperandValue(I.getOperand(0), SF);
-  GenericValue Src2 = getOperandValue(I.getOperand(1), SF);
+  const GenericValue &Src1 = getOperandValue(0, SF);
+  const GenericValue &Src2 = getOperandValue(1, SF);
   GenericValue R;   // Result
 
   switch (I.getOpcode()) {
@@ -546,7 +548,7 @@ void Interpreter::visitBinaryOperator(BinaryOperator &I) {
     llvm_unreachable(0);
   }
 
-  SetValue(&I, R, SF);
+  SetValue(SF.CurInst, R, SF);
 }
 
 static GenericValue executeSelectInst(GenericValue Src1, GenericValue Src2,
@@ -556,11 +558,11 @@ static GenericValue executeSelectInst(GenericValue Src1, GenericValue Src2,
 
 void Interpreter::visitSelectInst(SelectInst &I) {
   ExecutionContext &SF = ECStack.back();
-  GenericValue Src1 = getOperandValue(I.getOperand(0), SF);
-  GenericValue Src2 = getOperandValue(I.getOperand(1), SF);
-  GenericValue Src3 = getOperandValue(I.getOperand(2), SF);
+  const GenericValue &Src1 = getOperandValue(0, SF);
+  const GenericValue &Src2 = getOperandValue(1, SF);
+  const GenericValue &Src3 = getOperandValue(2, SF);
   GenericValue R = executeSelectInst(Src1, Src2, Src3);
-  SetValue(&I, R, SF);
+  SetValue(SF.CurInst, R, SF);
 }
 
 
@@ -603,9 +605,10 @@ void Interpreter::popStackAndReturnValueToCaller(const Type *RetTy,
     if (Instruction *I = CallingSF.Caller.getInstruction()) {
       // Save result...
       if (!CallingSF.Caller.getType()->isVoidTy())
-        SetValue(I, Result, CallingSF);
-      if (InvokeInst *II = dyn_cast<InvokeInst> (I))
-        SwitchToNewBasicBlock (II->getNormalDest (), CallingSF);
+        SetValue(CallingSF.CurInst, Result, CallingSF);
+      if (isa<InvokeInst>(I))  // The normal destination is the second last.
+        SwitchToNewBasicBlock(CallingSF.CurInst->Ops[I->getNumOperands() - 2],
+                              CallingSF);
       CallingSF.Caller = CallSite();          // We returned from the call...
     }
   }
@@ -619,7 +622,7 @@ void Interpreter::visitReturnInst(ReturnInst &I) {
   // Save away the return value... (if we are not 'ret void')
   if (I.getNumOperands()) {
     RetTy  = I.getReturnValue()->getType();
-    Result = getOperandValue(I.getReturnValue(), SF);
+    Result = getOperandValue(0, SF);
   }
 
   popStackAndReturnValueToCaller(RetTy, Result);
@@ -639,8 +642,10 @@ void Interpreter::visitUnwindInst(UnwindInst &I) {
   ExecutionContext &InvokingSF = ECStack.back();
   InvokingSF.Caller = CallSite();
 
-  // Go to exceptional destination BB of invoke instruction
-  SwitchToNewBasicBlock(cast<InvokeInst>(Inst)->getUnwindDest(), InvokingSF);
+  // Go to exceptional destination BB of invoke instruction, the last
+  // operand.
+  SwitchToNewBasicBlock(InvokingSF.CurInst->Ops[Inst->getNumOperands() - 1],
+                        InvokingSF);
 }
 
 void Interpreter::visitUnreachableInst(UnreachableInst &I) {
@@ -649,39 +654,39 @@ void Interpreter::visitUnreachableInst(UnreachableInst &I) {
 
 void Interpreter::visitBranchInst(BranchInst &I) {
   ExecutionContext &SF = ECStack.back();
-  BasicBlock *Dest;
+  const unsigned *Ops = SF.CurInst->Ops;
 
-  Dest = I.getSuccessor(0);          // Uncond branches have a fixed dest...
-  if (!I.isUnconditional()) {
-    Value *Cond = I.getCondition();
-    if (getOperandValue(Cond, SF).IntVal == 0) // If false cond...
-      Dest = I.getSuccessor(1);
-  }
+  // Uncond branches have a fixed dest.  Conditional ones have the condition,
+  // the false dest and the true dest, in that order.
+  unsigned Dest = Ops[0];
+  if (!I.isUnconditional())
+    Dest = getOperandValue(0, SF).IntVal == 0 ? Ops[1] : Ops[2];
   SwitchToNewBasicBlock(Dest, SF);
 }
 
 void Interpreter::visitSwitchInst(SwitchInst &I) {
   ExecutionContext &SF = ECStack.back();
-  GenericValue CondVal = getOperandValue(I.getOperand(0), SF);
+  GenericValue CondVal = getOperandValue(0, SF);
   const Type *ElTy = I.getOperand(0)->getType();
 
   // Check to see if any of the cases match...
-  BasicBlock *Dest = 0;
+  const unsigned *Ops = SF.CurInst->Ops;
+  unsigned Dest = Ops[1];                 // No cases matched: use default
   for (unsigned i = 2, e = I.getNumOperands(); i != e; i += 2)
-    if (executeICMP_EQ(CondVal, getOperandValue(I.getOperand(i), SF), ElTy)
-        .IntVal != 0) {
-      Dest = cast<BasicBlock>(I.getOperand(i+1));
+    if (executeICMP_EQ(CondVal, getOperandValue(i, SF), ElTy).IntVal != 0) {
+      Dest = Ops[i+1];
       break;
     }
 
-  if (!Dest) Dest = I.getDefaultDest();   // No cases matched: use default
   SwitchToNewBasicBlock(Dest, SF);
 }
 
 void Interpreter::visitIndirectBrInst(IndirectBrInst &I) {
   ExecutionContext &SF = ECStack.back();
-  void *Dest = GVTOP(getOperandValue(I.getAddress(), SF));
-  SwitchToNewBasicBlock((BasicBlock*)Dest, SF);
+  BasicBlock *Dest = (BasicBlock*)GVTOP(getOperandValue(0, SF));
+  const std::vector<BasicBlock*> &Blocks = SF.Info->Blocks;
+  SwitchToNewBasicBlock(std::find(Blocks.begin(), Blocks.end(), Dest) -
+                        Blocks.begin(), SF);
 }
 
 
@@ -695,32 +700,30 @@ void Interpreter::visitIndirectBrInst(IndirectBrInst &I) {
 // their inputs.  If the input PHI node is updated before it is read, incorrect
 // results can happen.  Thus we use a two phase approach.
 //
-void Interpreter::SwitchToNewBasicBlock(BasicBlock *Dest, ExecutionContext &SF){
+void Interpreter::SwitchToNewBasicBlock(unsigned Dest, ExecutionContext &SF){
   BasicBlock *PrevBB = SF.CurBB;      // Remember where we came from...
-  SF.CurBB   = Dest;                  // Update CurBB to branch destination
-  SF.CurInst = SF.CurBB->begin();     // Update new instruction ptr...
+  SF.CurBB = SF.Info->Blocks[Dest];   // Update CurBB to branch destination
+  const InstInfo *First = &SF.Info->Insts[SF.Info->BlockStarts[Dest]];
+  SF.NextInst = First;                // Update new instruction ptr...
 
-  if (!isa<PHINode>(SF.CurInst)) return;  // Nothing fancy to do
+  if (!isa<PHINode>(First->Inst)) return;  // Nothing fancy to do
 
   // Loop over all of the PHI nodes in the current block, reading their inputs.
-  std::vector<GenericValue> ResultValues;
+  SmallVector<GenericValue, 8> ResultValues;
 
-  for (; PHINode *PN = dyn_cast<PHINode>(SF.CurInst); ++SF.CurInst) {
+  for (; PHINode *PN = dyn_cast<PHINode>(SF.NextInst->Inst); ++SF.NextInst) {
     // Search for the value corresponding to this previous bb...
     int i = PN->getBasicBlockIndex(PrevBB);
     assert(i != -1 && "PHINode doesn't contain entry for predecessor??");
-    Value *IncomingValue = PN->getIncomingValue(i);
+    unsigned Ref = SF.NextInst->Ops[PHINode::getOperandNumForIncomingValue(i)];
 
     // Save the incoming value for this PHI node...
-    ResultValues.push_back(getOperandValue(IncomingValue, SF));
+    ResultValues.push_back(getValue(Ref, SF));
   }
 
   // Now loop over all of the PHI nodes setting their values...
-  SF.CurInst = SF.CurBB->begin();
-  for (unsigned i = 0; isa<PHINode>(SF.CurInst); ++SF.CurInst, ++i) {
-    PHINode *PN = cast<PHINode>(SF.CurInst);
-    SetValue(PN, ResultValues[i], SF);
-  }
+  for (unsigned i = 0, e = ResultValues.size(); i != e; ++i)
+    SetValue(First + i, ResultValues[i], SF);
 }
 
 //===----------------------------------------------------------------------===//
@@ -734,7 +737,7 @@ void Interpreter::visitAllocaInst(AllocaInst &I) {
 
   // Get the number of elements being allocated by the array...
   unsigned NumElements = 
-    getOperandValue(I.getOperand(0), SF).IntVal.getZExtValue();
+    getOperandValue(0, SF).IntVal.getZExtValue();
 
   unsigned TypeSize = (size_t)TD.getTypeAllocSize(Ty);
 
@@ -750,23 +753,23 @@ void Interpreter::visitAllocaInst(AllocaInst &I) {
 
   GenericValue Result = PTOGV(Memory);
   assert(Result.PointerVal != 0 && "Null pointer returned by malloc!");
-  SetValue(&I, Result, SF);
+  SetValue(SF.CurInst, Result, SF);
 
   if (I.getOpcode() == Instruction::Alloca)
     ECStack.back().Allocas.add(Memory);
 }
 
-// getElementOffset - The workhorse for getelementptr.
+// getElementOffset - The workhorse for getelementptr.  If SF is given, the
+// indices are the operands of the instruction being executed in it;
+// otherwise they are all constants.
 //
-GenericValue Interpreter::executeGEPOperation(Value *Ptr, gep_type_iterator I,
+GenericValue Interpreter::executeGEPOperation(GenericValue Ptr,
+                                              gep_type_iterator I,
                                               gep_type_iterator E,
-                                              ExecutionContext &SF) {
-  assert(Ptr->getType()->isPointerTy() &&
-         "Cannot getElementOffset of a nonpointer type!");
-
+                                              ExecutionContext *SF) {
   uint64_t Total = 0;
 
-  for (; I != E; ++I) {
+  for (unsigned OpNo = 1; I != E; ++I, ++OpNo) {
     if (const StructType *STy = dyn_cast<StructType>(*I)) {
       const StructLayout *SLO = TD.getStructLayout(STy);
 
@@ -777,7 +780,9 @@ GenericValue Interpreter::executeGEPOperation(Value *Ptr, gep_type_iterator I,
     } else {
       const SequentialType *ST = cast<SequentialType>(*I);
       // Get the index number for the array... which must be long type...
-      GenericValue IdxGV = getOperandValue(I.getOperand(), SF);
+      GenericValue IdxGV =
+        SF ? getOperandValue(OpNo, *SF)
+           : getConstantOperandValue(cast<Constant>(I.getOperand()));
 
       int64_t Idx;
       unsigned BitWidth = 
@@ -793,32 +798,33 @@ GenericValue Interpreter::executeGEPOperation(Value *Ptr, gep_type_iterator I,
   }
 
   GenericValue Result;
-  Result.PointerVal = ((char*)getOperandValue(Ptr, SF).PointerVal) + Total;
+  Result.PointerVal = ((char*)Ptr.PointerVal) + Total;
   DEBUG(dbgs() << "GEP Index " << Total << " bytes.\n");
   return Result;
 }
 
 void Interpreter::visitGetElementPtrInst(GetElementPtrInst &I) {
   ExecutionContext &SF = ECStack.back();
-  SetValue(&I, executeGEPOperation(I.getPointerOperand(),
-                                   gep_type_begin(I), gep_type_end(I), SF), SF);
+  SetValue(SF.CurInst, executeGEPOperation(getOperandValue(0, SF),
+                                           gep_type_begin(I), gep_type_end(I),
+                                           &SF), SF);
 }
 
 void Interpreter::visitLoadInst(LoadInst &I) {
   ExecutionContext &SF = ECStack.back();
-  GenericValue SRC = getOperandValue(I.getPointerOperand(), SF);
+  GenericValue SRC = getOperandValue(0, SF);
   GenericValue *Ptr = (GenericValue*)GVTOP(SRC);
   GenericValue Result;
   LoadValueFromMemory(Result, Ptr, I.getType());
-  SetValue(&I, Result, SF);
+  SetValue(SF.CurInst, Result, SF);
   if (I.isVolatile() && PrintVolatile)
     dbgs() << "Volatile load " << I;
 }
 
 void Interpreter::visitStoreInst(StoreInst &I) {
   ExecutionContext &SF = ECStack.back();
-  GenericValue Val = getOperandValue(I.getOperand(0), SF);
-  GenericValue SRC = getOperandValue(I.getPointerOperand(), SF);
+  GenericValue Val = getOperandValue(0, SF);
+  GenericValue SRC = getOperandValue(1, SF);
   StoreValueToMemory(Val, (GenericValue *)GVTOP(SRC),
                      I.getOperand(0)->getType());
   if (I.isVolatile() && PrintVolatile)
@@ -842,13 +848,13 @@ void Interpreter::visitCallSite(CallSite CS) {
       GenericValue ArgIndex;
       ArgIndex.UIntPairVal.first = ECStack.size() - 1;
       ArgIndex.UIntPairVal.second = 0;
-      SetValue(CS.getInstruction(), ArgIndex, SF);
+      SetValue(SF.CurInst, ArgIndex, SF);
       return;
     }
     case Intrinsic::vaend:    // va_end is a noop for the interpreter
       return;
     case Intrinsic::vacopy:   // va_copy: dest = src
-      SetValue(CS.getInstruction(), getOperandValue(*CS.arg_begin(), SF), SF);
+      SetValue(SF.CurInst, getOperandValue(0, SF), SF);
       return;
     default:
       // If it is an unknown intrinsic function, use the intrinsic lowering
@@ -861,14 +867,13 @@ void Interpreter::visitCallSite(CallSite CS) {
         --me;
       IL->LowerIntrinsicCall(cast<CallInst>(CS.getInstruction()));
 
-      // Restore the CurInst pointer to the first instruction newly inserted, if
-      // any.
-      if (atBegin) {
-        SF.CurInst = Parent->begin();
-      } else {
-        SF.CurInst = me;
-        ++SF.CurInst;
-      }
+      // Continue with the first instruction newly inserted, if any.  The
+      // function has changed, so it has to be lowered again.
+      if (atBegin)
+        me = Parent->begin();
+      else
+        ++me;
+      relowerFunction(SF.CurFunction, me);
       return;
     }
 
@@ -877,108 +882,113 @@ void Interpreter::visitCallSite(CallSite CS) {
   std::vector<GenericValue> ArgVals;
   const unsigned NumArgs = SF.Caller.arg_size();
   ArgVals.reserve(NumArgs);
-  uint16_t pNum = 1;
-  for (CallSite::arg_iterator i = SF.Caller.arg_begin(),
-         e = SF.Caller.arg_end(); i != e; ++i, ++pNum) {
-    Value *V = *i;
-    ArgVals.push_back(getOperandValue(V, SF));
-  }
+  // The arguments are the first operands of both calls and invokes.
+  for (unsigned i = 0; i != NumArgs; ++i)
+    ArgVals.push_back(getOperandValue(i, SF));
 
   // To handle indirect calls, we must get the pointer value from the argument
-  // and treat it as a function pointer.
-  GenericValue SRC = getOperandValue(SF.Caller.getCalledValue(), SF);
+  // and treat it as a function pointer.  It is the last operand of a call,
+  // and the third last of an invoke.
+  unsigned CalleeOpNo = CS.getInstruction()->getNumOperands() -
+                        (CS.isCall() ? 1 : 3);
+  GenericValue SRC = getOperandValue(CalleeOpNo, SF);
   callFunction((Function*)GVTOP(SRC), ArgVals);
 }
 
 void Interpreter::visitShl(BinaryOperator &I) {
   ExecutionContext &SF = ECStack.back();
-  GenericValue Src1 = getOperandValue(I.getOperand(0), SF);
-  GenericValue Src2 = getOperandValue(I.getOperand(1), SF);
+  const GenericValue &Src1 = getOperandValue(0, SF);
+  const GenericValue &Src2 = getOperandValue(1, SF);
   GenericValue Dest;
   if (Src2.IntVal.getZExtValue() < Src1.IntVal.getBitWidth())
     Dest.IntVal = Src1.IntVal.shl(Src2.IntVal.getZExtValue());
   else
     Dest.IntVal = Src1.IntVal;
   
-  SetValue(&I, Dest, SF);
+  SetValue(SF.CurInst, Dest, SF);
 }
 
 void Interpreter::visitLShr(BinaryOperator &I) {
   ExecutionContext &SF = ECStack.back();
-  GenericValue Src1 = getOperandValue(I.getOperand(0), SF);
-  GenericValue Src2 = getOperandValue(I.getOperand(1), SF);
+  const GenericValue &Src1 = getOperandValue(0, SF);
+  const GenericValue &Src2 = getOperandValue(1, SF);
   GenericValue Dest;
   if (Src2.IntVal.getZExtValue() < Src1.IntVal.getBitWidth())
     Dest.IntVal = Src1.IntVal.lshr(Src2.IntVal.getZExtValue());
   else
     Dest.IntVal = Src1.IntVal;
   
-  SetValue(&I, Dest, SF);
+  SetValue(SF.CurInst, Dest, SF);
 }
 
 void Interpreter::visitAShr(BinaryOperator &I) {
   ExecutionContext &SF = ECStack.back();
-  GenericValue Src1 = getOperandValue(I.getOperand(0), SF);
-  GenericValue Src2 = getOperandValue(I.getOperand(1), SF);
+  const GenericValue &Src1 = getOperandValue(0, SF);
+  const GenericValue &Src2 = getOperandValue(1, SF);
   GenericValue Dest;
   if (Src2.IntVal.getZExtValue() < Src1.IntVal.getBitWidth())
     Dest.IntVal = Src1.IntVal.ashr(Src2.IntVal.getZExtValue());
   else
     Dest.IntVal = Src1.IntVal;
   
-  SetValue(&I, Dest, SF);
+  SetValue(SF.CurInst, Dest, SF);
 }
 
-GenericValue Interpreter::executeTruncInst(Value *SrcVal, const Type *DstTy,
-                                           ExecutionContext &SF) {
-  GenericValue Dest, Src = getOperandValue(SrcVal, SF);
+GenericValue Interpreter::executeTruncInst(const GenericValue &Src,
+                                           const Type *SrcTy,
+                                           const Type *DstTy) {
+  GenericValue Dest;
   const IntegerType *DITy = cast<IntegerType>(DstTy);
   unsigned DBitWidth = DITy->getBitWidth();
   Dest.IntVal = Src.IntVal.trunc(DBitWidth);
   return Dest;
 }
 
-GenericValue Interpreter::executeSExtInst(Value *SrcVal, const Type *DstTy,
-                                          ExecutionContext &SF) {
-  GenericValue Dest, Src = getOperandValue(SrcVal, SF);
+GenericValue Interpreter::executeSExtInst(const GenericValue &Src,
+                                          const Type *SrcTy,
+                                          const Type *DstTy) {
+  GenericValue Dest;
   const IntegerType *DITy = cast<IntegerType>(DstTy);
   unsigned DBitWidth = DITy->getBitWidth();
   Dest.IntVal = Src.IntVal.sext(DBitWidth);
   return Dest;
 }
 
-GenericValue Interpreter::executeZExtInst(Value *SrcVal, const Type *DstTy,
-                                          ExecutionContext &SF) {
-  GenericValue Dest, Src = getOperandValue(SrcVal, SF);
+GenericValue Interpreter::executeZExtInst(const GenericValue &Src,
+                                          const Type *SrcTy,
+                                          const Type *DstTy) {
+  GenericValue Dest;
   const IntegerType *DITy = cast<IntegerType>(DstTy);
   unsigned DBitWidth = DITy->getBitWidth();
   Dest.IntVal = Src.IntVal.zext(DBitWidth);
   return Dest;
 }
 
-GenericValue Interpreter::executeFPTruncInst(Value *SrcVal, const Type *DstTy,
-                                             ExecutionContext &SF) {
-  GenericValue Dest, Src = getOperandValue(SrcVal, SF);
-  assert(SrcVal->getType()->isDoubleTy() && DstTy->isFloatTy() &&
+GenericValue Interpreter::executeFPTruncInst(const GenericValue &Src,
+                                             const Type *SrcTy,
+                                             const Type *DstTy) {
+  GenericValue Dest;
+  assert(SrcTy->isDoubleTy() && DstTy->isFloatTy() &&
          "Invalid FPTrunc instruction");
   Dest.FloatVal = (float) Src.DoubleVal;
   return Dest;
 }
 
-GenericValue Interpreter::executeFPExtInst(Value *SrcVal, const Type *DstTy,
-                                           ExecutionContext &SF) {
-  GenericValue Dest, Src = getOperandValue(SrcVal, SF);
-  assert(SrcVal->getType()->isFloatTy() && DstTy->isDoubleTy() &&
+GenericValue Interpreter::executeFPExtInst(const GenericValue &Src,
+                                           const Type *SrcTy,
+                                           const Type *DstTy) {
+  GenericValue Dest;
+  assert(SrcTy->isFloatTy() && DstTy->isDoubleTy() &&
          "Invalid FPTrunc instruction");
   Dest.DoubleVal = (double) Src.FloatVal;
   return Dest;
 }
 
-GenericValue Interpreter::executeFPToUIInst(Value *SrcVal, const Type *DstTy,
-                                            ExecutionContext &SF) {
-  const Type *SrcTy = SrcVal->getType();
+GenericValue Interpreter::executeFPToUIInst(const GenericValue &Src,
+                                            const Type *SrcTy,
+                                            const Type *DstTy) {
   uint32_t DBitWidth = cast<IntegerType>(DstTy)->getBitWidth();
-  GenericValue Dest, Src = getOperandValue(SrcVal, SF);
+  GenericValue Dest;
   assert(SrcTy->isFloatingPointTy() && "Invalid FPToUI instruction");
 
   if (SrcTy->getTypeID() == Type::FloatTyID)
@@ -988,11 +998,11 @@ GenericValue Interpreter::executeFPToUIInst(Value *SrcVal, const Type *DstTy,
   return Dest;
 }
 
-GenericValue Interpreter::executeFPToSIInst(Value *SrcVal, const Type *DstTy,
-                                            ExecutionContext &SF) {
-  const Type *SrcTy = SrcVal->getType();
+GenericValue Interpreter::executeFPToSIInst(const GenericValue &Src,
+                                            const Type *SrcTy,
+                                            const Type *DstTy) {
   uint32_t DBitWidth = cast<IntegerType>(DstTy)->getBitWidth();
-  GenericValue Dest, Src = getOperandValue(SrcVal, SF);
+  GenericValue Dest;
   assert(SrcTy->isFloatingPointTy() && "Invalid FPToSI instruction");
 
   if (SrcTy->getTypeID() == Type::FloatTyID)
@@ -1002,9 +1012,10 @@ GenericValue Interpreter::executeFPToSIInst(Value *SrcVal, const Type *DstTy,
   return Dest;
 }
 
-GenericValue Interpreter::executeUIToFPInst(Value *SrcVal, const Type *DstTy,
-                                            ExecutionContext &SF) {
-  GenericValue Dest, Src = getOperandValue(SrcVal, SF);
+GenericValue Interpreter::executeUIToFPInst(const GenericValue &Src,
+                                            const Type *SrcTy,
+                                            const Type *DstTy) {
+  GenericValue Dest;
   assert(DstTy->isFloatingPointTy() && "Invalid UIToFP instruction");
 
   if (DstTy->getTypeID() == Type::FloatTyID)
@@ -1014,9 +1025,10 @@ GenericValue Interpreter::executeUIToFPInst(Value *SrcVal, const Type *DstTy,
   return Dest;
 }
 
-GenericValue Interpreter::executeSIToFPInst(Value *SrcVal, const Type *DstTy,
-                                            ExecutionContext &SF) {
-  GenericValue Dest, Src = getOperandValue(SrcVal, SF);
+GenericValue Interpreter::executeSIToFPInst(const GenericValue &Src,
+                                            const Type *SrcTy,
+                                            const Type *DstTy) {
+  GenericValue Dest;
   assert(DstTy->isFloatingPointTy() && "Invalid SIToFP instruction");
 
   if (DstTy->getTypeID() == Type::FloatTyID)
@@ -1027,34 +1039,36 @@ GenericValue Interpreter::executeSIToFPInst(Value *SrcVal, const Type *DstTy,
 
 }
 
-GenericValue Interpreter::executePtrToIntInst(Value *SrcVal, const Type *DstTy,
-                                              ExecutionContext &SF) {
+GenericValue Interpreter::executePtrToIntInst(const GenericValue &Src,
+                                              const Type *SrcTy,
+                                              const Type *DstTy) {
   uint32_t DBitWidth = cast<IntegerType>(DstTy)->getBitWidth();
-  GenericValue Dest, Src = getOperandValue(SrcVal, SF);
-  assert(SrcVal->getType()->isPointerTy() && "Invalid PtrToInt instruction");
+  GenericValue Dest;
+  assert(SrcTy->isPointerTy() && "Invalid PtrToInt instruction");
 
   Dest.IntVal = APInt(DBitWidth, (intptr_t) Src.PointerVal);
   return Dest;
 }
 
-GenericValue Interpreter::executeIntToPtrInst(Value *SrcVal, const Type *DstTy,
-                                              ExecutionContext &SF) {
-  GenericValue Dest, Src = getOperandValue(SrcVal, SF);
+GenericValue Interpreter::executeIntToPtrInst(const GenericValue &Src,
+                                              const Type *SrcTy,
+                                              const Type *DstTy) {
+  GenericValue Dest;
   assert(DstTy->isPointerTy() && "Invalid PtrToInt instruction");
 
   uint32_t PtrSize = TD.getPointerSizeInBits();
-  if (PtrSize != Src.IntVal.getBitWidth())
-    Src.IntVal = Src.IntVal.zextOrTrunc(PtrSize);
+  APInt IntVal = Src.IntVal;
+  if (PtrSize != IntVal.getBitWidth())
+    IntVal = IntVal.zextOrTrunc(PtrSize);
 
-  Dest.PointerVal = PointerTy(intptr_t(Src.IntVal.getZExtValue()));
+  Dest.PointerVal = PointerTy(intptr_t(IntVal.getZExtValue()));
   return Dest;
 }
 
-GenericValue Interpreter::executeBitCastInst(Value *SrcVal, const Type *DstTy,
-                                             ExecutionContext &SF) {
-  
-  const Type *SrcTy = SrcVal->getType();
-  GenericValue Dest, Src = getOperandValue(SrcVal, SF);
+GenericValue Interpreter::executeBitCastInst(const GenericValue &Src,
+                                             const Type *SrcTy,
+                                             const Type *DstTy) {
+  GenericValue Dest;
   if (DstTy->isPointerTy()) {
     assert(SrcTy->isPointerTy() && "Invalid BitCast");
     Dest.PointerVal = Src.PointerVal;
@@ -1085,62 +1099,74 @@ GenericValue Interpreter::executeBitCastInst(Value *SrcVal, const Type *DstTy,
 
 void Interpreter::visitTruncInst(TruncInst &I) {
   ExecutionContext &SF = ECStack.back();
-  SetValue(&I, executeTruncInst(I.getOperand(0), I.getType(), SF), SF);
+  SetValue(SF.CurInst, executeTruncInst(getOperandValue(0, SF), I.getSrcTy(),
+                                        I.getType()), SF);
 }
 
 void Interpreter::visitSExtInst(SExtInst &I) {
   ExecutionContext &SF = ECStack.back();
-  SetValue(&I, executeSExtInst(I.getOperand(0), I.getType(), SF), SF);
+  SetValue(SF.CurInst, executeSExtInst(getOperandValue(0, SF), I.getSrcTy(),
+                                       I.getType()), SF);
 }
 
 void Interpreter::visitZExtInst(ZExtInst &I) {
   ExecutionContext &SF = ECStack.back();
-  SetValue(&I, executeZExtInst(I.getOperand(0), I.getType(), SF), SF);
+  SetValue(SF.CurInst, executeZExtInst(getOperandValue(0, SF), I.getSrcTy(),
+                                       I.getType()), SF);
 }
 
 void Interpreter::visitFPTruncInst(FPTruncInst &I) {
   ExecutionContext &SF = ECStack.back();
-  SetValue(&I, executeFPTruncInst(I.getOperand(0), I.getType(), SF), SF);
+  SetValue(SF.CurInst, executeFPTruncInst(getOperandValue(0, SF), I.getSrcTy(),
+                                          I.getType()), SF);
 }
 
 void Interpreter::visitFPExtInst(FPExtInst &I) {
   ExecutionContext &SF = ECStack.back();
-  SetValue(&I, executeFPExtInst(I.getOperand(0), I.getType(), SF), SF);
+  SetValue(SF.CurInst, executeFPExtInst(getOperandValue(0, SF), I.getSrcTy(),
+                                        I.getType()), SF);
 }
 
 void Interpreter::visitUIToFPInst(UIToFPInst &I) {
   ExecutionContext &SF = ECStack.back();
-  SetValue(&I, executeUIToFPInst(I.getOperand(0), I.getType(), SF), SF);
+  SetValue(SF.CurInst, executeUIToFPInst(getOperandValue(0, SF), I.getSrcTy(),
+                                         I.getType()), SF);
 }
 
 void Interpreter::visitSIToFPInst(SIToFPInst &I) {
   ExecutionContext &SF = ECStack.back();
-  SetValue(&I, executeSIToFPInst(I.getOperand(0), I.getType(), SF), SF);
+  SetValue(SF.CurInst, executeSIToFPInst(getOperandValue(0, SF), I.getSrcTy(),
+                                         I.getType()), SF);
 }
 
 void Interpreter::visitFPToUIInst(FPToUIInst &I) {
   ExecutionContext &SF = ECStack.back();
-  SetValue(&I, executeFPToUIInst(I.getOperand(0), I.getType(), SF), SF);
+  SetValue(SF.CurInst, executeFPToUIInst(getOperandValue(0, SF), I.getSrcTy(),
+                                         I.getType()), SF);
 }
 
 void Interpreter::visitFPToSIInst(FPToSIInst &I) {
   ExecutionContext &SF = ECStack.back();
-  SetValue(&I, executeFPToSIInst(I.getOperand(0), I.getType(), SF), SF);
+  SetValue(SF.CurInst, executeFPToSIInst(getOperandValue(0, SF), I.getSrcTy(),
+                                         I.getType()), SF);
 }
 
 void Interpreter::visitPtrToIntInst(PtrToIntInst &I) {
   ExecutionContext &SF = ECStack.back();
-  SetValue(&I, executePtrToIntInst(I.getOperand(0), I.getType(), SF), SF);
+  SetValue(SF.CurInst, executePtrToIntInst(getOperandValue(0, SF), I.getSrcTy(),
+                                           I.getType()), SF);
 }
 
 void Interpreter::visitIntToPtrInst(IntToPtrInst &I) {
   ExecutionContext &SF = ECStack.back();
-  SetValue(&I, executeIntToPtrInst(I.getOperand(0), I.getType(), SF), SF);
+  SetValue(SF.CurInst, executeIntToPtrInst(getOperandValue(0, SF), I.getSrcTy(),
+                                           I.getType()), SF);
 }
 
 void Interpreter::visitBitCastInst(BitCastInst &I) {
   ExecutionContext &SF = ECStack.back();
-  SetValue(&I, executeBitCastInst(I.getOperand(0), I.getType(), SF), SF);
+  SetValue(SF.CurInst, executeBitCastInst(getOperandValue(0, SF), I.getSrcTy(),
+                                          I.getType()), SF);
 }
 
 #define IMPLEMENT_VAARG(TY) \
@@ -1151,7 +1177,7 @@ void Interpreter::visitVAArgInst(VAArgInst &I) {
 
   // Get the incoming valist parameter.  LLI treats the valist as a
   // (ec-stack-depth var-arg-index) pair.
-  GenericValue VAList = getOperandValue(I.getOperand(0), SF);
+  GenericValue VAList = getOperandValue(0, SF);
   GenericValue Dest;
   GenericValue Src = ECStack[VAList.UIntPairVal.first]
                       .VarArgs[VAList.UIntPairVal.second];
@@ -1167,60 +1193,71 @@ void Interpreter::visitVAArgInst(VAArgInst &I) {
   }
 
   // Set the Value of this Instruction.
-  SetValue(&I, Dest, SF);
+  SetValue(SF.CurInst, Dest, SF);
 
   // Move the pointer to the next vararg.
   ++VAList.UIntPairVal.second;
 }
 
-GenericValue Interpreter::getConstantExprValue (ConstantExpr *CE,
-                                                ExecutionContext &SF) {
+GenericValue Interpreter::getConstantExprValue (ConstantExpr *CE) {
   switch (CE->getOpcode()) {
   case Instruction::Trunc:   
-      return executeTruncInst(CE->getOperand(0), CE->getType(), SF);
+      return executeTruncInst(getConstantOperandValue(CE->getOperand(0)),
+                              CE->getOperand(0)->getType(), CE->getType());
   case Instruction::ZExt:
-      return executeZExtInst(CE->getOperand(0), CE->getType(), SF);
+      return executeZExtInst(getConstantOperandValue(CE->getOperand(0)),
+                             CE->getOperand(0)->getType(), CE->getType());
   case Instruction::SExt:
-      return executeSExtInst(CE->getOperand(0), CE->getType(), SF);
+      return executeSExtInst(getConstantOperandValue(CE->getOperand(0)),
+                             CE->getOperand(0)->getType(), CE->getType());
   case Instruction::FPTrunc:
-      return executeFPTruncInst(CE->getOperand(0), CE->getType(), SF);
+      return executeFPTruncInst(getConstantOperandValue(CE->getOperand(0)),
+                                CE->getOperand(0)->getType(), CE->getType());
   case Instruction::FPExt:
-      return executeFPExtInst(CE->getOperand(0), CE->getType(), SF);
+      return executeFPExtInst(getConstantOperandValue(CE->getOperand(0)),
+                              CE->getOperand(0)->getType(), CE->getType());
   case Instruction::UIToFP:
-      return executeUIToFPInst(CE->getOperand(0), CE->getType(), SF);
+      return executeUIToFPInst(getConstantOperandValue(CE->getOperand(0)),
+                               CE->getOperand(0)->getType(), CE->getType());
   case Instruction::SIToFP:
-      return executeSIToFPInst(CE->getOperand(0), CE->getType(), SF);
+      return executeSIToFPInst(getConstantOperandValue(CE->getOperand(0)),
+                               CE->getOperand(0)->getType(), CE->getType());
   case Instruction::FPToUI:
-      return executeFPToUIInst(CE->getOperand(0), CE->getType(), SF);
+      return executeFPToUIInst(getConstantOperandValue(CE->getOperand(0)),
+                               CE->getOperand(0)->getType(), CE->getType());
   case Instruction::FPToSI:
-      return executeFPToSIInst(CE->getOperand(0), CE->getType(), SF);
+      return executeFPToSIInst(getConstantOperandValue(CE->getOperand(0)),
+                               CE->getOperand(0)->getType(), CE->getType());
   case Instruction::PtrToInt:
-      return executePtrToIntInst(CE->getOperand(0), CE->getType(), SF);
+      return executePtrToIntInst(getConstantOperandValue(CE->getOperand(0)),
+                                 CE->getOperand(0)->getType(), CE->getType());
   case Instruction::IntToPtr:
-      return executeIntToPtrInst(CE->getOperand(0), CE->getType(), SF);
+      return executeIntToPtrInst(getConstantOperandValue(CE->getOperand(0)),
+                                 CE->getOperand(0)->getType(), CE->getType());
   case Instruction::BitCast:
-      return executeBitCastInst(CE->getOperand(0), CE->getType(), SF);
+      return executeBitCastInst(getConstantOperandValue(CE->getOperand(0)),
+                                CE->getOperand(0)->getType(), CE->getType());
   case Instruction::GetElementPtr:
-    return executeGEPOperation(CE->getOperand(0), gep_type_begin(CE),
-                               gep_type_end(CE), SF);
+    return executeGEPOperation(getConstantOperandValue(CE->getOperand(0)),
+                               gep_type_begin(CE), gep_type_end(CE), 0);
   case Instruction::FCmp:
   case Instruction::ICmp:
     return executeCmpInst(CE->getPredicate(),
-                          getOperandValue(CE->getOperand(0), SF),
-                          getOperandValue(CE->getOperand(1), SF),
+                          getConstantOperandValue(CE->getOperand(0)),
+                          getConstantOperandValue(CE->getOperand(1)),
                           CE->getOperand(0)->getType());
   case Instruction::Select:
-    return executeSelectInst(getOperandValue(CE->getOperand(0), SF),
-                             getOperandValue(CE->getOperand(1), SF),
-                             getOperandValue(CE->getOperand(2), SF));
+    return executeSelectInst(getConstantOperandValue(CE->getOperand(0)),
+                             getConstantOperandValue(CE->getOperand(1)),
+                             getConstantOperandValue(CE->getOperand(2)));
   default :
     break;
   }
 
   // The cases below here require a GenericValue parameter for the result
   // so we initialize one, compute it and then return it.
-  GenericValue Op0 = getOperandValue(CE->getOperand(0), SF);
-  GenericValue Op1 = getOperandValue(CE->getOperand(1), SF);
+  GenericValue Op0 = getConstantOperandValue(CE->getOperand(0));
+  GenericValue Op1 = getConstantOperandValue(CE->getOperand(1));
   GenericValue Dest;
   const Type * Ty = CE->getOperand(0)->getType();
   switch (CE->getOpcode()) {
@@ -1256,16 +1293,127 @@ GenericValue Interpreter::getConstantExprValue (ConstantExpr *CE,
   return Dest;
 }
 
-GenericValue Interpreter::getOperandValue(Value *V, ExecutionContext &SF) {
-  if (ConstantExpr *CE = dyn_cast<ConstantExpr>(V)) {
-    return getConstantExprValue(CE, SF);
-  } else if (Constant *CPV = dyn_cast<Constant>(V)) {
-    return getConstantValue(CPV);
-  } else if (GlobalValue *GV = dyn_cast<GlobalValue>(V)) {
-    return PTOGV(getPointerToGlobal(GV));
-  } else {
-    return SF.Values[V];
+GenericValue Interpreter::getConstantOperandValue(Constant *C) {
+  if (ConstantExpr *CE = dyn_cast<ConstantExpr>(C))
+    return getConstantExprValue(CE);
+  return getConstantValue(C);
+}
+
+//===----------------------------------------------------------------------===//
+//                          Function Lowering Code
+//===----------------------------------------------------------------------===//
+
+FunctionInfo *Interpreter::getFunctionInfo(Function *F) {
+  FunctionInfo *&Info = FunctionInfos[F];
+  if (!Info)
+    Info = buildFunctionInfo(F);
+  return Info;
+}
+
+FunctionInfo *Interpreter::buildFunctionInfo(Function *F) {
+  FunctionInfo *Info = new FunctionInfo();
+
+  // Number the blocks, and give each argument and each instruction that
+  // produces a value a register slot.
+  DenseMap<const Value*, unsigned> Refs;
+  for (Function::arg_iterator AI = F->arg_begin(), E = F->arg_end();
+       AI != E; ++AI) {
+    Refs[AI] = Info->RegValues.size();
+    Info->RegValues.push_back(AI);
+  }
+  unsigned NumInsts = 0, NumOperands = 0;
+  for (Function::iterator BB = F->begin(), E = F->end(); BB != E; ++BB) {
+    Refs[BB] = Info->Blocks.size();
+    Info->Blocks.push_back(BB);
+    Info->BlockStarts.push_back(NumInsts);
+    for (BasicBlock::iterator I = BB->begin(), IE = BB->end(); I != IE; ++I) {
+      ++NumInsts;
+      NumOperands += I->getNumOperands();
+      if (I->getType()->isVoidTy())
+        continue;
+      Refs[I] = Info->RegValues.size();
+      Info->RegValues.push_back(I);
+    }
+  }
+  Info->NumRegs = Info->RegValues.size();
+
+  // Resolve the operands.  Constants go into the constant pool, once each.
+  // Anything else, such as metadata, is never read; it refers to a constant
+  // zero.
+  Info->Insts.reserve(NumInsts);
+  Info->Operands.reserve(NumOperands);
+  for (Function::iterator BB = F->begin(), E = F->end(); BB != E; ++BB)
+    for (BasicBlock::iterator I = BB->begin(), IE = BB->end(); I != IE; ++I) {
+      InstInfo II;
+      II.Inst = I;
+      II.Dest = Refs.lookup(I);
+      II.Ops = 0;
+      Info->Insts.push_back(II);
+      for (User::op_iterator OI = I->op_begin(), OE = I->op_end(); OI != OE;
+           ++OI) {
+        Value *V = *OI;
+        DenseMap<const Value*, unsigned>::iterator R = Refs.find(V);
+        if (R == Refs.end()) {
+          GenericValue Val;
+          if (Constant *C = dyn_cast<Constant>(V))
+            Val = getConstantOperandValue(C);
+          else
+            memset(&Val.Untyped, 0, sizeof(Val.Untyped));
+          R = Refs.insert(std::make_pair(V, Info->NumRegs +
+                                            Info->Constants.size())).first;
+          Info->Constants.push_back(Val);
+        }
+        Info->Operands.push_back(R->second);
+      }
+    }
+
+  // The operand storage no longer moves, so the instructions can point into
+  // it.
+  const unsigned *Ops = Info->Operands.empty() ? 0 : &Info->Operands[0];
+  for (unsigned i = 0, e = Info->Insts.size(); i != e; ++i) {
+    Info->Insts[i].Ops = Ops;
+    Ops += Info->Insts[i].Inst->getNumOperands();
+  }
+  return Info;
+}
+
+void Interpreter::relowerFunction(Function *F, Instruction *Next) {
+  FunctionInfo *Old = FunctionInfos[F];
+  FunctionInfo *New = buildFunctionInfo(F);
+  FunctionInfos[F] = New;
+
+  DenseMap<const Value*, unsigned> NewRegs;
+  for (unsigned i = 0, e = New->NumRegs; i != e; ++i)
+    NewRegs[New->RegValues[i]] = i;
+  DenseMap<const Instruction*, const InstInfo*> NewInsts;
+  for (unsigned i = 0, e = New->Insts.size(); i != e; ++i)
+    NewInsts[New->Insts[i].Inst] = &New->Insts[i];
+
+  // Carry the values over to the new register slots, and the other frames on
+  // to the same calls in the new form.  The values of the instructions that
+  // were removed are dropped; those of the new ones are set before they are
+  // read.
+  for (unsigned i = 0, e = ECStack.size(); i != e; ++i) {
+    ExecutionContext &SF = ECStack[i];
+    if (SF.Info != Old)
+      continue;
+    ValuePlaneTy Values(New->NumRegs);
+    for (unsigned r = 0, re = Old->NumRegs; r != re; ++r) {
+      DenseMap<const Value*, unsigned>::iterator R =
+        NewRegs.find(Old->RegValues[r]);
+      if (R != NewRegs.end())
+        Values[R->second] = SF.Values[r];
+    }
+    SF.Values.swap(Values);
+    SF.Info = New;
+    if (i + 1 == e) {
+      SF.CurInst = SF.NextInst = NewInsts.lookup(Next);
+    } else {
+      SF.CurInst = NewInsts.lookup(SF.CurInst->Inst);
+      SF.NextInst = SF.CurInst + 1;
+    }
   }
+  delete Old;
 }
 
 //===----------------------------------------------------------------------===//
@@ -1294,19 +1442,21 @@ void Interpreter::callFunction(Function *F,
   }
 
   // Get pointers to first LLVM BB & Instruction in function.
+  StackFrame.Info      = getFunctionInfo(F);
   StackFrame.CurBB     = F->begin();
-  StackFrame.CurInst   = StackFrame.CurBB->begin();
+  StackFrame.CurInst   = 0;
+  StackFrame.NextInst  = &StackFrame.Info->Insts[0];
+  StackFrame.Values.resize(StackFrame.Info->NumRegs);
 
   // Run through the function arguments and initialize their values...
   assert((ArgVals.size() == F->arg_size() ||
          (ArgVals.size() > F->arg_size() && F->getFunctionType()->isVarArg()))&&
          "Invalid number of values passed to function invocation!");
 
-  // Handle non-varargs arguments...
+  // Handle non-varargs arguments; they have the first register slots...
   unsigned i = 0;
-  for (Function::arg_iterator AI = F->arg_begin(), E = F->arg_end(); 
-       AI != E; ++AI, ++i)
-    SetValue(AI, ArgVals[i], StackFrame);
+  for (unsigned e = F->arg_size(); i != e; ++i)
+    StackFrame.Values[i] = ArgVals[i];
 
   // Handle varargs arguments...
   StackFrame.VarArgs.assign(ArgVals.begin()+i, ArgVals.end());
@@ -1317,7 +1467,8 @@ void Interpreter::run() {
   while (!ECStack.empty()) {
     // Interpret a single instruction & increment the "PC".
     ExecutionContext &SF = ECStack.back();  // Current stack frame
-    Instruction &I = *SF.CurInst++;         // Increment before execute
+    SF.CurInst = SF.NextInst++;             // Increment before execute
+    Instruction &I = *SF.CurInst->Inst;
 
     // Track the number of dynamic instructions executed.
     ++NumDynamicInsts;
@@ -1330,7 +1481,7 @@ DEBUG(
     if (!isa<CallInst>(I) && !isa<InvokeInst>(I) && 
         I.getType() != Type::VoidTy) {
       dbgs() << "  --> ";
-      const GenericValue &Val = SF.Values[&I];
+      const GenericValue &Val = SF.Values[SF.CurInst->Dest];
       switch (I.getType()->getTypeID()) {
       default: llvm_unreachable("Invalid GenericValue Type");
       case Type::VoidTyID:    dbgs() << "void"; break;
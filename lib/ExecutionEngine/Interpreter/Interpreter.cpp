@@ -17,6 +17,7 @@
 #include "llvm/CodeGen/IntrinsicLowering.h"
 #include "llvm/DerivedTypes.h"
 #include "llvm/Module.h"
+#include "llvm/ADT/STLExtras.h"
 #include <cstring>
 using namespace llvm;
 
@@ -58,6 +59,7 @@ Interpreter::Interpreter(Module *M)
 }
 
 Interpreter::~Interpreter() {
+  DeleteContainerSeconds(FunctionInfos);
   delete IL;
 }
 
@@ -15,6 +15,7 @@
 #define LLI_INTERPRETER_H
 
 #include "llvm/Function.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ExecutionEngine/ExecutionEngine.h"
 #include "llvm/ExecutionEngine/GenericValue.h"
 #include "llvm/Target/TargetData.h"
@@ -26,7 +27,6 @@
 namespace llvm {
 
 class IntrinsicLowering;
-struct FunctionInfo;
 template<typename T> class generic_gep_type_iterator;
 class ConstantExpr;
 typedef generic_gep_type_iterator<User::const_op_iterator> gep_type_iterator;
@@ -64,14 +64,43 @@ public:
 
 typedef std::vector<GenericValue> ValuePlaneTy;
 
+// InstInfo - One instruction of a function, as the interpreter executes it.
+// Each operand is resolved to a reference when the function is lowered: a
+// register slot if it is less than the number of registers in the function,
+// an index into the function's constant pool (offset by the number of
+// registers) otherwise.  Basic block operands hold the number of the block.
+//
+struct InstInfo {
+  Instruction          *Inst;       // The instruction itself
+  unsigned              Dest;       // The register slot of the result, if any
+  const unsigned       *Ops;        // The reference for each operand
+};
+
+// FunctionInfo - The lowered form of a function, built the first time the
+// function is called.  Every argument, and every instruction that produces a
+// value, has a register slot in the stack frame; constant operands are
+// evaluated once, up front.
+//
+struct FunctionInfo {
+  unsigned              NumRegs;    // Register slots in each stack frame
+  std::vector<InstInfo> Insts;      // The instructions, block by block
+  std::vector<unsigned> Operands;   // The operand references of all of them
+  ValuePlaneTy          Constants;  // The values of the constant operands
+  std::vector<BasicBlock*> Blocks;  // The basic blocks, by number
+  std::vector<unsigned> BlockStarts;// The first instruction of each block
+  std::vector<Value*>   RegValues;  // The value held in each register slot
+};
+
 // ExecutionContext struct - This struct represents one stack frame currently
 // executing.
 //
 struct ExecutionContext {
   Function             *CurFunction;// The currently executing function
+  FunctionInfo         *Info;       // The lowered form of CurFunction
   BasicBlock           *CurBB;      // The currently executing BB
-  BasicBlock::iterator  CurInst;    // The next instruction to execute
-  std::map<Value *, GenericValue> Values; // LLVM values used in this invocation
+  const InstInfo       *CurInst;    // The instruction being executed
+  const InstInfo       *NextInst;   // The next instruction to execute
+  ValuePlaneTy          Values;     // The register slots of this invocation
   std::vector<GenericValue>  VarArgs; // Values passed through an ellipsis
   CallSite             Caller;     // Holds the call that called subframes.
                                    // NULL if main func or debugger invoked fn
@@ -93,6 +122,9 @@ class Interpreter : public ExecutionEngine, public InstVisitor<Interpreter> {
   // registered with the atexit() library function.
   std::vector<Function*> AtExitHandlers;
 
+  // The lowered form of each function that has been called.
+  DenseMap<const Function*, FunctionInfo*> FunctionInfos;
+
 public:
   explicit Interpreter(Module *M);
   ~Interpreter();
@@ -191,48 +223,72 @@ public:
   }
 
 private:  // Helper functions
-  GenericValue executeGEPOperation(Value *Ptr, gep_type_iterator I,
-                                   gep_type_iterator E, ExecutionContext &SF);
+  GenericValue executeGEPOperation(GenericValue Ptr, gep_type_iterator I,
+                                   gep_type_iterator E, ExecutionContext *SF);
+
+  // SwitchToNewBasicBlock - Start execution in block number Dest of the
+  // current function and run any PHI nodes in the top of the block.  This is
+  // used for intraprocedural control flow.
+  //
+  void SwitchToNewBasicBlock(unsigned Dest, ExecutionContext &SF);
 
-  // SwitchToNewBasicBlock - Start execution in a new basic block and run any
-  // PHI nodes in the top of the block.  This is used for intraprocedural
-  // control flow.
+  // getFunctionInfo - Return the lowered form of F, building it if needed.
   //
-  void SwitchToNewBasicBlock(BasicBlock *Dest, ExecutionContext &SF);
+  FunctionInfo *getFunctionInfo(Function *F);
+  FunctionInfo *buildFunctionInfo(Function *F);
+
+  // relowerFunction - Lower F again after its code has been changed, and move
+  // the stack frames that are running it over to the new form.  The top
+  // frame continues at Next.
+  //
+  void relowerFunction(Function *F, Instruction *Next);
+
+  // getValue - Return the value of the operand reference Ref in SF.
+  //
+  const GenericValue &getValue(unsigned Ref, ExecutionContext &SF) {
+    if (Ref < SF.Info->NumRegs)
+      return SF.Values[Ref];
+    return SF.Info->Constants[Ref - SF.Info->NumRegs];
+  }
+
+  // getOperandValue - Return the value of operand OpNo of the instruction
+  // being executed in SF.
+  //
+  const GenericValue &getOperandValue(unsigned OpNo, ExecutionContext &SF) {
+    return getValue(SF.CurInst->Ops[OpNo], SF);
+  }
 
   void *getPointerToFunction(Function *F) { return (void*)F; }
   void *getPointerToBasicBlock(BasicBlock *BB) { return (void*)BB; }
 
   void initializeExecutionEngine() { }
   void initializeExternalFunctions();
-  GenericValue getConstantExprValue(ConstantExpr *CE, ExecutionContext &SF);
-  GenericValue getOperandValue(Value *V, ExecutionContext &SF);
-  GenericValue executeTruncInst(Value *SrcVal, const Type *DstTy,
-                                ExecutionContext &SF);
-  GenericValue executeSExtInst(Value *SrcVal, const Type *DstTy,
-                               ExecutionContext &SF);
-  GenericValue executeZExtInst(Value *SrcVal, const Type *DstTy,
-                               ExecutionContext &SF);
-  GenericValue executeFPTruncInst(Value *SrcVal, const Type *DstTy,
-                                  ExecutionContext &SF);
-  GenericValue executeFPExtInst(Value *SrcVal, const Type *DstTy,
-                                ExecutionContext &SF);
-  GenericValue executeFPToUIInst(Value *SrcVal, const Type *DstTy,
-                                 ExecutionContext &SF);
-  GenericValue executeFPToSIInst(Value *SrcVal, const Type *DstTy,
-                                 ExecutionContext &SF);
-  GenericValue executeUIToFPInst(Value *SrcVal, const Type *DstTy,
-                                 ExecutionContext &SF);
-  GenericValue executeSIToFPInst(Value *SrcVal, const Type *DstTy,
-                                 ExecutionContext &SF);
-  GenericValue executePtrToIntInst(Value *SrcVal, const Type *DstTy,
-                                   ExecutionContext &SF);
-  GenericValue executeIntToPtrInst(Value *SrcVal, const Type *DstTy,
-                                   ExecutionContext &SF);
-  GenericValue executeBitCastInst(Value *SrcVal, const Type *DstTy,
-                                  ExecutionContext &SF);
-  GenericValue executeCastOperation(Instruction::CastOps opcode, Value *SrcVal, 
-                                    const Type *Ty, ExecutionContext &SF);
+  GenericValue getConstantExprValue(ConstantExpr *CE);
+  GenericValue getConstantOperandValue(Constant *C);
+  GenericValue executeTruncInst(const GenericValue &Src, const Type *SrcTy,
+                                const Type *DstTy);
+  GenericValue executeSExtInst(const GenericValue &Src, const Type *SrcTy,
+                               const Type *DstTy);
+  GenericValue executeZExtInst(const GenericValue &Src, const Type *SrcTy,
+                               const Type *DstTy);
+  GenericValue executeFPTruncInst(const GenericValue &Src, const Type *SrcTy,
+                                  const Type *DstTy);
+  GenericValue executeFPExtInst(const GenericValue &Src, const Type *SrcTy,
+                                const Type *DstTy);
+  GenericValue executeFPToUIInst(const GenericValue &Src, const Type *SrcTy,
+                                 const Type *DstTy);
+  GenericValue executeFPToSIInst(const GenericValue &Src, const Type *SrcTy,
+                                 const Type *DstTy);
+  GenericValue executeUIToFPInst(const GenericValue &Src, const Type *SrcTy,
+                                 const Type *DstTy);
+  GenericValue executeSIToFPInst(const GenericValue &Src, const Type *SrcTy,
+                                 const Type *DstTy);
+  GenericValue executePtrToIntInst(const GenericValue &Src, const Type *SrcTy,
+                                   const Type *DstTy);
+  GenericValue executeIntToPtrInst(const GenericValue &Src, const Type *SrcTy,
+                                   const Type *DstTy);
+  GenericValue executeBitCastInst(const GenericValue &Src, const Type *SrcTy,
+                                  const Type *DstTy);
   void popStackAndReturnValueToCaller(const Type *RetTy, GenericValue Result);
 
 };
@@ -12,6 +12,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#define DEBUG_TYPE "jit"
 #include "JIT.h"
 #include "llvm/Constants.h"
 #include "llvm/DerivedTypes.h"
@@ -19,6 +20,8 @@
 #include "llvm/GlobalVariable.h"
 #include "llvm/Instructions.h"
 #include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/CodeGen/JITCodeEmitter.h"
 #include "llvm/CodeGen/MachineCodeInfo.h"
 #include "llvm/ExecutionEngine/GenericValue.h"
@@ -26,8 +29,11 @@
 #include "llvm/Target/TargetData.h"
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/Target/TargetJITInfo.h"
+#include "llvm/Support/Debug.h"
 #include "llvm/Support/Dwarf.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/CallSite.h"
+#include "llvm/Support/IRBuilder.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/MutexGuard.h"
 #include "llvm/Support/DynamicLibrary.h"
@@ -35,6 +41,9 @@
 
 using namespace llvm;
 
+STATISTIC(NumTieredUp, "Number of functions recompiled at the higher tier");
+STATISTIC(NumBackground, "Number of functions compiled in the background");
+
 #ifdef __APPLE__
 // Apple gcc defaults to -fuse-cxa-atexit (i.e. calls __cxa_atexit instead
 // of atexit). It passes the address of linker generated symbol __dso_handle
@@ -291,7 +300,9 @@ extern "C" {
 JIT::JIT(Module *M, TargetMachine &tm, TargetJITInfo &tji,
          JITMemoryManager *JMM, CodeGenOpt::Level OptLevel, bool GVsWithCode)
   : ExecutionEngine(M), TM(tm), TJI(tji), AllocateGVsWithCode(GVsWithCode),
-    isAlreadyCodeGenerating(false) {
+    isAlreadyCodeGenerating(false), OptLevel(OptLevel), TierUpThreshold(0),
+    CompilingBaselineTier(false), TierUpThread(0), TierUpThreadRunning(false),
+    BackgroundThread(0), BackgroundThreadRunning(false), ShuttingDown(false) {
   setTargetData(TM.getTargetData());
 
   jitstate = new JITState(M);
@@ -302,16 +313,9 @@ JIT::JIT(Module *M, TargetMachine &tm, TargetJITInfo &tji,
   // Register in global list of all JITs.
   AllJits->Add(this);
 
-  // Add target data
+  // Add the code generation passes.
   MutexGuard locked(lock);
-  FunctionPassManager &PM = jitstate->getPM(locked);
-  PM.add(new TargetData(*TM.getTargetData()));
-
-  // Turn the machine code intermediate representation into bytes in memory that
-  // may be executed.
-  if (TM.addPassesToEmitMachineCode(PM, *JCE, OptLevel)) {
-    report_fatal_error("Target does not support machine code emission!");
-  }
+  initializeJITState(locked);
 
   // Register routine for informing unwinding runtime about new EH frames
 #if HAVE_EHTABLE_SUPPORT
@@ -333,12 +337,24 @@ JIT::JIT(Module *M, TargetMachine &tm, TargetJITInfo &tji,
   //InstallExceptionTableDeregister(__deregister_frame);
 #endif // __APPLE__
 #endif // HAVE_EHTABLE_SUPPORT
-
-  // Initialize passes.
-  PM.doInitialization();
 }
 
 JIT::~JIT() {
+  // Stop the background and tier-up compilers, and wait for any compilation
+  // they are doing to finish before tearing down the state it uses.
+  {
+    MutexGuard locked(lock);
+    MutexGuard guard(TierUpLock);
+    ShuttingDown = true;
+    BackgroundQueue.clear();
+    TierUpQueue.clear();
+  }
+  llvm_join_thread(BackgroundThread);
+  llvm_join_thread(TierUpThread);
+  for (DenseMap<const Function*, TierUpCounter*>::iterator
+         I = TierUpCounters.begin(), E = TierUpCounters.end(); I != E; ++I)
+    delete I->second;
+
   // Unregister all exception tables registered by this JIT.
   DeregisterAllTables();
   // Cleanup.
@@ -348,6 +364,54 @@ JIT::~JIT() {
   delete &TM;
 }
 
+/// initializeJITState - Add the code generation passes to the pass managers of
+/// a freshly created jitstate.
+void JIT::initializeJITState(const MutexGuard &locked) {
+  FunctionPassManager &PM = jitstate->getPM(locked);
+  PM.add(new TargetData(*TM.getTargetData()));
+
+  // Turn the machine code intermediate representation into bytes in memory
+  // that may be executed.  With tiered compilation the first compile of each
+  // function is done as quickly as possible.
+  CodeGenOpt::Level BaselineLevel = TierUpThreshold ? CodeGenOpt::None
+                                                    : OptLevel;
+  if (TM.addPassesToEmitMachineCode(PM, *JCE, BaselineLevel)) {
+    report_fatal_error("Target does not support machine code emission!");
+  }
+
+  // Initialize passes.
+  PM.doInitialization();
+
+  if (!TierUpThreshold)
+    return;
+
+  FunctionPassManager *OptimizedPM =
+    new FunctionPassManager(jitstate->getModule());
+  OptimizedPM->add(new TargetData(*TM.getTargetData()));
+  if (TM.addPassesToEmitMachineCode(*OptimizedPM, *JCE, OptLevel)) {
+    report_fatal_error("Target does not support machine code emission!");
+  }
+  OptimizedPM->doInitialization();
+  jitstate->setOptimizedPM(OptimizedPM, locked);
+}
+
+/// EnableTieredCompilation - Switch to compiling at CodeGenOpt::None first and
+/// at OptLevel once a function has been entered Threshold times.
+void JIT::EnableTieredCompilation(unsigned Threshold) {
+  MutexGuard locked(lock);
+  if (Threshold == TierUpThreshold)
+    return;
+  TierUpThreshold = Threshold;
+
+  // Rebuild the pass managers for the new levels.
+  if (jitstate) {
+    Module *M = jitstate->getModule();
+    delete jitstate;
+    jitstate = new JITState(M);
+    initializeJITState(locked);
+  }
+}
+
 /// addModule - Add a new Module to the JIT.  If we previously removed the last
 /// Module, we need re-initialize jitstate with a valid Module.
 void JIT::addModule(Module *M) {
@@ -357,18 +421,7 @@ void JIT::addModule(Module *M) {
     assert(!jitstate && "jitstate should be NULL if Modules vector is empty!");
 
     jitstate = new JITState(M);
-
-    FunctionPassManager &PM = jitstate->getPM(locked);
-    PM.add(new TargetData(*TM.getTargetData()));
-
-    // Turn the machine code intermediate representation into bytes in memory
-    // that may be executed.
-    if (TM.addPassesToEmitMachineCode(PM, *JCE, CodeGenOpt::Default)) {
-      report_fatal_error("Target does not support machine code emission!");
-    }
-
-    // Initialize passes.
-    PM.doInitialization();
+    initializeJITState(locked);
   }
 
   ExecutionEngine::addModule(M);
@@ -386,20 +439,19 @@ bool JIT::removeModule(Module *M) {
     jitstate = 0;
   }
 
+  // The background compiler must not pick up functions from M any more.
+  for (std::deque<WeakVH>::iterator I = BackgroundQueue.begin();
+       I != BackgroundQueue.end(); ) {
+    Function *F = dyn_cast_or_null<Function>(static_cast<Value*>(*I));
+    if (F && F->getParent() == M)
+      I = BackgroundQueue.erase(I);
+    else
+      ++I;
+  }
+
   if (!jitstate && !Modules.empty()) {
     jitstate = new JITState(Modules[0]);
-
-    FunctionPassManager &PM = jitstate->getPM(locked);
-    PM.add(new TargetData(*TM.getTargetData()));
-
-    // Turn the machine code intermediate representation into bytes in memory
-    // that may be executed.
-    if (TM.addPassesToEmitMachineCode(PM, *JCE, CodeGenOpt::Default)) {
-      report_fatal_error("Target does not support machine code emission!");
-    }
-
-    // Initialize passes.
-    PM.doInitialization();
+    initializeJITState(locked);
   }
   return result;
 }
@@ -639,9 +691,78 @@ void JIT::runJITOnFunctionUnlocked(Function *F, const MutexGuard &locked) {
   assert(!isAlreadyCodeGenerating && "Error: Recursive compilation detected!");
 
   jitTheFunction(F, locked);
+  jitPendingFunctions(locked);
+
+  if (isCompilingInBackground() && isCompilingLazily())
+    queueCalleesForBackground(F, locked);
+}
+
+/// queueCalleesForBackground - Predict that the functions F calls directly
+/// will be called soon, and have the background thread compile the ones that
+/// are not compiled yet.
+void JIT::queueCalleesForBackground(Function *F, const MutexGuard &locked) {
+  bool Queued = false;
+  for (Function::iterator BB = F->begin(), E = F->end(); BB != E; ++BB)
+    for (BasicBlock::iterator I = BB->begin(), IE = BB->end(); I != IE; ++I) {
+      CallSite CS(I);
+      if (!CS.getInstruction())
+        continue;
+      Function *Callee = CS.getCalledFunction();
+      if (!Callee || Callee == F || Callee->isDeclaration() ||
+          Callee->hasAvailableExternallyLinkage() ||
+          getPointerToGlobalIfAvailable(Callee))
+        continue;
+      BackgroundQueue.push_back(Callee);
+      Queued = true;
+    }
+
+  if (!Queued || BackgroundThreadRunning || ShuttingDown)
+    return;
+
+  // The previous background thread, if any, has finished its work and only
+  // needs to be reaped.
+  llvm_join_thread(BackgroundThread);
+  BackgroundThreadRunning = true;
+  BackgroundThread = llvm_start_thread(BackgroundCompileMain, this);
+}
+
+void JIT::BackgroundCompileMain(void *TheJIT) {
+  static_cast<JIT*>(TheJIT)->runBackgroundCompiles();
+}
+
+/// runBackgroundCompiles - Compile the functions in BackgroundQueue one at a
+/// time, releasing the JIT lock in between so that other threads can get in,
+/// and point their lazy stubs at the new code.  A thread that calls one of
+/// these functions through its stub before the background thread gets to it
+/// compiles the function itself, as usual.
+void JIT::runBackgroundCompiles() {
+  while (true) {
+    MutexGuard locked(lock);
+    if (ShuttingDown || BackgroundQueue.empty() || !jitstate) {
+      BackgroundThreadRunning = false;
+      return;
+    }
+
+    Function *F = dyn_cast_or_null<Function>(
+      static_cast<Value*>(BackgroundQueue.front()));
+    BackgroundQueue.pop_front();
 
+    // Skip functions that were deleted or compiled since they were queued.
+    if (!F || getPointerToGlobalIfAvailable(F))
+      continue;
+
+    DEBUG(dbgs() << "JIT: Compiling '" << F->getName()
+                 << "' in the background\n");
+    getPointerToFunction(F);
+    updateFunctionStubIfAvailable(F, /*Concurrent=*/true);
+    ++NumBackground;
+  }
+}
+
+void JIT::jitPendingFunctions(const MutexGuard &locked) {
   // If the function referred to another function that had not yet been
   // read from bitcode, and we are jitting non-lazily, emit it now.
+  SmallVector<Function*, 8> Emitted;
   while (!jitstate->getPendingFunctions(locked).empty()) {
     Function *PF = jitstate->getPendingFunctions(locked).back();
     jitstate->getPendingFunctions(locked).pop_back();
@@ -650,22 +771,201 @@ void JIT::runJITOnFunctionUnlocked(Function *F, const MutexGuard &locked) {
            "Externally-defined function should not be in pending list.");
 
     jitTheFunction(PF, locked);
-
-    // Now that the function has been jitted, ask the JITEmitter to rewrite
-    // the stub with real address of the function.
-    updateFunctionStub(PF);
+    Emitted.push_back(PF);
   }
+
+  // None of the code compiled since the last call can run until it is made
+  // executable.  Doing that for all of it at once lets the memory manager put
+  // functions compiled together on the same pages.
+  setEmittedCodeExecutable();
+
+  // Now that the functions have been jitted, ask the JITEmitter to rewrite
+  // their stubs with the real addresses of the functions.
+  for (unsigned i = 0, e = Emitted.size(); i != e; ++i)
+    updateFunctionStub(Emitted[i]);
+}
+
+namespace {
+/// TierUpInstrumentation - The IR inserted at the start of a function to count
+/// its entries for tiered compilation.  The IR only needs to be there while
+/// the baseline code is generated; remove() restores the function exactly.
+class TierUpInstrumentation {
+  BasicBlock *Entry, *Call, *Body;
+  Instruction *Load, *Add, *Store, *Cmp;
+public:
+  TierUpInstrumentation(Function *F, TierUpCounter *C, unsigned Threshold,
+                        void (*Callback)(void*), const TargetData *TD);
+  void remove();
+};
+}
+
+/// Split the entry block after its allocas, which must stay in the entry block
+/// to be static, and insert:
+///
+///   %count = load Counter->Count
+///   %next = add %count, 1
+///   store %next, Counter->Count
+///   br (%next == Threshold), %tier.up, %tier.body
+/// tier.up:
+///   call Callback(Counter)
+///   br %tier.body
+TierUpInstrumentation::TierUpInstrumentation(Function *F, TierUpCounter *C,
+                                             unsigned Threshold,
+                                             void (*Callback)(void*),
+                                             const TargetData *TD) {
+  LLVMContext &Ctx = F->getContext();
+  const Type *IntPtrTy = TD->getIntPtrType(Ctx);
+
+  Entry = &F->getEntryBlock();
+  BasicBlock::iterator SplitPt = Entry->begin();
+  while (isa<AllocaInst>(SplitPt))
+    ++SplitPt;
+  Body = Entry->splitBasicBlock(SplitPt, "tier.body");
+  Entry->getTerminator()->eraseFromParent();
+  Call = BasicBlock::Create(Ctx, "tier.up", F, Body);
+
+  IRBuilder<> Builder(Entry);
+  Constant *CountPtr =
+    ConstantExpr::getIntToPtr(ConstantInt::get(IntPtrTy, (intptr_t)&C->Count),
+                              Builder.getInt32Ty()->getPointerTo());
+  Load = Builder.CreateLoad(CountPtr, "tier.count");
+  Add = cast<Instruction>(Builder.CreateAdd(Load, Builder.getInt32(1)));
+  Store = Builder.CreateStore(Add, CountPtr);
+  Cmp = cast<Instruction>(Builder.CreateICmpEQ(Add,
+                                               Builder.getInt32(Threshold)));
+  Builder.CreateCondBr(Cmp, Call, Body);
+
+  Builder.SetInsertPoint(Call);
+  const Type *ArgTy = Builder.getInt8PtrTy();
+  const FunctionType *CallbackTy =
+    FunctionType::get(Builder.getVoidTy(), std::vector<const Type*>(1, ArgTy),
+                      false);
+  Constant *CallbackPtr =
+    ConstantExpr::getIntToPtr(ConstantInt::get(IntPtrTy, (intptr_t)Callback),
+                              CallbackTy->getPointerTo());
+  Builder.CreateCall(CallbackPtr,
+    ConstantExpr::getIntToPtr(ConstantInt::get(IntPtrTy, (intptr_t)C), ArgTy));
+  Builder.CreateBr(Body);
+}
+
+void TierUpInstrumentation::remove() {
+  Entry->getTerminator()->eraseFromParent();
+  Cmp->eraseFromParent();
+  Store->eraseFromParent();
+  Add->eraseFromParent();
+  Load->eraseFromParent();
+  Call->eraseFromParent();
+
+  // Merge the body back into the entry block.  Successor PHIs refer to Body.
+  Body->replaceAllUsesWith(Entry);
+  Entry->getInstList().splice(Entry->end(), Body->getInstList());
+  Body->eraseFromParent();
 }
 
 void JIT::jitTheFunction(Function *F, const MutexGuard &locked) {
   isAlreadyCodeGenerating = true;
-  jitstate->getPM(locked).run(*F);
+  if (!TierUpThreshold) {
+    jitstate->getPM(locked).run(*F);
+  } else {
+    // Compile at the baseline tier with a counter on the function's entry.
+    TierUpCounter *&C = TierUpCounters[F];
+    if (!C)
+      C = new TierUpCounter();
+    C->TheJIT = this;
+    C->F = F;
+    C->Count = 0;
+    C->Scheduled = false;
+
+    TierUpInstrumentation Counter(F, C, TierUpThreshold, TierUpCallback,
+                                  getTargetData());
+    CompilingBaselineTier = true;
+    jitstate->getPM(locked).run(*F);
+    CompilingBaselineTier = false;
+    Counter.remove();
+  }
   isAlreadyCodeGenerating = false;
 
   // clear basic block addresses after this function is done
   getBasicBlockAddressMap(locked).clear();
 }
 
+/// TierUpCallback - Called by baseline code when its function has been entered
+/// TierUpThreshold times.  Queue it to be recompiled in the background and
+/// return to the baseline code right away.
+void JIT::TierUpCallback(void *Counter) {
+  TierUpCounter *C = static_cast<TierUpCounter*>(Counter);
+  JIT *TheJIT = C->TheJIT;
+  MutexGuard guard(TheJIT->TierUpLock);
+  if (C->Scheduled || TheJIT->ShuttingDown)
+    return;
+  C->Scheduled = true;
+  TheJIT->TierUpQueue.push_back(C);
+  if (TheJIT->TierUpThreadRunning)
+    return;
+
+  // The previous tier-up thread, if any, has finished its work and only needs
+  // to be reaped.
+  llvm_join_thread(TheJIT->TierUpThread);
+  TheJIT->TierUpThreadRunning = true;
+  TheJIT->TierUpThread = llvm_start_thread(TierUpThreadMain, TheJIT);
+}
+
+void JIT::TierUpThreadMain(void *TheJIT) {
+  static_cast<JIT*>(TheJIT)->runTierUps();
+}
+
+/// runTierUps - Recompile the functions in TierUpQueue one at a time.  The
+/// recompiles hold the JIT lock, so one thread is all they can use.
+void JIT::runTierUps() {
+  while (true) {
+    TierUpCounter *C;
+    {
+      MutexGuard guard(TierUpLock);
+      if (TierUpQueue.empty()) {
+        TierUpThreadRunning = false;
+        return;
+      }
+      C = TierUpQueue.front();
+      TierUpQueue.pop_front();
+    }
+    tierUpFunction(C);
+  }
+}
+
+/// tierUpFunction - Recompile a hot function at OptLevel, and patch its
+/// baseline code and stub to jump to the new code.  Callers that were linked
+/// directly to the baseline code go through its entry, so they pick up the new
+/// code as well.  Other threads may be running the baseline code meanwhile, so
+/// only patches the target can make atomically are applied.
+void JIT::tierUpFunction(TierUpCounter *C) {
+  MutexGuard locked(lock);
+  Function *F = C->F;
+  if (ShuttingDown || !F || !jitstate || !jitstate->getOptimizedPM(locked))
+    return;
+  void *OldAddr = getPointerToGlobalIfAvailable(F);
+  if (!OldAddr)
+    return;
+
+  DEBUG(dbgs() << "JIT: Recompiling hot function '" << F->getName()
+               << "' after " << TierUpThreshold << " calls\n");
+
+  updateGlobalMapping(F, 0);
+  isAlreadyCodeGenerating = true;
+  jitstate->getOptimizedPM(locked)->run(*F);
+  isAlreadyCodeGenerating = false;
+  getBasicBlockAddressMap(locked).clear();
+  jitPendingFunctions(locked);
+
+  void *Addr = getPointerToGlobalIfAvailable(F);
+  assert(Addr && "Code generation didn't add function to GlobalAddress table!");
+  // Code that was already compiled keeps calling the old version if the old
+  // code can't be patched, and so do calls through the stub if the stub can't
+  // be redirected atomically.
+  forwardMachineCode(OldAddr, Addr, /*Concurrent=*/true);
+  updateFunctionStubIfAvailable(F, /*Concurrent=*/true);
+  ++NumTieredUp;
+}
+
 /// getPointerToFunction - This method is used to get the address of the
 /// specified function, compiling it if necessary.
 ///
@@ -789,7 +1089,8 @@ void *JIT::recompileAndRelinkFunction(Function *F) {
   // Update state, forward the old function to the new function.
   void *Addr = getPointerToGlobalIfAvailable(F);
   assert(Addr && "Code generation didn't add function to GlobalAddress table!");
-  TJI.replaceMachineCodeForFunction(OldAddr, Addr);
+  if (!forwardMachineCode(OldAddr, Addr, /*Concurrent=*/false))
+    updateFunctionStubIfAvailable(F);
   return Addr;
 }
 
@@ -16,7 +16,10 @@
 
 #include "llvm/ExecutionEngine/ExecutionEngine.h"
 #include "llvm/PassManager.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/ValueHandle.h"
+#include <deque>
 
 namespace llvm {
 
@@ -26,12 +29,26 @@ class MachineCodeEmitter;
 class MachineCodeInfo;
 class TargetJITInfo;
 class TargetMachine;
+class JIT;
+
+/// TierUpCounter - The entry counter of a function compiled at the baseline
+/// tier, and what the counter's callback needs to find the function.
+struct TierUpCounter {
+  JIT *TheJIT;
+  Function *F;      // Null once the function's code has been freed.
+  unsigned Count;
+  bool Scheduled;   // A recompilation has been queued.
+};
 
 class JITState {
 private:
   FunctionPassManager PM;  // Passes to compile a function
   Module *M;               // Module used to create the PM
 
+  /// OptimizedPM - With tiered compilation, PM compiles every function at
+  /// CodeGenOpt::None and these passes recompile the ones that get hot.
+  OwningPtr<FunctionPassManager> OptimizedPM;
+
   /// PendingFunctions - Functions which have not been code generated yet, but
   /// were called from a function being code generated.
   std::vector<AssertingVH<Function> > PendingFunctions;
@@ -43,6 +60,13 @@ public:
     return PM;
   }
 
+  FunctionPassManager *getOptimizedPM(const MutexGuard &L) {
+    return OptimizedPM.get();
+  }
+  void setOptimizedPM(FunctionPassManager *P, const MutexGuard &L) {
+    OptimizedPM.reset(P);
+  }
+
   Module *getModule() const { return M; }
   std::vector<AssertingVH<Function> > &getPendingFunctions(const MutexGuard &L){
     return PendingFunctions;
@@ -69,6 +93,52 @@ class JIT : public ExecutionEngine {
   /// entry.
   bool isAlreadyCodeGenerating;
 
+  /// OptLevel - The level functions are compiled at.  With tiered compilation
+  /// this is the level hot functions are recompiled at.
+  CodeGenOpt::Level OptLevel;
+
+  /// TierUpThreshold - If nonzero, tiered compilation is enabled, and a
+  /// function is recompiled at OptLevel once it has been entered this many
+  /// times.
+  unsigned TierUpThreshold;
+
+  /// TierUpCounters - The entry counter of every function compiled at the
+  /// baseline tier.  Generated code refers to the counters, so they live as
+  /// long as the JIT.
+  DenseMap<const Function*, TierUpCounter*> TierUpCounters;
+
+  /// CompilingBaselineTier - True while a function is being compiled at the
+  /// baseline tier, whose code must have an entry that can be patched while
+  /// other threads are running it.
+  bool CompilingBaselineTier;
+
+  /// TierUpQueue - The hot functions waiting to be recompiled, in the order
+  /// they got hot.  It is guarded by TierUpLock rather than the JIT lock so
+  /// that hot code does not have to wait for the compiler.
+  std::deque<TierUpCounter*> TierUpQueue;
+  sys::Mutex TierUpLock;
+
+  /// TierUpThread - The thread draining TierUpQueue.  Like BackgroundThread,
+  /// it exits when the queue is empty, and a new one is started when more
+  /// work arrives.  Guarded by TierUpLock.
+  llvm_thread *TierUpThread;
+  bool TierUpThreadRunning;
+
+  /// BackgroundQueue - With background compilation, the callees of compiled
+  /// functions that have not been compiled yet, in the order they were found.
+  /// Guarded by the JIT lock.
+  std::deque<WeakVH> BackgroundQueue;
+
+  /// BackgroundThread - The thread draining BackgroundQueue.  It exits when
+  /// the queue is empty, and a new one is started when more work arrives.
+  llvm_thread *BackgroundThread;
+  bool BackgroundThreadRunning;
+
+  /// ShuttingDown - Set when the JIT is being destroyed, to stop the
+  /// background and tier-up threads early.  Written under both the JIT lock
+  /// and TierUpLock.
+  bool ShuttingDown;
+
   JITState *jitstate;
 
   /// BasicBlockAddressMap - A mapping between LLVM basic blocks and their
@@ -91,6 +161,10 @@ public:
   ///
   TargetJITInfo &getJITInfo() const { return TJI; }
 
+  /// isCompilingBaselineTier - Return true while the function being emitted
+  /// is compiled at the baseline tier of tiered compilation.
+  bool isCompilingBaselineTier() const { return CompilingBaselineTier; }
+
   /// create - Create an return a new JIT compiler if there is one available
   /// for the current target.  Otherwise, return null.
   ///
@@ -158,6 +232,12 @@ public:
   ///
   void *getPointerToFunctionOrStub(Function *F);
 
+  /// EnableTieredCompilation - Compile functions at CodeGenOpt::None with an
+  /// entry counter, and recompile each one at the JIT's optimization level on
+  /// a background thread once it has been entered Threshold times.  This must
+  /// be called before any code is generated.
+  virtual void EnableTieredCompilation(unsigned Threshold);
+
   /// recompileAndRelinkFunction - This method is used to force a function
   /// which has already been compiled, to be compiled again, possibly
   /// after it has been modified. Then the entry to the old copy is overwritten
@@ -221,9 +301,23 @@ public:
 private:
   static JITCodeEmitter *createEmitter(JIT &J, JITMemoryManager *JMM,
                                        TargetMachine &tm);
+  void initializeJITState(const MutexGuard &locked);
   void runJITOnFunctionUnlocked(Function *F, const MutexGuard &locked);
-  void updateFunctionStub(Function *F);
+  bool updateFunctionStub(Function *F, bool Concurrent = false);
+  void updateFunctionStubIfAvailable(Function *F, bool Concurrent = false);
+  bool forwardMachineCode(void *OldAddr, void *Addr, bool Concurrent);
+  void setEmittedCodeExecutable();
   void jitTheFunction(Function *F, const MutexGuard &locked);
+  void jitPendingFunctions(const MutexGuard &locked);
+  void queueCalleesForBackground(Function *F, const MutexGuard &locked);
+
+  static void BackgroundCompileMain(void *TheJIT);
+  void runBackgroundCompiles();
+
+  static void TierUpCallback(void *Counter);
+  static void TierUpThreadMain(void *TheJIT);
+  void runTierUps();
+  void tierUpFunction(TierUpCounter *C);
 
 protected:
 
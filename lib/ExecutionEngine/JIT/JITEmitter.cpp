@@ -389,6 +389,7 @@ namespace {
     static inline bool classof(const MachineCodeEmitter*) { return true; }
 
     JITResolver &getJITResolver() { return Resolver; }
+    JITMemoryManager *getMemMgr() const { return MemMgr; }
 
     virtual void startFunction(MachineFunction &F);
     virtual bool finishFunction(MachineFunction &F);
@@ -806,6 +807,11 @@ void JITEmitter::startFunction(MachineFunction &F) {
   TheJIT->updateGlobalMapping(F.getFunction(), CurBufferPtr);
   EmittedFunctions[F.getFunction()].Code = CurBufferPtr;
 
+  // Baseline code is replaced by a jump to the optimized code while it may be
+  // running, which needs room the target can overwrite atomically.
+  if (TheJIT->isCompilingBaselineTier())
+    TheJIT->getJITInfo().emitPatchableEntry(*this);
+
   MBBLocations.clear();
 
   EmissionDetails.MF = &F;
@@ -934,8 +940,8 @@ bool JITEmitter::finishFunction(MachineFunction &F) {
   Relocations.clear();
   ConstPoolAddresses.clear();
 
-  // Mark code region readable and executable if it's not so already.
-  MemMgr->setMemoryExecutable();
+  // The JIT makes the code executable once it has compiled the functions
+  // this one needs; see JIT::setEmittedCodeExecutable.
 
   DEBUG({
       if (sys::hasDisassembler()) {
@@ -1290,7 +1296,11 @@ void *JIT::getPointerToFunctionOrStub(Function *F) {
   return JE->getJITResolver().getLazyFunctionStub(F);
 }
 
-void JIT::updateFunctionStub(Function *F) {
+/// updateFunctionStub - Point F's lazy stub at F's code.  If Concurrent, other
+/// threads may be calling through the stub, so only do it if the target can
+/// redirect the stub atomically; otherwise the stub is left for the next
+/// caller to resolve itself.  Returns true if the stub was updated.
+bool JIT::updateFunctionStub(Function *F, bool Concurrent) {
   // Get the empty stub we generated earlier.
   assert(isa<JITEmitter>(JCE) && "Unexpected MCE?");
   JITEmitter *JE = cast<JITEmitter>(getCodeEmitter());
@@ -1298,12 +1308,52 @@ void JIT::updateFunctionStub(Function *F) {
   void *Addr = getPointerToGlobalIfAvailable(F);
   assert(Addr != Stub && "Function must have non-stub address to be updated.");
 
+  if (getJITInfo().updateFunctionStub(Stub, Addr))
+    return true;
+  if (Concurrent)
+    return false;
+
   // Tell the target jit info to rewrite the stub at the specified address,
   // rather than creating a new one.
   TargetJITInfo::StubLayout layout = getJITInfo().getStubLayout();
   JE->startGVStub(Stub, layout.Size);
   getJITInfo().emitFunctionStub(F, Addr, *getCodeEmitter());
   JE->finishGVStub();
+  return true;
+}
+
+/// updateFunctionStubIfAvailable - If F has a lazy stub, point it at F's
+/// current code.
+void JIT::updateFunctionStubIfAvailable(Function *F, bool Concurrent) {
+  assert(isa<JITEmitter>(JCE) && "Unexpected MCE?");
+  JITEmitter *JE = cast<JITEmitter>(getCodeEmitter());
+  if (JE->getJITResolver().getLazyFunctionStubIfAvailable(F))
+    updateFunctionStub(F, Concurrent);
+}
+
+/// forwardMachineCode - A function has been recompiled from OldAddr to Addr.
+/// Patch the old code to jump to the new code, unless the memory manager does
+/// not allow emitted code to be modified.  If Concurrent, the old code may be
+/// running, so only patch it if the target can do so atomically.  Returns
+/// true if it was patched.
+bool JIT::forwardMachineCode(void *OldAddr, void *Addr, bool Concurrent) {
+  assert(isa<JITEmitter>(JCE) && "Unexpected MCE?");
+  JITEmitter *JE = cast<JITEmitter>(getCodeEmitter());
+  if (!JE->getMemMgr()->allowsCodePatching())
+    return false;
+  if (TJI.patchFunctionEntry(OldAddr, Addr))
+    return true;
+  if (Concurrent)
+    return false;
+  TJI.replaceMachineCodeForFunction(OldAddr, Addr);
+  return true;
+}
+
+/// setEmittedCodeExecutable - Mark the code emitted since the last call
+/// readable and executable, if it's not so already.
+void JIT::setEmittedCodeExecutable() {
+  assert(isa<JITEmitter>(JCE) && "Unexpected MCE?");
+  cast<JITEmitter>(getCodeEmitter())->getMemMgr()->setMemoryExecutable();
 }
 
 /// freeMachineCodeForFunction - release machine code memory for given Function.
@@ -1313,6 +1363,16 @@ void JIT::freeMachineCodeForFunction(Function *F) {
   // retranslated next time it is used.
   updateGlobalMapping(F, 0);
 
+  // A background recompilation that has not started yet must leave the
+  // function alone.
+  {
+    MutexGuard locked(lock);
+    DenseMap<const Function*, TierUpCounter*>::iterator I =
+      TierUpCounters.find(F);
+    if (I != TierUpCounters.end())
+      I->second->F = 0;
+  }
+
   // Free the actual memory for the function body and related stuff.
   assert(isa<JITEmitter>(JCE) && "Unexpected MCE?");
   cast<JITEmitter>(JCE)->deallocateMemForFunction(F);
@@ -0,0 +1,534 @@
+//===-- RegionJITMemoryManager.cpp - Per-module, W^X JIT memory -----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the RegionJITMemoryManager class, which is returned by
+// JITMemoryManager::CreateRegionMemManager.
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "jit"
+#include "llvm/ExecutionEngine/JITMemoryManager.h"
+#include "llvm/Function.h"
+#include "llvm/GlobalValue.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/Twine.h"
+#include "llvm/Support/Allocator.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/Memory.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+using namespace llvm;
+
+STATISTIC(NumCodeChunks, "Number of code chunks mapped by the JIT");
+STATISTIC(NumRegionsFreed, "Number of module code regions unmapped by the JIT");
+
+/// allocateRWX - Map Size bytes, rounded up to whole pages, for the JIT.
+static sys::MemoryBlock allocateRWX(size_t Size) {
+  std::string ErrMsg;
+  sys::MemoryBlock B = sys::Memory::AllocateRWX(Size, 0, &ErrMsg);
+  if (B.base() == 0)
+    report_fatal_error("Allocation failed when allocating new memory in the"
+                       " JIT\n" + Twine(ErrMsg));
+  return B;
+}
+
+/// protect - Change the protection of B, which must consist of whole pages.
+static void protect(const sys::MemoryBlock &B, unsigned Flags) {
+  std::string ErrMsg;
+  if (sys::Memory::protectBlock(B, Flags, &ErrMsg))
+    report_fatal_error("Unable to change the protection of JIT memory: " +
+                       Twine(ErrMsg));
+}
+
+namespace {
+
+  /// StubSlabAllocator - Allocates the slabs for function stubs.  The JIT
+  /// rewrites stubs while the program runs (for example when a lazily
+  /// compiled function has been generated), so they stay RWX.
+  class StubSlabAllocator : public SlabAllocator {
+  public:
+    uint64_t BytesMapped;
+
+    StubSlabAllocator() : BytesMapped(0) {}
+
+    virtual MemSlab *Allocate(size_t Size) {
+      sys::MemoryBlock B = allocateRWX(Size);
+      BytesMapped += B.size();
+      MemSlab *Slab = (MemSlab*)B.base();
+      Slab->Size = B.size();
+      Slab->NextPtr = 0;
+      return Slab;
+    }
+
+    virtual void Deallocate(MemSlab *Slab) {
+      BytesMapped -= Slab->Size;
+      sys::MemoryBlock B(Slab, Slab->Size);
+      sys::Memory::ReleaseRWX(B);
+    }
+  };
+
+  /// DataSlabAllocator - Allocates the slabs for globals from the heap, which
+  /// is never executable, and keeps count of them.
+  class DataSlabAllocator : public SlabAllocator {
+    MallocSlabAllocator Malloc;
+  public:
+    uint64_t BytesAllocated;
+
+    DataSlabAllocator() : BytesAllocated(0) {}
+
+    virtual MemSlab *Allocate(size_t Size) {
+      MemSlab *Slab = Malloc.Allocate(Size);
+      BytesAllocated += Slab->Size;
+      return Slab;
+    }
+
+    virtual void Deallocate(MemSlab *Slab) {
+      BytesAllocated -= Slab->Size;
+      Malloc.Deallocate(Slab);
+    }
+  };
+
+  /// CodeRegion - The code memory of one module.  It is a list of chunks of
+  /// whole pages, some holding function bodies and some exception tables.
+  /// New blocks are packed one after another at the end of the last chunk of
+  /// their kind.  Once a page of function bodies has been made executable
+  /// nothing more is written to it, so the next body starts on a fresh page.
+  struct CodeRegion {
+    std::vector<sys::MemoryBlock> Chunks;
+
+    /// CodePtr, CodeEnd - The unused memory at the end of the last chunk of
+    /// function bodies.  CodePtr is only in the middle of a page if that page
+    /// is still writable.
+    uint8_t *CodePtr;
+    uint8_t *CodeEnd;
+
+    /// DataPtr, DataEnd - The unused memory at the end of the last chunk of
+    /// exception tables.  These chunks are never made executable.
+    uint8_t *DataPtr;
+    uint8_t *DataEnd;
+
+    /// NumLive - The number of blocks in the region that have not been freed.
+    /// The region is unmapped when this drops to zero.
+    unsigned NumLive;
+
+    /// MappedBytes, LiveBytes - The size of all chunks, and the number of
+    /// bytes used by blocks that have not been freed.
+    uint64_t MappedBytes;
+    uint64_t LiveBytes;
+
+    CodeRegion()
+      : CodePtr(0), CodeEnd(0), DataPtr(0), DataEnd(0), NumLive(0),
+        MappedBytes(0), LiveBytes(0) {}
+  };
+
+  /// CodeBlock - A function body or exception table handed out by the memory
+  /// manager.
+  struct CodeBlock {
+    const Module *M;
+
+    /// Extent - The memory the block owns.  Until the block is finished,
+    /// this is everything that was handed out for it.
+    sys::MemoryBlock Extent;
+
+    /// Used - The number of bytes in use once the block is finished.
+    uintptr_t Used;
+
+    /// IsCode - Function bodies are made executable; exception tables are
+    /// only data and stay writable.
+    bool IsCode;
+  };
+
+  /// RegionJITMemoryManager - Manage memory for the JIT with one region per
+  /// module and no memory that is writable and executable at once, except for
+  /// function stubs.  See JITMemoryManager::CreateRegionMemManager.
+  class RegionJITMemoryManager : public JITMemoryManager {
+    // Whether to poison freed memory.
+    bool PoisonMemory;
+
+    size_t PageSize;
+
+    DenseMap<const Module*, CodeRegion*> Regions;
+
+    // The blocks handed out from the regions, by start address.
+    DenseMap<const void*, CodeBlock> Blocks;
+
+    // Function bodies that have been finished but not made executable yet.
+    std::vector<const void*> Unsealed;
+
+    StubSlabAllocator StubSlabs;
+    DataSlabAllocator DataSlabs;
+    BumpPtrAllocator StubAllocator;
+    BumpPtrAllocator DataAllocator;
+
+    uint8_t *GOTBase;     // Target Specific reserved memory
+
+    /// DefaultChunkSize - Map code memory in chunks of at least this size.
+    static const size_t DefaultChunkSize;
+
+    /// DefaultSlabSize - Allocate stubs and globals in slabs of this size.
+    static const size_t DefaultSlabSize;
+
+    /// BlockAlignment - Blocks packed into a chunk start on this boundary.
+    static const uintptr_t BlockAlignment;
+
+    uintptr_t roundUpToPage(uintptr_t Size) const {
+      return (Size + PageSize - 1) & ~(uintptr_t)(PageSize - 1);
+    }
+
+    /// getPages - Return the whole pages that Block overlaps.
+    sys::MemoryBlock getPages(const CodeBlock &Block) const {
+      uintptr_t Start = (uintptr_t)Block.Extent.base();
+      uintptr_t PagesStart = Start & ~(uintptr_t)(PageSize - 1);
+      uintptr_t PagesEnd = roundUpToPage(Start + Block.Extent.size());
+      return sys::MemoryBlock((void*)PagesStart, PagesEnd - PagesStart);
+    }
+
+    /// startBlock - Hand out the rest of the current chunk of the given kind
+    /// in the region of M, or a new chunk if fewer than ActualSize bytes (a
+    /// page without a size hint) are left.  ActualSize is set to the size
+    /// handed out.
+    uint8_t *startBlock(const Module *M, uintptr_t &ActualSize, bool IsCode);
+
+    /// endBlock - Finish the block at Start, which uses [Start, End), and give
+    /// the memory it did not use back to the region.
+    void endBlock(uint8_t *Start, uint8_t *End);
+
+    /// deallocateBlock - Free the block at Start, and its region if that was
+    /// the region's last live block.
+    void deallocateBlock(void *Start);
+
+  public:
+    RegionJITMemoryManager();
+    ~RegionJITMemoryManager();
+
+    void AllocateGOT() {
+      assert(GOTBase == 0 && "Cannot allocate the got multiple times");
+      GOTBase = new uint8_t[sizeof(void*) * 8192];
+      HasGOT = true;
+    }
+
+    uint8_t *getGOTBase() const {
+      return GOTBase;
+    }
+
+    uint8_t *startFunctionBody(const Function *F, uintptr_t &ActualSize) {
+      return startBlock(F->getParent(), ActualSize, /*IsCode=*/true);
+    }
+
+    void endFunctionBody(const Function *F, uint8_t *FunctionStart,
+                         uint8_t *FunctionEnd) {
+      endBlock(FunctionStart, FunctionEnd);
+      Unsealed.push_back(FunctionStart);
+    }
+
+    uint8_t *startExceptionTable(const Function *F, uintptr_t &ActualSize) {
+      return startBlock(F->getParent(), ActualSize, /*IsCode=*/false);
+    }
+
+    void endExceptionTable(const Function *F, uint8_t *TableStart,
+                           uint8_t *TableEnd, uint8_t *FrameRegister) {
+      endBlock(TableStart, TableEnd);
+    }
+
+    /// allocateSpace - Constant pools and the like are only data, so they
+    /// come from the heap like globals.
+    uint8_t *allocateSpace(intptr_t Size, unsigned Alignment) {
+      return (uint8_t*)DataAllocator.Allocate(Size, Alignment);
+    }
+
+    uint8_t *allocateGlobal(uintptr_t Size, unsigned Alignment) {
+      return (uint8_t*)DataAllocator.Allocate(Size, Alignment);
+    }
+
+    uint8_t *allocateStub(const GlobalValue *F, unsigned StubSize,
+                          unsigned Alignment) {
+      return (uint8_t*)StubAllocator.Allocate(StubSize, Alignment);
+    }
+
+    void deallocateFunctionBody(void *Body) {
+      if (Body) deallocateBlock(Body);
+    }
+
+    void deallocateExceptionTable(void *ET) {
+      if (ET) deallocateBlock(ET);
+    }
+
+    /// setMemoryWritable - Every block is handed out on pages that have never
+    /// been executable, so there is nothing to do.
+    void setMemoryWritable() {}
+
+    /// setMemoryExecutable - Flip the pages of the function bodies finished
+    /// since the last call from read/write to read/execute.  Bodies finished
+    /// together share pages.  The JIT calls this once it has compiled a
+    /// function and the functions that had to be compiled with it, so with
+    /// lazy compilation each function body still starts on its own page.
+    void setMemoryExecutable();
+
+    void setPoisonMemory(bool poison) {
+      PoisonMemory = poison;
+    }
+
+    bool allowsCodePatching() const {
+      return false;
+    }
+
+    bool getMemoryStats(JITMemoryStats &Stats);
+
+    virtual bool CheckInvariants(std::string &ErrorStr);
+  };
+}
+
+// Map code memory in chunks of 64K.  (probably 16 pages)
+const size_t RegionJITMemoryManager::DefaultChunkSize = 64 * 1024;
+
+// Allocate stubs and globals in slabs of 64K, like the default manager.
+const size_t RegionJITMemoryManager::DefaultSlabSize = 64 * 1024;
+
+// Align packed blocks like the default manager aligns function bodies.
+const uintptr_t RegionJITMemoryManager::BlockAlignment = 16;
+
+RegionJITMemoryManager::RegionJITMemoryManager()
+  :
+#ifdef NDEBUG
+    PoisonMemory(false),
+#else
+    PoisonMemory(true),
+#endif
+    PageSize(sys::Process::GetPageSize()),
+    StubAllocator(DefaultSlabSize, DefaultSlabSize, StubSlabs),
+    DataAllocator(DefaultSlabSize, DefaultSlabSize, DataSlabs), GOTBase(0) {
+}
+
+RegionJITMemoryManager::~RegionJITMemoryManager() {
+  for (DenseMap<const Module*, CodeRegion*>::iterator I = Regions.begin(),
+       E = Regions.end(); I != E; ++I) {
+    CodeRegion *R = I->second;
+    for (unsigned i = 0, e = R->Chunks.size(); i != e; ++i)
+      sys::Memory::ReleaseRWX(R->Chunks[i]);
+    delete R;
+  }
+  delete[] GOTBase;
+}
+
+uint8_t *RegionJITMemoryManager::startBlock(const Module *M,
+                                            uintptr_t &ActualSize,
+                                            bool IsCode) {
+  CodeRegion *&R = Regions[M];
+  if (!R)
+    R = new CodeRegion();
+  uint8_t *&CurPtr = IsCode ? R->CodePtr : R->DataPtr;
+  uint8_t *&End = IsCode ? R->CodeEnd : R->DataEnd;
+
+  // Without a size hint, hand out at least a page; the JIT asks again with a
+  // bigger size if the block does not fit.
+  uintptr_t MinSize = ActualSize ? ActualSize : PageSize;
+  uint8_t *Start =
+    (uint8_t*)RoundUpToAlignment((uintptr_t)CurPtr, BlockAlignment);
+  if (!CurPtr || Start >= End || uintptr_t(End - Start) < MinSize) {
+    // Whatever is left of the current chunk stays unused; it is counted as
+    // fragmentation.
+    sys::MemoryBlock B = allocateRWX(std::max(DefaultChunkSize,
+                                              (size_t)roundUpToPage(MinSize)));
+    protect(B, sys::Memory::MF_READ | sys::Memory::MF_WRITE);
+    if (PoisonMemory)
+      memset(B.base(), 0xCD, B.size());
+    R->Chunks.push_back(B);
+    R->MappedBytes += B.size();
+    Start = (uint8_t*)B.base();
+    End = Start + B.size();
+    ++NumCodeChunks;
+  }
+
+  ActualSize = End - Start;
+  CurPtr = End;
+  ++R->NumLive;
+
+  CodeBlock &Block = Blocks[Start];
+  Block.M = M;
+  Block.Extent = sys::MemoryBlock(Start, ActualSize);
+  Block.Used = 0;
+  Block.IsCode = IsCode;
+  return Start;
+}
+
+void RegionJITMemoryManager::endBlock(uint8_t *Start, uint8_t *End) {
+  assert(End > Start && "Empty block!");
+  DenseMap<const void*, CodeBlock>::iterator I = Blocks.find(Start);
+  assert(I != Blocks.end() && "Mismatched block start/end!");
+  CodeBlock &Block = I->second;
+  CodeRegion *R = Regions[Block.M];
+
+  uint8_t *ExtentEnd = (uint8_t*)Block.Extent.base() + Block.Extent.size();
+  assert(End <= ExtentEnd && "Block overran its memory!");
+
+  // If this is still the last block of the chunk, give back the memory it did
+  // not use.  The next block is packed right after this one.
+  uint8_t *&CurPtr = Block.IsCode ? R->CodePtr : R->DataPtr;
+  if (CurPtr == ExtentEnd)
+    CurPtr = End;
+  Block.Extent = sys::MemoryBlock(Start, End - Start);
+  Block.Used = End - Start;
+  R->LiveBytes += Block.Used;
+}
+
+void RegionJITMemoryManager::deallocateBlock(void *Start) {
+  DenseMap<const void*, CodeBlock>::iterator I = Blocks.find(Start);
+  assert(I != Blocks.end() && "Block isn't allocated!");
+  CodeBlock Block = I->second;
+  Blocks.erase(I);
+
+  // A body that is freed before it was made executable (because the JIT ran
+  // out of space and is starting over) must not be sealed later.
+  std::vector<const void*>::iterator U =
+    std::find(Unsealed.begin(), Unsealed.end(), Start);
+  bool Executable = Block.IsCode && U == Unsealed.end();
+  if (U != Unsealed.end())
+    Unsealed.erase(U);
+
+  DenseMap<const Module*, CodeRegion*>::iterator RI = Regions.find(Block.M);
+  CodeRegion *R = RI->second;
+  R->LiveBytes -= Block.Used;
+  if (--R->NumLive == 0) {
+    // That was the last block of the module; return the whole region to the
+    // OS.
+    DEBUG(dbgs() << "JIT: Unmapping " << R->MappedBytes
+                 << " bytes of code for a freed module\n");
+    for (unsigned i = 0, e = R->Chunks.size(); i != e; ++i)
+      sys::Memory::ReleaseRWX(R->Chunks[i]);
+    delete R;
+    Regions.erase(RI);
+    ++NumRegionsFreed;
+    return;
+  }
+
+  // Memory that was never made executable can be handed out again if
+  // nothing was allocated after it.
+  uint8_t *&CurPtr = Block.IsCode ? R->CodePtr : R->DataPtr;
+  uint8_t *ExtentEnd = (uint8_t*)Block.Extent.base() + Block.Extent.size();
+  if (!Executable && CurPtr == ExtentEnd) {
+    CurPtr = (uint8_t*)Block.Extent.base();
+    if (PoisonMemory)
+      memset(Block.Extent.base(), 0xCD, Block.Extent.size());
+    return;
+  }
+
+  // Otherwise fill the dead block with garbage, if asked to.  Executable
+  // pages may hold other functions that are running, so only the pages that
+  // lie entirely inside the block are made writable to do that.
+  if (!PoisonMemory)
+    return;
+  if (!Executable) {
+    memset(Block.Extent.base(), 0xCD, Block.Extent.size());
+    return;
+  }
+  uintptr_t PoisonStart = roundUpToPage((uintptr_t)Block.Extent.base());
+  uintptr_t PoisonEnd = (uintptr_t)ExtentEnd & ~(uintptr_t)(PageSize - 1);
+  if (PoisonStart < PoisonEnd) {
+    sys::MemoryBlock Pages((void*)PoisonStart, PoisonEnd - PoisonStart);
+    protect(Pages, sys::Memory::MF_READ | sys::Memory::MF_WRITE);
+    memset(Pages.base(), 0xCD, Pages.size());
+    protect(Pages, sys::Memory::MF_READ | sys::Memory::MF_EXEC);
+  }
+}
+
+void RegionJITMemoryManager::setMemoryExecutable() {
+  for (unsigned i = 0, e = Unsealed.size(); i != e; ++i) {
+    const CodeBlock &Block = Blocks.find(Unsealed[i])->second;
+    sys::MemoryBlock Pages = getPages(Block);
+    protect(Pages, sys::Memory::MF_READ | sys::Memory::MF_EXEC);
+    sys::Memory::InvalidateInstructionCache(Block.Extent.base(),
+                                            Block.Extent.size());
+
+    // The rest of the last page is no longer writable, so the next function
+    // body starts on the following page.
+    CodeRegion *R = Regions[Block.M];
+    uint8_t *PagesEnd = (uint8_t*)Pages.base() + Pages.size();
+    if (R->CodePtr >= (uint8_t*)Pages.base() && R->CodePtr < PagesEnd)
+      R->CodePtr = PagesEnd;
+  }
+  Unsealed.clear();
+}
+
+bool RegionJITMemoryManager::getMemoryStats(JITMemoryStats &Stats) {
+  Stats = JITMemoryStats();
+  for (DenseMap<const Module*, CodeRegion*>::iterator I = Regions.begin(),
+       E = Regions.end(); I != E; ++I) {
+    Stats.CodeBytes += I->second->MappedBytes;
+    Stats.LiveCodeBytes += I->second->LiveBytes;
+  }
+  Stats.StubBytes = StubSlabs.BytesMapped;
+  Stats.DataBytes = DataSlabs.BytesAllocated;
+  Stats.NumRegions = Regions.size();
+  return true;
+}
+
+/// CheckInvariants - For testing only.  Check that every block is aligned and
+/// lies inside a chunk of its module's region, that no writable function body
+/// shares a page with an executable one, and that the per-region counts agree
+/// with the blocks.
+bool RegionJITMemoryManager::CheckInvariants(std::string &ErrorStr) {
+  raw_string_ostream Err(ErrorStr);
+  DenseMap<const CodeRegion*, std::pair<unsigned, uint64_t> > Counts;
+
+  for (DenseMap<const void*, CodeBlock>::iterator I = Blocks.begin(),
+       E = Blocks.end(); I != E; ++I) {
+    const CodeBlock &Block = I->second;
+    DenseMap<const Module*, CodeRegion*>::iterator RI = Regions.find(Block.M);
+    if (RI == Regions.end()) {
+      Err << "Block at " << I->first << " has no region.";
+      return false;
+    }
+    const CodeRegion *R = RI->second;
+
+    uintptr_t Start = (uintptr_t)Block.Extent.base();
+    if (Start % BlockAlignment) {
+      Err << "Block at " << I->first << " is not aligned.";
+      return false;
+    }
+
+    bool Found = false;
+    for (unsigned i = 0, e = R->Chunks.size(); i != e && !Found; ++i) {
+      uintptr_t ChunkStart = (uintptr_t)R->Chunks[i].base();
+      Found = ChunkStart <= Start &&
+              Start + Block.Extent.size() <= ChunkStart + R->Chunks[i].size();
+    }
+    if (!Found) {
+      Err << "Block at " << I->first << " is outside its region.";
+      return false;
+    }
+
+    std::pair<unsigned, uint64_t> &C = Counts[R];
+    ++C.first;
+    C.second += Block.Used;
+  }
+
+  for (DenseMap<const Module*, CodeRegion*>::iterator I = Regions.begin(),
+       E = Regions.end(); I != E; ++I) {
+    std::pair<unsigned, uint64_t> C = Counts.lookup(I->second);
+    if (C.first != I->second->NumLive || C.second != I->second->LiveBytes) {
+      Err << "Region has " << I->second->NumLive << " live blocks of "
+          << I->second->LiveBytes << " bytes, but " << C.first
+          << " blocks of " << C.second << " bytes were found.";
+      return false;
+    }
+  }
+
+  // All invariants are preserved.
+  return true;
+}
+
+JITMemoryManager *JITMemoryManager::CreateRegionMemManager() {
+  return new RegionJITMemoryManager();
+}
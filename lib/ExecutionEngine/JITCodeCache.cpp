@@ -0,0 +1,314 @@
+//===-- JITCodeCache.cpp - Persistent cache of JIT'd object files ---------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the on-disk object cache used by the JIT to skip code
+// generation for modules it has already compiled in an earlier process.
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "jit"
+#include "llvm/ExecutionEngine/JITCodeCache.h"
+#include "llvm/Module.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Config/config.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetOptions.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+using namespace llvm;
+
+STATISTIC(NumCacheHits,    "Number of objects loaded from the JIT code cache");
+STATISTIC(NumCacheMisses,  "Number of JIT code cache lookups that missed");
+STATISTIC(NumCacheInvalid, "Number of invalid JIT code cache entries removed");
+STATISTIC(NumCacheStores,  "Number of objects stored in the JIT code cache");
+STATISTIC(NumCachePruned,  "Number of JIT code cache entries pruned");
+
+/// Every cache entry starts with this header, followed by the key and then
+/// the object.  All fields are little-endian.
+///
+///   char     Magic[8]   "LLVMJITC"
+///   uint32_t Version
+///   uint32_t KeySize
+///   uint64_t ObjectSize
+///   uint64_t ObjectHash
+///
+/// CacheVersion must be bumped whenever this layout changes, or the objects
+/// change in a way the key does not capture, such as a change to the object
+/// format RuntimeDyld expects.  Entries of any other version are misses.
+static const char CacheMagic[] = "LLVMJITC";
+static const unsigned CacheMagicSize = 8;
+static const unsigned CacheVersion = 2;
+static const unsigned CacheHeaderSize = CacheMagicSize + 4 + 4 + 8 + 8;
+static const char CacheExtension[] = ".jitobj";
+
+/// hashBytes - 64-bit FNV-1a.  This only has to tell apart different modules
+/// and detect damaged entries, not resist deliberate collisions; the full key
+/// is stored in each entry as well.
+static uint64_t hashBytes(StringRef Data) {
+  uint64_t Hash = 14695981039346656037ULL;
+  for (StringRef::iterator I = Data.begin(), E = Data.end(); I != E; ++I) {
+    Hash ^= (unsigned char)*I;
+    Hash *= 1099511628211ULL;
+  }
+  return Hash;
+}
+
+static void writeLE(raw_ostream &OS, uint64_t Value, unsigned Bytes) {
+  for (unsigned i = 0; i != Bytes; ++i)
+    OS << char((Value >> (8 * i)) & 0xFF);
+}
+
+static uint64_t readLE(const char *Ptr, unsigned Bytes) {
+  uint64_t Value = 0;
+  for (unsigned i = 0; i != Bytes; ++i)
+    Value |= uint64_t((unsigned char)Ptr[i]) << (8 * i);
+  return Value;
+}
+
+static std::string toHex(uint64_t Value) {
+  std::string Str;
+  raw_string_ostream OS(Str);
+  OS << format("%016llx", (unsigned long long)Value);
+  return OS.str();
+}
+
+JITCodeCache::JITCodeCache(StringRef dir, uint64_t maxSize)
+  : Dir(dir), MaxSize(maxSize) {
+  bool Existed;
+  sys::fs::create_directories(Dir, Existed);
+}
+
+std::string JITCodeCache::getPathForKey(StringRef Key) const {
+  SmallString<128> Path(Dir);
+  sys::path::append(Path, toHex(hashBytes(Key)) + CacheExtension);
+  return Path.str();
+}
+
+/// printTargetOptions - Print the code generation options which are held in
+/// globals rather than in the TargetMachine.
+static void printTargetOptions(raw_ostream &OS) {
+  const bool Flags[] = {
+    NoFramePointerElim, NoFramePointerElimNonLeaf, LessPreciseFPMADOption,
+    NoExcessFPPrecision, UnsafeFPMath, NoInfsFPMath, NoNaNsFPMath,
+    HonorSignDependentRoundingFPMathOption, UseSoftFloat, NoZerosInBSS,
+    JITExceptionHandling, JITEmitDebugInfo, UnwindTablesMandatory,
+    GuaranteedTailCallOpt, RealignStack, DisableJumpTables, EnableFastISel,
+    StrongPHIElim, HasDivModLibcall
+  };
+  for (unsigned i = 0; i != array_lengthof(Flags); ++i)
+    OS << (Flags[i] ? '1' : '0');
+  OS << "-fabi" << unsigned(FloatABIType) << "-sa" << StackAlignment
+     << "-trap" << getTrapFunctionName();
+}
+
+std::string JITCodeCache::getKey(const Module &M, StringRef Triple,
+                                 StringRef CPU,
+                                 const SmallVectorImpl<std::string> &Attrs,
+                                 CodeGenOpt::Level OptLevel,
+                                 CodeModel::Model CMModel) {
+  // Hash the textual form of the module; it captures everything codegen
+  // sees, including types, attributes and metadata.
+  std::string IR;
+  raw_string_ostream IROS(IR);
+  M.print(IROS, 0);
+  IROS.flush();
+
+  std::string Key;
+  raw_string_ostream OS(Key);
+  OS << toHex(hashBytes(IR)) << '-' << Triple << '-' << CPU << '-';
+  for (unsigned i = 0, e = Attrs.size(); i != e; ++i)
+    OS << (i ? "," : "") << Attrs[i];
+  OS << "-O" << unsigned(OptLevel) << "-cm" << unsigned(CMModel) << '-';
+  printTargetOptions(OS);
+
+  // Objects from another version of LLVM may have been generated
+  // differently.  Builds from a revision control system define
+  // LLVM_VERSION_INFO to the revision.
+  OS << "-" PACKAGE_VERSION;
+#ifdef LLVM_VERSION_INFO
+  OS << LLVM_VERSION_INFO;
+#endif
+  return OS.str();
+}
+
+MemoryBuffer *JITCodeCache::lookup(StringRef Key) {
+  std::string Path = getPathForKey(Key);
+  OwningPtr<MemoryBuffer> Entry;
+  if (MemoryBuffer::getFile(Path, Entry)) {
+    ++NumCacheMisses;
+    return 0;
+  }
+
+  // Validate the entry before trusting any of it.
+  const char *Start = Entry->getBufferStart();
+  uint64_t EntrySize = Entry->getBufferSize();
+  bool Valid = EntrySize >= CacheHeaderSize &&
+               memcmp(Start, CacheMagic, CacheMagicSize) == 0 &&
+               readLE(Start + 8, 4) == CacheVersion;
+  uint64_t KeySize = Valid ? readLE(Start + 12, 4) : 0;
+  uint64_t ObjectSize = Valid ? readLE(Start + 16, 8) : 0;
+  Valid = Valid && EntrySize == CacheHeaderSize + KeySize + ObjectSize;
+  StringRef Object;
+  if (Valid) {
+    Valid = StringRef(Start + CacheHeaderSize, KeySize) == Key;
+    Object = StringRef(Start + CacheHeaderSize + KeySize, ObjectSize);
+    Valid = Valid && hashBytes(Object) == readLE(Start + 24, 8);
+  }
+
+  if (!Valid) {
+    DEBUG(dbgs() << "JIT: Removing invalid code cache entry " << Path << "\n");
+    ++NumCacheInvalid;
+    ++NumCacheMisses;
+    bool Existed;
+    sys::fs::remove(Path, Existed);
+    return 0;
+  }
+
+  ++NumCacheHits;
+  return MemoryBuffer::getMemBufferCopy(Object, Path);
+}
+
+bool JITCodeCache::store(StringRef Key, StringRef Object,
+                         std::string *ErrMsg) {
+  uint64_t EntrySize = CacheHeaderSize + Key.size() + Object.size();
+  if (MaxSize && EntrySize > MaxSize) {
+    if (ErrMsg)
+      *ErrMsg = "object is larger than the code cache size limit";
+    return true;
+  }
+
+  // Write the entry to a temporary file in the cache directory and rename it
+  // into place, so that concurrent readers only ever see complete entries.
+  SmallString<128> Model(Dir);
+  sys::path::append(Model, "%%%%%%%%.tmp");
+  SmallString<128> TmpPath;
+  int FD;
+  if (error_code EC = sys::fs::unique_file(Twine(Model), FD, TmpPath)) {
+    if (ErrMsg)
+      *ErrMsg = EC.message();
+    return true;
+  }
+
+  {
+    raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    OS.write(CacheMagic, CacheMagicSize);
+    writeLE(OS, CacheVersion, 4);
+    writeLE(OS, Key.size(), 4);
+    writeLE(OS, Object.size(), 8);
+    writeLE(OS, hashBytes(Object), 8);
+    OS << Key << Object;
+    OS.close();
+    if (OS.has_error()) {
+      OS.clear_error();
+      bool Existed;
+      sys::fs::remove(Twine(TmpPath), Existed);
+      if (ErrMsg)
+        *ErrMsg = "error writing code cache entry";
+      return true;
+    }
+  }
+
+  std::string Path = getPathForKey(Key);
+  if (error_code EC = sys::fs::rename(Twine(TmpPath), Path)) {
+    bool Existed;
+    sys::fs::remove(Twine(TmpPath), Existed);
+    if (ErrMsg)
+      *ErrMsg = EC.message();
+    return true;
+  }
+
+  ++NumCacheStores;
+  pruneExcept(Path);
+  return false;
+}
+
+namespace {
+  /// CacheEntry - A file in the cache directory, as seen by the pruner.
+  struct CacheEntry {
+    std::string Path;
+    uint64_t Size;
+    sys::TimeValue ModTime;
+
+    CacheEntry(const std::string &path, uint64_t size, sys::TimeValue modTime)
+      : Path(path), Size(size), ModTime(modTime) {}
+
+    bool operator<(const CacheEntry &RHS) const {
+      if (ModTime != RHS.ModTime)
+        return ModTime < RHS.ModTime;
+      return Path < RHS.Path;
+    }
+  };
+}
+
+/// getEntries - Collect the cache entries in Dir, with their sizes and
+/// modification times.
+static void getEntries(StringRef Dir, std::vector<CacheEntry> &Entries) {
+  error_code EC;
+  for (sys::fs::directory_iterator I(Dir, EC), E; I != E && !EC;
+       I.increment(EC)) {
+    if (sys::path::extension(I->path()) != CacheExtension)
+      continue;
+    sys::PathWithStatus P(I->path());
+    const sys::FileStatus *Status = P.getFileStatus();
+    if (!Status)
+      continue;
+    Entries.push_back(CacheEntry(I->path(), Status->getSize(),
+                                 Status->getTimestamp()));
+  }
+}
+
+uint64_t JITCodeCache::getSize() const {
+  std::vector<CacheEntry> Entries;
+  getEntries(Dir, Entries);
+  uint64_t Size = 0;
+  for (unsigned i = 0, e = Entries.size(); i != e; ++i)
+    Size += Entries[i].Size;
+  return Size;
+}
+
+void JITCodeCache::prune() {
+  pruneExcept(StringRef());
+}
+
+void JITCodeCache::pruneExcept(StringRef Keep) {
+  if (!MaxSize)
+    return;
+
+  std::vector<CacheEntry> Entries;
+  getEntries(Dir, Entries);
+  uint64_t Size = 0;
+  for (unsigned i = 0, e = Entries.size(); i != e; ++i)
+    Size += Entries[i].Size;
+  if (Size <= MaxSize)
+    return;
+
+  // Remove the oldest entries first.  The entry that was just stored is kept
+  // even if it is no newer than the others by the file system's clock.
+  std::sort(Entries.begin(), Entries.end());
+  for (unsigned i = 0, e = Entries.size(); i != e && Size > MaxSize; ++i) {
+    if (Entries[i].Path == Keep)
+      continue;
+    bool Existed;
+    if (sys::fs::remove(Entries[i].Path, Existed) || !Existed)
+      continue;
+    DEBUG(dbgs() << "JIT: Pruned code cache entry " << Entries[i].Path
+                 << "\n");
+    Size -= Entries[i].Size;
+    ++NumCachePruned;
+  }
+}
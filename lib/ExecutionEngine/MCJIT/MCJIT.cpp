@@ -9,16 +9,32 @@
 
 #include "MCJIT.h"
 #include "MCJITMemoryManager.h"
+#include "llvm/Constants.h"
 #include "llvm/DerivedTypes.h"
 #include "llvm/Function.h"
+#include "llvm/GlobalAlias.h"
+#include "llvm/GlobalVariable.h"
+#include "llvm/Instructions.h"
+#include "llvm/Module.h"
+#include "llvm/PassManager.h"
 #include "llvm/ExecutionEngine/GenericValue.h"
+#include "llvm/ExecutionEngine/JITCodeCache.h"
 #include "llvm/ExecutionEngine/MCJIT.h"
 #include "llvm/ExecutionEngine/JITMemoryManager.h"
 #include "llvm/MC/MCAsmInfo.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/CallSite.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/DynamicLibrary.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/MutexGuard.h"
+#include "llvm/Support/raw_ostream.h"
 #include "llvm/Target/TargetData.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include <cstring>
 
 using namespace llvm;
 
@@ -33,6 +49,15 @@ static struct RegisterJIT {
 extern "C" void LLVMLinkInMCJIT() {
 }
 
+/// The names of the symbols that make up a lazy compilation stub for a
+/// function: the stub itself, the stub target passed to the compile callback,
+/// and a pointer to the callback.  The stub calls the callback through a
+/// pointer because the callback may be too far away from JIT'd code for a
+/// direct call.
+static const char StubSuffix[] = ".mcjit.stub";
+static const char StubTargetSuffix[] = ".mcjit.target";
+static const char CompileCallbackName[] = "__mcjit.compile";
+
 ExecutionEngine *MCJIT::createJIT(Module *M,
                                   std::string *ErrorStr,
                                   JITMemoryManager *JMM,
@@ -58,8 +83,7 @@ ExecutionEngine *MCJIT::createJIT(Module *M,
 
   // If the target supports JIT code generation, create the JIT.
   if (TargetJITInfo *TJ = TM->getJITInfo())
-    return new MCJIT(M, TM, *TJ, new MCJITMemoryManager(JMM), OptLevel,
-                     GVsWithCode);
+    return new MCJIT(M, TM, *TJ, JMM, OptLevel, GVsWithCode, MCPU, MAttrs);
 
   if (ErrorStr)
     *ErrorStr = "target does not support JIT code generation";
@@ -67,38 +91,444 @@ ExecutionEngine *MCJIT::createJIT(Module *M,
 }
 
 MCJIT::MCJIT(Module *m, TargetMachine *tm, TargetJITInfo &tji,
-             RTDyldMemoryManager *MM, CodeGenOpt::Level OptLevel,
-             bool AllocateGVsWithCode)
-  : ExecutionEngine(m), TM(tm), MemMgr(MM), M(m), OS(Buffer), Dyld(MM) {
+             JITMemoryManager *JMM, CodeGenOpt::Level optLevel,
+             bool AllocateGVsWithCode, StringRef MCPU,
+             const SmallVectorImpl<std::string> &MAttrs)
+  : ExecutionEngine(m), TM(tm), MemMgr(new MCJITMemoryManager(JMM, this)),
+    OptLevel(optLevel), CPU(MCPU), Attrs(MAttrs.begin(), MAttrs.end()),
+    CMModel(tm->getCodeModel()), Cache(0), Dyld(MemMgr), NextModuleID(0),
+    NumAnonymous(0), LinkDepth(0) {
+  setTargetData(TM->getTargetData());
+  registerModule(m);
+
+  // Nothing is compiled until code is needed, so that a code cache can still
+  // be set up after construction.
+}
+
+MCJIT::~MCJIT() {
+  DeleteContainerSeconds(StubTargets);
+  delete MemMgr;
+}
+
+void MCJIT::setCodeCache(JITCodeCache *C) {
+  MutexGuard locked(lock);
+  Cache = C;
+}
+
+void MCJIT::addModule(Module *M) {
+  MutexGuard locked(lock);
+  ExecutionEngine::addModule(M);
+  registerModule(M);
+}
+
+bool MCJIT::removeModule(Module *M) {
+  MutexGuard locked(lock);
+  if (!ExecutionEngine::removeModule(M))
+    return false;
+
+  // Forget the module's names.  The RuntimeDyld cannot unload code, so any
+  // code generated for it stays in memory.
+  for (Module::iterator I = M->begin(), E = M->end(); I != E; ++I) {
+    DenseMap<const GlobalValue*, std::string>::iterator N =
+      SymbolNames.find(I);
+    if (N == SymbolNames.end())
+      continue;
+    if (Definitions.lookup(N->second) == I)
+      Definitions.erase(N->second);
+    SymbolNames.erase(N);
+    DenseMap<const Function*, LazyStubTarget*>::iterator T =
+      StubTargets.find(I);
+    if (T != StubTargets.end()) {
+      // A stub that is still reachable would call back into a dead function.
+      T->second->F = 0;
+    }
+  }
+  for (Module::global_iterator I = M->global_begin(), E = M->global_end();
+       I != E; ++I) {
+    DenseMap<const GlobalValue*, std::string>::iterator N =
+      SymbolNames.find(I);
+    if (N == SymbolNames.end())
+      continue;
+    if (Definitions.lookup(N->second) == I)
+      Definitions.erase(N->second);
+    SymbolNames.erase(N);
+  }
+  ModuleIDs.erase(M);
+  return true;
+}
+
+void MCJIT::registerModule(Module *M) {
+  ModuleIDs[M] = NextModuleID++;
+  for (Module::iterator I = M->begin(), E = M->end(); I != E; ++I)
+    if (!I->isDeclaration())
+      getSymbolName(I);
+  for (Module::global_iterator I = M->global_begin(), E = M->global_end();
+       I != E; ++I)
+    if (!I->isDeclaration())
+      getSymbolName(I);
+}
+
+std::string MCJIT::getSymbolName(const GlobalValue *GV) {
+  std::string Name = SymbolNames.lookup(GV);
+  if (Name.empty()) {
+    if (!GV->hasName())
+      Name = "__mcjit.anon." + utostr(NumAnonymous++);
+    else if (GV->hasLocalLinkage())
+      Name = GV->getName().str() + ".mcjit" +
+             utostr(ModuleIDs.lookup(GV->getParent()));
+    else
+      Name = GV->getName();
+    SymbolNames[GV] = Name;
+  }
+
+  // Record definitions every time; a function may have been given a body
+  // since its name was first computed.
+  if (!GV->isDeclaration() && !GV->hasAvailableExternallyLinkage())
+    Definitions[Name] = const_cast<GlobalValue*>(GV);
+  return Name;
+}
+
+void *MCJIT::getSymbolAddress(const std::string &Name) {
+  return Dyld.getSymbolAddress(TM->getMCAsmInfo()->getGlobalPrefix() + Name);
+}
+
+Function *MCJIT::getFunctionForSymbol(StringRef Name) {
+  StringRef Prefix = TM->getMCAsmInfo()->getGlobalPrefix();
+  if (Name.startswith(Prefix))
+    Name = Name.substr(Prefix.size());
+  if (Name.endswith(StubSuffix))
+    Name = Name.substr(0, Name.size() - strlen(StubSuffix));
+  return dyn_cast_or_null<Function>(Definitions.lookup(Name));
+}
+
+void *MCJIT::resolveSymbol(StringRef SymName, bool AbortOnFailure) {
+  MutexGuard locked(lock);
+  StringRef Name = SymName;
+  StringRef Prefix = TM->getMCAsmInfo()->getGlobalPrefix();
+  if (Name.startswith(Prefix))
+    Name = Name.substr(Prefix.size());
+
+  // The pieces of the lazy compilation stubs.
+  if (Name == CompileCallbackName) {
+    static void *(*const Callback)(LazyStubTarget*) = &LazyCompileCallback;
+    return (void*)&Callback;
+  }
+  if (Name.endswith(StubTargetSuffix)) {
+    StringRef FnName = Name.substr(0, Name.size() - strlen(StubTargetSuffix));
+    Function *F = cast<Function>(Definitions.lookup(FnName));
+    LazyStubTarget *&Target = StubTargets[F];
+    if (!Target) {
+      Target = new LazyStubTarget();
+      Target->JIT = this;
+      Target->F = F;
+    }
+    return Target;
+  }
+
+  // Symbols that none of the modules define come from the program.
+  GlobalValue *GV = Definitions.lookup(Name);
+  if (!GV)
+    return getPointerToNamedFunction(Name, AbortOnFailure);
+
+  // Global variables are allocated by the ExecutionEngine.
+  if (GlobalVariable *GVar = dyn_cast<GlobalVariable>(GV))
+    return getPointerToGlobal(GVar);
+
+  return getPointerToFunction(cast<Function>(GV));
+}
+
+void *MCJIT::LazyCompileCallback(LazyStubTarget *Target) {
+  if (!Target->F)
+    report_fatal_error("Lazy compilation stub called for a function whose "
+                       "module has been removed!");
+  return Target->JIT->getPointerToFunction(Target->F);
+}
+
+/// collectGlobals - Add the global values that V refers to, directly or
+/// through constants, to Globals, in the order they are found.
+static void collectGlobals(const Value *V, SmallPtrSet<const Value*, 32> &Seen,
+                           SmallVectorImpl<GlobalValue*> &Globals) {
+  if (!isa<Constant>(V) || !Seen.insert(V))
+    return;
+  if (const GlobalValue *GV = dyn_cast<GlobalValue>(V)) {
+    Globals.push_back(const_cast<GlobalValue*>(GV));
+    return;
+  }
+  const Constant *C = cast<Constant>(V);
+  for (Constant::const_op_iterator I = C->op_begin(), E = C->op_end();
+       I != E; ++I)
+    collectGlobals(*I, Seen, Globals);
+}
+
+Module *MCJIT::buildPartition(Module *M, ArrayRef<Function*> Fns,
+                              bool WithStubs) {
+  LLVMContext &Context = M->getContext();
+  Module *P = new Module(M->getModuleIdentifier(), Context);
+  P->setTargetTriple(M->getTargetTriple());
+  P->setDataLayout(M->getDataLayout());
+
+  // Find everything the functions refer to, in the order they refer to it, so
+  // that the same functions always give the same partition (and code cache
+  // key).
+  SmallPtrSet<const Value*, 32> Seen;
+  SmallVector<GlobalValue*, 32> Globals(Fns.begin(), Fns.end());
+  for (unsigned i = 0, e = Fns.size(); i != e; ++i)
+    Seen.insert(Fns[i]);
+  for (unsigned i = 0, e = Fns.size(); i != e; ++i)
+    for (Function::iterator BB = Fns[i]->begin(), BE = Fns[i]->end();
+         BB != BE; ++BB)
+      for (BasicBlock::iterator I = BB->begin(), IE = BB->end(); I != IE; ++I)
+        for (User::op_iterator OI = I->op_begin(), OE = I->op_end();
+             OI != OE; ++OI)
+          collectGlobals(*OI, Seen, Globals);
+
+  // Declare all of them.  Global variables are never defined in the
+  // partition: the ExecutionEngine allocates them, and the code refers to
+  // them by name, so that there is only one copy however many partitions
+  // use them.
+  ValueToValueMapTy VMap;
+  SmallVector<GlobalAlias*, 4> Aliases;
+  for (unsigned i = 0, e = Globals.size(); i != e; ++i) {
+    GlobalValue *GV = Globals[i];
+    if (GlobalAlias *GA = dyn_cast<GlobalAlias>(GV)) {
+      // Refer to whatever the alias resolves to instead.
+      const GlobalValue *Aliasee = GA->resolveAliasedGlobal(false);
+      if (!Aliasee)
+        report_fatal_error("MCJIT cannot resolve alias '" + GA->getName() +
+                           "'");
+      if (Seen.insert(Aliasee))
+        Globals.push_back(const_cast<GlobalValue*>(Aliasee));
+      Aliases.push_back(GA);
+      continue;
+    }
 
-  PM.add(new TargetData(*TM->getTargetData()));
+    GlobalValue *New;
+    if (Function *F = dyn_cast<Function>(GV)) {
+      Function *NewF = Function::Create(F->getFunctionType(),
+                                        GlobalValue::ExternalLinkage,
+                                        getSymbolName(F), P);
+      NewF->copyAttributesFrom(F);
+      New = NewF;
+    } else {
+      GlobalVariable *GVar = cast<GlobalVariable>(GV);
+      New = new GlobalVariable(*P, GVar->getType()->getElementType(),
+                               GVar->isConstant(),
+                               GlobalValue::ExternalLinkage, 0,
+                               getSymbolName(GVar), 0, GVar->isThreadLocal(),
+                               GVar->getType()->getAddressSpace());
+    }
+    New->setVisibility(GlobalValue::DefaultVisibility);
+    VMap[GV] = New;
+  }
+  for (unsigned i = 0, e = Aliases.size(); i != e; ++i) {
+    GlobalAlias *GA = Aliases[i];
+    Constant *Aliasee = cast<Constant>(VMap[GA->resolveAliasedGlobal(false)]);
+    VMap[GA] = ConstantExpr::getBitCast(Aliasee, GA->getType());
+  }
+
+  // Copy the bodies.
+  for (unsigned i = 0, e = Fns.size(); i != e; ++i) {
+    Function *F = Fns[i];
+    Function *NewF = cast<Function>(VMap[F]);
+    Function::arg_iterator DestI = NewF->arg_begin();
+    for (Function::const_arg_iterator I = F->arg_begin(), E = F->arg_end();
+         I != E; ++I, ++DestI) {
+      DestI->setName(I->getName());
+      VMap[I] = DestI;
+    }
+    SmallVector<ReturnInst*, 8> Returns;
+    CloneFunctionInto(NewF, F, VMap, /*ModuleLevelChanges=*/true, Returns);
+
+    // All code goes in the text section, which is the only one the dynamic
+    // linker handles.
+    NewF->setVisibility(GlobalValue::DefaultVisibility);
+    NewF->setSection("");
+  }
+
+  if (!WithStubs)
+    return P;
 
-  // Turn the machine code intermediate representation into bytes in memory
-  // that may be executed.
-  if (TM->addPassesToEmitMC(PM, Ctx, OS, CodeGenOpt::Default, false)) {
-    report_fatal_error("Target does not support MC emission!");
+  // Direct calls to callees that have not been compiled yet go through a
+  // stub instead.  Every other use still refers to the callee itself, so that
+  // its address is the same everywhere; that compiles it when the partition
+  // is linked.
+  DenseMap<Value*, Function*> Stubs;
+  for (unsigned i = Fns.size(), e = Globals.size(); i != e; ++i) {
+    Function *F = dyn_cast<Function>(Globals[i]);
+    if (!F || F->isDeclaration() || F->hasAvailableExternallyLinkage() ||
+        F->isVarArg() || getPointerToGlobalIfAvailable(F))
+      continue;
+    Stubs[VMap[F]] = F;
+  }
+  if (Stubs.empty())
+    return P;
+  for (unsigned i = 0, e = Fns.size(); i != e; ++i) {
+    Function *NewF = cast<Function>(VMap[Fns[i]]);
+    for (Function::iterator BB = NewF->begin(), BE = NewF->end(); BB != BE;
+         ++BB)
+      for (BasicBlock::iterator I = BB->begin(), IE = BB->end(); I != IE; ++I) {
+        CallSite CS(I);
+        if (!CS)
+          continue;
+        DenseMap<Value*, Function*>::iterator S =
+          Stubs.find(CS.getCalledValue());
+        if (S != Stubs.end())
+          CS.setCalledFunction(getLazyStub(P, S->second));
+      }
   }
+  return P;
+}
+
+Function *MCJIT::getLazyStub(Module *P, Function *F) {
+  std::string Name = getSymbolName(F);
+  if (Function *Stub = P->getFunction(Name + StubSuffix))
+    return Stub;
+
+  // The stub has the same type as F.
+  Function *Stub = Function::Create(F->getFunctionType(),
+                                    GlobalValue::ExternalLinkage,
+                                    Name + StubSuffix, P);
+  Stub->setCallingConv(F->getCallingConv());
+  Stub->setAttributes(F->getAttributes());
+
+  // Only one object defines the stub; the others link against it.
+  if (getSymbolAddress(Name + StubSuffix))
+    return Stub;
+
+  LLVMContext &Context = P->getContext();
+  const Type *Int8PtrTy = Type::getInt8PtrTy(Context);
+
+  // The stub target and the callback are resolved by name when the stub is
+  // linked, so the stub does not embed any addresses and can be cached like
+  // the rest of the partition.
+  Constant *Target = P->getOrInsertGlobal(Name + StubTargetSuffix,
+                                          Type::getInt8Ty(Context));
+  std::vector<const Type*> Params(1, Int8PtrTy);
+  const Type *CallbackTy =
+    PointerType::getUnqual(FunctionType::get(Int8PtrTy, Params, false));
+  Constant *CallbackPtr = P->getOrInsertGlobal(CompileCallbackName,
+                                               CallbackTy);
+
+  // The stub asks the callback for F's address, and then calls F with its
+  // own arguments.
+  BasicBlock *BB = BasicBlock::Create(Context, "", Stub);
+  Value *Callback = new LoadInst(CallbackPtr, "", BB);
+  Value *Addr = CallInst::Create(Callback, Target, "", BB);
+  Value *Callee = new BitCastInst(Addr, F->getType(), "", BB);
+  SmallVector<Value*, 8> Args;
+  for (Function::arg_iterator I = Stub->arg_begin(), E = Stub->arg_end();
+       I != E; ++I)
+    Args.push_back(I);
+  CallInst *Call = CallInst::Create(Callee, Args.begin(), Args.end(), "", BB);
+  Call->setCallingConv(F->getCallingConv());
+  Call->setAttributes(F->getAttributes());
+  Call->setTailCall();
+  if (F->getReturnType()->isVoidTy())
+    ReturnInst::Create(Context, BB);
+  else
+    ReturnInst::Create(Context, Call, BB);
+  return Stub;
+}
+
+void MCJIT::emitPartition(Module *P) {
+  OwningPtr<Module> Partition(P);
+
+  // Remember which functions the partition defines before code generation
+  // gets to it.
+  SmallVector<std::pair<Function*, std::string>, 8> Defined;
+  for (Module::iterator I = P->begin(), E = P->end(); I != E; ++I)
+    if (!I->isDeclaration())
+      if (Function *F = dyn_cast_or_null<Function>(
+            Definitions.lookup(I->getName())))
+        Defined.push_back(std::make_pair(F, I->getName().str()));
+
+  std::string Key;
+  MemoryBuffer *MB = 0;
+  if (Cache) {
+    // Only LLVMTargetMachines support addPassesToEmitMC, so that is what we
+    // have here.
+    const std::string &Triple =
+      static_cast<LLVMTargetMachine*>(TM)->getTargetTriple();
+    Key = JITCodeCache::getKey(*P, Triple, CPU, Attrs, OptLevel, CMModel);
+    MB = Cache->lookup(Key);
+  }
+
+  if (!MB) {
+    SmallVector<char, 4096> Buffer;
+    raw_svector_ostream OS(Buffer);
+    PassManager PM;
+    PM.add(new TargetData(*TM->getTargetData()));
 
-  // Initialize passes.
-  // FIXME: When we support multiple modules, we'll want to move the code
-  // gen and finalization out of the constructor here and do it more
-  // on-demand as part of getPointerToFunction().
-  PM.run(*M);
-  // Flush the output buffer so the SmallVector gets its data.
-  OS.flush();
+    // Turn the machine code intermediate representation into bytes in memory
+    // that may be executed.
+    MCContext *Ctx;
+    if (TM->addPassesToEmitMC(PM, Ctx, OS, OptLevel, false))
+      report_fatal_error("Target does not support MC emission!");
+    PM.run(*P);
+    // Flush the output buffer so the SmallVector gets its data.
+    OS.flush();
+    StringRef Object(Buffer.data(), Buffer.size());
+
+    // Failing to save the object only costs a later process a compile.
+    if (Cache)
+      Cache->store(Key, Object);
+
+    // FIXME: It would be nice to avoid making yet another copy.
+    MB = MemoryBuffer::getMemBufferCopy(Object);
+  }
+
+  // Linking the object can compile more code, to resolve its references, and
+  // that code can refer back to this object.  Keep the memory writable until
+  // the outermost link is done.
+  JITMemoryManager *JMM = MemMgr->getMemMgr();
+  if (LinkDepth++ == 0)
+    JMM->setMemoryWritable();
 
   // Load the object into the dynamic linker.
-  // FIXME: It would be nice to avoid making yet another copy.
-  MemoryBuffer *MB = MemoryBuffer::getMemBufferCopy(StringRef(Buffer.data(),
-                                                              Buffer.size()));
   if (Dyld.loadObject(MB))
     report_fatal_error(Dyld.getErrorString());
-  // Resolve any relocations.
+
+  // Record the new addresses before resolving relocations, so that code
+  // compiled to resolve them finds these functions.
+  for (unsigned i = 0, e = Defined.size(); i != e; ++i)
+    updateGlobalMapping(Defined[i].first, getSymbolAddress(Defined[i].second));
+
   Dyld.resolveRelocations();
+  if (!Dyld.getErrorString().empty())
+    report_fatal_error(Dyld.getErrorString());
+
+  // Point the code that called these functions through a stub, or called an
+  // earlier version of them, straight at the new code.  If the memory
+  // manager does not allow patching code, it keeps going through the stubs.
+  if (JMM->allowsCodePatching()) {
+    StringRef Prefix = TM->getMCAsmInfo()->getGlobalPrefix();
+    for (unsigned i = 0, e = Defined.size(); i != e; ++i) {
+      const std::string &Name = Defined[i].second;
+      uint8_t *Addr = (uint8_t*)getSymbolAddress(Name);
+      Dyld.reassignSymbolAddress(Prefix.str() + Name, Addr);
+      if (getSymbolAddress(Name + StubSuffix))
+        Dyld.reassignSymbolAddress(Prefix.str() + Name + StubSuffix, Addr);
+    }
+  }
+
+  if (--LinkDepth == 0)
+    JMM->setMemoryExecutable();
 }
 
-MCJIT::~MCJIT() {
-  delete MemMgr;
+void MCJIT::emitModule(Module *M) {
+  SmallVector<Function*, 16> Fns;
+  for (Module::iterator I = M->begin(), E = M->end(); I != E; ++I)
+    if (!I->isDeclaration() && !I->hasAvailableExternallyLinkage() &&
+        !getPointerToGlobalIfAvailable(I))
+      Fns.push_back(I);
+  if (!Fns.empty())
+    emitPartition(buildPartition(M, Fns, /*WithStubs=*/false));
+}
+
+void *MCJIT::emitFunction(Function *F) {
+  Function *Fns[] = { F };
+  emitPartition(buildPartition(F->getParent(), Fns, isCompilingLazily()));
+  return getPointerToGlobalIfAvailable(F);
 }
 
 void *MCJIT::getPointerToBasicBlock(BasicBlock *BB) {
@@ -107,19 +537,38 @@ void *MCJIT::getPointerToBasicBlock(BasicBlock *BB) {
 }
 
 void *MCJIT::getPointerToFunction(Function *F) {
+  MutexGuard locked(lock);
+  if (void *Addr = getPointerToGlobalIfAvailable(F))
+    return Addr;
+
   if (F->isDeclaration() || F->hasAvailableExternallyLinkage()) {
+    // Another module may define it.
+    if (Function *Def = dyn_cast_or_null<Function>(
+          Definitions.lookup(getSymbolName(F))))
+      if (Def != F)
+        return getPointerToFunction(Def);
+
     bool AbortOnFailure = !F->hasExternalWeakLinkage();
     void *Addr = getPointerToNamedFunction(F->getName(), AbortOnFailure);
     addGlobalMapping(F, Addr);
     return Addr;
   }
 
-  Twine Name = TM->getMCAsmInfo()->getGlobalPrefix() + F->getName();
-  return (void*)Dyld.getSymbolAddress(Name.str());
+  if (isCompilingLazily())
+    return emitFunction(F);
+
+  emitModule(F->getParent());
+  return getPointerToGlobalIfAvailable(F);
 }
 
 void *MCJIT::recompileAndRelinkFunction(Function *F) {
-  report_fatal_error("not yet implemented");
+  MutexGuard locked(lock);
+
+  // If it's not already compiled there is no reason to patch it up.
+  if (!getPointerToGlobalIfAvailable(F))
+    return getPointerToFunction(F);
+
+  return emitFunction(F);
 }
 
 void MCJIT::freeMachineCodeForFunction(Function *F) {
@@ -10,43 +10,131 @@
 #ifndef LLVM_LIB_EXECUTIONENGINE_MCJIT_H
 #define LLVM_LIB_EXECUTIONENGINE_MCJIT_H
 
-#include "llvm/PassManager.h"
 #include "llvm/ExecutionEngine/ExecutionEngine.h"
 #include "llvm/ExecutionEngine/RuntimeDyld.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallVector.h"
-#include "llvm/Support/raw_ostream.h"
+#include "llvm/ADT/StringMap.h"
 
 namespace llvm {
 
-// FIXME: This makes all kinds of horrible assumptions for the time being,
-// like only having one module, not needing to worry about multi-threading,
-// blah blah. Purely in get-it-up-and-limping mode for now.
-
+class MCJITMemoryManager;
+
+// FIXME: This still assumes that only one thread runs code generation at a
+// time; all of it happens under the ExecutionEngine lock.
+
+/// MCJIT - A JIT that generates a relocatable object file for each piece of
+/// code it compiles and links it into memory with the RuntimeDyld.
+///
+/// Any number of modules can be added.  References between them, and to the
+/// globals of the program, are resolved by name when an object is linked.
+/// Global variables are not part of the objects; the ExecutionEngine
+/// allocates and initializes them, as it does for the interpreter.
+///
+/// When lazy compilation is enabled, each function is compiled into its own
+/// object the first time its address is needed.  Calls to functions that have
+/// not been compiled yet go through small stubs, generated with the caller,
+/// which compile the callee on first use.  Otherwise, the first use of any
+/// function in a module compiles the whole module.
 class MCJIT : public ExecutionEngine {
   MCJIT(Module *M, TargetMachine *tm, TargetJITInfo &tji,
-        RTDyldMemoryManager *MemMgr, CodeGenOpt::Level OptLevel,
-        bool AllocateGVsWithCode);
+        JITMemoryManager *JMM, CodeGenOpt::Level OptLevel,
+        bool AllocateGVsWithCode, StringRef MCPU,
+        const SmallVectorImpl<std::string> &MAttrs);
 
   TargetMachine *TM;
-  MCContext *Ctx;
-  RTDyldMemoryManager *MemMgr;
+  MCJITMemoryManager *MemMgr;
+  CodeGenOpt::Level OptLevel;
+
+  // The CPU and attributes the target was selected with, which together with
+  // the module and triple make up the code cache key.
+  std::string CPU;
+  SmallVector<std::string, 4> Attrs;
+
+  // The code model the JIT was created with.  Code generation replaces a
+  // default code model with the target's JIT code model, so the cache key
+  // uses this one, which doesn't depend on whether anything was compiled yet.
+  CodeModel::Model CMModel;
 
-  // FIXME: These may need moved to a separate 'jitstate' member like the
-  // non-MC JIT does for multithreading and such. Just keep them here for now.
-  PassManager PM;
-  Module *M;
-  // FIXME: This really doesn't belong here.
-  SmallVector<char, 4096> Buffer; // Working buffer into which we JIT.
-  raw_svector_ostream OS;
+  // The on-disk code cache consulted before running code generation, if any.
+  JITCodeCache *Cache;
 
   RuntimeDyld Dyld;
 
+  /// LazyStubTarget - What a lazy compilation stub passes to the compile
+  /// callback to identify the function it stands in for.
+  struct LazyStubTarget {
+    MCJIT *JIT;
+    Function *F;
+  };
+
+  // The stub targets handed out so far, by function.
+  DenseMap<const Function*, LazyStubTarget*> StubTargets;
+
+  // The name each global value is given in the generated objects, and the
+  // reverse map for the definitions, used to resolve references by name.
+  DenseMap<const GlobalValue*, std::string> SymbolNames;
+  StringMap<GlobalValue*> Definitions;
+
+  // A number for each module, used to keep the names of values with local
+  // linkage apart.
+  DenseMap<const Module*, unsigned> ModuleIDs;
+  unsigned NextModuleID;
+  unsigned NumAnonymous;
+
+  // How many objects are being linked at the moment.  Linking one object can
+  // require compiling another to resolve its references, so this nests.
+  unsigned LinkDepth;
+
+  /// registerModule - Record the names of the definitions in M so that
+  /// references from other modules resolve to them.
+  void registerModule(Module *M);
+
+  /// getSymbolName - Return the name GV has in the objects the JIT generates,
+  /// without the target's global prefix.  Values with local linkage are
+  /// renamed so that they cannot clash with those of other modules.
+  std::string getSymbolName(const GlobalValue *GV);
+
+  /// buildPartition - Create a new module that contains the bodies of Fns,
+  /// which must all come from M, and declarations for everything they
+  /// reference.  If WithStubs is true, direct calls to the callees that have
+  /// not been compiled yet go through lazy compilation stubs.
+  Module *buildPartition(Module *M, ArrayRef<Function*> Fns, bool WithStubs);
+
+  /// getLazyStub - Return the stub for F in P, which compiles F and calls it.
+  /// The stub is defined in P unless an earlier object already defined it.
+  Function *getLazyStub(Module *P, Function *F);
+
+  /// emitPartition - Generate code for P, or load it from the code cache, and
+  /// link it into memory.  P is deleted.
+  void emitPartition(Module *P);
+
+  /// emitModule - Compile all of the functions in M.
+  void emitModule(Module *M);
+
+  /// emitFunction - Compile F on its own, and return its address.
+  void *emitFunction(Function *F);
+
+  /// getSymbolAddress - Return the address of the linked symbol for the
+  /// unprefixed Name, or null if there is none.
+  void *getSymbolAddress(const std::string &Name);
+
+  /// LazyCompileCallback - Called by the lazy compilation stubs.  Returns the
+  /// address of the function the stub stands in for, compiling it first if
+  /// needed.
+  static void *LazyCompileCallback(LazyStubTarget *Target);
+
 public:
   ~MCJIT();
 
   /// @name ExecutionEngine interface implementation
   /// @{
 
+  virtual void addModule(Module *M);
+
+  virtual bool removeModule(Module *M);
+
   virtual void *getPointerToBasicBlock(BasicBlock *BB);
 
   virtual void *getPointerToFunction(Function *F);
@@ -58,6 +146,8 @@ public:
   virtual GenericValue runFunction(Function *F,
                                    const std::vector<GenericValue> &ArgValues);
 
+  virtual void setCodeCache(JITCodeCache *C);
+
   /// getPointerToNamedFunction - This method returns the address of the
   /// specified function by using the dlsym function call.  As such it is only
   /// useful for resolving library symbols, not code generated symbols.
@@ -68,6 +158,21 @@ public:
   ///
   void *getPointerToNamedFunction(const std::string &Name,
                                   bool AbortOnFailure = true);
+  /// @}
+  /// @name Interfaces for the memory manager
+  /// @{
+
+  /// getFunctionForSymbol - Return the function the code for symbol Name
+  /// belongs to.  The code of a lazy compilation stub belongs to the function
+  /// it stands in for.
+  Function *getFunctionForSymbol(StringRef Name);
+
+  /// resolveSymbol - Return the address of symbol Name, which is referenced
+  /// but not defined by the objects linked so far.  This compiles the
+  /// function that defines it if it is in one of the modules; otherwise it is
+  /// looked up in the program.
+  void *resolveSymbol(StringRef Name, bool AbortOnFailure);
+
   /// @}
   /// @name (Private) Registration Interfaces
   /// @{
@@ -10,7 +10,8 @@
 #ifndef LLVM_LIB_EXECUTIONENGINE_MCJITMEMORYMANAGER_H
 #define LLVM_LIB_EXECUTIONENGINE_MCJITMEMORYMANAGER_H
 
-#include "llvm/Module.h"
+#include "MCJIT.h"
+#include "llvm/Function.h"
 #include "llvm/ExecutionEngine/JITMemoryManager.h"
 #include "llvm/ExecutionEngine/RuntimeDyld.h"
 #include <assert.h>
@@ -19,23 +20,30 @@ namespace llvm {
 
 // The MCJIT memory manager is a layer between the standard JITMemoryManager
 // and the RuntimeDyld interface that maps objects, by name, onto their
-// matching LLVM IR counterparts in the module(s) being compiled.
+// matching LLVM IR counterparts in the modules being compiled.
 class MCJITMemoryManager : public RTDyldMemoryManager {
   JITMemoryManager *JMM;
 
-  // FIXME: Multiple modules.
-  Module *M;
+  // The JIT whose modules the symbols come from.
+  MCJIT *JIT;
 public:
-  MCJITMemoryManager(JITMemoryManager *jmm) : JMM(jmm) {}
+  // Takes ownership of jmm, or creates a default memory manager if it is
+  // null.
+  MCJITMemoryManager(JITMemoryManager *jmm, MCJIT *jit)
+    : JMM(jmm ? jmm : JITMemoryManager::CreateDefaultMemManager()),
+      JIT(jit) {}
+
+  ~MCJITMemoryManager() {
+    delete JMM;
+  }
+
+  JITMemoryManager *getMemMgr() const { return JMM; }
 
   // Allocate ActualSize bytes, or more, for the named function. Return
   // a pointer to the allocated memory and update Size to reflect how much
   // memory was acutally allocated.
   uint8_t *startFunctionBody(const char *Name, uintptr_t &Size) {
-    // FIXME: This should really reference the MCAsmInfo to get the global
-    //        prefix.
-    if (Name[0] == '_') ++Name;
-    Function *F = M->getFunction(Name);
+    Function *F = JIT->getFunctionForSymbol(Name);
     assert(F && "No matching function in JIT IR Module!");
     return JMM->startFunctionBody(F, Size);
   }
@@ -44,14 +52,16 @@ public:
   // memory was actually used.
   void endFunctionBody(const char *Name, uint8_t *FunctionStart,
                        uint8_t *FunctionEnd) {
-    // FIXME: This should really reference the MCAsmInfo to get the global
-    //        prefix.
-    if (Name[0] == '_') ++Name;
-    Function *F = M->getFunction(Name);
+    Function *F = JIT->getFunctionForSymbol(Name);
     assert(F && "No matching function in JIT IR Module!");
     JMM->endFunctionBody(F, FunctionStart, FunctionEnd);
   }
 
+  // Find the address of a symbol that none of the loaded objects define.
+  void *getPointerToNamedFunction(const std::string &Name,
+                                  bool AbortOnFailure = true) {
+    return JIT->resolveSymbol(Name, AbortOnFailure);
+  }
 };
 
 } // End llvm namespace
@@ -33,6 +33,28 @@ using namespace llvm::object;
 // Empty out-of-line virtual destructor as the key function.
 RTDyldMemoryManager::~RTDyldMemoryManager() {}
 
+// The size of a stub that jumps anywhere in the address space:
+//   jmpq *0(%rip)
+//   .quad <destination>
+static const unsigned FarBranchStubSize = 14;
+
+// Is the raw x86-64 relocation with second word Word1 a 32-bit PC-relative
+// branch, which may need to go through a stub?
+static bool isFarBranchCandidate(uint32_t Word1) {
+  bool isPCRel = (Word1 >> 24) & 1;
+  unsigned Type = (Word1 >> 28) & 0xf;
+  return isPCRel && Type == macho::RIT_X86_64_Branch;
+}
+
+// Write a stub that jumps to Dest at Stub.
+static void writeFarBranchStub(uint8_t *Stub, uint8_t *Dest) {
+  static const uint8_t Jmp[6] = { 0xFF, 0x25, 0x00, 0x00, 0x00, 0x00 };
+  memcpy(Stub, Jmp, sizeof(Jmp));
+  uint64_t Value = (uintptr_t)Dest;
+  for (unsigned i = 0; i != 8; ++i, Value >>= 8)
+    Stub[sizeof(Jmp) + i] = (uint8_t)Value;
+}
+
 namespace llvm {
 class RuntimeDyldImpl {
   unsigned CPUType;
@@ -61,11 +83,14 @@ class RuntimeDyldImpl {
     uint64_t    Offset;     // Offset into the object for the relocation.
     uint32_t    Data;       // Second word of the raw macho relocation entry.
     int64_t     Addend;     // Addend encoded in the instruction itself, if any.
+    uint64_t    StubOffset; // Offset into the object of a stub to branch
+                            // through if the symbol is out of range, or 0.
     bool        isResolved; // Has this relocation been resolved previously?
 
-    RelocationEntry(StringRef t, uint64_t offset, uint32_t data, int64_t addend)
+    RelocationEntry(StringRef t, uint64_t offset, uint32_t data, int64_t addend,
+                    uint64_t stubOffset = 0)
       : Target(t), Offset(offset), Data(data), Addend(addend),
-        isResolved(false) {}
+        StubOffset(stubOffset), isResolved(false) {}
   };
   typedef SmallVector<RelocationEntry, 4> RelocationList;
   StringMap<RelocationList> Relocations;
@@ -85,7 +110,7 @@ class RuntimeDyldImpl {
   }
 
   void extractFunction(StringRef Name, uint8_t *StartAddress,
-                       uint8_t *EndAddress);
+                       uint8_t *EndAddress, unsigned StubSpace = 0);
   bool resolveRelocation(uint8_t *Address, uint8_t *Value, bool isPCRel,
                          unsigned Type, unsigned Size);
   bool resolveX86_64Relocation(uintptr_t Address, uintptr_t Value, bool isPCRel,
@@ -115,6 +140,11 @@ public:
 
   void reassignSymbolAddress(StringRef Name, uint8_t *Addr);
 
+  // Resolve the relocations based on symbol Name against Addr. If OnlyPending
+  // is true, relocations that have been resolved before are left alone.
+  void resolveSymbolRelocations(StringRef Name, uint8_t *Addr,
+                                bool OnlyPending);
+
   // Is the linker in an error state?
   bool hasError() { return HasError; }
 
@@ -126,15 +156,33 @@ public:
 };
 
 void RuntimeDyldImpl::extractFunction(StringRef Name, uint8_t *StartAddress,
-                                      uint8_t *EndAddress) {
-  // Allocate memory for the function via the memory manager.
-  uintptr_t Size = EndAddress - StartAddress + 1;
+                                      uint8_t *EndAddress,
+                                      unsigned StubSpace) {
+  // If the function has been loaded before (the JIT re-compiled it), the
+  // relocations in the old code must not be applied to the new code.
+  if (Functions.count(Name))
+    for (StringMap<RelocationList>::iterator i = Relocations.begin(),
+         e = Relocations.end(); i != e; ++i) {
+      RelocationList &Relocs = i->getValue();
+      for (unsigned j = 0; j != Relocs.size(); )
+        if (Relocs[j].Target == Name)
+          Relocs.erase(Relocs.begin() + j);
+        else
+          ++j;
+    }
+
+  // Allocate memory for the function, and any stubs after it, via the memory
+  // manager.
+  uintptr_t Size = EndAddress - StartAddress + 1 + StubSpace;
   uint8_t *Mem = MemMgr->startFunctionBody(Name.data(), Size);
-  assert(Size >= (uint64_t)(EndAddress - StartAddress + 1) &&
+  assert(Size >= (uint64_t)(EndAddress - StartAddress + 1 + StubSpace) &&
          "Memory manager failed to allocate enough memory!");
   // Copy the function payload into the memory block.
-  memcpy(Mem, StartAddress, EndAddress - StartAddress + 1);
-  MemMgr->endFunctionBody(Name.data(), Mem, Mem + Size);
+  Size = EndAddress - StartAddress + 1;
+  memcpy(Mem, StartAddress, Size);
+  // Tell the memory manager how much was used, so that it can reclaim the
+  // rest.
+  MemMgr->endFunctionBody(Name.data(), Mem, Mem + Size + StubSpace);
   // Remember where we put it.
   Functions[Name] = sys::MemoryBlock(Mem, Size);
   // Default the assigned address for this symbol to wherever this
@@ -268,6 +316,11 @@ loadSegment32(const MachOObject *Obj,
     if (!Sect)
       return Error("unable to load section: '" + Twine(SectNum) + "'");
 
+    // Unwind tables are not registered with the runtime, so there is no
+    // need to load them.
+    if (strncmp(Sect->Name, "__eh_frame", sizeof(Sect->Name)) == 0)
+      continue;
+
     // FIXME: Improve check.
     if (Sect->Flags != 0x80000400)
       return Error("unsupported section type!");
@@ -352,8 +405,9 @@ loadSegment32(const MachOObject *Obj,
           break;
       // Adjust the offset to be relative to the symbol.
       Offset -= Symbols[SymbolNum].first;
-      // Get the name of the symbol containing the relocation.
-      StringRef TargetName = SymbolNames[SymbolNum];
+      // Get the name of the symbol containing the relocation. SymbolNum
+      // indexes the symbols of this section, not the whole symbol table.
+      StringRef TargetName = Symbols[SymbolNum].second;
 
       bool isExtern = (RE->Word1 >> 27) & 1;
       // Figure out the source symbol of the relocation. If isExtern is true,
@@ -403,6 +457,11 @@ loadSegment64(const MachOObject *Obj,
     if (!Sect)
       return Error("unable to load section: '" + Twine(SectNum) + "'");
 
+    // Unwind tables are not registered with the runtime, so there is no
+    // need to load them.
+    if (strncmp(Sect->Name, "__eh_frame", sizeof(Sect->Name)) == 0)
+      continue;
+
     // FIXME: Improve check.
     if (Sect->Flags != 0x80000400)
       return Error("unsupported section type!");
@@ -443,6 +502,23 @@ loadSegment64(const MachOObject *Obj,
     // Sort the symbols by address, just in case they didn't come in that way.
     array_pod_sort(Symbols.begin(), Symbols.end());
 
+    // A branch only reaches 2GB either way, which the code it calls (in the
+    // program, or loaded later) may be further away than.  Leave room for a
+    // stub after each function for each of its branches, to go through if
+    // that turns out to be the case.
+    SmallVector<unsigned, 64> NumBranches(Symbols.size());
+    for (unsigned j = 0; j != Sect->NumRelocationTableEntries; ++j) {
+      InMemoryStruct<macho::RelocationEntry> RE;
+      Obj->ReadRelocationEntry(Sect->RelocationTableOffset, j, RE);
+      if (!isFarBranchCandidate(RE->Word1))
+        continue;
+      unsigned SymbolNum;
+      for (SymbolNum = 0; SymbolNum < Symbols.size() - 1; ++SymbolNum)
+        if (Symbols[SymbolNum + 1].first > RE->Word0)
+          break;
+      ++NumBranches[SymbolNum];
+    }
+
     // Extract the function data.
     uint8_t *Base = (uint8_t*)Obj->getData(Segment64LC->FileOffset,
                                            Segment64LC->FileSize).data();
@@ -451,7 +527,8 @@ loadSegment64(const MachOObject *Obj,
       uint64_t EndOffset = Symbols[i + 1].first - 1;
       DEBUG(dbgs() << "Extracting function: " << Symbols[i].second
                    << " from [" << StartOffset << ", " << EndOffset << "]\n");
-      extractFunction(Symbols[i].second, Base + StartOffset, Base + EndOffset);
+      extractFunction(Symbols[i].second, Base + StartOffset, Base + EndOffset,
+                      NumBranches[i] * FarBranchStubSize);
     }
     // The last symbol we do after since the end address is calculated
     // differently because there is no next symbol to reference.
@@ -460,7 +537,10 @@ loadSegment64(const MachOObject *Obj,
     DEBUG(dbgs() << "Extracting function: " << Symbols[Symbols.size()-1].second
                  << " from [" << StartOffset << ", " << EndOffset << "]\n");
     extractFunction(Symbols[Symbols.size()-1].second,
-                    Base + StartOffset, Base + EndOffset);
+                    Base + StartOffset, Base + EndOffset,
+                    NumBranches[Symbols.size() - 1] * FarBranchStubSize);
+    // Hand out the stubs in the same order.
+    SmallVector<unsigned, 64> NumStubsUsed(Symbols.size());
 
     // Now extract the relocation information for each function and process it.
     for (unsigned j = 0; j != Sect->NumRelocationTableEntries; ++j) {
@@ -485,8 +565,9 @@ loadSegment64(const MachOObject *Obj,
           break;
       // Adjust the offset to be relative to the symbol.
       Offset -= Symbols[SymbolNum].first;
-      // Get the name of the symbol containing the relocation.
-      StringRef TargetName = SymbolNames[SymbolNum];
+      // Get the name of the symbol containing the relocation. SymbolNum
+      // indexes the symbols of this section, not the whole symbol table.
+      StringRef TargetName = Symbols[SymbolNum].second;
 
       bool isExtern = (RE->Word1 >> 27) & 1;
       // Figure out the source symbol of the relocation. If isExtern is true,
@@ -502,10 +583,19 @@ loadSegment64(const MachOObject *Obj,
 
       // Now store the relocation information. Associate it with the source
       // symbol.
+      uint64_t StubOffset = 0;
+      if (isFarBranchCandidate(RE->Word1)) {
+        uint64_t FunctionSize = (SymbolNum + 1 < NumSymbols ?
+                                 Symbols[SymbolNum + 1].first : Sect->Size) -
+                                Symbols[SymbolNum].first;
+        StubOffset = FunctionSize +
+                     NumStubsUsed[SymbolNum]++ * FarBranchStubSize;
+      }
       Relocations[SourceName].push_back(RelocationEntry(TargetName,
                                                         Offset,
                                                         RE->Word1,
-                                                        0 /*Addend*/));
+                                                        0 /*Addend*/,
+                                                        StubOffset));
       DEBUG(dbgs() << "Relocation at '" << TargetName << "' + " << Offset
                    << " from '" << SourceName << "(Word1: "
                    << format("0x%x", RE->Word1) << ")\n");
@@ -601,14 +691,40 @@ bool RuntimeDyldImpl::loadObject(MemoryBuffer *InputBuffer) {
   return false;
 }
 
-// Resolve the relocations for all symbols we currently know about.
+// Resolve the relocations that have not been resolved yet.
 void RuntimeDyldImpl::resolveRelocations() {
-  // Just iterate over the symbols in our symbol table and assign their
-  // addresses.
-  StringMap<uint8_t*>::iterator i = SymbolTable.begin();
-  StringMap<uint8_t*>::iterator e = SymbolTable.end();
-  for (;i != e; ++i)
-    reassignSymbolAddress(i->getKey(), i->getValue());
+  // Collect the symbols that still have relocations to resolve first.
+  // Looking up a symbol with the memory manager can load more objects, which
+  // changes the maps.
+  SmallVector<std::string, 16> Pending;
+  for (StringMap<RelocationList>::iterator i = Relocations.begin(),
+       e = Relocations.end(); i != e; ++i) {
+    RelocationList &Relocs = i->getValue();
+    for (unsigned j = 0, je = Relocs.size(); j != je; ++j)
+      if (!Relocs[j].isResolved) {
+        Pending.push_back(i->getKey());
+        break;
+      }
+  }
+
+  for (unsigned i = 0, e = Pending.size(); i != e; ++i) {
+    StringRef Name = Pending[i];
+    uint8_t *Addr;
+    StringMap<uint8_t*>::iterator I = SymbolTable.find(Name);
+    if (I != SymbolTable.end()) {
+      Addr = I->getValue();
+    } else {
+      // No object defines the symbol; ask the memory manager for it, and
+      // remember the answer for the next object that refers to it.
+      Addr = (uint8_t*)MemMgr->getPointerToNamedFunction(Name);
+      if (!Addr) {
+        Error("unresolved external symbol '" + Name + "'");
+        continue;
+      }
+      SymbolTable[Name] = Addr;
+    }
+    resolveSymbolRelocations(Name, Addr, /*OnlyPending=*/true);
+  }
 }
 
 // Assign an address to a symbol name and resolve all the relocations
@@ -616,22 +732,38 @@ void RuntimeDyldImpl::resolveRelocations() {
 void RuntimeDyldImpl::reassignSymbolAddress(StringRef Name, uint8_t *Addr) {
   // Assign the address in our symbol table.
   SymbolTable[Name] = Addr;
+  resolveSymbolRelocations(Name, Addr, /*OnlyPending=*/false);
+}
 
+void RuntimeDyldImpl::resolveSymbolRelocations(StringRef Name, uint8_t *Addr,
+                                               bool OnlyPending) {
   RelocationList &Relocs = Relocations[Name];
   for (unsigned i = 0, e = Relocs.size(); i != e; ++i) {
     RelocationEntry &RE = Relocs[i];
+    if (OnlyPending && RE.isResolved)
+      continue;
     uint8_t *Target = SymbolTable[RE.Target] + RE.Offset;
     bool isPCRel = (RE.Data >> 24) & 1;
     unsigned Type = (RE.Data >> 28) & 0xf;
     unsigned Size = 1 << ((RE.Data >> 25) & 3);
 
+    // A branch that cannot reach the symbol goes through its stub instead.
+    uint8_t *Value = Addr;
+    if (RE.StubOffset) {
+      int64_t Delta = (intptr_t)Addr - (intptr_t)(Target + 4);
+      if (Delta != (int64_t)(int32_t)Delta) {
+        Value = SymbolTable[RE.Target] + RE.StubOffset;
+        writeFarBranchStub(Value, Addr);
+      }
+    }
+
     DEBUG(dbgs() << "Resolving relocation at '" << RE.Target
           << "' + " << RE.Offset << " (" << format("%p", Target) << ")"
           << " from '" << Name << " (" << format("%p", Addr) << ")"
           << "(" << (isPCRel ? "pcrel" : "absolute")
           << ", type: " << Type << ", Size: " << Size << ").\n");
 
-    resolveRelocation(Target, Addr, isPCRel, Type, Size);
+    resolveRelocation(Target, Value, isPCRel, Type, Size);
     RE.isResolved = true;
   }
 }
@@ -0,0 +1,114 @@
+//===--- llvm/Support/DataStream.cpp - Lazy streamed data -----------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements DataStreamer, which fetches bytes of Data from
+// a stream source. It provides support for streaming (lazy reading) of
+// bitcode. An example implementation of streaming from a file or stdin
+// is included.
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "Data-stream"
+#include "llvm/Support/DataStream.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Support/DataTypes.h"
+#include "llvm/Support/Program.h"
+#include "llvm/Support/system_error.h"
+#include <cerrno>
+#include <cstdio>
+#include <string>
+#if !defined(_MSC_VER) && !defined(__MINGW32__)
+#include <unistd.h>
+#else
+#include <io.h>
+#endif
+#include <fcntl.h>
+using namespace llvm;
+
+// Interface goals:
+// * StreamableMemoryObject doesn't care about complexities like using
+//   threads/async callbacks to actually overlap reading and parsing.
+// * Don't want to duplicate Data in memory.
+// * Don't need to know total Data len in advance.
+// Non-goals:
+// StreamableMemoryObject already has random access so this interface only does
+// in-order streaming (no arbitrary seeking, else we'd have to buffer all the
+// Data here in addition to MemoryObject).
+
+namespace { const llvm::error_code success; }
+
+STATISTIC(NumStreamFetches, "Number of calls to Data stream fetch");
+
+DataStreamer::~DataStreamer() {}
+
+namespace {
+
+// Very simple stream backed by a file descriptor.  Mostly useful for stdin and
+// pipes; regular files are usually better served by mmap.
+class DataFileStreamer : public DataStreamer {
+  int Fd;
+public:
+  DataFileStreamer() : Fd(0) {}
+  virtual ~DataFileStreamer() {
+    if (Fd != 0)
+      ::close(Fd);
+  }
+
+  virtual size_t GetBytes(unsigned char *buf, size_t len) {
+    ++NumStreamFetches;
+    // Pipes may return fewer bytes than were asked for without being at the
+    // end of the stream, so keep reading until the request is satisfied.
+    size_t Read = 0;
+    while (Read != len) {
+      ssize_t Bytes = ::read(Fd, buf + Read, len - Read);
+      if (Bytes == 0)
+        break;
+      if (Bytes == -1) {
+        if (errno == EINTR)
+          continue;
+        break;
+      }
+      Read += Bytes;
+    }
+    return Read;
+  }
+
+  error_code OpenFile(const std::string &Filename) {
+    if (Filename == "-") {
+      Fd = 0;
+      sys::Program::ChangeStdinToBinary();
+      return success;
+    }
+
+    int OpenFlags = O_RDONLY;
+#ifdef O_BINARY
+    OpenFlags |= O_BINARY;  // Open input file in binary mode on win32.
+#endif
+    Fd = ::open(Filename.c_str(), OpenFlags);
+    if (Fd == -1) {
+      Fd = 0;
+      return error_code(errno, posix_category());
+    }
+    return success;
+  }
+};
+
+}
+
+DataStreamer *llvm::getDataFileStreamer(const std::string &Filename,
+                                        std::string *StrError) {
+  DataFileStreamer *s = new DataFileStreamer();
+  if (error_code e = s->OpenFile(Filename)) {
+    *StrError = std::string("Could not open ") + Filename + ": " +
+        e.message() + "\n";
+    delete s;
+    return 0;
+  }
+  return s;
+}
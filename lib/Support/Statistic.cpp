@@ -24,9 +24,11 @@
 #include "llvm/ADT/Statistic.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/Format.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/Mutex.h"
+#include "llvm/Support/ThreadLocal.h"
 #include "llvm/ADT/StringExtras.h"
 #include <algorithm>
 #include <cstring>
@@ -42,7 +44,23 @@ static cl::opt<bool>
 Enabled("stats", cl::desc("Enable statistics output from program"));
 
 
+/// -stats-json - Command line option to print the statistics as JSON rather
+/// than as a table.
+static cl::opt<bool>
+StatsAsJSON("stats-json", cl::desc("Display statistics as json data"));
+
+
 namespace {
+/// StatisticCounters - The counters of one thread, indexed by Statistic::Index.
+/// Only the thread itself updates them, and the vector only grows under the
+/// statistics lock.  Other threads read them to add them up without waiting
+/// for the owner, so a sum taken while the owner is counting is approximate:
+/// each counter is a single aligned word, read either before or after any
+/// given update.
+struct StatisticCounters {
+  std::vector<unsigned> Counters;
+};
+
 /// StatisticInfo - This class is used in a ManagedStatic so that it is created
 /// on demand (when the first statistic is bumped) and destroyed only when
 /// llvm_shutdown is called.  We print statistics from the destructor.
@@ -50,27 +68,72 @@ class StatisticInfo {
   std::vector<const Statistic*> Stats;
   friend void llvm::PrintStatistics();
   friend void llvm::PrintStatistics(raw_ostream &OS);
+  friend void llvm::PrintStatisticsJSON(raw_ostream &OS);
+  friend void llvm::GetStatistics(std::vector<StatisticValue> &Values,
+                                  bool Reset);
+  friend class llvm::Statistic;
+
+  // The counters of every live thread that has updated a statistic.  Where
+  // the host says when a thread exits, its counters are folded into the
+  // statistics and freed then; otherwise they last as long as this does.
+  std::vector<StatisticCounters*> Threads;
 public:
   ~StatisticInfo();
 
   void addStatistic(const Statistic *S) {
     Stats.push_back(S);
   }
+
+  /// sumCounters - Add up what the threads have counted for statistic S.
+  unsigned sumCounters(const Statistic *S) const {
+    unsigned Sum = 0;
+    for (size_t i = 0, e = Threads.size(); i != e; ++i)
+      if (S->Index < Threads[i]->Counters.size())
+        Sum += Threads[i]->Counters[S->Index];
+    return Sum;
+  }
+
+  /// removeThread - Add what an exiting thread has counted to the values of
+  /// the statistics, and forget its counters.
+  void removeThread(StatisticCounters *C) {
+    for (size_t i = 0, e = Stats.size(); i != e; ++i) {
+      Statistic *S = const_cast<Statistic*>(Stats[i]);
+      if (S->Index < C->Counters.size())
+        S->Value += C->Counters[S->Index];
+    }
+    Threads.erase(std::find(Threads.begin(), Threads.end(), C));
+  }
+};
+
+/// CountersOfThread - The counters of the calling thread, released when it
+/// exits.
+struct CountersOfThread : public sys::ThreadLocal<const StatisticCounters> {
+  CountersOfThread() : sys::ThreadLocal<const StatisticCounters>(release) {}
+  static void release(void *Counters);
 };
 }
 
 static ManagedStatic<StatisticInfo> StatInfo;
 static ManagedStatic<sys::SmartMutex<true> > StatLock;
+static ManagedStatic<CountersOfThread> ThreadCounters;
+
+/// release - Called when a thread which has updated statistics exits.
+void CountersOfThread::release(void *Counters) {
+  StatisticCounters *C = static_cast<StatisticCounters*>(Counters);
+  sys::SmartScopedLock<true> Writer(*StatLock);
+  StatInfo->removeThread(C);
+  delete C;
+}
 
 /// RegisterStatistic - The first time a statistic is bumped, this method is
 /// called.
 void Statistic::RegisterStatistic() {
-  // If stats are enabled, inform StatInfo that this statistic should be
-  // printed.
+  // Inform StatInfo of the statistic, whether or not stats are enabled, so
+  // that its value can be read back with GetStatistics.
   sys::SmartScopedLock<true> Writer(*StatLock);
   if (!Initialized) {
-    if (Enabled)
-      StatInfo->addStatistic(this);
+    Index = StatInfo->Stats.size();
+    StatInfo->addStatistic(this);
 
     sys::MemoryFence();
     // Remember we have been registered.
@@ -78,8 +141,40 @@ void Statistic::RegisterStatistic() {
   }
 }
 
-namespace {
+unsigned &Statistic::getCounter() {
+  init();
+  StatisticCounters *C =
+    const_cast<StatisticCounters*>(ThreadCounters->get());
+  if (C && Index < C->Counters.size())
+    return C->Counters[Index];
+
+  // The first statistic this thread updates, or one registered since the
+  // thread last grew its counters.
+  sys::SmartScopedLock<true> Writer(*StatLock);
+  if (!C) {
+    C = new StatisticCounters();
+    StatInfo->Threads.push_back(C);
+    ThreadCounters->set(C);
+  }
+  C->Counters.resize(StatInfo->Stats.size());
+  return C->Counters[Index];
+}
+
+sys::cas_flag Statistic::getValue() const {
+  if (!Initialized)
+    return Value;
+  sys::SmartScopedLock<true> Reader(*StatLock);
+  return Value + StatInfo->sumCounters(this);
+}
+
+void Statistic::setValue(unsigned Val) {
+  // The threads keep counting from where they are, so the part of the value
+  // they do not hold makes up the difference.
+  sys::SmartScopedLock<true> Writer(*StatLock);
+  Value = Val - StatInfo->sumCounters(this);
+}
 
+namespace {
 struct NameCompare {
   bool operator()(const Statistic *LHS, const Statistic *RHS) const {
     int Cmp = std::strcmp(LHS->getName(), RHS->getName());
@@ -95,6 +190,8 @@ struct NameCompare {
 // Print information when destroyed, iff command line option is specified.
 StatisticInfo::~StatisticInfo() {
   llvm::PrintStatistics();
+  for (size_t i = 0, e = Threads.size(); i != e; ++i)
+    delete Threads[i];
 }
 
 void llvm::EnableStatistics() {
@@ -106,6 +203,7 @@ bool llvm::AreStatisticsEnabled() {
 }
 
 void llvm::PrintStatistics(raw_ostream &OS) {
+  sys::SmartScopedLock<true> Reader(*StatLock);
   StatisticInfo &Stats = *StatInfo;
 
   // Figure out how long the biggest Value and Name fields are.
@@ -139,14 +237,76 @@ void llvm::PrintStatistics(raw_ostream &OS) {
 
 }
 
+/// printJSONString - Print Str as a quoted JSON string.
+static void printJSONString(raw_ostream &OS, const char *Str) {
+  OS << '"';
+  for (; *Str; ++Str) {
+    unsigned char C = *Str;
+    if (C == '"' || C == '\\')
+      OS << '\\' << C;
+    else if (C < 0x20)
+      OS << format("\\u%04x", C);
+    else
+      OS << C;
+  }
+  OS << '"';
+}
+
+void llvm::PrintStatisticsJSON(raw_ostream &OS) {
+  std::vector<StatisticValue> Values;
+  GetStatistics(Values);
+
+  OS << "[\n";
+  for (size_t i = 0, e = Values.size(); i != e; ++i) {
+    OS << "  {\"name\": ";
+    printJSONString(OS, Values[i].Name);
+    OS << ", \"desc\": ";
+    printJSONString(OS, Values[i].Desc);
+    OS << ", \"value\": " << Values[i].Value << '}'
+       << (i + 1 != e ? ",\n" : "\n");
+  }
+  OS << "]\n";
+  OS.flush();
+}
+
+void llvm::GetStatistics(std::vector<StatisticValue> &Values, bool Reset) {
+  sys::SmartScopedLock<true> Writer(*StatLock);
+  StatisticInfo &Stats = *StatInfo;
+
+  std::stable_sort(Stats.Stats.begin(), Stats.Stats.end(), NameCompare());
+
+  Values.clear();
+  Values.reserve(Stats.Stats.size());
+  for (size_t i = 0, e = Stats.Stats.size(); i != e; ++i) {
+    // Statistics are only changed through their operators, and the list only
+    // holds them as const so that it cannot be done by accident.
+    Statistic *S = const_cast<Statistic*>(Stats.Stats[i]);
+    unsigned Counted = Stats.sumCounters(S);
+    StatisticValue V = { S->getName(), S->getDesc(), S->Value + Counted };
+    Values.push_back(V);
+
+    // Anything the threads count from here on goes into the next reading.
+    if (Reset)
+      S->Value = -Counted;
+  }
+}
+
+void llvm::ResetStatistics() {
+  std::vector<StatisticValue> Values;
+  GetStatistics(Values, /*Reset=*/true);
+}
+
 void llvm::PrintStatistics() {
   StatisticInfo &Stats = *StatInfo;
 
   // Statistics not enabled?
-  if (Stats.Stats.empty()) return;
+  if (!Enabled || Stats.Stats.empty()) return;
 
   // Get the stream to write to.
   raw_ostream &OutStream = *CreateInfoOutputFile();
-  PrintStatistics(OutStream);
+  if (StatsAsJSON)
+    PrintStatisticsJSON(OutStream);
+  else
+    PrintStatistics(OutStream);
   delete &OutStream;   // Close the file.
 }
@@ -14,6 +14,7 @@
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/Endian.h"
 using namespace llvm;
 
 /// StrInStrNoCase - Portable version of strcasestr.  Locates the first
@@ -79,3 +80,46 @@ void llvm::StringRef::split(SmallVectorImpl<StringRef> &A,
   if (rest.data() != NULL && (rest.size() != 0 || KeepEmpty))
     A.push_back(rest);
 }
+
+/// load64/load32 - Read a possibly unaligned little-endian word from memory,
+/// so that the hash is the same on every host.
+static inline uint64_t load64(const char *P) {
+  return support::endian::read_le<uint64_t, support::unaligned>(P);
+}
+
+static inline uint32_t load32(const char *P) {
+  return support::endian::read_le<uint32_t, support::unaligned>(P);
+}
+
+/// loadTail - Read the last 1 to 8 bytes of a string into a word, reading
+/// no byte outside of [P, P+Len).
+static inline uint64_t loadTail(const char *P, size_t Len) {
+  if (Len >= 4)
+    return load32(P) | (uint64_t(load32(P + Len - 4)) << 32);
+  return (uint64_t((unsigned char)P[0]) << 16) |
+         (uint64_t((unsigned char)P[Len >> 1]) << 8) |
+         uint64_t((unsigned char)P[Len - 1]);
+}
+
+/// mixWord - Fold a word of the string into the hash.  The multiplication
+/// carries low bits up, the shift brings the high bits back down, so the low
+/// bits that pick the bucket depend on the whole word.
+static inline uint64_t mixWord(uint64_t Hash, uint64_t W) {
+  Hash = (Hash ^ W) * 0x9E3779B97F4A7C15ULL;
+  return Hash ^ (Hash >> 32);
+}
+
+unsigned llvm::HashStringFast(StringRef Str) {
+  const char *P = Str.data();
+  size_t Len = Str.size();
+  uint64_t Hash = Len * 0x9E3779B97F4A7C15ULL;
+  if (Len > 8) {
+    for (const char *E = P + Len - 8; P < E; P += 8)
+      Hash = mixWord(Hash, load64(P));
+    Hash = mixWord(Hash, load64(Str.data() + Len - 8));
+  } else if (Len) {
+    Hash = mixWord(Hash, loadTail(P, Len));
+  }
+  Hash *= 0xFF51AFD7ED558CCDULL;
+  return unsigned(Hash ^ (Hash >> 32));
+}
@@ -14,8 +14,34 @@
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringExtras.h"
 #include <cassert>
+#include <cstring>
 using namespace llvm;
 
+/// KeyMatches - Return true if the key of an item, of length ItemLen at
+/// ItemStr, is Name.  This is only called when the full hash values match, so
+/// the answer is nearly always yes; the length and the first bytes are checked
+/// inline so that short keys, the common case for symbol names, never call
+/// memcmp.
+static inline bool KeyMatches(const char *ItemStr, unsigned ItemLen,
+                              StringRef Name) {
+  if (ItemLen != Name.size())
+    return false;
+  const char *NameStr = Name.data();
+  if (ItemLen < sizeof(uint64_t)) {
+    for (unsigned i = 0; i != ItemLen; ++i)
+      if (ItemStr[i] != NameStr[i])
+        return false;
+    return true;
+  }
+  uint64_t ItemPrefix, NamePrefix;
+  memcpy(&ItemPrefix, ItemStr, sizeof(uint64_t));
+  memcpy(&NamePrefix, NameStr, sizeof(uint64_t));
+  if (ItemPrefix != NamePrefix)
+    return false;
+  return memcmp(ItemStr + sizeof(uint64_t), NameStr + sizeof(uint64_t),
+                ItemLen - sizeof(uint64_t)) == 0;
+}
+
 StringMapImpl::StringMapImpl(unsigned InitSize, unsigned itemSize) {
   ItemSize = itemSize;
   
@@ -58,7 +84,7 @@ unsigned StringMapImpl::LookupBucketFor(StringRef Name) {
     init(16);
     HTSize = NumBuckets;
   }
-  unsigned FullHashValue = HashString(Name);
+  unsigned FullHashValue = HashStringFast(Name);
   unsigned BucketNo = FullHashValue & (HTSize-1);
   
   unsigned ProbeAmt = 1;
@@ -91,7 +117,7 @@ unsigned StringMapImpl::LookupBucketFor(StringRef Name) {
       // Do the comparison like this because Name isn't necessarily
       // null-terminated!
       char *ItemStr = (char*)BucketItem+ItemSize;
-      if (Name == StringRef(ItemStr, BucketItem->getKeyLength())) {
+      if (KeyMatches(ItemStr, BucketItem->getKeyLength(), Name)) {
         // We found a match!
         return BucketNo;
       }
@@ -113,7 +139,7 @@ unsigned StringMapImpl::LookupBucketFor(StringRef Name) {
 int StringMapImpl::FindKey(StringRef Key) const {
   unsigned HTSize = NumBuckets;
   if (HTSize == 0) return -1;  // Really empty table?
-  unsigned FullHashValue = HashString(Key);
+  unsigned FullHashValue = HashStringFast(Key);
   unsigned BucketNo = FullHashValue & (HTSize-1);
   
   unsigned ProbeAmt = 1;
@@ -135,7 +161,7 @@ int StringMapImpl::FindKey(StringRef Key) const {
       // Do the comparison like this because NameStart isn't necessarily
       // null-terminated!
       char *ItemStr = (char*)BucketItem+ItemSize;
-      if (Key == StringRef(ItemStr, BucketItem->getKeyLength())) {
+      if (KeyMatches(ItemStr, BucketItem->getKeyLength(), Key)) {
         // We found a match!
         return BucketNo;
       }
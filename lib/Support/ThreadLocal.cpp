@@ -23,7 +23,7 @@
 // Define all methods as no-ops if threading is explicitly disabled
 namespace llvm {
 using namespace sys;
-ThreadLocalImpl::ThreadLocalImpl() { }
+ThreadLocalImpl::ThreadLocalImpl(void (*)(void*)) { }
 ThreadLocalImpl::~ThreadLocalImpl() { }
 void ThreadLocalImpl::setInstance(const void* d) { data = const_cast<void*>(d);}
 const void* ThreadLocalImpl::getInstance() { return data; }
@@ -40,9 +40,9 @@ void ThreadLocalImpl::removeInstance() { data = 0; }
 namespace llvm {
 using namespace sys;
 
-ThreadLocalImpl::ThreadLocalImpl() : data(0) {
+ThreadLocalImpl::ThreadLocalImpl(void (*Destructor)(void*)) : data(0) {
   pthread_key_t* key = new pthread_key_t;
-  int errorcode = pthread_key_create(key, NULL);
+  int errorcode = pthread_key_create(key, Destructor);
   assert(errorcode == 0);
   (void) errorcode;
   data = (void*)key;
@@ -103,6 +103,42 @@ void llvm::llvm_execute_on_thread(void (*Fn)(void*), void *UserData,
   ::pthread_attr_destroy(&Attr);
 }
 
+struct llvm::llvm_thread {
+  pthread_t Thread;
+  ThreadInfo Info;
+};
+
+llvm_thread *llvm::llvm_start_thread(void (*Fn)(void*), void *UserData,
+                                     unsigned RequestedStackSize) {
+  llvm_thread *T = new llvm_thread();
+  T->Info.UserFn = Fn;
+  T->Info.UserData = UserData;
+
+  pthread_attr_t Attr;
+  bool Started = false;
+  if (::pthread_attr_init(&Attr) == 0) {
+    if (RequestedStackSize == 0 ||
+        ::pthread_attr_setstacksize(&Attr, RequestedStackSize) == 0)
+      Started = ::pthread_create(&T->Thread, &Attr, ExecuteOnThread_Dispatch,
+                                 &T->Info) == 0;
+    ::pthread_attr_destroy(&Attr);
+  }
+
+  if (!Started) {
+    delete T;
+    Fn(UserData);
+    return 0;
+  }
+  return T;
+}
+
+void llvm::llvm_join_thread(llvm_thread *T) {
+  if (!T)
+    return;
+  ::pthread_join(T->Thread, 0);
+  delete T;
+}
+
 #else
 
 // No non-pthread implementation, currently.
@@ -113,4 +149,15 @@ void llvm::llvm_execute_on_thread(void (*Fn)(void*), void *UserData,
   Fn(UserData);
 }
 
+llvm_thread *llvm::llvm_start_thread(void (*Fn)(void*), void *UserData,
+                                     unsigned RequestedStackSize) {
+  (void) RequestedStackSize;
+  Fn(UserData);
+  return 0;
+}
+
+void llvm::llvm_join_thread(llvm_thread *T) {
+  (void) T;
+}
+
 #endif
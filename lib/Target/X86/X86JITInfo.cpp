@@ -17,6 +17,7 @@
 #include "X86Subtarget.h"
 #include "X86TargetMachine.h"
 #include "llvm/Function.h"
+#include "llvm/Support/Atomic.h"
 #include "llvm/Support/Compiler.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/Valgrind.h"
@@ -31,6 +32,37 @@ using namespace llvm;
 # define X86_32_JIT
 #endif
 
+#if defined (X86_64_JIT)
+// An X86-64 stub jumps through a pointer kept in the stub, so that the JIT can
+// redirect it with one atomic store while other threads are calling through
+// it.  A stub for a function that has not been compiled yet starts out
+// pointing at its own call to the compilation callback:
+//
+//    0: jmpq *StubSlotOffset(%rip)
+//    6: movabsq $X86CompilationCallback, %r10
+//   16: callq *%r10
+//   19: 0xCE marker
+//   24: the 8-byte aligned target pointer
+static const unsigned StubCallOffset = 6;
+static const unsigned StubMarkerOffset = 19;
+static const unsigned StubSlotOffset = 24;
+static const unsigned StubSize = 32;
+
+/// setStubTarget - Point the stub at Stub to Target.  The slot is aligned, so
+/// the store is atomic, and the fence makes the code at Target visible to any
+/// thread that sees the new pointer.
+static void setStubTarget(void *Stub, void *Target) {
+  sys::MemoryFence();
+  *(void *volatile *)((char*)Stub + StubSlotOffset) = Target;
+}
+
+/// PatchableEntry - The 8-byte no-op (nopl 0(%rax,%rax,1)) that starts
+/// functions which may be patched while they are running.
+static const unsigned char PatchableEntry[8] = {
+  0x0F, 0x1F, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+#endif
+
 void X86JITInfo::replaceMachineCodeForFunction(void *Old, void *New) {
   unsigned char *OldByte = (unsigned char *)Old;
   *OldByte++ = 0xE9;                // Emit JMP opcode.
@@ -44,6 +76,42 @@ void X86JITInfo::replaceMachineCodeForFunction(void *Old, void *New) {
   sys::ValgrindDiscardTranslations(Old, 5);
 }
 
+void X86JITInfo::emitPatchableEntry(JITCodeEmitter &JCE) {
+#if defined (X86_64_JIT)
+  for (unsigned i = 0; i != sizeof(PatchableEntry); ++i)
+    JCE.emitByte(PatchableEntry[i]);
+#endif
+}
+
+bool X86JITInfo::patchFunctionEntry(void *Old, void *New) {
+#if defined (X86_64_JIT)
+  if ((uintptr_t)Old % sizeof(PatchableEntry) ||
+      memcmp(Old, PatchableEntry, sizeof(PatchableEntry)) != 0)
+    return false;
+  intptr_t Disp = (intptr_t)New - ((intptr_t)Old + 5);
+  if (Disp < -2147483648LL || Disp > 2147483647LL)
+    return false;
+
+  // Replace the no-op with a jmp to New, padded with int3s that are never
+  // reached.  A thread is either before the no-op or past it, so it sees
+  // either the whole no-op or the whole jump.
+  unsigned char Jump[8] = {
+    0xE9,
+    (unsigned char)Disp, (unsigned char)(Disp >> 8),
+    (unsigned char)(Disp >> 16), (unsigned char)(Disp >> 24),
+    0xCC, 0xCC, 0xCC
+  };
+  uint64_t Word;
+  memcpy(&Word, Jump, sizeof(Word));
+  sys::MemoryFence();
+  *(volatile uint64_t *)Old = Word;
+  sys::ValgrindDiscardTranslations(Old, sizeof(Jump));
+  return true;
+#else
+  return false;
+#endif
+}
+
 
 /// JITCompilerFunction - This contains the address of the JIT function used to
 /// compile a function lazily.
@@ -394,19 +462,11 @@ X86CompilationCallback2(intptr_t *StackPtr, intptr_t RetAddr) {
     // when the requested function finally gets called.  This also makes the
     // 0xCE byte (interrupt) dead, so the marker doesn't effect anything.
 #if defined (X86_64_JIT)
-    // If the target address is within 32-bit range of the stub, use a
-    // PC-relative branch instead of loading the actual address.  (This is
-    // considerably shorter than the 64-bit immediate load already there.)
-    // We assume here intptr_t is 64 bits.
-    intptr_t diff = NewVal-RetAddr+7;
-    if (diff >= -2147483648LL && diff <= 2147483647LL) {
-      *(unsigned char*)(RetAddr-0xc) = 0xE9;
-      *(intptr_t *)(RetAddr-0xb) = diff & 0xffffffff;
-    } else {
-      *(intptr_t *)(RetAddr - 0xa) = NewVal;
-      ((unsigned char*)RetAddr)[0] = (2 | (4 << 3) | (3 << 6));
-    }
-    sys::ValgrindDiscardTranslations((void*)(RetAddr-0xc), 0xd);
+    // On X86-64 the stub jumps through its target pointer, so it is enough
+    // to point that at the function.  Other threads that are calling through
+    // the stub meanwhile get here or to the function, never to a half-written
+    // instruction.
+    setStubTarget((void*)(RetAddr + 1 - StubMarkerOffset), (void*)NewVal);
 #else
     ((unsigned char*)RetAddr)[-1] = 0xE9;
     sys::ValgrindDiscardTranslations((void*)(RetAddr-1), 5);
@@ -415,7 +475,7 @@ X86CompilationCallback2(intptr_t *StackPtr, intptr_t RetAddr) {
 
   // Change the return address to reexecute the call instruction...
 #if defined (X86_64_JIT)
-  *RetAddrLoc -= 0xd;
+  *RetAddrLoc = RetAddr + 1 - StubMarkerOffset;
 #else
   *RetAddrLoc -= 5;
 #endif
@@ -458,13 +518,15 @@ void *X86JITInfo::emitGlobalValueIndirectSym(const GlobalValue* GV, void *ptr,
 }
 
 TargetJITInfo::StubLayout X86JITInfo::getStubLayout() {
-  // The 64-bit stub contains:
-  //   movabs r10 <- 8-byte-target-address  # 10 bytes
-  //   call|jmp *r10  # 3 bytes
+#if defined (X86_64_JIT)
+  // See the layout at the top of this file.
+  StubLayout Result = {StubSize, 8};
+#else
   // The 32-bit stub contains a 5-byte call|jmp.
   // If the stub is a call to the compilation callback, an extra byte is added
   // to mark it as a stub.
   StubLayout Result = {14, 4};
+#endif
   return Result;
 }
 
@@ -478,43 +540,60 @@ void *X86JITInfo::emitFunctionStub(const Function* F, void *Target,
 #else
   bool NotCC = Target != (void*)(intptr_t)X86CompilationCallback;
 #endif
-  JCE.emitAlignment(4);
-  void *Result = (void*)JCE.getCurrentPCValue();
-  if (NotCC) {
 #if defined (X86_64_JIT)
+  JCE.emitAlignment(8);
+  void *Result = (void*)JCE.getCurrentPCValue();
+  JCE.emitByte(0xFF);          // jmpq *StubSlotOffset(%rip)
+  JCE.emitByte(0x25);
+  JCE.emitWordLE(StubSlotOffset - StubCallOffset);
+
+  void *Slot = Target;
+  unsigned Size = StubCallOffset;
+  if (!NotCC) {
     JCE.emitByte(0x49);          // REX prefix
     JCE.emitByte(0xB8+2);        // movabsq r10
     JCE.emitWordLE((unsigned)(intptr_t)Target);
     JCE.emitWordLE((unsigned)(((intptr_t)Target) >> 32));
     JCE.emitByte(0x41);          // REX prefix
-    JCE.emitByte(0xFF);          // jmpq *r10
-    JCE.emitByte(2 | (4 << 3) | (3 << 6));
+    JCE.emitByte(0xFF);          // callq *r10
+    JCE.emitByte(2 | (2 << 3) | (3 << 6));
+    JCE.emitByte(0xCE);          // Marker identifying the stub.
+    Slot = (char*)Result + StubCallOffset;
+    Size = StubMarkerOffset + 1;
+  }
+  for (; Size != StubSlotOffset; ++Size)
+    JCE.emitByte(0xCC);          // int3, never reached.
+  JCE.emitWordLE((unsigned)(intptr_t)Slot);
+  JCE.emitWordLE((unsigned)(((intptr_t)Slot) >> 32));
+  return Result;
 #else
+  JCE.emitAlignment(4);
+  void *Result = (void*)JCE.getCurrentPCValue();
+  if (NotCC) {
     JCE.emitByte(0xE9);
     JCE.emitWordLE((intptr_t)Target-JCE.getCurrentPCValue()-4);
-#endif
     return Result;
   }
 
-#if defined (X86_64_JIT)
-  JCE.emitByte(0x49);          // REX prefix
-  JCE.emitByte(0xB8+2);        // movabsq r10
-  JCE.emitWordLE((unsigned)(intptr_t)Target);
-  JCE.emitWordLE((unsigned)(((intptr_t)Target) >> 32));
-  JCE.emitByte(0x41);          // REX prefix
-  JCE.emitByte(0xFF);          // callq *r10
-  JCE.emitByte(2 | (2 << 3) | (3 << 6));
-#else
   JCE.emitByte(0xE8);   // Call with 32 bit pc-rel destination...
 
   JCE.emitWordLE((intptr_t)Target-JCE.getCurrentPCValue()-4);
-#endif
 
   // This used to use 0xCD, but that value is used by JITMemoryManager to
   // initialize the buffer with garbage, which means it may follow a
   // noreturn function call, confusing X86CompilationCallback2.  PR 4929.
   JCE.emitByte(0xCE);   // Interrupt - Just a marker identifying the stub!
   return Result;
+#endif
+}
+
+bool X86JITInfo::updateFunctionStub(void *Stub, void *Target) {
+#if defined (X86_64_JIT)
+  setStubTarget(Stub, Target);
+  return true;
+#else
+  return false;
+#endif
 }
 
 /// getPICJumpTableEntry - Returns the value of the jumptable entry for the
@@ -37,6 +37,14 @@ namespace llvm {
     ///
     virtual void replaceMachineCodeForFunction(void *Old, void *New);
 
+    /// emitPatchableEntry - On X86-64, emit an 8-byte no-op that
+    /// patchFunctionEntry can overwrite with a jump.
+    virtual void emitPatchableEntry(JITCodeEmitter &JCE);
+
+    /// patchFunctionEntry - On X86-64, overwrite the 8-byte no-op at Old with
+    /// a jump to New in one aligned 8-byte store.
+    virtual bool patchFunctionEntry(void *Old, void *New);
+
     /// emitGlobalValueIndirectSym - Use the specified JITCodeEmitter object
     /// to emit an indirect symbol which contains the address of the specified
     /// ptr.
@@ -53,6 +61,10 @@ namespace llvm {
     virtual void *emitFunctionStub(const Function* F, void *Target,
                                    JITCodeEmitter &JCE);
 
+    /// updateFunctionStub - On X86-64, stubs jump through an aligned pointer
+    /// in the stub, which is replaced with one atomic store.
+    virtual bool updateFunctionStub(void *Stub, void *Target);
+
     /// getPICJumpTableEntry - Returns the value of the jumptable entry for the
     /// specific basic block.
     virtual uintptr_t getPICJumpTableEntry(uintptr_t BB, uintptr_t JTBase);
@@ -41,6 +41,7 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/IRBuilder.h"
+#include <algorithm>
 using namespace llvm;
 
 STATISTIC(NumGVNInstr,  "Number of instructions deleted");
@@ -53,6 +54,13 @@ static cl::opt<bool> EnablePRE("enable-pre",
                                cl::init(true), cl::Hidden);
 static cl::opt<bool> EnableLoadPRE("enable-load-pre", cl::init(true));
 
+// Bound the number of blocks a single non-local load query may visit, so that
+// the cost of analyzing a load does not grow with the size of the function.
+static cl::opt<unsigned>
+MaxNonLocalBlocks("gvn-max-nonlocal-blocks", cl::init(1000), cl::Hidden,
+  cl::desc("Maximum number of blocks to search for the dependencies of a "
+           "non-local load (0 = unlimited)"));
+
 //===----------------------------------------------------------------------===//
 //                         ValueTable Class
 //===----------------------------------------------------------------------===//
@@ -67,25 +75,102 @@ namespace {
     SmallVector<uint32_t, 4> varargs;
 
     Expression() { }
-    Expression(uint32_t o) : opcode(o) { }
 
-    bool operator==(const Expression &other) const {
-      if (opcode != other.opcode)
-        return false;
-      else if (opcode == ~0U || opcode == ~1U)
-        return true;
-      else if (type != other.type)
-        return false;
-      else if (varargs != other.varargs)
+    /// getHash - Mix the opcode, type and operand value numbers together.
+    unsigned getHash() const {
+      unsigned hash = opcode * 37U;
+      hash ^= ((unsigned)((uintptr_t)type >> 4) ^
+               (unsigned)((uintptr_t)type >> 9));
+      for (SmallVector<uint32_t, 4>::const_iterator I = varargs.begin(),
+           E = varargs.end(); I != E; ++I)
+        hash = (hash ^ *I) * 0x9E3779B1U;
+      return hash ^ (hash >> 15);
+    }
+  };
+
+  /// ExpressionTable - A hash-consed table mapping expressions to value
+  /// numbers.  Each expression is stored once, as a fixed-size entry whose
+  /// operands live in a single shared pool, and is found through an
+  /// open-addressed array of entry indices.  This keeps the table compact on
+  /// very large functions, where a DenseMap<Expression, uint32_t> would pay
+  /// for a full Expression (including its inline operand storage) in every
+  /// bucket, empty or not.  Expressions are never removed individually.
+  class ExpressionTable {
+    struct Entry {
+      unsigned Hash;
+      uint32_t Opcode;
+      const Type *Ty;
+      unsigned ArgsBegin, NumArgs;
+      uint32_t Num;
+    };
+
+    std::vector<Entry> Entries;
+    std::vector<uint32_t> Args;
+
+    /// Buckets - One plus the index into Entries of the expression hashed to
+    /// each slot, or zero for an empty slot.  The size is a power of two.
+    std::vector<unsigned> Buckets;
+
+    bool matches(const Entry &En, unsigned Hash, const Expression &E) const {
+      if (En.Hash != Hash || En.Opcode != E.opcode || En.Ty != E.type ||
+          En.NumArgs != E.varargs.size())
         return false;
-      return true;
+      return std::equal(E.varargs.begin(), E.varargs.end(),
+                        Args.begin() + En.ArgsBegin);
+    }
+
+    void grow() {
+      unsigned NewSize = Buckets.empty() ? 64 : Buckets.size() * 2;
+      Buckets.assign(NewSize, 0);
+      for (unsigned i = 0, e = Entries.size(); i != e; ++i) {
+        unsigned Mask = NewSize - 1, Slot = Entries[i].Hash & Mask;
+        while (Buckets[Slot])
+          Slot = (Slot + 1) & Mask;
+        Buckets[Slot] = i + 1;
+      }
+    }
+
+  public:
+    /// operator[] - Return the value number slot for E, inserting E with a
+    /// value number of zero if it is not in the table yet.  The reference is
+    /// invalidated by the next insertion.
+    uint32_t &operator[](const Expression &E) {
+      // Keep the load factor under 3/4 so that probe sequences stay short.
+      if ((Entries.size() + 1) * 4 > Buckets.size() * 3)
+        grow();
+
+      unsigned Hash = E.getHash();
+      unsigned Mask = Buckets.size() - 1, Slot = Hash & Mask;
+      while (unsigned Idx = Buckets[Slot]) {
+        if (matches(Entries[Idx - 1], Hash, E))
+          return Entries[Idx - 1].Num;
+        Slot = (Slot + 1) & Mask;
+      }
+
+      Entry En;
+      En.Hash = Hash;
+      En.Opcode = E.opcode;
+      En.Ty = E.type;
+      En.ArgsBegin = Args.size();
+      En.NumArgs = E.varargs.size();
+      En.Num = 0;
+      Args.insert(Args.end(), E.varargs.begin(), E.varargs.end());
+      Entries.push_back(En);
+      Buckets[Slot] = Entries.size();
+      return Entries.back().Num;
+    }
+
+    void clear() {
+      Entries.clear();
+      Args.clear();
+      Buckets.clear();
     }
   };
 
   class ValueTable {
     private:
       DenseMap<Value*, uint32_t> valueNumbering;
-      DenseMap<Expression, uint32_t> expressionNumbering;
+      ExpressionTable expressionNumbering;
       AliasAnalysis* AA;
       MemoryDependenceAnalysis* MD;
       DominatorTree* DT;
@@ -110,35 +195,6 @@ namespace {
   };
 }
 
-namespace llvm {
-template <> struct DenseMapInfo<Expression> {
-  static inline Expression getEmptyKey() {
-    return ~0U;
-  }
-
-  static inline Expression getTombstoneKey() {
-    return ~1U;
-  }
-
-  static unsigned getHashValue(const Expression e) {
-    unsigned hash = e.opcode;
-
-    hash = ((unsigned)((uintptr_t)e.type >> 4) ^
-            (unsigned)((uintptr_t)e.type >> 9));
-
-    for (SmallVector<uint32_t, 4>::const_iterator I = e.varargs.begin(),
-         E = e.varargs.end(); I != E; ++I)
-      hash = *I + hash * 37;
-    
-    return hash;
-  }
-  static bool isEqual(const Expression &LHS, const Expression &RHS) {
-    return LHS == RHS;
-  }
-};
-
-}
-
 //===----------------------------------------------------------------------===//
 //                     ValueTable Internal Functions
 //===----------------------------------------------------------------------===//
@@ -1076,7 +1132,8 @@ bool GVN::processNonLocalLoad(LoadInst *LI,
   // Find the non-local dependencies of the load.
   SmallVector<NonLocalDepResult, 64> Deps;
   AliasAnalysis::Location Loc = VN.getAliasAnalysis()->getLocation(LI);
-  MD->getNonLocalPointerDependency(Loc, true, LI->getParent(), Deps);
+  MD->getNonLocalPointerDependency(Loc, true, LI->getParent(), Deps,
+                                   MaxNonLocalBlocks);
   //DEBUG(dbgs() << "INVESTIGATING NONLOCAL LOAD: "
   //             << Deps.size() << *LI << '\n');
 
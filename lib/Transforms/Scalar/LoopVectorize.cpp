@@ -0,0 +1,854 @@
+//===- LoopVectorize.cpp - Vectorize innermost counted loops --------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass widens simple innermost loops so that each iteration of the new
+// loop performs VF iterations of the original one using vector instructions.
+// It handles single-block loops with a computable trip count whose memory
+// accesses are consecutive in the induction variable, e.g.:
+//
+//   for (i = 0; i < n; ++i)
+//     A[i] = B[i] + C[i];
+//
+// The vectorized loop is emitted in front of the original loop, which is kept
+// to run the remaining (TripCount % VF) iterations:
+//
+//          preheader ----------------------------.
+//              |  (vector trip count == 0)         |
+//        vector.memcheck ------------------------+
+//              |  (pointer ranges overlap)         |
+//          vector.ph                               |
+//              |                                   |
+//        vector.body <-.                           |
+//              |  -----'                           |
+//        middle.block ------------------------- scalar.ph
+//              |  (no remaining iterations)        |
+//              |                               original loop
+//              |                                   |
+//              |                                  exit
+//          exit.merge <----------------------------'
+//
+// Pointers that may overlap are checked at runtime; if any range written by
+// the loop overlaps another range it accesses, only the scalar loop runs.
+//
+// Integer induction variables with a constant step and integer reductions
+// (add, mul, and, or, xor) whose final value is used after the loop are
+// supported.  Anything else in the loop body makes the pass give up.
+//
+//===----------------------------------------------------------------------===//
+//
+// TODO List:
+//
+// Handle loops with more than one block by if-converting them first.
+// Handle reverse and strided accesses, and loads from invariant addresses.
+// Use a cost model instead of a fixed vector width.
+// Drop the runtime checks when AliasAnalysis proves the underlying objects
+// are distinct.
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "loop-vectorize"
+#include "llvm/Transforms/Scalar.h"
+#include "llvm/Constants.h"
+#include "llvm/DerivedTypes.h"
+#include "llvm/Instructions.h"
+#include "llvm/Analysis/Dominators.h"
+#include "llvm/Analysis/LoopPass.h"
+#include "llvm/Analysis/ScalarEvolutionExpressions.h"
+#include "llvm/Analysis/ScalarEvolutionExpander.h"
+#include "llvm/Target/TargetData.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/IRBuilder.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include <algorithm>
+using namespace llvm;
+
+STATISTIC(NumVectorized,    "Number of loops vectorized");
+STATISTIC(NumRuntimeChecks, "Number of loops vectorized with alias checks");
+
+static cl::opt<unsigned>
+VectorWidth("loop-vectorize-width", cl::init(4), cl::Hidden,
+            cl::desc("Number of scalar iterations performed by one iteration "
+                     "of a vectorized loop (must be a power of two)"));
+
+/// MaxRuntimePointers - Give up on loops that would need to compare more than
+/// this many distinct pointers against each other at runtime.
+static const unsigned MaxRuntimePointers = 8;
+
+namespace {
+  /// MemAccess - A load or store whose address advances by exactly one
+  /// element per iteration.
+  struct MemAccess {
+    Instruction *Inst;
+    Value *Ptr;
+    const SCEVAddRecExpr *AR;
+  };
+
+  /// PointerRange - A distinct address recurrence accessed by the loop, used
+  /// to emit the runtime overlap checks.
+  struct PointerRange {
+    const SCEVAddRecExpr *AR;
+    uint64_t EltSize;
+    bool IsWritten;
+  };
+
+  /// Induction - An integer phi that advances by a constant each iteration.
+  struct Induction {
+    PHINode *Phi;
+    Value *Start;
+    ConstantInt *Step;
+  };
+
+  /// Reduction - An integer phi that folds one value per iteration into an
+  /// accumulator with an associative and commutative operator.
+  struct Reduction {
+    PHINode *Phi;
+    Value *Start;
+    BinaryOperator *Update;
+  };
+
+  class LoopVectorize : public LoopPass {
+    Loop *CurLoop;
+    LoopInfo *LI;
+    DominatorTree *DT;
+    ScalarEvolution *SE;
+    const TargetData *TD;
+    unsigned VF;
+
+    // Facts collected by canVectorize.
+    const SCEV *BECount;
+    BranchInst *LatchBr;
+    ICmpInst *LatchCmp;
+    SmallVector<Induction, 4> Inductions;
+    SmallVector<Reduction, 4> Reductions;
+    SmallVector<MemAccess, 8> Accesses;
+    SmallVector<PointerRange, 8> Ranges;
+
+    // State used while emitting the vector loop.
+    DenseMap<Value*, Value*> WidenMap;
+    DenseMap<Value*, Value*> BaseMap;
+    BasicBlock *VecPH;
+    PHINode *Index;
+  public:
+    static char ID;
+    explicit LoopVectorize() : LoopPass(ID) {
+      initializeLoopVectorizePass(*PassRegistry::getPassRegistry());
+    }
+
+    bool runOnLoop(Loop *L, LPPassManager &LPM);
+
+    virtual void getAnalysisUsage(AnalysisUsage &AU) const {
+      AU.addRequired<LoopInfo>();
+      AU.addPreserved<LoopInfo>();
+      AU.addRequiredID(LoopSimplifyID);
+      AU.addPreservedID(LoopSimplifyID);
+      AU.addRequiredID(LCSSAID);
+      AU.addPreservedID(LCSSAID);
+      AU.addRequired<ScalarEvolution>();
+      AU.addPreserved<ScalarEvolution>();
+      AU.addRequired<DominatorTree>();
+      AU.addPreserved<DominatorTree>();
+    }
+
+  private:
+    bool isVectorizableType(const Type *Ty) const;
+    bool isInductionUpdate(Instruction *I) const;
+    bool analyzePhi(PHINode *PN, BasicBlock *Preheader);
+    bool analyzeAccess(Instruction *I, Value *Ptr);
+    bool canVectorize();
+
+    Value *getBroadcast(Value *V);
+    Value *getVectorValue(Value *V, IRBuilder<> &Builder);
+    Value *getVectorPointer(Value *Ptr, const Type *VecTy,
+                            IRBuilder<> &Builder);
+    Value *emitRuntimeChecks(BasicBlock *MemCheck, SCEVExpander &Exp);
+    void vectorizeBody(BasicBlock *VecBody, IRBuilder<> &Builder);
+    void vectorize(LPPassManager &LPM);
+  };
+}
+
+char LoopVectorize::ID = 0;
+INITIALIZE_PASS_BEGIN(LoopVectorize, "loop-vectorize",
+                      "Vectorize innermost loops", false, false)
+INITIALIZE_PASS_DEPENDENCY(LoopInfo)
+INITIALIZE_PASS_DEPENDENCY(DominatorTree)
+INITIALIZE_PASS_DEPENDENCY(LoopSimplify)
+INITIALIZE_PASS_DEPENDENCY(LCSSA)
+INITIALIZE_PASS_DEPENDENCY(ScalarEvolution)
+INITIALIZE_PASS_END(LoopVectorize, "loop-vectorize",
+                    "Vectorize innermost loops", false, false)
+
+Pass *llvm::createLoopVectorizePass() { return new LoopVectorize(); }
+
+bool LoopVectorize::runOnLoop(Loop *L, LPPassManager &LPM) {
+  // Only innermost loops are candidates.  The vector loops this pass creates
+  // are queued too, but canVectorize rejects them since they use vectors.
+  if (!L->empty())
+    return false;
+
+  VF = VectorWidth;
+  if (VF < 2 || !isPowerOf2_32(VF))
+    return false;
+
+  // Element sizes are needed to recognize consecutive accesses.
+  TD = getAnalysisIfAvailable<TargetData>();
+  if (TD == 0) return false;
+
+  CurLoop = L;
+  LI = &getAnalysis<LoopInfo>();
+  DT = &getAnalysis<DominatorTree>();
+  SE = &getAnalysis<ScalarEvolution>();
+
+  Inductions.clear();
+  Reductions.clear();
+  Accesses.clear();
+  Ranges.clear();
+
+  DEBUG(dbgs() << "LV: Checking loop in '"
+               << L->getHeader()->getParent()->getName() << "' at "
+               << L->getHeader()->getName() << "\n");
+
+  if (!canVectorize())
+    return false;
+
+  vectorize(LPM);
+  WidenMap.clear();
+  BaseMap.clear();
+  ++NumVectorized;
+  return true;
+}
+
+/// isVectorizableType - Return true if values of type Ty can be the elements
+/// of a vector operated on by the widened loop.
+bool LoopVectorize::isVectorizableType(const Type *Ty) const {
+  if (Ty->isFloatTy() || Ty->isDoubleTy())
+    return true;
+  if (!Ty->isIntegerTy())
+    return false;
+  unsigned Bits = Ty->getPrimitiveSizeInBits();
+  return Bits == 8 || Bits == 16 || Bits == 32 || Bits == 64;
+}
+
+/// isInductionUpdate - Return true if I only feeds the loop control, so it
+/// does not need a vector version.
+bool LoopVectorize::isInductionUpdate(Instruction *I) const {
+  if (I->use_empty())
+    return false;
+  for (Value::use_iterator UI = I->use_begin(), E = I->use_end();
+       UI != E; ++UI) {
+    if (*UI == LatchCmp)
+      continue;
+    PHINode *PN = dyn_cast<PHINode>(*UI);
+    if (PN == 0 || PN->getParent() != CurLoop->getHeader())
+      return false;
+    bool IsInduction = false;
+    for (unsigned i = 0, e = Inductions.size(); i != e; ++i)
+      if (Inductions[i].Phi == PN)
+        IsInduction = true;
+    if (!IsInduction)
+      return false;
+  }
+  return true;
+}
+
+/// analyzePhi - Classify a header phi as an induction variable or a
+/// reduction.  Return false if it is neither.
+bool LoopVectorize::analyzePhi(PHINode *PN, BasicBlock *Preheader) {
+  const Type *Ty = PN->getType();
+  if (!Ty->isIntegerTy() || !isVectorizableType(Ty))
+    return false;
+
+  Value *Start = PN->getIncomingValueForBlock(Preheader);
+
+  // Induction variables advance by a constant amount.
+  if (const SCEVAddRecExpr *AR =
+        dyn_cast<SCEVAddRecExpr>(SE->getSCEV(PN)))
+    if (AR->getLoop() == CurLoop && AR->isAffine())
+      if (const SCEVConstant *Step =
+            dyn_cast<SCEVConstant>(AR->getStepRecurrence(*SE))) {
+        Induction IV = { PN, Start, Step->getValue() };
+        Inductions.push_back(IV);
+        return true;
+      }
+
+  // Otherwise this must be a reduction: the phi feeds a single binary
+  // operator whose result feeds back into the phi and is otherwise only used
+  // after the loop.
+  if (!PN->hasOneUse())
+    return false;
+  BinaryOperator *Update =
+    dyn_cast<BinaryOperator>(PN->getIncomingValueForBlock(CurLoop->getHeader()));
+  if (Update == 0 || *PN->use_begin() != Update ||
+      Update->getParent() != CurLoop->getHeader())
+    return false;
+
+  switch (Update->getOpcode()) {
+  case Instruction::Add:
+  case Instruction::Mul:
+  case Instruction::And:
+  case Instruction::Or:
+  case Instruction::Xor:
+    break;
+  default:
+    return false;
+  }
+
+  // The accumulator must not be used as the other operand too.
+  if (Update->getOperand(0) == PN && Update->getOperand(1) == PN)
+    return false;
+
+  for (Value::use_iterator UI = Update->use_begin(), E = Update->use_end();
+       UI != E; ++UI) {
+    Instruction *User = cast<Instruction>(*UI);
+    if (User == PN)
+      continue;
+    if (CurLoop->contains(User) || !isa<PHINode>(User))
+      return false;
+  }
+
+  Reduction R = { PN, Start, Update };
+  Reductions.push_back(R);
+  return true;
+}
+
+/// analyzeAccess - Check that the load or store I accesses consecutive
+/// elements, and record it along with the range of memory it touches.
+bool LoopVectorize::analyzeAccess(Instruction *I, Value *Ptr) {
+  const Type *EltTy = cast<PointerType>(Ptr->getType())->getElementType();
+  if (!isVectorizableType(EltTy))
+    return false;
+
+  const SCEVAddRecExpr *AR = dyn_cast<SCEVAddRecExpr>(SE->getSCEV(Ptr));
+  if (AR == 0 || AR->getLoop() != CurLoop || !AR->isAffine())
+    return false;
+
+  uint64_t EltSize = TD->getTypeAllocSize(EltTy);
+  const SCEVConstant *Step =
+    dyn_cast<SCEVConstant>(AR->getStepRecurrence(*SE));
+  if (Step == 0 || Step->getValue()->getValue() != EltSize)
+    return false;
+
+  MemAccess Access = { I, Ptr, AR };
+  Accesses.push_back(Access);
+
+  bool IsWrite = isa<StoreInst>(I);
+  for (unsigned i = 0, e = Ranges.size(); i != e; ++i)
+    if (Ranges[i].AR == AR) {
+      Ranges[i].IsWritten |= IsWrite;
+      Ranges[i].EltSize = std::max(Ranges[i].EltSize, EltSize);
+      return true;
+    }
+  PointerRange Range = { AR, EltSize, IsWrite };
+  Ranges.push_back(Range);
+  return true;
+}
+
+/// canVectorize - Return true if the current loop has a shape and a body this
+/// pass knows how to widen, filling in the induction, reduction and memory
+/// access lists as a side effect.
+bool LoopVectorize::canVectorize() {
+  BasicBlock *Header = CurLoop->getHeader();
+  BasicBlock *Preheader = CurLoop->getLoopPreheader();
+  if (CurLoop->getBlocks().size() != 1 || Preheader == 0 ||
+      CurLoop->getExitBlock() == 0) {
+    DEBUG(dbgs() << "LV: Not a single block loop with one exit.\n");
+    return false;
+  }
+
+  LatchBr = dyn_cast<BranchInst>(Header->getTerminator());
+  if (LatchBr == 0 || !LatchBr->isConditional())
+    return false;
+  LatchCmp = dyn_cast<ICmpInst>(LatchBr->getCondition());
+  if (LatchCmp == 0 || LatchCmp->getParent() != Header ||
+      !LatchCmp->hasOneUse())
+    return false;
+
+  BECount = SE->getBackedgeTakenCount(CurLoop);
+  if (isa<SCEVCouldNotCompute>(BECount)) {
+    DEBUG(dbgs() << "LV: Trip count is not computable.\n");
+    return false;
+  }
+
+  for (BasicBlock::iterator I = Header->begin(); isa<PHINode>(I); ++I)
+    if (!analyzePhi(cast<PHINode>(I), Preheader)) {
+      DEBUG(dbgs() << "LV: Unsupported phi: " << *I << "\n");
+      return false;
+    }
+
+  for (BasicBlock::iterator I = Header->getFirstNonPHI(), E = Header->end();
+       I != E; ++I) {
+    if (&*I == LatchBr || &*I == LatchCmp)
+      continue;
+
+    bool Supported;
+    switch (I->getOpcode()) {
+    default:
+      Supported = false;
+      break;
+    case Instruction::Load: {
+      LoadInst *Load = cast<LoadInst>(I);
+      Supported = !Load->isVolatile() &&
+                  analyzeAccess(Load, Load->getPointerOperand());
+      break;
+    }
+    case Instruction::Store: {
+      StoreInst *Store = cast<StoreInst>(I);
+      Supported = !Store->isVolatile() &&
+                  isVectorizableType(Store->getValueOperand()->getType()) &&
+                  analyzeAccess(Store, Store->getPointerOperand());
+      break;
+    }
+    case Instruction::GetElementPtr: {
+      // Addresses are recomputed from their recurrence, so the GEP itself
+      // must only be used as the address of a load or store.
+      Supported = true;
+      for (Value::use_iterator UI = I->use_begin(), UE = I->use_end();
+           UI != UE; ++UI) {
+        if (LoadInst *Load = dyn_cast<LoadInst>(*UI))
+          Supported &= Load->getPointerOperand() == &*I;
+        else if (StoreInst *Store = dyn_cast<StoreInst>(*UI))
+          Supported &= Store->getPointerOperand() == &*I;
+        else
+          Supported = false;
+      }
+      break;
+    }
+    case Instruction::Trunc:   case Instruction::ZExt:
+    case Instruction::SExt:    case Instruction::FPTrunc:
+    case Instruction::FPExt:   case Instruction::FPToUI:
+    case Instruction::FPToSI:  case Instruction::UIToFP:
+    case Instruction::SIToFP:
+      Supported = isVectorizableType(I->getOperand(0)->getType()) &&
+                  isVectorizableType(I->getType());
+      break;
+    case Instruction::Add:  case Instruction::FAdd:
+    case Instruction::Sub:  case Instruction::FSub:
+    case Instruction::Mul:  case Instruction::FMul:
+    case Instruction::UDiv: case Instruction::SDiv:
+    case Instruction::FDiv: case Instruction::URem:
+    case Instruction::SRem: case Instruction::FRem:
+    case Instruction::Shl:  case Instruction::LShr:
+    case Instruction::AShr: case Instruction::And:
+    case Instruction::Or:   case Instruction::Xor:
+      Supported = isVectorizableType(I->getType());
+      break;
+    }
+    if (!Supported) {
+      DEBUG(dbgs() << "LV: Unsupported instruction: " << *I << "\n");
+      return false;
+    }
+
+    // Only reduction results may be live after the loop.
+    bool IsReduction = false;
+    for (unsigned i = 0, e = Reductions.size(); i != e; ++i)
+      if (Reductions[i].Update == &*I)
+        IsReduction = true;
+    if (!IsReduction)
+      for (Value::use_iterator UI = I->use_begin(), UE = I->use_end();
+           UI != UE; ++UI)
+        if (!CurLoop->contains(cast<Instruction>(*UI))) {
+          DEBUG(dbgs() << "LV: Value used outside the loop: " << *I << "\n");
+          return false;
+        }
+  }
+
+  // A loop without stores or reductions has no effect worth widening.
+  if (Reductions.empty()) {
+    bool HasStore = false;
+    for (unsigned i = 0, e = Accesses.size(); i != e; ++i)
+      HasStore |= isa<StoreInst>(Accesses[i].Inst);
+    if (!HasStore)
+      return false;
+  }
+
+  // Every pair of ranges involving a write is compared at runtime; bound the
+  // number of comparisons.
+  bool HasWrite = false;
+  for (unsigned i = 0, e = Ranges.size(); i != e; ++i)
+    HasWrite |= Ranges[i].IsWritten;
+  if (HasWrite && Ranges.size() > MaxRuntimePointers) {
+    DEBUG(dbgs() << "LV: Too many pointers to check at runtime.\n");
+    return false;
+  }
+
+  // Values leaving through the exit must be reductions or loop invariant.
+  BasicBlock *Exit = CurLoop->getExitBlock();
+  for (BasicBlock::iterator I = Exit->begin(); isa<PHINode>(I); ++I) {
+    Instruction *In =
+      dyn_cast<Instruction>(cast<PHINode>(I)->getIncomingValueForBlock(Header));
+    if (In == 0 || !CurLoop->contains(In))
+      continue;
+    bool IsReduction = false;
+    for (unsigned i = 0, e = Reductions.size(); i != e; ++i)
+      if (Reductions[i].Update == In)
+        IsReduction = true;
+    if (!IsReduction) {
+      DEBUG(dbgs() << "LV: Value used outside the loop: " << *In << "\n");
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/// getBroadcast - Return a vector with every element set to the loop
+/// invariant value V, computed in the vector preheader.
+Value *LoopVectorize::getBroadcast(Value *V) {
+  Value *&Entry = WidenMap[V];
+  if (Entry)
+    return Entry;
+
+  if (Constant *C = dyn_cast<Constant>(V)) {
+    SmallVector<Constant*, 8> Elts(VF, C);
+    return Entry = ConstantVector::get(Elts);
+  }
+
+  IRBuilder<> Builder(VecPH->getTerminator());
+  const Type *VecTy = VectorType::get(V->getType(), VF);
+  const Type *I32Ty = Type::getInt32Ty(V->getContext());
+  Value *Vec = Builder.CreateInsertElement(UndefValue::get(VecTy), V,
+                                           ConstantInt::get(I32Ty, 0));
+  Constant *Zeros = Constant::getNullValue(VectorType::get(I32Ty, VF));
+  return Entry = Builder.CreateShuffleVector(Vec, UndefValue::get(VecTy),
+                                             Zeros, "broadcast");
+}
+
+/// getVectorValue - Return the vector version of V for the current vector
+/// iteration.  Induction variables are widened on first use.
+Value *LoopVectorize::getVectorValue(Value *V, IRBuilder<> &Builder) {
+  Instruction *I = dyn_cast<Instruction>(V);
+  if (I == 0 || !CurLoop->contains(I))
+    return getBroadcast(V);
+
+  Value *&Entry = WidenMap[V];
+  if (Entry)
+    return Entry;
+
+  // <Start + Index*Step + 0*Step, ..., Start + Index*Step + (VF-1)*Step>
+  for (unsigned i = 0, e = Inductions.size(); i != e; ++i) {
+    if (Inductions[i].Phi != V)
+      continue;
+    const Type *Ty = V->getType();
+    ConstantInt *Step = Inductions[i].Step;
+    Value *Idx = Builder.CreateIntCast(Index, Ty, false);
+    Value *Base = Builder.CreateAdd(Inductions[i].Start,
+                                    Builder.CreateMul(Idx, Step));
+    const Type *VecTy = VectorType::get(Ty, VF);
+    const Type *I32Ty = Type::getInt32Ty(V->getContext());
+    Value *Vec = Builder.CreateInsertElement(UndefValue::get(VecTy), Base,
+                                             ConstantInt::get(I32Ty, 0));
+    Vec = Builder.CreateShuffleVector(Vec, UndefValue::get(VecTy),
+                                      Constant::getNullValue(
+                                        VectorType::get(I32Ty, VF)));
+    SmallVector<Constant*, 8> Lanes;
+    for (unsigned Lane = 0; Lane != VF; ++Lane)
+      Lanes.push_back(ConstantInt::get(Ty, Step->getSExtValue() * int64_t(Lane),
+                                       true));
+    return Entry = Builder.CreateAdd(Vec, ConstantVector::get(Lanes),
+                                     "vec.ind");
+  }
+
+  llvm_unreachable("Operand was not widened before its use!");
+}
+
+/// getVectorPointer - Return a pointer to the VecTy accessed through Ptr in
+/// the current vector iteration.
+Value *LoopVectorize::getVectorPointer(Value *Ptr, const Type *VecTy,
+                                       IRBuilder<> &Builder) {
+  Value *Base = BaseMap[Ptr];
+  assert(Base && "No base pointer for access!");
+  // Index counts iterations from zero and may be narrower than a pointer.
+  // GEP would sign-extend it, so widen it explicitly as an unsigned value.
+  Value *Offset = Builder.CreateIntCast(
+    Index, TD->getIntPtrType(Ptr->getContext()), false, "index.ext");
+  Value *Addr = Builder.CreateGEP(Base, Offset);
+  unsigned AS = cast<PointerType>(Ptr->getType())->getAddressSpace();
+  return Builder.CreateBitCast(Addr, PointerType::get(VecTy, AS));
+}
+
+/// emitRuntimeChecks - Emit code into MemCheck that computes whether any
+/// range written by the loop overlaps another range it accesses.  Return the
+/// result, or null if no check is needed.
+Value *LoopVectorize::emitRuntimeChecks(BasicBlock *MemCheck,
+                                        SCEVExpander &Exp) {
+  LLVMContext &Context = MemCheck->getContext();
+  const Type *I8PtrTy = Type::getInt8PtrTy(Context);
+  Instruction *Loc = MemCheck->getTerminator();
+
+  SmallVector<Value*, 8> Starts, Ends;
+  for (unsigned i = 0, e = Ranges.size(); i != e; ++i) {
+    const SCEVAddRecExpr *AR = Ranges[i].AR;
+    const Type *IntPtrTy = SE->getEffectiveSCEVType(AR->getType());
+    const SCEV *Count = SE->getTruncateOrZeroExtend(BECount, IntPtrTy);
+    const SCEV *Last =
+      SE->getAddExpr(AR->getStart(),
+                     SE->getMulExpr(Count, AR->getStepRecurrence(*SE)));
+    const SCEV *End =
+      SE->getAddExpr(Last, SE->getConstant(IntPtrTy, Ranges[i].EltSize));
+    Starts.push_back(Exp.expandCodeFor(AR->getStart(), I8PtrTy, Loc));
+    Ends.push_back(Exp.expandCodeFor(End, I8PtrTy, Loc));
+  }
+
+  IRBuilder<> Builder(Loc);
+  Value *Conflict = 0;
+  for (unsigned i = 0, e = Ranges.size(); i != e; ++i)
+    for (unsigned j = i + 1; j != e; ++j) {
+      if (!Ranges[i].IsWritten && !Ranges[j].IsWritten)
+        continue;
+      Value *Cmp0 = Builder.CreateICmpULT(Starts[i], Ends[j], "bound0");
+      Value *Cmp1 = Builder.CreateICmpULT(Starts[j], Ends[i], "bound1");
+      Value *Overlap = Builder.CreateAnd(Cmp0, Cmp1, "found.conflict");
+      Conflict = Conflict ? Builder.CreateOr(Conflict, Overlap, "conflict.rdx")
+                          : Overlap;
+    }
+  return Conflict;
+}
+
+/// vectorizeBody - Emit the vector version of each instruction of the loop
+/// body into VecBody, in the original order so that loads and stores to the
+/// same address keep their order.
+void LoopVectorize::vectorizeBody(BasicBlock *VecBody, IRBuilder<> &Builder) {
+  BasicBlock *Header = CurLoop->getHeader();
+  for (BasicBlock::iterator It = Header->getFirstNonPHI(), E = Header->end();
+       It != E; ++It) {
+    Instruction *I = It;
+    if (I == LatchBr || I == LatchCmp || isa<GetElementPtrInst>(I) ||
+        isInductionUpdate(I))
+      continue;
+
+    if (BinaryOperator *BO = dyn_cast<BinaryOperator>(I)) {
+      Value *LHS = getVectorValue(BO->getOperand(0), Builder);
+      Value *RHS = getVectorValue(BO->getOperand(1), Builder);
+      WidenMap[I] = Builder.CreateBinOp(BO->getOpcode(), LHS, RHS);
+    } else if (CastInst *CI = dyn_cast<CastInst>(I)) {
+      Value *Op = getVectorValue(CI->getOperand(0), Builder);
+      WidenMap[I] = Builder.CreateCast(CI->getOpcode(), Op,
+                                       VectorType::get(CI->getType(), VF));
+    } else if (LoadInst *Load = dyn_cast<LoadInst>(I)) {
+      const Type *EltTy = Load->getType();
+      const Type *VecTy = VectorType::get(EltTy, VF);
+      Value *Ptr = getVectorPointer(Load->getPointerOperand(), VecTy, Builder);
+      LoadInst *VecLoad = Builder.CreateLoad(Ptr, "wide.load");
+      unsigned Align = Load->getAlignment();
+      VecLoad->setAlignment(Align ? Align : TD->getABITypeAlignment(EltTy));
+      WidenMap[I] = VecLoad;
+    } else {
+      StoreInst *Store = cast<StoreInst>(I);
+      Value *Val = getVectorValue(Store->getValueOperand(), Builder);
+      Value *Ptr = getVectorPointer(Store->getPointerOperand(),
+                                    Val->getType(), Builder);
+      StoreInst *VecStore = Builder.CreateStore(Val, Ptr);
+      unsigned Align = Store->getAlignment();
+      const Type *EltTy = Store->getValueOperand()->getType();
+      VecStore->setAlignment(Align ? Align : TD->getABITypeAlignment(EltTy));
+    }
+  }
+}
+
+/// vectorize - Emit the vector loop in front of the current loop and wire up
+/// the control flow shown at the top of this file.
+void LoopVectorize::vectorize(LPPassManager &LPM) {
+  BasicBlock *Header = CurLoop->getHeader();
+  BasicBlock *Preheader = CurLoop->getLoopPreheader();
+  BasicBlock *Exit = CurLoop->getExitBlock();
+  Loop *ParentLoop = CurLoop->getParentLoop();
+  Function *F = Header->getParent();
+  LLVMContext &Context = F->getContext();
+  const Type *IdxTy = BECount->getType();
+
+  // Split off the scalar preheader and the block joining both loops' exits.
+  // SplitBlock keeps LoopInfo and the DominatorTree up to date.
+  BasicBlock *ScalarPH = SplitBlock(Preheader, Preheader->getTerminator(), this);
+  ScalarPH->setName("scalar.ph");
+  BasicBlock *ExitMerge = SplitBlock(Exit, Exit->getFirstNonPHI(), this);
+  ExitMerge->setName("exit.merge");
+
+  bool NeedsChecks = false;
+  for (unsigned i = 0, e = Ranges.size(); i != e; ++i)
+    NeedsChecks |= Ranges[i].IsWritten;
+  NeedsChecks &= Ranges.size() > 1;
+
+  BasicBlock *MemCheck = 0;
+  if (NeedsChecks)
+    MemCheck = BasicBlock::Create(Context, "vector.memcheck", F, ScalarPH);
+  VecPH = BasicBlock::Create(Context, "vector.ph", F, ScalarPH);
+  BasicBlock *VecBody = BasicBlock::Create(Context, "vector.body", F, ScalarPH);
+  BasicBlock *Middle = BasicBlock::Create(Context, "middle.block", F, ScalarPH);
+
+  // Compute the number of iterations the vector loop covers, and skip it if
+  // that is zero.  If the trip count wraps to zero the scalar loop runs too.
+  SCEVExpander Exp(*SE);
+  TerminatorInst *OldTerm = Preheader->getTerminator();
+  Value *BEValue = Exp.expandCodeFor(BECount, IdxTy, OldTerm);
+  IRBuilder<> Builder(OldTerm);
+  Value *Count = Builder.CreateAdd(BEValue, ConstantInt::get(IdxTy, 1),
+                                   "trip.count");
+  Value *VecCount =
+    Builder.CreateAnd(Count, ConstantInt::get(IdxTy, ~uint64_t(VF - 1)),
+                      "n.vec");
+  Value *IsEmpty = Builder.CreateICmpEQ(VecCount,
+                                        Constant::getNullValue(IdxTy),
+                                        "cmp.zero");
+  BranchInst::Create(ScalarPH, MemCheck ? MemCheck : VecPH, IsEmpty,
+                     Preheader);
+  OldTerm->eraseFromParent();
+
+  if (MemCheck) {
+    BranchInst *Br = BranchInst::Create(ScalarPH, VecPH,
+                                        ConstantInt::getFalse(Context),
+                                        MemCheck);
+    Br->setCondition(emitRuntimeChecks(MemCheck, Exp));
+    ++NumRuntimeChecks;
+  }
+
+  // Base pointers for the consecutive accesses, and the reduction start
+  // vectors, live in the vector preheader.
+  BranchInst::Create(VecBody, VecPH);
+  for (unsigned i = 0, e = Accesses.size(); i != e; ++i) {
+    Value *&Base = BaseMap[Accesses[i].Ptr];
+    if (!Base)
+      Base = Exp.expandCodeFor(Accesses[i].AR->getStart(),
+                               Accesses[i].Ptr->getType(),
+                               VecPH->getTerminator());
+  }
+
+  Builder.SetInsertPoint(VecBody);
+  Index = Builder.CreatePHI(IdxTy, 2, "index");
+  Index->addIncoming(Constant::getNullValue(IdxTy), VecPH);
+
+  SmallVector<PHINode*, 4> VecRdxPhis;
+  for (unsigned i = 0, e = Reductions.size(); i != e; ++i) {
+    const Reduction &R = Reductions[i];
+    const Type *Ty = R.Phi->getType();
+    Constant *Identity;
+    switch (R.Update->getOpcode()) {
+    default: llvm_unreachable("Unexpected reduction kind!");
+    case Instruction::Add:
+    case Instruction::Or:
+    case Instruction::Xor:
+      Identity = Constant::getNullValue(Ty);
+      break;
+    case Instruction::Mul:
+      Identity = ConstantInt::get(Ty, 1);
+      break;
+    case Instruction::And:
+      Identity = Constant::getAllOnesValue(Ty);
+      break;
+    }
+
+    // <Start, Identity, ..., Identity>
+    SmallVector<Constant*, 8> Elts(VF, Identity);
+    IRBuilder<> PHBuilder(VecPH->getTerminator());
+    Value *StartVec =
+      PHBuilder.CreateInsertElement(ConstantVector::get(Elts), R.Start,
+                                    ConstantInt::get(Type::getInt32Ty(Context),
+                                                     0));
+    PHINode *VecPhi = Builder.CreatePHI(VectorType::get(Ty, VF), 2,
+                                        "vec.phi");
+    VecPhi->addIncoming(StartVec, VecPH);
+    WidenMap[R.Phi] = VecPhi;
+    VecRdxPhis.push_back(VecPhi);
+  }
+
+  vectorizeBody(VecBody, Builder);
+
+  for (unsigned i = 0, e = Reductions.size(); i != e; ++i)
+    VecRdxPhis[i]->addIncoming(WidenMap[Reductions[i].Update], VecBody);
+
+  Value *NextIndex = Builder.CreateAdd(Index, ConstantInt::get(IdxTy, VF),
+                                       "index.next");
+  Index->addIncoming(NextIndex, VecBody);
+  Builder.CreateCondBr(Builder.CreateICmpEQ(NextIndex, VecCount),
+                       Middle, VecBody);
+
+  // Fold each vector accumulator into a scalar, compute where the scalar
+  // loop resumes, and skip it if no iterations remain.
+  Builder.SetInsertPoint(Middle);
+  DenseMap<Value*, Value*> ResumeMap;
+  for (unsigned i = 0, e = Reductions.size(); i != e; ++i) {
+    const Reduction &R = Reductions[i];
+    Value *VecUpdate = WidenMap[R.Update];
+    PHINode *Exiting = Builder.CreatePHI(VecUpdate->getType(), 1,
+                                         "rdx.vec.exit");
+    Exiting->addIncoming(VecUpdate, VecBody);
+    Value *Rdx = 0;
+    for (unsigned Lane = 0; Lane != VF; ++Lane) {
+      Value *Elt =
+        Builder.CreateExtractElement(Exiting,
+                                     ConstantInt::get(Type::getInt32Ty(Context),
+                                                      Lane));
+      Rdx = Rdx ? Builder.CreateBinOp(R.Update->getOpcode(), Rdx, Elt) : Elt;
+    }
+    Rdx->setName("rdx");
+    ResumeMap[R.Phi] = Rdx;
+    ResumeMap[R.Update] = Rdx;
+  }
+  for (unsigned i = 0, e = Inductions.size(); i != e; ++i) {
+    const Induction &IV = Inductions[i];
+    const Type *Ty = IV.Phi->getType();
+    Value *Idx = Builder.CreateIntCast(VecCount, Ty, false);
+    ResumeMap[IV.Phi] = Builder.CreateAdd(IV.Start,
+                                          Builder.CreateMul(Idx, IV.Step),
+                                          "resume.val");
+  }
+  Builder.CreateCondBr(Builder.CreateICmpEQ(Count, VecCount, "cmp.n"),
+                       ExitMerge, ScalarPH);
+
+  // The scalar loop starts where the vector loop stopped, or from the
+  // beginning if the vector loop was skipped.
+  for (BasicBlock::iterator I = Header->begin(); isa<PHINode>(I); ++I) {
+    PHINode *PN = cast<PHINode>(I);
+    Value *Start = PN->getIncomingValueForBlock(ScalarPH);
+    PHINode *Resume = PHINode::Create(PN->getType(), 3, "resume",
+                                      ScalarPH->begin());
+    Resume->addIncoming(ResumeMap[PN], Middle);
+    Resume->addIncoming(Start, Preheader);
+    if (MemCheck)
+      Resume->addIncoming(Start, MemCheck);
+    PN->setIncomingValue(PN->getBasicBlockIndex(ScalarPH), Resume);
+  }
+
+  // Merge the values that leave the loop.
+  for (BasicBlock::iterator I = Exit->begin(); isa<PHINode>(I); ++I) {
+    PHINode *PN = cast<PHINode>(I);
+    PHINode *Merge = PHINode::Create(PN->getType(), 2, PN->getName() + ".merge",
+                                     ExitMerge->begin());
+    PN->replaceAllUsesWith(Merge);
+    Value *V = PN->getIncomingValueForBlock(Header);
+    Value *FromMiddle = ResumeMap.lookup(V);
+    Merge->addIncoming(PN, Exit);
+    Merge->addIncoming(FromMiddle ? FromMiddle : V, Middle);
+  }
+
+  // Update the dominator tree and the loop nest for the new blocks.
+  if (MemCheck)
+    DT->addNewBlock(MemCheck, Preheader);
+  DT->addNewBlock(VecPH, MemCheck ? MemCheck : Preheader);
+  DT->addNewBlock(VecBody, VecPH);
+  DT->addNewBlock(Middle, VecBody);
+  DT->changeImmediateDominator(ExitMerge,
+                               DT->findNearestCommonDominator(Exit, Middle));
+
+  Loop *VecLoop = new Loop();
+  LPM.insertLoop(VecLoop, ParentLoop);
+  VecLoop->addBasicBlockToLoop(VecBody, LI->getBase());
+  if (ParentLoop) {
+    if (MemCheck)
+      ParentLoop->addBasicBlockToLoop(MemCheck, LI->getBase());
+    ParentLoop->addBasicBlockToLoop(VecPH, LI->getBase());
+    ParentLoop->addBasicBlockToLoop(Middle, LI->getBase());
+  }
+
+  SE->forgetLoop(CurLoop);
+  DEBUG(dbgs() << "LV: Vectorized loop with width " << VF << "\n");
+}
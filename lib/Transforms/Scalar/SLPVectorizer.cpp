@@ -0,0 +1,636 @@
+//===- SLPVectorizer.cpp - Pack isomorphic scalar operations --------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass implements a simple superword-level parallelism vectorizer for
+// straight-line code.  It looks for runs of stores to consecutive addresses
+// in a basic block, e.g.:
+//
+//   p->x = a->x + b->x;
+//   p->y = a->y + b->y;
+//   p->z = a->z + b->z;
+//   p->w = a->w + b->w;
+//
+// and walks the expression trees feeding them bottom-up.  As long as the
+// operations in each lane are isomorphic (same opcode, same types), the
+// lanes are packed into a single vector operation; consecutive loads become
+// one vector load.  Values that cannot be packed are gathered into a vector
+// with insertelement, and scalars that are still needed outside the tree are
+// extracted again with extractelement.
+//
+// The tree is only rewritten if the cost of the scalar code exceeds the cost
+// of the vector code plus the pack/unpack overhead.  When a TargetLowering is
+// available, operations the target cannot perform on the vector type are
+// assumed to be scalarized.
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "slp-vectorizer"
+#include "llvm/Transforms/Scalar.h"
+#include "llvm/Constants.h"
+#include "llvm/DerivedTypes.h"
+#include "llvm/Function.h"
+#include "llvm/Instructions.h"
+#include "llvm/Pass.h"
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/Target/TargetData.h"
+#include "llvm/Target/TargetLowering.h"
+#include "llvm/Transforms/Utils/Local.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/IRBuilder.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include <algorithm>
+using namespace llvm;
+
+STATISTIC(NumTreesVectorized, "Number of store trees vectorized");
+STATISTIC(NumPackedScalars,   "Number of scalar instructions packed");
+
+static cl::opt<unsigned>
+VectorBits("slp-vector-bits", cl::init(128), cl::Hidden,
+           cl::desc("Width in bits of the vectors formed by the SLP "
+                    "vectorizer"));
+
+static cl::opt<int>
+CostThreshold("slp-threshold", cl::init(0), cl::Hidden,
+              cl::desc("Only vectorize a tree if it saves more than this "
+                       "many instructions"));
+
+/// MaxTreeDepth - Stop packing operands this far below the stores and gather
+/// them instead.
+static const unsigned MaxTreeDepth = 12;
+
+namespace {
+  /// TreeNode - One packed value of the tree: VF scalars, one per lane, that
+  /// are either replaced by a single vector instruction or gathered.
+  struct TreeNode {
+    SmallVector<Value*, 8> Scalars;
+    SmallVector<unsigned, 2> Operands;
+    bool NeedToGather;
+    Value *VectorValue;
+  };
+
+  class SLPVectorizer : public FunctionPass {
+    /// TLI - Keep a pointer of a TargetLowering to consult for the cost of
+    /// vector operations.
+    const TargetLowering *const TLI;
+    const TargetData *TD;
+    AliasAnalysis *AA;
+
+    /// Order - The position of each instruction of the current block.
+    DenseMap<Instruction*, unsigned> Order;
+
+    // The tree being built for the current group of stores.
+    SmallVector<TreeNode, 16> Tree;
+    DenseMap<Value*, unsigned> ScalarToNode;
+    SmallPtrSet<Value*, 16> GatheredScalars;
+    bool TreeFailed;
+  public:
+    static char ID;
+    explicit SLPVectorizer(const TargetLowering *tli = 0)
+      : FunctionPass(ID), TLI(tli) {
+      initializeSLPVectorizerPass(*PassRegistry::getPassRegistry());
+    }
+
+    bool runOnFunction(Function &F);
+
+    virtual void getAnalysisUsage(AnalysisUsage &AU) const {
+      AU.setPreservesCFG();
+      AU.addRequired<AliasAnalysis>();
+      AU.addPreserved<AliasAnalysis>();
+    }
+
+  private:
+    bool vectorizeBlock(BasicBlock &BB);
+    bool vectorizeStores(ArrayRef<StoreInst*> Stores);
+    void numberBlock(BasicBlock &BB);
+
+    unsigned newNode(ArrayRef<Value*> VL, bool NeedToGather);
+    unsigned buildTree(ArrayRef<Value*> VL, BasicBlock *BB, unsigned Depth);
+    bool isConsecutiveAccess(Value *A, Value *B);
+    bool canSinkMemoryAccesses(ArrayRef<StoreInst*> Stores, Instruction *Loc);
+    int getTreeCost(Instruction *Loc, bool &Legal);
+    int getVectorOpCost(unsigned Opcode, const Type *VecTy) const;
+    Value *vectorizeNode(unsigned Idx, IRBuilder<> &Builder);
+  };
+}
+
+char SLPVectorizer::ID = 0;
+INITIALIZE_PASS_BEGIN(SLPVectorizer, "slp-vectorizer",
+                      "Vectorize isomorphic straight-line code", false, false)
+INITIALIZE_AG_DEPENDENCY(AliasAnalysis)
+INITIALIZE_PASS_END(SLPVectorizer, "slp-vectorizer",
+                    "Vectorize isomorphic straight-line code", false, false)
+
+FunctionPass *llvm::createSLPVectorizerPass(const TargetLowering *TLI) {
+  return new SLPVectorizer(TLI);
+}
+
+/// isPackableType - Return true if Ty can be the element type of a vector
+/// formed by this pass.
+static bool isPackableType(const Type *Ty) {
+  if (Ty->isFloatTy() || Ty->isDoubleTy())
+    return true;
+  if (!Ty->isIntegerTy())
+    return false;
+  unsigned Bits = Ty->getPrimitiveSizeInBits();
+  return Bits == 8 || Bits == 16 || Bits == 32 || Bits == 64;
+}
+
+bool SLPVectorizer::runOnFunction(Function &F) {
+  TD = getAnalysisIfAvailable<TargetData>();
+  if (TD == 0) return false;
+  AA = &getAnalysis<AliasAnalysis>();
+
+  bool Changed = false;
+  for (Function::iterator BB = F.begin(), E = F.end(); BB != E; ++BB)
+    Changed |= vectorizeBlock(*BB);
+  return Changed;
+}
+
+void SLPVectorizer::numberBlock(BasicBlock &BB) {
+  Order.clear();
+  unsigned N = 0;
+  for (BasicBlock::iterator I = BB.begin(), E = BB.end(); I != E; ++I)
+    Order[I] = N++;
+}
+
+namespace {
+  /// StoreOffset - A store and the constant offset of its address from the
+  /// base pointer of its group, used to sort the stores by address.
+  struct StoreOffset {
+    int64_t Offset;
+    StoreInst *Store;
+    bool operator<(const StoreOffset &RHS) const {
+      return Offset < RHS.Offset;
+    }
+  };
+}
+
+/// vectorizeBlock - Group the stores in BB by base pointer and stored type,
+/// and try to vectorize each run of consecutive stores.
+bool SLPVectorizer::vectorizeBlock(BasicBlock &BB) {
+  typedef std::pair<Value*, const Type*> GroupKey;
+  DenseMap<GroupKey, unsigned> GroupIdx;
+  SmallVector<SmallVector<StoreOffset, 8>, 4> Groups;
+
+  for (BasicBlock::iterator I = BB.begin(), E = BB.end(); I != E; ++I) {
+    StoreInst *SI = dyn_cast<StoreInst>(I);
+    if (SI == 0 || SI->isVolatile())
+      continue;
+    const Type *Ty = SI->getValueOperand()->getType();
+    if (!isPackableType(Ty))
+      continue;
+    int64_t Offset = 0;
+    Value *Base = GetPointerBaseWithConstantOffset(SI->getPointerOperand(),
+                                                   Offset, *TD);
+    GroupKey Key(Base, Ty);
+    DenseMap<GroupKey, unsigned>::iterator It = GroupIdx.find(Key);
+    if (It == GroupIdx.end()) {
+      It = GroupIdx.insert(std::make_pair(Key, Groups.size())).first;
+      Groups.resize(Groups.size() + 1);
+    }
+    StoreOffset SO = { Offset, SI };
+    Groups[It->second].push_back(SO);
+  }
+
+  bool Changed = false;
+  for (unsigned g = 0, ge = Groups.size(); g != ge; ++g) {
+    SmallVector<StoreOffset, 8> &Group = Groups[g];
+    if (Group.size() < 2)
+      continue;
+    std::stable_sort(Group.begin(), Group.end());
+
+    const Type *Ty = Group[0].Store->getValueOperand()->getType();
+    int64_t EltSize = TD->getTypeStoreSize(Ty);
+    unsigned VF = VectorBits / Ty->getPrimitiveSizeInBits();
+    if (VF < 2 || TD->getTypeAllocSize(Ty) != uint64_t(EltSize))
+      continue;
+
+    // Slide a window of VF stores over the sorted group; every store in a
+    // window must follow the previous one directly in memory.
+    for (unsigned i = 0, e = Group.size(); i + VF <= e; ) {
+      bool Consecutive = true;
+      for (unsigned j = 1; j != VF && Consecutive; ++j)
+        Consecutive = Group[i+j].Offset == Group[i+j-1].Offset + EltSize;
+      if (!Consecutive) {
+        ++i;
+        continue;
+      }
+
+      SmallVector<StoreInst*, 8> Stores;
+      for (unsigned j = 0; j != VF; ++j)
+        Stores.push_back(Group[i+j].Store);
+      if (vectorizeStores(Stores)) {
+        Changed = true;
+        i += VF;
+      } else {
+        ++i;
+      }
+    }
+  }
+  return Changed;
+}
+
+unsigned SLPVectorizer::newNode(ArrayRef<Value*> VL, bool NeedToGather) {
+  unsigned Idx = Tree.size();
+  Tree.resize(Idx + 1);
+  TreeNode &N = Tree.back();
+  N.Scalars.append(VL.begin(), VL.end());
+  N.NeedToGather = NeedToGather;
+  N.VectorValue = 0;
+  // A scalar which is both gathered and packed would be inserted into the
+  // gathered vector before it is extracted from the packed one, if the gather
+  // is emitted first.  Give up on such trees.
+  for (unsigned i = 0, e = VL.size(); i != e; ++i) {
+    if (NeedToGather) {
+      if (!isa<Instruction>(VL[i]))
+        continue;
+      if (ScalarToNode.count(VL[i]))
+        TreeFailed = true;
+      GatheredScalars.insert(VL[i]);
+    } else {
+      if (GatheredScalars.count(VL[i]))
+        TreeFailed = true;
+      ScalarToNode[VL[i]] = Idx;
+    }
+  }
+  return Idx;
+}
+
+/// isConsecutiveAccess - Return true if the load or store B accesses the
+/// element right after the one accessed by A.
+bool SLPVectorizer::isConsecutiveAccess(Value *A, Value *B) {
+  Value *PtrA = isa<LoadInst>(A) ? cast<LoadInst>(A)->getPointerOperand()
+                                 : cast<StoreInst>(A)->getPointerOperand();
+  Value *PtrB = isa<LoadInst>(B) ? cast<LoadInst>(B)->getPointerOperand()
+                                 : cast<StoreInst>(B)->getPointerOperand();
+  int64_t OffA = 0, OffB = 0;
+  Value *BaseA = GetPointerBaseWithConstantOffset(PtrA, OffA, *TD);
+  Value *BaseB = GetPointerBaseWithConstantOffset(PtrB, OffB, *TD);
+  const Type *Ty = cast<PointerType>(PtrA->getType())->getElementType();
+  return BaseA == BaseB &&
+         OffB - OffA == int64_t(TD->getTypeStoreSize(Ty));
+}
+
+/// buildTree - Add a node for the lanes in VL, and for its operands as long
+/// as they can be packed.  Return the index of the node.
+unsigned SLPVectorizer::buildTree(ArrayRef<Value*> VL, BasicBlock *BB,
+                                  unsigned Depth) {
+  if (Depth > MaxTreeDepth)
+    return newNode(VL, true);
+
+  // A scalar can only live in one lane of one node.
+  for (unsigned i = 0, e = VL.size(); i != e; ++i) {
+    if (ScalarToNode.count(VL[i]))
+      TreeFailed = true;
+    for (unsigned j = 0; j != i; ++j)
+      if (VL[i] == VL[j])
+        return newNode(VL, true);
+  }
+  if (TreeFailed)
+    return newNode(VL, true);
+
+  Instruction *I0 = dyn_cast<Instruction>(VL[0]);
+  if (I0 == 0 || I0->getParent() != BB || !isPackableType(I0->getType()))
+    return newNode(VL, true);
+  for (unsigned i = 1, e = VL.size(); i != e; ++i) {
+    Instruction *I = dyn_cast<Instruction>(VL[i]);
+    if (I == 0 || I->getParent() != BB || I->getOpcode() != I0->getOpcode() ||
+        I->getType() != I0->getType())
+      return newNode(VL, true);
+  }
+
+  switch (I0->getOpcode()) {
+  default:
+    return newNode(VL, true);
+
+  case Instruction::Load: {
+    for (unsigned i = 0, e = VL.size(); i != e; ++i)
+      if (cast<LoadInst>(VL[i])->isVolatile() ||
+          (i && !isConsecutiveAccess(VL[i-1], VL[i])))
+        return newNode(VL, true);
+    return newNode(VL, false);
+  }
+
+  case Instruction::Trunc:   case Instruction::ZExt:
+  case Instruction::SExt:    case Instruction::FPTrunc:
+  case Instruction::FPExt:   case Instruction::FPToUI:
+  case Instruction::FPToSI:  case Instruction::UIToFP:
+  case Instruction::SIToFP: {
+    const Type *SrcTy = I0->getOperand(0)->getType();
+    if (!isPackableType(SrcTy))
+      return newNode(VL, true);
+    SmallVector<Value*, 8> Ops;
+    for (unsigned i = 0, e = VL.size(); i != e; ++i) {
+      if (cast<Instruction>(VL[i])->getOperand(0)->getType() != SrcTy)
+        return newNode(VL, true);
+      Ops.push_back(cast<Instruction>(VL[i])->getOperand(0));
+    }
+    unsigned Idx = newNode(VL, false);
+    unsigned Op = buildTree(Ops, BB, Depth + 1);
+    Tree[Idx].Operands.push_back(Op);
+    return Idx;
+  }
+
+  case Instruction::Add:  case Instruction::FAdd:
+  case Instruction::Sub:  case Instruction::FSub:
+  case Instruction::Mul:  case Instruction::FMul:
+  case Instruction::UDiv: case Instruction::SDiv:
+  case Instruction::FDiv: case Instruction::URem:
+  case Instruction::SRem: case Instruction::FRem:
+  case Instruction::Shl:  case Instruction::LShr:
+  case Instruction::AShr: case Instruction::And:
+  case Instruction::Or:   case Instruction::Xor: {
+    unsigned Idx = newNode(VL, false);
+    for (unsigned OpNo = 0; OpNo != 2; ++OpNo) {
+      SmallVector<Value*, 8> Ops;
+      for (unsigned i = 0, e = VL.size(); i != e; ++i)
+        Ops.push_back(cast<Instruction>(VL[i])->getOperand(OpNo));
+      unsigned Op = buildTree(Ops, BB, Depth + 1);
+      Tree[Idx].Operands.push_back(Op);
+    }
+    return Idx;
+  }
+  }
+}
+
+/// canSinkMemoryAccesses - The packed loads and stores are all emitted at
+/// Loc, the last of the stores.  Check that no other memory access between
+/// their original position and Loc depends on them.
+bool SLPVectorizer::canSinkMemoryAccesses(ArrayRef<StoreInst*> Stores,
+                                          Instruction *Loc) {
+  for (unsigned n = 0, ne = Tree.size(); n != ne; ++n) {
+    if (Tree[n].NeedToGather ||
+        !isa<LoadInst>(Tree[n].Scalars[0]))
+      continue;
+    for (unsigned i = 0, e = Tree[n].Scalars.size(); i != e; ++i) {
+      LoadInst *Load = cast<LoadInst>(Tree[n].Scalars[i]);
+      AliasAnalysis::Location LoadLoc = AA->getLocation(Load);
+      for (BasicBlock::iterator It = Load; &*It != Loc; ++It)
+        if (It->mayWriteToMemory() &&
+            (AA->getModRefInfo(It, LoadLoc) & AliasAnalysis::Mod))
+          return false;
+      if (AA->getModRefInfo(Loc, LoadLoc) & AliasAnalysis::Mod)
+        return false;
+    }
+  }
+
+  for (unsigned i = 0, e = Stores.size(); i != e; ++i) {
+    AliasAnalysis::Location StoreLoc = AA->getLocation(Stores[i]);
+    BasicBlock::iterator It = Stores[i];
+    for (++It; Stores[i] != Loc && &*It != Loc; ++It) {
+      if (!(It->mayReadFromMemory() || It->mayWriteToMemory()) ||
+          std::find(Stores.begin(), Stores.end(), &*It) != Stores.end())
+        continue;
+      if (AA->getModRefInfo(It, StoreLoc) != AliasAnalysis::NoModRef)
+        return false;
+    }
+  }
+  return true;
+}
+
+/// getVectorOpCost - Return the cost of performing Opcode on VecTy, as the
+/// number of instructions the target is expected to need.
+int SLPVectorizer::getVectorOpCost(unsigned Opcode, const Type *VecTy) const {
+  const VectorType *VTy = cast<VectorType>(VecTy);
+  // A scalarized operation extracts its operands, performs the scalar
+  // operation and inserts the result, for every lane.
+  int Scalarized = 3 * VTy->getNumElements();
+
+  if (TLI == 0) {
+    // Without a target, assume vectors of the requested width are legal but
+    // that integer division is not.
+    switch (Opcode) {
+    case Instruction::UDiv: case Instruction::SDiv:
+    case Instruction::URem: case Instruction::SRem:
+      return Scalarized;
+    }
+    return VTy->getBitWidth() <= VectorBits ? 1 : Scalarized;
+  }
+
+  EVT VT = TLI->getValueType(VTy, true);
+  if (!VT.isSimple() || !TLI->isTypeLegal(VT))
+    return Scalarized;
+
+  unsigned ISDOpcode;
+  switch (Opcode) {
+  default: return 1;    // Loads, stores and casts of legal types.
+  case Instruction::Add:  ISDOpcode = ISD::ADD;  break;
+  case Instruction::FAdd: ISDOpcode = ISD::FADD; break;
+  case Instruction::Sub:  ISDOpcode = ISD::SUB;  break;
+  case Instruction::FSub: ISDOpcode = ISD::FSUB; break;
+  case Instruction::Mul:  ISDOpcode = ISD::MUL;  break;
+  case Instruction::FMul: ISDOpcode = ISD::FMUL; break;
+  case Instruction::UDiv: ISDOpcode = ISD::UDIV; break;
+  case Instruction::SDiv: ISDOpcode = ISD::SDIV; break;
+  case Instruction::FDiv: ISDOpcode = ISD::FDIV; break;
+  case Instruction::URem: ISDOpcode = ISD::UREM; break;
+  case Instruction::SRem: ISDOpcode = ISD::SREM; break;
+  case Instruction::FRem: ISDOpcode = ISD::FREM; break;
+  case Instruction::Shl:  ISDOpcode = ISD::SHL;  break;
+  case Instruction::LShr: ISDOpcode = ISD::SRL;  break;
+  case Instruction::AShr: ISDOpcode = ISD::SRA;  break;
+  case Instruction::And:  ISDOpcode = ISD::AND;  break;
+  case Instruction::Or:   ISDOpcode = ISD::OR;   break;
+  case Instruction::Xor:  ISDOpcode = ISD::XOR;  break;
+  }
+  return TLI->isOperationLegalOrCustom(ISDOpcode, VT) ? 1 : Scalarized;
+}
+
+/// getTreeCost - Return how many instructions vectorizing the tree saves
+/// (negative if it costs more), counting the insertelements needed to pack
+/// gathered lanes and the extractelements needed to unpack scalars used
+/// outside the tree.  Legal is cleared if some scalar is used before Loc,
+/// where it could not be extracted.
+int SLPVectorizer::getTreeCost(Instruction *Loc, bool &Legal) {
+  int ScalarCost = 0, VectorCost = 0;
+  Legal = true;
+  for (unsigned n = 0, ne = Tree.size(); n != ne; ++n) {
+    TreeNode &N = Tree[n];
+    unsigned VF = N.Scalars.size();
+    const Type *VecTy = VectorType::get(N.Scalars[0]->getType(), VF);
+
+    if (N.NeedToGather) {
+      bool AllConstant = true, Splat = true;
+      for (unsigned i = 0; i != VF; ++i) {
+        AllConstant &= isa<Constant>(N.Scalars[i]);
+        Splat &= N.Scalars[i] == N.Scalars[0];
+      }
+      // Constant vectors are free; a splat is an insert and a shuffle.
+      if (!AllConstant)
+        VectorCost += Splat ? 2 : VF;
+      continue;
+    }
+
+    Instruction *I0 = cast<Instruction>(N.Scalars[0]);
+    ScalarCost += VF;
+    VectorCost += getVectorOpCost(I0->getOpcode(), VecTy);
+
+    for (unsigned i = 0; i != VF; ++i) {
+      Instruction *I = cast<Instruction>(N.Scalars[i]);
+      bool Extract = false;
+      for (Value::use_iterator UI = I->use_begin(), E = I->use_end();
+           UI != E; ++UI) {
+        Instruction *User = cast<Instruction>(*UI);
+        if (ScalarToNode.count(User))
+          continue;
+        if (User->getParent() == Loc->getParent() &&
+            Order[User] <= Order[Loc])
+          Legal = false;
+        Extract = true;
+      }
+      if (Extract)
+        ++VectorCost;
+    }
+  }
+  return ScalarCost - VectorCost;
+}
+
+/// vectorizeNode - Emit the vector value for node Idx and its operands.
+Value *SLPVectorizer::vectorizeNode(unsigned Idx, IRBuilder<> &Builder) {
+  TreeNode &N = Tree[Idx];
+  if (N.VectorValue)
+    return N.VectorValue;
+
+  unsigned VF = N.Scalars.size();
+  const Type *EltTy = N.Scalars[0]->getType();
+  const Type *VecTy = VectorType::get(EltTy, VF);
+  const Type *I32Ty = Type::getInt32Ty(EltTy->getContext());
+
+  if (N.NeedToGather) {
+    bool AllConstant = true;
+    for (unsigned i = 0; i != VF; ++i)
+      AllConstant &= isa<Constant>(N.Scalars[i]);
+    if (AllConstant) {
+      SmallVector<Constant*, 8> Elts;
+      for (unsigned i = 0; i != VF; ++i)
+        Elts.push_back(cast<Constant>(N.Scalars[i]));
+      return N.VectorValue = ConstantVector::get(Elts);
+    }
+    bool Splat = true;
+    for (unsigned i = 1; i != VF; ++i)
+      Splat &= N.Scalars[i] == N.Scalars[0];
+    Value *Vec = UndefValue::get(VecTy);
+    if (Splat) {
+      Vec = Builder.CreateInsertElement(Vec, N.Scalars[0],
+                                        ConstantInt::get(I32Ty, 0));
+      Constant *Zeros = Constant::getNullValue(VectorType::get(I32Ty, VF));
+      return N.VectorValue = Builder.CreateShuffleVector(Vec,
+                                                         UndefValue::get(VecTy),
+                                                         Zeros);
+    }
+    for (unsigned i = 0; i != VF; ++i)
+      Vec = Builder.CreateInsertElement(Vec, N.Scalars[i],
+                                        ConstantInt::get(I32Ty, i));
+    return N.VectorValue = Vec;
+  }
+
+  Instruction *I0 = cast<Instruction>(N.Scalars[0]);
+  Value *V;
+  if (LoadInst *Load = dyn_cast<LoadInst>(I0)) {
+    unsigned AS = Load->getPointerAddressSpace();
+    Value *Ptr = Builder.CreateBitCast(Load->getPointerOperand(),
+                                       PointerType::get(VecTy, AS));
+    LoadInst *VecLoad = Builder.CreateLoad(Ptr);
+    unsigned Align = Load->getAlignment();
+    VecLoad->setAlignment(Align ? Align : TD->getABITypeAlignment(EltTy));
+    V = VecLoad;
+  } else if (CastInst *CI = dyn_cast<CastInst>(I0)) {
+    Value *Op = vectorizeNode(N.Operands[0], Builder);
+    V = Builder.CreateCast(CI->getOpcode(), Op, VecTy);
+  } else {
+    BinaryOperator *BO = cast<BinaryOperator>(I0);
+    Value *LHS = vectorizeNode(N.Operands[0], Builder);
+    Value *RHS = vectorizeNode(N.Operands[1], Builder);
+    V = Builder.CreateBinOp(BO->getOpcode(), LHS, RHS);
+  }
+  N.VectorValue = V;
+  NumPackedScalars += VF;
+
+  // Unpack the lanes still used outside the tree.  getTreeCost has checked
+  // that those users all come after the insertion point.
+  for (unsigned i = 0; i != VF; ++i) {
+    Instruction *I = cast<Instruction>(N.Scalars[i]);
+    SmallVector<Instruction*, 4> External;
+    for (Value::use_iterator UI = I->use_begin(), E = I->use_end();
+         UI != E; ++UI)
+      if (!ScalarToNode.count(*UI))
+        External.push_back(cast<Instruction>(*UI));
+    if (External.empty())
+      continue;
+    Value *Extract = Builder.CreateExtractElement(V,
+                                                  ConstantInt::get(I32Ty, i));
+    for (unsigned u = 0, ue = External.size(); u != ue; ++u)
+      External[u]->replaceUsesOfWith(I, Extract);
+  }
+  return V;
+}
+
+/// vectorizeStores - Try to replace the consecutive Stores, in address order,
+/// with one vector store of a packed expression tree.
+bool SLPVectorizer::vectorizeStores(ArrayRef<StoreInst*> Stores) {
+  BasicBlock *BB = Stores[0]->getParent();
+  numberBlock(*BB);
+
+  // Everything is emitted at the last of the stores.
+  StoreInst *Loc = Stores[0];
+  for (unsigned i = 1, e = Stores.size(); i != e; ++i)
+    if (Order[Stores[i]] > Order[Loc])
+      Loc = Stores[i];
+
+  Tree.clear();
+  ScalarToNode.clear();
+  GatheredScalars.clear();
+  TreeFailed = false;
+
+  // The stores themselves form the root; they are not in ScalarToNode since
+  // they have no value, so register them explicitly.
+  SmallVector<Value*, 8> Values;
+  for (unsigned i = 0, e = Stores.size(); i != e; ++i) {
+    Values.push_back(Stores[i]->getValueOperand());
+    ScalarToNode[Stores[i]] = ~0U;
+  }
+  unsigned Root = buildTree(Values, BB, 0);
+  if (TreeFailed || Tree[Root].NeedToGather)
+    return false;
+
+  bool Legal;
+  int Saved = getTreeCost(Loc, Legal);
+  // The vector store replaces VF scalar stores.
+  Saved += Stores.size() - getVectorOpCost(Instruction::Store,
+                                           VectorType::get(Values[0]->getType(),
+                                                           Stores.size()));
+  DEBUG(dbgs() << "SLP: Tree of " << Tree.size() << " nodes rooted at "
+               << *Stores[0] << " saves " << Saved << "\n");
+  if (!Legal || Saved <= CostThreshold || !canSinkMemoryAccesses(Stores, Loc))
+    return false;
+
+  IRBuilder<> Builder(Loc);
+  Value *Vec = vectorizeNode(Root, Builder);
+  StoreInst *First = Stores[0];
+  unsigned AS = First->getPointerAddressSpace();
+  Value *Ptr = Builder.CreateBitCast(First->getPointerOperand(),
+                                     PointerType::get(Vec->getType(), AS));
+  StoreInst *VecStore = Builder.CreateStore(Vec, Ptr);
+  unsigned Align = First->getAlignment();
+  VecStore->setAlignment(Align ? Align :
+                         TD->getABITypeAlignment(Values[0]->getType()));
+
+  for (unsigned i = 0, e = Stores.size(); i != e; ++i) {
+    Stores[i]->eraseFromParent();
+    RecursivelyDeleteTriviallyDeadInstructions(Values[i]);
+  }
+  ++NumTreesVectorized;
+  return true;
+}
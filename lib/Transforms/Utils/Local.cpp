@@ -256,15 +256,14 @@ bool llvm::RecursivelyDeleteTriviallyDeadInstructions(Value *V) {
     for (unsigned i = 0, e = I->getNumOperands(); i != e; ++i) {
       Value *OpV = I->getOperand(i);
       I->setOperand(i, 0);
-      
-      if (!OpV->use_empty()) continue;
-    
+
       // If the operand is an instruction that became dead as we nulled out the
       // operand, and if it is 'trivially' dead, delete it in a future loop
-      // iteration.
-      if (Instruction *OpI = dyn_cast<Instruction>(OpV))
-        if (isInstructionTriviallyDead(OpI))
-          DeadInsts.push_back(OpI);
+      // iteration.  Only look at the use lists of instructions: those of
+      // constants and globals may be changing on other threads.
+      Instruction *OpI = dyn_cast<Instruction>(OpV);
+      if (OpI && OpI->use_empty() && isInstructionTriviallyDead(OpI))
+        DeadInsts.push_back(OpI);
     }
     
     I->eraseFromParent();
@@ -418,9 +418,10 @@ Value *SimplifyCFGOpt::isValueEqualityComparison(TerminatorInst *TI) {
                                              pred_end(SI->getParent())) <= 128)
       CV = SI->getCondition();
   } else if (BranchInst *BI = dyn_cast<BranchInst>(TI))
-    if (BI->isConditional() && BI->getCondition()->hasOneUse())
+    if (BI->isConditional())
       if (ICmpInst *ICI = dyn_cast<ICmpInst>(BI->getCondition()))
-        if ((ICI->getPredicate() == ICmpInst::ICMP_EQ ||
+        if (ICI->hasOneUse() &&
+            (ICI->getPredicate() == ICmpInst::ICMP_EQ ||
              ICI->getPredicate() == ICmpInst::ICMP_NE) &&
             GetConstantInt(ICI->getOperand(1), TD))
           CV = ICI->getOperand(0);
@@ -1531,7 +1532,7 @@ bool llvm::FoldBranchToCommonDest(BranchInst *BI) {
     if (InvertPredCond) {
       Value *NewCond = PBI->getCondition();
       
-      if (NewCond->hasOneUse() && isa<CmpInst>(NewCond)) {
+      if (isa<CmpInst>(NewCond) && NewCond->hasOneUse()) {
         CmpInst *CI = cast<CmpInst>(NewCond);
         CI->setPredicate(CI->getInversePredicate());
       } else {
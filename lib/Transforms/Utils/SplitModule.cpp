@@ -0,0 +1,257 @@
+//===- SplitModule.cpp - Split a module into partitions -------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file splits a module into partitions.  Each function definition is
+// assigned to one partition, keeping callers and callees together where
+// possible, and every partition gets a copy of the module in which the
+// definitions owned by the others are reduced to declarations.  Local symbols
+// which are referenced across partitions are promoted to hidden globals.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/Utils/SplitModule.h"
+#include "llvm/Constants.h"
+#include "llvm/DerivedTypes.h"
+#include "llvm/GlobalAlias.h"
+#include "llvm/GlobalVariable.h"
+#include "llvm/Module.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/InstIterator.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include <vector>
+using namespace llvm;
+
+/// collectReferencedGlobals - Append to Globals the global values which the
+/// instructions of F refer to, directly or through constants such as a
+/// getelementptr or bitcast constant expression, in the order they are found.
+static void collectReferencedGlobals(Function *F,
+                                     SmallVectorImpl<GlobalValue*> &Globals) {
+  SmallPtrSet<Constant*, 32> Visited;
+  SmallVector<Constant*, 16> Worklist;
+  for (inst_iterator II = inst_begin(F), IE = inst_end(F); II != IE; ++II)
+    for (User::op_iterator OI = II->op_begin(), OE = II->op_end();
+         OI != OE; ++OI) {
+      Constant *C = dyn_cast<Constant>(*OI);
+      if (!C || !Visited.insert(C))
+        continue;
+      Worklist.push_back(C);
+      while (!Worklist.empty()) {
+        C = Worklist.pop_back_val();
+        if (GlobalValue *GV = dyn_cast<GlobalValue>(C)) {
+          Globals.push_back(GV);
+          continue;
+        }
+        for (User::op_iterator CI = C->op_begin(), CE = C->op_end();
+             CI != CE; ++CI)
+          if (Constant *Op = dyn_cast<Constant>(*CI))
+            if (Visited.insert(Op))
+              Worklist.push_back(Op);
+      }
+    }
+}
+
+/// orderByCallGraph - Append the function definitions in M to Order so that
+/// each function tends to be followed by the functions it refers to.
+static void orderByCallGraph(Module &M, std::vector<Function*> &Order) {
+  SmallPtrSet<Function*, 64> Visited;
+  SmallVector<Function*, 16> Worklist;
+  for (Module::iterator I = M.begin(), E = M.end(); I != E; ++I) {
+    if (I->isDeclaration() || !Visited.insert(I))
+      continue;
+    Worklist.push_back(I);
+    while (!Worklist.empty()) {
+      Function *F = Worklist.pop_back_val();
+      Order.push_back(F);
+      SmallVector<GlobalValue*, 16> Globals;
+      collectReferencedGlobals(F, Globals);
+      for (unsigned i = 0, e = Globals.size(); i != e; ++i)
+        if (Function *Callee = dyn_cast<Function>(Globals[i]))
+          if (!Callee->isDeclaration() && Visited.insert(Callee))
+            Worklist.push_back(Callee);
+    }
+  }
+}
+
+bool llvm::AssignModulePartitions(Module &M, unsigned NumPartitions,
+                                  ModulePartitionMap &Owner) {
+  std::vector<Function*> Order;
+  orderByCallGraph(M, Order);
+
+  std::vector<unsigned> Sizes;
+  size_t TotalSize = 0;
+  for (unsigned i = 0, e = Order.size(); i != e; ++i) {
+    unsigned Size = 0;
+    for (Function::iterator BB = Order[i]->begin(), E = Order[i]->end();
+         BB != E; ++BB) {
+      // A blockaddress can't refer to a function in another module.
+      if (BB->hasAddressTaken())
+        return false;
+      Size += BB->size();
+    }
+    Sizes.push_back(Size);
+    TotalSize += Size;
+  }
+
+  // Cut the call graph order into runs of about the same size.  Global
+  // variables go with the first function which refers to them, even if only
+  // through a constant expression.
+  size_t SizeSoFar = 0;
+  for (unsigned i = 0, e = Order.size(); i != e; ++i) {
+    unsigned Part = unsigned(SizeSoFar * NumPartitions / (TotalSize + 1));
+    Owner[Order[i]] = Part;
+    SizeSoFar += Sizes[i];
+
+    SmallVector<GlobalValue*, 16> Globals;
+    collectReferencedGlobals(Order[i], Globals);
+    for (unsigned j = 0, je = Globals.size(); j != je; ++j)
+      if (GlobalVariable *GV = dyn_cast<GlobalVariable>(Globals[j]))
+        if (!GV->isDeclaration())
+          Owner.insert(std::make_pair(GV, Part));
+  }
+
+  // Everything else lives in the first partition.  Appending globals such as
+  // llvm.global_ctors must only be emitted once, and aliases must be in the
+  // same module as their aliasees.
+  for (Module::global_iterator I = M.global_begin(), E = M.global_end();
+       I != E; ++I) {
+    if (I->isDeclaration())
+      continue;
+    if (I->hasAppendingLinkage())
+      Owner[I] = 0;
+    else
+      Owner.insert(std::make_pair(I, 0U));
+  }
+  for (Module::alias_iterator I = M.alias_begin(), E = M.alias_end();
+       I != E; ++I) {
+    Owner[I] = 0;
+    if (const GlobalValue *Aliasee = I->getAliasedGlobal())
+      Owner[Aliasee] = 0;
+  }
+  return true;
+}
+
+/// isUsedOutsidePartition - Return true if V is used by code or data which
+/// belongs to a partition other than Part.
+static bool isUsedOutsidePartition(const Value *V, unsigned Part,
+                                   const ModulePartitionMap &Owner,
+                                   SmallPtrSet<const Value*, 16> &Visited) {
+  for (Value::const_use_iterator UI = V->use_begin(), UE = V->use_end();
+       UI != UE; ++UI) {
+    const User *U = *UI;
+    if (const Instruction *I = dyn_cast<Instruction>(U)) {
+      if (Owner.lookup(I->getParent()->getParent()) != Part)
+        return true;
+    } else if (const GlobalValue *GV = dyn_cast<GlobalValue>(U)) {
+      if (Owner.lookup(GV) != Part)
+        return true;
+    } else if (isa<Constant>(U) && Visited.insert(U)) {
+      if (isUsedOutsidePartition(U, Part, Owner, Visited))
+        return true;
+    }
+  }
+  return false;
+}
+
+/// promoteLocal - Make a local symbol visible to the other partitions, under
+/// a name which won't collide with anything else in the link.
+static void promoteLocal(GlobalValue *GV) {
+  if (GV->hasName())
+    GV->setName(GV->getName().str() + ".lto_priv");
+  else
+    GV->setName("__lto_priv");
+  GV->setLinkage(GlobalValue::ExternalLinkage);
+  GV->setVisibility(GlobalValue::HiddenVisibility);
+}
+
+void llvm::PromoteCrossPartitionLocals(Module &M,
+                                       const ModulePartitionMap &Owner) {
+  std::vector<GlobalValue*> Locals;
+  for (Module::iterator I = M.begin(), E = M.end(); I != E; ++I)
+    if (I->hasLocalLinkage() && !I->isDeclaration())
+      Locals.push_back(I);
+  for (Module::global_iterator I = M.global_begin(), E = M.global_end();
+       I != E; ++I)
+    if (I->hasLocalLinkage() && !I->isDeclaration())
+      Locals.push_back(I);
+  for (Module::alias_iterator I = M.alias_begin(), E = M.alias_end();
+       I != E; ++I)
+    if (I->hasLocalLinkage())
+      Locals.push_back(I);
+
+  for (unsigned i = 0, e = Locals.size(); i != e; ++i) {
+    SmallPtrSet<const Value*, 16> Visited;
+    if (isUsedOutsidePartition(Locals[i], Owner.lookup(Locals[i]), Owner,
+                               Visited))
+      promoteLocal(Locals[i]);
+  }
+}
+
+Module *llvm::ExtractModulePartition(const Module &M, unsigned Part,
+                                     const ModulePartitionMap &Owner) {
+  ValueToValueMapTy VMap;
+  Module *Clone = CloneModule(&M, VMap);
+
+  // Locals owned elsewhere are only referenced from other partitions, so they
+  // can be deleted once their bodies and initializers are gone.
+  std::vector<GlobalValue*> Dead;
+
+  for (Module::const_iterator I = M.begin(), E = M.end(); I != E; ++I) {
+    if (I->isDeclaration() || Owner.lookup(I) == Part)
+      continue;
+    Function *F = cast<Function>(VMap[I]);
+    if (F->hasLocalLinkage())
+      Dead.push_back(F);
+    F->deleteBody();
+  }
+
+  for (Module::const_global_iterator I = M.global_begin(),
+       E = M.global_end(); I != E; ++I) {
+    if (I->isDeclaration() || Owner.lookup(I) == Part)
+      continue;
+    GlobalVariable *GV = cast<GlobalVariable>(VMap[I]);
+    if (GV->hasLocalLinkage() || GV->hasAppendingLinkage())
+      Dead.push_back(GV);
+    GV->setInitializer(0);
+    GV->setLinkage(GlobalValue::ExternalLinkage);
+  }
+
+  // Aliases can't refer to declarations, so replace those owned elsewhere
+  // with a declaration of the same symbol.
+  for (Module::const_alias_iterator I = M.alias_begin(), E = M.alias_end();
+       I != E; ++I) {
+    if (Owner.lookup(I) == Part)
+      continue;
+    GlobalAlias *GA = cast<GlobalAlias>(VMap[I]);
+    const Type *Ty = GA->getType()->getElementType();
+    GlobalValue *Decl;
+    if (const FunctionType *FTy = dyn_cast<FunctionType>(Ty))
+      Decl = Function::Create(FTy, GlobalValue::ExternalLinkage, "", Clone);
+    else
+      Decl = new GlobalVariable(*Clone, Ty, false,
+                                GlobalValue::ExternalLinkage, 0, "");
+    Decl->takeName(GA);
+    Decl->setVisibility(GA->getVisibility());
+    GA->replaceAllUsesWith(ConstantExpr::getBitCast(Decl, GA->getType()));
+    if (GA->hasLocalLinkage())
+      Dead.push_back(Decl);
+    GA->eraseFromParent();
+  }
+
+  for (unsigned i = 0, e = Dead.size(); i != e; ++i) {
+    Dead[i]->removeDeadConstantUsers();
+    if (Dead[i]->use_empty())
+      Dead[i]->eraseFromParent();
+  }
+
+  // Module level inline asm may define symbols, so emit it only once.
+  if (Part != 0)
+    Clone->setModuleInlineAsm("");
+  return Clone;
+}
@@ -377,6 +377,7 @@ ConstantInt *ConstantInt::get(LLVMContext &Context, const APInt &V) {
   const IntegerType *ITy = IntegerType::get(Context, V.getBitWidth());
   // get an existing value or the insertion position
   DenseMapAPIntKeyInfo::KeyTy Key(V, ITy);
+  sys::SmartScopedLock<true> Guard(Context.pImpl->Lock);
   ConstantInt *&Slot = Context.pImpl->IntConstants[Key]; 
   if (!Slot) Slot = new ConstantInt(ITy, V);
   return Slot;
@@ -506,6 +507,7 @@ ConstantFP* ConstantFP::get(LLVMContext &Context, const APFloat& V) {
   DenseMapAPFloatKeyInfo::KeyTy Key(V);
   
   LLVMContextImpl* pImpl = Context.pImpl;
+  sys::SmartScopedLock<true> Guard(pImpl->Lock);
   
   ConstantFP *&Slot = pImpl->FPConstants[Key];
     
@@ -1124,6 +1126,7 @@ BlockAddress *BlockAddress::get(BasicBlock *BB) {
 }
 
 BlockAddress *BlockAddress::get(Function *F, BasicBlock *BB) {
+  sys::SmartScopedLock<true> Guard(F->getContext().pImpl->Lock);
   BlockAddress *&BA =
     F->getContext().pImpl->BlockAddresses[std::make_pair(F, BB)];
   if (BA == 0)
@@ -1145,8 +1148,9 @@ BlockAddress::BlockAddress(Function *F, BasicBlock *BB)
 // destroyConstant - Remove the constant from the constant table.
 //
 void BlockAddress::destroyConstant() {
-  getFunction()->getRawType()->getContext().pImpl
-    ->BlockAddresses.erase(std::make_pair(getFunction(), getBasicBlock()));
+  LLVMContextImpl *pImpl = getFunction()->getRawType()->getContext().pImpl;
+  sys::SmartScopedLock<true> Guard(pImpl->Lock);
+  pImpl->BlockAddresses.erase(std::make_pair(getFunction(), getBasicBlock()));
   getBasicBlock()->AdjustBlockAddressRefCount(-1);
   destroyConstantImpl();
 }
@@ -20,6 +20,7 @@
 #include "llvm/Operator.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/Mutex.h"
 #include "llvm/Support/raw_ostream.h"
 #include <map>
 
@@ -676,6 +677,7 @@ public:
   /// getOrCreate - Return the specified constant from the map, creating it if
   /// necessary.
   ConstantClass *getOrCreate(const TypeClass *Ty, const ValType &V) {
+    sys::SmartScopedLock<true> Guard(Ty->getContext().pImpl->Lock);
     MapKey Lookup(Ty, V);
     ConstantClass* Result = 0;
     
@@ -730,6 +732,8 @@ public:
   }
 
   void remove(ConstantClass *CP) {
+    sys::SmartScopedLock<true>
+      Guard(CP->getRawType()->getContext().pImpl->Lock);
     typename MapTy::iterator I = FindExistingElement(CP);
     assert(I != Map.end() && "Constant not found in constant table!");
     assert(I->second == CP && "Didn't find correct element?");
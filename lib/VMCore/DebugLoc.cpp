@@ -19,6 +19,8 @@ using namespace llvm;
 MDNode *DebugLoc::getScope(const LLVMContext &Ctx) const {
   if (ScopeIdx == 0) return 0;
   
+  sys::SmartScopedLock<true> Guard(Ctx.pImpl->Lock);
+
   if (ScopeIdx > 0) {
     // Positive ScopeIdx is an index into ScopeRecords, which has no inlined-at
     // position specified.
@@ -38,6 +40,7 @@ MDNode *DebugLoc::getInlinedAt(const LLVMContext &Ctx) const {
   // position specified.  Zero is invalid.
   if (ScopeIdx >= 0) return 0;
   
+  sys::SmartScopedLock<true> Guard(Ctx.pImpl->Lock);
   // Otherwise, the index is in the ScopeInlinedAtRecords array.
   assert(unsigned(-ScopeIdx) <= Ctx.pImpl->ScopeInlinedAtRecords.size() &&
          "Invalid ScopeIdx");
@@ -52,6 +55,8 @@ void DebugLoc::getScopeAndInlinedAt(MDNode *&Scope, MDNode *&IA,
     return;
   }
   
+  sys::SmartScopedLock<true> Guard(Ctx.pImpl->Lock);
+
   if (ScopeIdx > 0) {
     // Positive ScopeIdx is an index into ScopeRecords, which has no inlined-at
     // position specified.
@@ -83,7 +88,8 @@ DebugLoc DebugLoc::get(unsigned Line, unsigned Col,
   Result.LineCol = Line | (Col << 24);
   
   LLVMContext &Ctx = Scope->getContext();
-  
+  sys::SmartScopedLock<true> Guard(Ctx.pImpl->Lock);
+
   // If there is no inlined-at location, use the ScopeRecords array.
   if (InlinedAt == 0)
     Result.ScopeIdx = Ctx.pImpl->getOrAddScopeRecordIdxEntry(Scope, 0);
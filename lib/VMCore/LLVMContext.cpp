@@ -128,6 +128,7 @@ unsigned LLVMContext::getMDKindID(StringRef Name) const {
   assert(isValidName(Name) && "Invalid MDNode name");
 
   // If this is new, assign it its ID.
+  sys::SmartScopedLock<true> Guard(pImpl->Lock);
   return
     pImpl->CustomMDKindNames.GetOrCreateValue(
       Name, pImpl->CustomMDKindNames.size()).second;
@@ -136,6 +137,7 @@ unsigned LLVMContext::getMDKindID(StringRef Name) const {
 /// getHandlerNames - Populate client supplied smallvector using custome
 /// metadata name and ID.
 void LLVMContext::getMDKindNames(SmallVectorImpl<StringRef> &Names) const {
+  sys::SmartScopedLock<true> Guard(pImpl->Lock);
   Names.resize(pImpl->CustomMDKindNames.size());
   for (StringMap<unsigned>::const_iterator I = pImpl->CustomMDKindNames.begin(),
        E = pImpl->CustomMDKindNames.end(); I != E; ++I)
@@ -30,6 +30,7 @@
 #include "llvm/ADT/FoldingSet.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Mutex.h"
 #include <vector>
 
 namespace llvm {
@@ -121,6 +122,17 @@ public:
   
   LLVMContext::InlineAsmDiagHandlerTy InlineAsmDiagHandler;
   void *InlineAsmDiagContext;
+
+  /// Lock - Guards the uniquing tables, the value handle lists and the
+  /// metadata maps below, so that function passes may run on several
+  /// functions at once (see -parallel-function-passes).  It is recursive and
+  /// only taken once llvm_start_multithreaded() has been called.
+  sys::SmartMutex<true> Lock;
+
+  /// UseListLock - Guards the use lists of constants, globals and metadata,
+  /// which instructions in different functions may share.  No other lock is
+  /// ever acquired while it is held.
+  sys::SmartMutex<true> UseListLock;
   
   typedef DenseMap<DenseMapAPIntKeyInfo::KeyTy, ConstantInt*, 
                          DenseMapAPIntKeyInfo> IntMapTy;
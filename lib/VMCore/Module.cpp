@@ -21,6 +21,7 @@
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/Support/LeakDetector.h"
+#include "LLVMContextImpl.h"
 #include "SymbolTableListTraitsImpl.h"
 #include "llvm/TypeSymbolTable.h"
 #include <algorithm>
@@ -124,6 +125,7 @@ Module::PointerSize Module::getPointerSize() const {
 /// the specified name, of arbitrary type.  This method returns null
 /// if a global with the specified name is not found.
 GlobalValue *Module::getNamedValue(StringRef Name) const {
+  sys::SmartScopedLock<true> Guard(Context.pImpl->Lock);
   return cast_or_null<GlobalValue>(getValueSymbolTable().lookup(Name));
 }
 
@@ -153,6 +155,7 @@ void Module::getMDKindNames(SmallVectorImpl<StringRef> &Result) const {
 Constant *Module::getOrInsertFunction(StringRef Name,
                                       const FunctionType *Ty,
                                       AttrListPtr AttributeList) {
+  sys::SmartScopedLock<true> Guard(Context.pImpl->Lock);
   // See if we have a definition for the specified function already.
   GlobalValue *F = getNamedValue(Name);
   if (F == 0) {
@@ -186,6 +189,7 @@ Constant *Module::getOrInsertFunction(StringRef Name,
 Constant *Module::getOrInsertTargetIntrinsic(StringRef Name,
                                              const FunctionType *Ty,
                                              AttrListPtr AttributeList) {
+  sys::SmartScopedLock<true> Guard(Context.pImpl->Lock);
   // See if we have a definition for the specified function already.
   GlobalValue *F = getNamedValue(Name);
   if (F == 0) {
@@ -282,6 +286,7 @@ GlobalVariable *Module::getGlobalVariable(StringRef Name,
 ///   3. Finally, if the existing global is the correct delclaration, return the
 ///      existing global.
 Constant *Module::getOrInsertGlobal(StringRef Name, const Type *Ty) {
+  sys::SmartScopedLock<true> Guard(Context.pImpl->Lock);
   // See if we have a definition for the specified global already.
   GlobalVariable *GV = dyn_cast_or_null<GlobalVariable>(getNamedValue(Name));
   if (GV == 0) {
@@ -22,10 +22,14 @@
 #include "llvm/Support/Timer.h"
 #include "llvm/Module.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/Format.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/PassNameParser.h"
+#include "llvm/Support/Process.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/Mutex.h"
+#include "llvm/Support/Atomic.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/ADT/StringMap.h"
 #include <algorithm>
 #include <cstdio>
@@ -500,9 +504,67 @@ public:
   }
 };
 
+//===----------------------------------------------------------------------===//
+/// PassReport Class - This class collects the pass runs measured by
+/// PassReportRegion and writes them out as JSON or CSV.  This only happens
+/// when -pass-report is given on the command line.
+///
+
+/// PassReportEntry - The runs of one pass over one unit of IR.  A pass that
+/// runs over the same unit several times, such as a loop pass over the loops
+/// of a function, gets a single entry that adds up the times and heap growth.
+struct PassReportEntry {
+  std::string PassName;
+  std::string PassArg;
+  const char *Kind;      // "module", "function" or "scc".
+  std::string Unit;
+  unsigned Runs;
+  TimeRecord Time;
+  int64_t HeapDelta;     // Net growth of the heap over all of the runs.
+  int64_t HeapPeak;      // Largest net growth over a single run.
+  unsigned SizeBefore;   // Instructions in the unit before the first run...
+  unsigned SizeAfter;    // ...and after the last one.
+};
+
+class PassReport {
+  std::vector<PassReportEntry> Entries;
+
+  // The entry for each pass and unit, for the runs since the report was last
+  // written.  Passes are only known to stay alive that long.
+  StringMap<unsigned> EntryMap;
+
+  // Whether anything was recorded since the report was last written.
+  bool Dirty;
+
+  sys::SmartMutex<true> Lock;
+
+  void writeJSON(raw_ostream &OS) const;
+  void writeCSV(raw_ostream &OS) const;
+public:
+  PassReport() : Dirty(false) {}
+
+  // Write the report one last time, in case the tool ran some passes after
+  // the pass managers last wrote it.
+  ~PassReport() { write(); }
+
+  // createThePassReport - This method initializes the ThePassReport pointer
+  // if -pass-report is given.  It may be called multiple times.
+  static void createThePassReport();
+
+  /// record - Add a run of pass P over Unit to the report.
+  void record(Pass *P, const char *Kind, StringRef Unit,
+              const TimeRecord &Time, int64_t Heap,
+              unsigned SizeBefore, unsigned SizeAfter);
+
+  /// write - Write the whole report to the -pass-report file, replacing what
+  /// was there, if anything changed since it was last written.
+  void write();
+};
+
 } // End of anon namespace
 
 static TimingInfo *TheTimeInfo;
+static PassReport *ThePassReport;
 
 //===----------------------------------------------------------------------===//
 // PMTopLevelManager implementation
@@ -1264,6 +1326,7 @@ bool BBPassManager::runOnFunction(Function &F) {
         // If the pass crashes, remember this.
         PassManagerPrettyStackEntry X(BP, *I);
         TimeRegion PassTimer(getPassTimer(BP));
+        PassReportRegion Report(BP, F);
 
         LocalChanged |= BP->runOnBasicBlock(*I);
       }
@@ -1395,6 +1458,92 @@ bool FunctionPassManager::doFinalization() {
   return FPM->doFinalization(*M);
 }
 
+//===----------------------------------------------------------------------===//
+// runFunctionPassesInParallel implementation
+//
+namespace {
+/// ParallelFunctionQueue - The function definitions of a module, handed out
+/// one at a time to the threads of runFunctionPassesInParallel.
+struct ParallelFunctionQueue {
+  std::vector<Function*> Functions;
+  volatile sys::cas_flag Next;
+};
+
+/// ParallelFunctionWorker - The pass manager of one of those threads.
+struct ParallelFunctionWorker {
+  ParallelFunctionQueue *Queue;
+  FunctionPassManager *FPM;
+  bool Changed;
+};
+}
+
+/// RunParallelFunctionWorker - Run the pipeline of a ParallelFunctionWorker
+/// over functions from its queue until none are left.
+static void RunParallelFunctionWorker(void *Arg) {
+  ParallelFunctionWorker &W = *static_cast<ParallelFunctionWorker*>(Arg);
+  ParallelFunctionQueue &Q = *W.Queue;
+  while (true) {
+    size_t Idx = size_t(sys::AtomicIncrement(&Q.Next)) - 1;
+    if (Idx >= Q.Functions.size())
+      break;
+    W.Changed |= W.FPM->run(*Q.Functions[Idx]);
+  }
+}
+
+bool llvm::runFunctionPassesInParallel(Module &M, unsigned NumThreads,
+                                       void (*Populate)(FunctionPassManager &,
+                                                        void *),
+                                       void *Data) {
+  // The bitcode reader is not thread safe, so read in every body up front.
+  std::string ErrInfo;
+  if (M.MaterializeAll(&ErrInfo))
+    report_fatal_error("Error reading bitcode file: " + Twine(ErrInfo));
+
+  ParallelFunctionQueue Queue;
+  Queue.Next = 0;
+  for (Module::iterator I = M.begin(), E = M.end(); I != E; ++I)
+    if (!I->isDeclaration())
+      Queue.Functions.push_back(I);
+
+  if (NumThreads > Queue.Functions.size())
+    NumThreads = Queue.Functions.size();
+  if (NumThreads > 1 && !llvm_is_multithreaded() &&
+      !llvm_start_multithreaded())
+    NumThreads = 1;
+  if (NumThreads == 0)
+    NumThreads = 1;
+
+  // Each thread gets a pass manager of its own, since passes keep per-function
+  // state in their members.
+  bool Changed = false;
+  std::vector<ParallelFunctionWorker> Workers(NumThreads);
+  for (unsigned i = 0; i != NumThreads; ++i) {
+    ParallelFunctionWorker &W = Workers[i];
+    W.Queue = &Queue;
+    W.FPM = new FunctionPassManager(&M);
+    W.Changed = false;
+    Populate(*W.FPM, Data);
+    Changed |= W.FPM->doInitialization();
+  }
+
+  // The calling thread takes a share of the functions rather than sitting idle.
+  std::vector<llvm_thread*> Threads;
+  for (unsigned i = 0; i + 1 < NumThreads; ++i)
+    Threads.push_back(llvm_start_thread(RunParallelFunctionWorker,
+                                        &Workers[i]));
+  RunParallelFunctionWorker(&Workers[NumThreads - 1]);
+  for (unsigned i = 0, e = Threads.size(); i != e; ++i)
+    llvm_join_thread(Threads[i]);
+
+  for (unsigned i = 0; i != NumThreads; ++i) {
+    ParallelFunctionWorker &W = Workers[i];
+    Changed |= W.Changed;
+    Changed |= W.FPM->doFinalization();
+    delete W.FPM;
+  }
+  return Changed;
+}
+
 //===----------------------------------------------------------------------===//
 // FunctionPassManagerImpl implementation
 //
@@ -1416,6 +1565,9 @@ bool FunctionPassManagerImpl::doFinalization(Module &M) {
   for (unsigned Index = 0; Index < getNumContainedManagers(); ++Index)
     Changed |= getContainedManager(Index)->doFinalization(M);
 
+  // Clients such as libLTO generate code with a FunctionPassManager and may
+  // never call llvm_shutdown, so write the report once the module is done.
+  writePassReport();
   return Changed;
 }
 
@@ -1446,6 +1598,7 @@ void FunctionPassManagerImpl::releaseMemoryOnTheFly() {
 bool FunctionPassManagerImpl::run(Function &F) {
   bool Changed = false;
   TimingInfo::createTheTimeInfo();
+  PassReport::createThePassReport();
   createDebugInfoProbe();
 
   initializeAllAnalysisInfo();
@@ -1499,6 +1652,7 @@ bool FPPassManager::runOnFunction(Function &F) {
     {
       PassManagerPrettyStackEntry X(FP, F);
       TimeRegion PassTimer(getPassTimer(FP));
+      PassReportRegion Report(FP, F);
 
       LocalChanged |= FP->runOnFunction(F);
     }
@@ -1521,6 +1675,9 @@ bool FPPassManager::runOnFunction(Function &F) {
 bool FPPassManager::runOnModule(Module &M) {
   bool Changed = doInitialization(M);
 
+  // Functions are visited one at a time, since the passes keep per-function
+  // state in their members.  runFunctionPassesInParallel runs a pipeline with
+  // one pass manager per thread instead.
   for (Module::iterator I = M.begin(), E = M.end(); I != E; ++I)
     runOnFunction(*I);
 
@@ -1575,6 +1732,7 @@ MPPassManager::runOnModule(Module &M) {
     {
       PassManagerPrettyStackEntry X(MP, M);
       TimeRegion PassTimer(getPassTimer(MP));
+      PassReportRegion Report(MP, M);
 
       LocalChanged |= MP->runOnModule(M);
     }
@@ -1651,6 +1809,7 @@ Pass* MPPassManager::getOnTheFlyPass(Pass *MP, AnalysisID PI, Function &F){
 bool PassManagerImpl::run(Module &M) {
   bool Changed = false;
   TimingInfo::createTheTimeInfo();
+  PassReport::createThePassReport();
   createDebugInfoProbe();
 
   dumpArguments();
@@ -1659,6 +1818,8 @@ bool PassManagerImpl::run(Module &M) {
   initializeAllAnalysisInfo();
   for (unsigned Index = 0; Index < getNumContainedManagers(); ++Index)
     Changed |= getContainedManager(Index)->runOnModule(M);
+
+  writePassReport();
   return Changed;
 }
 
@@ -1735,6 +1896,265 @@ Timer *llvm::getPassTimer(Pass *P) {
   return 0;
 }
 
+//===----------------------------------------------------------------------===//
+// PassReport implementation
+//
+
+enum PassReportFormat { ReportJSON, ReportCSV };
+
+static cl::opt<std::string>
+PassReportFile("pass-report", cl::value_desc("filename"),
+               cl::desc("Write the time, heap growth and change in IR size of "
+                        "each pass on each function or module to a file"));
+
+static cl::opt<PassReportFormat>
+PassReportFmt("pass-report-format", cl::init(ReportJSON),
+              cl::desc("Format of the -pass-report file"),
+              cl::values(clEnumValN(ReportJSON, "json", "a JSON array"),
+                         clEnumValN(ReportCSV, "csv",
+                                    "comma separated values with a header"),
+                         clEnumValEnd));
+
+// createThePassReport - This method either initializes the ThePassReport
+// pointer to a non null value (if the -pass-report option is given) or it
+// leaves it null.  It may be called multiple times.
+void PassReport::createThePassReport() {
+  if (PassReportFile.empty() || ThePassReport) return;
+
+  // Constructed the first time this is called, iff -pass-report is given, so
+  // that it is destroyed, writing the report, before the static globals.
+  static ManagedStatic<PassReport> TPR;
+  ThePassReport = &*TPR;
+}
+
+void PassReport::record(Pass *P, const char *Kind, StringRef Unit,
+                        const TimeRecord &Time, int64_t Heap,
+                        unsigned SizeBefore, unsigned SizeAfter) {
+  sys::SmartScopedLock<true> Guard(Lock);
+  Dirty = true;
+
+  std::string Key((const char*)&P, sizeof(P));
+  Key += Unit;
+  StringMapEntry<unsigned> &Index =
+    EntryMap.GetOrCreateValue(Key, Entries.size());
+  if (Index.getValue() == Entries.size()) {
+    Entries.push_back(PassReportEntry());
+    PassReportEntry &E = Entries.back();
+    E.PassName = P->getPassName();
+    if (const PassInfo *PI = Pass::lookupPassInfo(P->getPassID()))
+      E.PassArg = PI->getPassArgument();
+    E.Kind = Kind;
+    E.Unit = Unit;
+    E.Runs = 0;
+    E.HeapDelta = 0;
+    E.HeapPeak = 0;
+    E.SizeBefore = SizeBefore;
+  }
+
+  PassReportEntry &E = Entries[Index.getValue()];
+  ++E.Runs;
+  E.Time += Time;
+  E.HeapDelta += Heap;
+  E.HeapPeak = std::max(E.HeapPeak, Heap);
+  E.SizeAfter = SizeAfter;
+}
+
+/// writeJSONString - Write Str as a quoted JSON string.
+static void writeJSONString(raw_ostream &OS, StringRef Str) {
+  OS << '"';
+  for (StringRef::iterator I = Str.begin(), E = Str.end(); I != E; ++I) {
+    unsigned char C = *I;
+    if (C == '"' || C == '\\')
+      OS << '\\' << C;
+    else if (C < 0x20)
+      OS << format("\\u%04x", C);
+    else
+      OS << C;
+  }
+  OS << '"';
+}
+
+/// writeCSVField - Write Str as a CSV field, quoted if it needs to be.
+static void writeCSVField(raw_ostream &OS, StringRef Str) {
+  if (Str.find_first_of(",\"\r\n") == StringRef::npos) {
+    OS << Str;
+    return;
+  }
+  OS << '"';
+  for (StringRef::iterator I = Str.begin(), E = Str.end(); I != E; ++I) {
+    if (*I == '"')
+      OS << '"';
+    OS << *I;
+  }
+  OS << '"';
+}
+
+void PassReport::writeJSON(raw_ostream &OS) const {
+  OS << "[\n";
+  for (unsigned i = 0, e = Entries.size(); i != e; ++i) {
+    const PassReportEntry &E = Entries[i];
+    OS << "  {\"pass\": ";
+    writeJSONString(OS, E.PassName);
+    OS << ", \"arg\": ";
+    writeJSONString(OS, E.PassArg);
+    OS << ", \"kind\": \"" << E.Kind << "\", \"unit\": ";
+    writeJSONString(OS, E.Unit);
+    OS << ", \"runs\": " << E.Runs
+       << format(", \"wall\": %.6f", E.Time.getWallTime())
+       << format(", \"user\": %.6f", E.Time.getUserTime())
+       << format(", \"system\": %.6f", E.Time.getSystemTime())
+       << ", \"heap_delta\": " << E.HeapDelta
+       << ", \"heap_peak\": " << E.HeapPeak
+       << ", \"ir_before\": " << E.SizeBefore
+       << ", \"ir_after\": " << E.SizeAfter << '}';
+    OS << (i + 1 != e ? ",\n" : "\n");
+  }
+  OS << "]\n";
+}
+
+void PassReport::writeCSV(raw_ostream &OS) const {
+  OS << "pass,arg,kind,unit,runs,wall,user,system,heap_delta,heap_peak,"
+        "ir_before,ir_after\n";
+  for (unsigned i = 0, e = Entries.size(); i != e; ++i) {
+    const PassReportEntry &E = Entries[i];
+    writeCSVField(OS, E.PassName);
+    OS << ',';
+    writeCSVField(OS, E.PassArg);
+    OS << ',' << E.Kind << ',';
+    writeCSVField(OS, E.Unit);
+    OS << ',' << E.Runs
+       << format(",%.6f,%.6f,%.6f", E.Time.getWallTime(),
+                 E.Time.getUserTime(), E.Time.getSystemTime())
+       << ',' << E.HeapDelta << ',' << E.HeapPeak
+       << ',' << E.SizeBefore << ',' << E.SizeAfter << '\n';
+  }
+}
+
+void PassReport::write() {
+  sys::SmartScopedLock<true> Guard(Lock);
+  EntryMap.clear();
+  if (!Dirty)
+    return;
+  Dirty = false;
+
+  std::string ErrorInfo;
+  raw_fd_ostream OS(PassReportFile.c_str(), ErrorInfo);
+  if (!ErrorInfo.empty()) {
+    errs() << "Error opening pass report file '" << PassReportFile << "': "
+           << ErrorInfo << '\n';
+    return;
+  }
+  if (PassReportFmt == ReportCSV)
+    writeCSV(OS);
+  else
+    writeJSON(OS);
+}
+
+void llvm::writePassReport() {
+  if (ThePassReport)
+    ThePassReport->write();
+}
+
+/// countInstructions - Return the number of instructions in F.
+static unsigned countInstructions(const Function &F) {
+  unsigned Count = 0;
+  for (Function::const_iterator I = F.begin(), E = F.end(); I != E; ++I)
+    Count += I->size();
+  return Count;
+}
+
+namespace llvm {
+
+/// PassReportRun - What a PassReportRegion knows about the run of a pass it
+/// is measuring.
+class PassReportRun {
+public:
+  Pass *P;
+  const char *Kind;
+  std::string Unit;
+  Module *M;
+  SmallVector<Function*, 1> Fns;
+  unsigned SizeBefore;
+  size_t HeapBefore;
+  TimeRecord StartTime;
+
+  PassReportRun(Pass *p, const char *kind, StringRef unit, Module *m)
+    : P(p), Kind(kind), Unit(unit), M(m) {}
+
+  /// getSize - Return the number of instructions in the unit of IR.
+  unsigned getSize() const {
+    unsigned Size = 0;
+    if (M) {
+      for (Module::const_iterator I = M->begin(), E = M->end(); I != E; ++I)
+        Size += countInstructions(*I);
+    }
+    for (unsigned i = 0, e = Fns.size(); i != e; ++i)
+      Size += countInstructions(*Fns[i]);
+    return Size;
+  }
+
+  /// start - Take the measurements for the start of the run.  The time comes
+  /// last, so that taking the others is not part of it.
+  void start() {
+    SizeBefore = getSize();
+    HeapBefore = sys::Process::GetMallocUsage();
+    StartTime = TimeRecord::getCurrentTime(true);
+  }
+
+  /// finish - Take the measurements for the end of the run, and record it.
+  void finish() {
+    TimeRecord Time = TimeRecord::getCurrentTime(false);
+    Time -= StartTime;
+    int64_t Heap = (int64_t)sys::Process::GetMallocUsage() -
+                   (int64_t)HeapBefore;
+    ThePassReport->record(P, Kind, Unit, Time, Heap, SizeBefore, getSize());
+  }
+};
+
+}
+
+PassReportRegion::PassReportRegion(Pass *P, Module &M) : Run(0) {
+  if (!ThePassReport || P->getAsPMDataManager())
+    return;
+  Run = new PassReportRun(P, "module", M.getModuleIdentifier(), &M);
+  Run->start();
+}
+
+PassReportRegion::PassReportRegion(Pass *P, Function &F) : Run(0) {
+  if (!ThePassReport || P->getAsPMDataManager())
+    return;
+  Run = new PassReportRun(P, "function", F.getName(), 0);
+  Run->Fns.push_back(&F);
+  Run->start();
+}
+
+PassReportRegion::PassReportRegion(Pass *P, ArrayRef<Function*> SCC)
+  : Run(0) {
+  if (!ThePassReport || P->getAsPMDataManager())
+    return;
+  // An SCC is known by its first function, if it has any.  The one without
+  // is the node that stands for the callers outside of the module.
+  Run = new PassReportRun(P, "scc",
+                          SCC.empty() ? "<external node>" : SCC[0]->getName(),
+                          0);
+  Run->Fns.append(SCC.begin(), SCC.end());
+  Run->start();
+}
+
+void PassReportRegion::setSCCFunctions(ArrayRef<Function*> SCC) {
+  if (!Run)
+    return;
+  Run->Fns.clear();
+  Run->Fns.append(SCC.begin(), SCC.end());
+}
+
+PassReportRegion::~PassReportRegion() {
+  if (!Run)
+    return;
+  Run->finish();
+  delete Run;
+}
+
 //===----------------------------------------------------------------------===//
 // PMStack implementation
 //
@@ -799,12 +799,11 @@ const IntegerType *IntegerType::get(LLVMContext &C, unsigned NumBits) {
   }
 
   LLVMContextImpl *pImpl = C.pImpl;
+  sys::SmartScopedLock<true> Guard(pImpl->Lock);
   
   IntegerValType IVT(NumBits);
   IntegerType *ITy = 0;
   
-  // First, see if the type is already in the table, for which
-  // a reader lock suffices.
   ITy = pImpl->IntegerTypes.get(IVT);
     
   if (!ITy) {
@@ -845,6 +844,7 @@ FunctionType *FunctionType::get(const Type *ReturnType,
   FunctionType *FT = 0;
   
   LLVMContextImpl *pImpl = ReturnType->getContext().pImpl;
+  sys::SmartScopedLock<true> Guard(pImpl->Lock);
   
   FT = pImpl->FunctionTypes.get(VT);
   
@@ -869,6 +869,7 @@ ArrayType *ArrayType::get(const Type *ElementType, uint64_t NumElements) {
   ArrayType *AT = 0;
 
   LLVMContextImpl *pImpl = ElementType->getContext().pImpl;
+  sys::SmartScopedLock<true> Guard(pImpl->Lock);
   
   AT = pImpl->ArrayTypes.get(AVT);
       
@@ -894,6 +895,7 @@ VectorType *VectorType::get(const Type *ElementType, unsigned NumElements) {
   VectorType *PT = 0;
   
   LLVMContextImpl *pImpl = ElementType->getContext().pImpl;
+  sys::SmartScopedLock<true> Guard(pImpl->Lock);
   
   PT = pImpl->VectorTypes.get(PVT);
     
@@ -922,6 +924,7 @@ StructType *StructType::get(LLVMContext &Context,
   StructType *ST = 0;
   
   LLVMContextImpl *pImpl = Context.pImpl;
+  sys::SmartScopedLock<true> Guard(pImpl->Lock);
   
   ST = pImpl->StructTypes.get(STV);
     
@@ -969,6 +972,7 @@ PointerType *PointerType::get(const Type *ValueType, unsigned AddressSpace) {
   PointerType *PT = 0;
   
   LLVMContextImpl *pImpl = ValueType->getContext().pImpl;
+  sys::SmartScopedLock<true> Guard(pImpl->Lock);
   
   PT = pImpl->PointerTypes.get(PVT);
   
@@ -999,6 +1003,7 @@ bool PointerType::isValidElementType(const Type *ElemTy) {
 OpaqueType *OpaqueType::get(LLVMContext &C) {
   OpaqueType *OT = new OpaqueType(C);       // All opaque types are distinct.
   LLVMContextImpl *pImpl = C.pImpl;
+  sys::SmartScopedLock<true> Guard(pImpl->Lock);
   pImpl->OpaqueTypes.insert(OT);
   return OT;
 }
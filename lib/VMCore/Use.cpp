@@ -12,6 +12,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Value.h"
+#include "LLVMContextImpl.h"
 
 namespace llvm {
 
@@ -23,6 +24,15 @@ void Use::swap(Use &RHS) {
   Value *V1(Val);
   Value *V2(RHS.Val);
   if (V1 != V2) {
+    // Hold the lock of a shared use list for the whole swap rather than for
+    // each of the four list updates, so that no other thread sees a use in
+    // neither list.
+    sys::SmartMutex<true> *Lock = 0;
+    if ((V1 && V1->hasSharedUseList()) || (V2 && V2->hasSharedUseList())) {
+      Lock = &(V1 ? V1 : V2)->getContext().pImpl->UseListLock;
+      Lock->acquire();
+    }
+
     if (V1) {
       removeFromList();
     }
@@ -41,9 +51,28 @@ void Use::swap(Use &RHS) {
     } else {
       RHS.Val = 0;
     }
+
+    if (Lock)
+      Lock->release();
   }
 }
 
+//===----------------------------------------------------------------------===//
+//                         Use shared list Implementation
+//===----------------------------------------------------------------------===//
+
+void Use::addToSharedList(Use **List) {
+  sys::SmartScopedLock<true> Guard(Val->getContext().pImpl->UseListLock);
+  addToList(List);
+}
+
+void Use::removeFromSharedList() {
+  sys::SmartScopedLock<true> Guard(Val->getContext().pImpl->UseListLock);
+  Use **StrippedPrev = Prev.getPointer();
+  *StrippedPrev = Next;
+  if (Next) Next->setPrev(StrippedPrev);
+}
+
 //===----------------------------------------------------------------------===//
 //                         Use getImpliedUser Implementation
 //===----------------------------------------------------------------------===//
@@ -426,6 +426,7 @@ LLVMContext &Value::getContext() const { return VTy->getContext(); }
 /// List is known to point into the existing use list.
 void ValueHandleBase::AddToExistingUseList(ValueHandleBase **List) {
   assert(List && "Handle list is null?");
+  sys::SmartScopedLock<true> Guard(VP->getContext().pImpl->Lock);
 
   // Splice ourselves into the list.
   Next = *List;
@@ -439,6 +440,7 @@ void ValueHandleBase::AddToExistingUseList(ValueHandleBase **List) {
 
 void ValueHandleBase::AddToExistingUseListAfter(ValueHandleBase *List) {
   assert(List && "Must insert after existing node");
+  sys::SmartScopedLock<true> Guard(VP->getContext().pImpl->Lock);
 
   Next = List->Next;
   setPrevPtr(&List->Next);
@@ -452,6 +454,7 @@ void ValueHandleBase::AddToUseList() {
   assert(VP && "Null pointer doesn't have a use list!");
 
   LLVMContextImpl *pImpl = VP->getContext().pImpl;
+  sys::SmartScopedLock<true> Guard(pImpl->Lock);
 
   if (VP->HasValueHandle) {
     // If this value already has a ValueHandle, then it must be in the
@@ -493,6 +496,8 @@ void ValueHandleBase::AddToUseList() {
 /// RemoveFromUseList - Remove this ValueHandle from its current use list.
 void ValueHandleBase::RemoveFromUseList() {
   assert(VP && VP->HasValueHandle && "Pointer doesn't have a use list!");
+  LLVMContextImpl *pImpl = VP->getContext().pImpl;
+  sys::SmartScopedLock<true> Guard(pImpl->Lock);
 
   // Unlink this from its use list.
   ValueHandleBase **PrevPtr = getPrevPtr();
@@ -508,7 +513,6 @@ void ValueHandleBase::RemoveFromUseList() {
   // If the Next pointer was null, then it is possible that this was the last
   // ValueHandle watching VP.  If so, delete its entry from the ValueHandles
   // map.
-  LLVMContextImpl *pImpl = VP->getContext().pImpl;
   DenseMap<Value*, ValueHandleBase*> &Handles = pImpl->ValueHandles;
   if (Handles.isPointerIntoBucketsArray(PrevPtr)) {
     Handles.erase(VP);
@@ -523,6 +527,7 @@ void ValueHandleBase::ValueIsDeleted(Value *V) {
   // Get the linked list base, which is guaranteed to exist since the
   // HasValueHandle flag is set.
   LLVMContextImpl *pImpl = V->getContext().pImpl;
+  sys::SmartScopedLock<true> Guard(pImpl->Lock);
   ValueHandleBase *Entry = pImpl->ValueHandles[V];
   assert(Entry && "Value bit set but no entries exist");
 
@@ -581,6 +586,7 @@ void ValueHandleBase::ValueIsRAUWd(Value *Old, Value *New) {
   // Get the linked list base, which is guaranteed to exist since the
   // HasValueHandle flag is set.
   LLVMContextImpl *pImpl = Old->getContext().pImpl;
+  sys::SmartScopedLock<true> Guard(pImpl->Lock);
   ValueHandleBase *Entry = pImpl->ValueHandles[Old];
 
   assert(Entry && "Value bit set but no entries exist");
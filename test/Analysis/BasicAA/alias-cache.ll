@@ -0,0 +1,57 @@
+; Sub-queries that come up more than once while answering one alias query are
+; answered from the cache, with the same results as when they are recomputed.
+; RUN: opt < %s -basicaa -aa-eval -print-all-alias-modref-info -disable-output |& FileCheck %s
+; RUN: opt < %s -basicaa -basicaa-cache=false -aa-eval -print-all-alias-modref-info -disable-output |& FileCheck %s
+; RUN: opt < %s -basicaa -aa-eval -disable-output -stats |& FileCheck %s -check-prefix=STATS
+target datalayout = "e-p:64:64:64-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:64:64-f32:32:32-f64:64:64-v64:64:64-v128:128:128-a0:0:64-s0:64:64-f80:128:128-n8:16:32:64"
+
+; CHECK: Function: phis
+; CHECK: NoAlias: i32* %a0, i32* %a1
+; CHECK: MayAlias: i32* %a0, i32* %p
+; CHECK: NoAlias: i32* %q, i32* %y
+; CHECK: MayAlias: i32* %a0, i32* %q
+define void @phis(i1 %c, i32* noalias %x, i32* noalias %y) nounwind {
+entry:
+  %a = alloca [2 x i32], align 4
+  %a0 = getelementptr inbounds [2 x i32]* %a, i64 0, i64 0
+  %a1 = getelementptr inbounds [2 x i32]* %a, i64 0, i64 1
+  br i1 %c, label %left, label %right
+
+left:
+  br label %join
+
+right:
+  br label %join
+
+join:
+  %p = phi i32* [ %a0, %left ], [ %a1, %right ]
+  %q = select i1 %c, i32* %x, i32* %a0
+  store i32 0, i32* %a0
+  store i32 1, i32* %a1
+  store i32 2, i32* %p
+  store i32 3, i32* %q
+  ret void
+}
+
+; The selects share a condition, so comparing them compares %g with %h and
+; then %h with %g, which is the same sub-query.
+; CHECK: Function: selects
+; CHECK: NoAlias: i32* %g, i32* %h
+; CHECK: NoAlias: i32* %s1, i32* %s2
+define void @selects(i1 %c, i64 %i) nounwind {
+entry:
+  %a = alloca [8 x i32], align 4
+  %g = getelementptr inbounds [8 x i32]* %a, i64 0, i64 %i
+  %i1 = add i64 %i, 1
+  %h = getelementptr inbounds [8 x i32]* %a, i64 0, i64 %i1
+  %s1 = select i1 %c, i32* %g, i32* %h
+  %s2 = select i1 %c, i32* %h, i32* %g
+  store i32 0, i32* %g
+  store i32 1, i32* %h
+  store i32 2, i32* %s1
+  store i32 3, i32* %s2
+  ret void
+}
+
+; STATS: Number of alias sub-queries answered from cache
+; STATS: Number of alias sub-queries computed and cached
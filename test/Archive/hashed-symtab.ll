@@ -0,0 +1,24 @@
+; Test that llvm-ld can find archive members through the hashed symbol table
+; written by llvm-ar, and that it only pulls in the members it needs.
+; RUN: rm -f %t.a
+; RUN: echo {define i32 @a() \{ ret i32 1 \}} | llvm-as -o %t.a.bc
+; RUN: echo {define i32 @b() \{ ret i32 2 \}} | llvm-as -o %t.b.bc
+; RUN: echo {@c = global i32 3} | llvm-as -o %t.c.bc
+; RUN: llvm-ar rcs %t.a %t.a.bc %t.b.bc %t.c.bc
+; RUN: llvm-as %s -o %t.main.bc
+; RUN: llvm-ld -disable-opt %t.main.bc %t.a -o %t.linked
+; RUN: llvm-dis < %t.linked.bc > %t.ll
+; RUN: grep {define i32 @a()} %t.ll
+; RUN: grep {@c = global i32 3} %t.ll
+; RUN: not grep {@b()} %t.ll
+
+@c = external global i32
+
+declare i32 @a()
+
+define i32 @main() {
+  %x = call i32 @a()
+  %y = load i32* @c
+  %z = add i32 %x, %y
+  ret i32 %z
+}
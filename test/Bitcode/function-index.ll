@@ -0,0 +1,45 @@
+; RUN: llvm-as < %s | llvm-bcanalyzer -dump |& FileCheck %s
+; RUN: llvm-as < %s > %t
+; RUN: llvm-extract -func b -S %t | FileCheck --check-prefix=EXTRACT %s
+; RUN: llvm-dis < %t | FileCheck --check-prefix=DIS %s
+
+; The writer emits a FUNCINDEX record pointing at a FUNCTION_INDEX block that
+; follows the function bodies.
+; CHECK: <FUNCINDEX
+; CHECK: <FUNCTION_BLOCK
+; CHECK: <FUNCTION_BLOCK
+; CHECK: <FUNCTION_BLOCK
+; CHECK: <FUNCTION_INDEX_BLOCK
+; CHECK-NEXT: <OFFSETS
+; CHECK-NEXT: </FUNCTION_INDEX_BLOCK>
+
+; llvm-extract loads lazily, so only @b's body should be read through the
+; index.
+; EXTRACT: define i32 @b(i32 %x) {
+; EXTRACT:   %y = add i32 %x, 2
+; EXTRACT: declare i32 @c(i32)
+
+; DIS: define i32 @a(i32 %x) {
+; DIS:   %y = add i32 %x, 1
+; DIS: define i32 @b(i32 %x) {
+; DIS:   %y = add i32 %x, 2
+; DIS: define i32 @c(i32 %x) {
+; DIS:   %y = mul i32 %x, 3
+
+declare void @ext()
+
+define i32 @a(i32 %x) {
+  %y = add i32 %x, 1
+  ret i32 %y
+}
+
+define i32 @b(i32 %x) {
+  %y = add i32 %x, 2
+  %z = call i32 @c(i32 %y)
+  ret i32 %z
+}
+
+define i32 @c(i32 %x) {
+  %y = mul i32 %x, 3
+  ret i32 %y
+}
@@ -0,0 +1,43 @@
+; RUN: llvm-as < %s > %t.serial
+; RUN: llvm-as -bitcode-writer-threads=3 < %s > %t.parallel
+; RUN: cmp %t.serial %t.parallel
+; RUN: llvm-dis < %t.parallel | FileCheck %s
+
+; Function blocks encoded on separate threads must be spliced back in order
+; and produce exactly the same bytes as the serial writer.
+
+@g = global i32 7
+
+; CHECK: define i32 @a
+define i32 @a(i32 %x) {
+  %y = add i32 %x, 1
+  ret i32 %y
+}
+
+declare void @ext()
+
+; CHECK: define i32 @b
+define i32 @b(i32 %x) {
+entry:
+  %c = icmp eq i32 %x, 0
+  br i1 %c, label %zero, label %nonzero
+zero:
+  call void @ext()
+  ret i32 0
+nonzero:
+  %v = load i32* @g
+  %r = mul i32 %v, %x
+  ret i32 %r
+}
+
+; CHECK: define double @c
+define double @c(double %x) {
+  %y = fmul double %x, 2.5
+  ret double %y
+}
+
+; CHECK: define i32 @d
+define i32 @d() {
+  %r = call i32 @a(i32 41)
+  ret i32 %r
+}
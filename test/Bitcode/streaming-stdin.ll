@@ -0,0 +1,48 @@
+; RUN: llvm-as < %s > %t.bc
+; RUN: llvm-dis %t.bc -o - | grep -v ModuleID > %t.file.ll
+; RUN: cat %t.bc | llvm-dis - | grep -v ModuleID > %t.pipe.ll
+; RUN: diff %t.file.ll %t.pipe.ll
+; RUN: cat %t.bc | llvm-dis - | FileCheck %s
+
+; Reading bitcode from a pipe, where the reader cannot seek ahead to the
+; function bodies, gives the same module as reading it from a file.
+
+@g = global i32 7
+@fp = global i32 (i32)* @callee
+
+; @addr refers to a block of a function whose body comes later in the stream.
+; CHECK: define i8* @addr()
+define i8* @addr() {
+entry:
+; CHECK: blockaddress(@callee, %pos)
+  ret i8* blockaddress(@callee, %pos)
+}
+
+; CHECK: define i32 @caller(i32 %x)
+define i32 @caller(i32 %x) {
+entry:
+; CHECK: call i32 @callee(i32 %x)
+  %r = call i32 @callee(i32 %x)
+  %v = load i32* @g, !tag !0
+  %s = add i32 %r, %v
+  ret i32 %s
+}
+
+; CHECK: define i32 @callee(i32 %x)
+define i32 @callee(i32 %x) {
+entry:
+  %c = icmp sgt i32 %x, 0
+  br i1 %c, label %pos, label %neg
+
+pos:
+; CHECK: mul i32 %x, 3
+  %a = mul i32 %x, 3
+  ret i32 %a
+
+neg:
+  %b = sub i32 0, %x
+  ret i32 %b
+}
+
+; CHECK: !0 = metadata !{metadata !"g"}
+!0 = metadata !{metadata !"g"}
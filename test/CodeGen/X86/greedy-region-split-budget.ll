@@ -0,0 +1,48 @@
+; RUN: llc < %s -mtriple=i386-unknown-linux -regalloc=greedy \
+; RUN:   -greedy-report-ms=0 -greedy-region-split-budget=1 -o /dev/null |& \
+; RUN:   FileCheck %s
+; RUN: llc < %s -mtriple=i386-unknown-linux -regalloc=greedy \
+; RUN:   -greedy-report-ms=0 -o /dev/null |& \
+; RUN:   FileCheck %s -check-prefix=UNLIMITED
+
+; With a tiny budget, region splitting gives up after the first candidate but
+; the function is still allocated.
+; CHECK: greedy-report: function=f {{.*}} over-budget={{[1-9][0-9]*}}
+; UNLIMITED: greedy-report: function=f {{.*}} over-budget=0
+
+declare void @g(i32)
+
+define i32 @f(i32* %p, i32 %n) nounwind {
+entry:
+  %a = load i32* %p
+  %p1 = getelementptr i32* %p, i32 1
+  %b = load i32* %p1
+  %p2 = getelementptr i32* %p, i32 2
+  %c = load i32* %p2
+  %p3 = getelementptr i32* %p, i32 3
+  %d = load i32* %p3
+  %p4 = getelementptr i32* %p, i32 4
+  %e = load i32* %p4
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %s = phi i32 [ 0, %entry ], [ %s.next, %loop ]
+  %t0 = add i32 %s, %a
+  %t1 = add i32 %t0, %b
+  %t2 = add i32 %t1, %c
+  %t3 = add i32 %t2, %d
+  %s.next = add i32 %t3, %e
+  call void @g(i32 %s.next)
+  %i.next = add i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  %r0 = mul i32 %a, %b
+  %r1 = mul i32 %r0, %c
+  %r2 = mul i32 %r1, %d
+  %r3 = mul i32 %r2, %e
+  %r = add i32 %r3, %s.next
+  ret i32 %r
+}
@@ -0,0 +1,22 @@
+; RUN: llc < %s -march=x86-64 -regalloc=greedy -greedy-report-ms=0 |& \
+; RUN:   FileCheck %s
+; RUN: llc < %s -march=x86-64 -regalloc=greedy -greedy-report-ms=100000 |& \
+; RUN:   FileCheck %s -check-prefix=SLOW
+
+; Every function is reported with a zero threshold, none with a huge one.
+; CHECK: greedy-report: function=f seconds={{[0-9.]+}} blocks=1 vregs={{[0-9]+}} evict-tries={{[0-9]+}}
+; CHECK: cache-hits={{[0-9]+}} cache-misses={{[0-9]+}}
+; CHECK: greedy-report: function=g
+; SLOW-NOT: greedy-report:
+
+define i32 @f(i32 %a, i32 %b) nounwind {
+entry:
+  %c = add i32 %a, %b
+  ret i32 %c
+}
+
+define i32 @g(i32 %a) nounwind {
+entry:
+  %c = mul i32 %a, %a
+  ret i32 %c
+}
@@ -0,0 +1,44 @@
+; RUN: llc < %s -march=x86-64 -mattr=+sse2 -O3 | FileCheck %s
+; RUN: llc < %s -march=x86-64 -mattr=+sse2 -O3 -disable-slp-vectorizer | FileCheck %s -check-prefix=SCALAR
+
+; Four consecutive float additions become one addps at -O3.
+define void @add4(float* noalias %p, float* noalias %a, float* noalias %b) nounwind {
+entry:
+  %a0 = load float* %a, align 4
+  %b0 = load float* %b, align 4
+  %s0 = fadd float %a0, %b0
+  store float %s0, float* %p, align 4
+  %pa1 = getelementptr inbounds float* %a, i64 1
+  %pb1 = getelementptr inbounds float* %b, i64 1
+  %pp1 = getelementptr inbounds float* %p, i64 1
+  %a1 = load float* %pa1, align 4
+  %b1 = load float* %pb1, align 4
+  %s1 = fadd float %a1, %b1
+  store float %s1, float* %pp1, align 4
+  %pa2 = getelementptr inbounds float* %a, i64 2
+  %pb2 = getelementptr inbounds float* %b, i64 2
+  %pp2 = getelementptr inbounds float* %p, i64 2
+  %a2 = load float* %pa2, align 4
+  %b2 = load float* %pb2, align 4
+  %s2 = fadd float %a2, %b2
+  store float %s2, float* %pp2, align 4
+  %pa3 = getelementptr inbounds float* %a, i64 3
+  %pb3 = getelementptr inbounds float* %b, i64 3
+  %pp3 = getelementptr inbounds float* %p, i64 3
+  %a3 = load float* %pa3, align 4
+  %b3 = load float* %pb3, align 4
+  %s3 = fadd float %a3, %b3
+  store float %s3, float* %pp3, align 4
+  ret void
+; CHECK: add4:
+; CHECK: movups
+; CHECK: addps
+; CHECK: movups
+; CHECK-NOT: addss
+
+; SCALAR: add4:
+; SCALAR: addss
+; SCALAR: addss
+; SCALAR: addss
+; SCALAR: addss
+}
@@ -0,0 +1,46 @@
+; RUN: lli -jit-background-compile %s > /dev/null
+; RUN: lli -jit-background-compile -jit-tier-up-threshold=5 %s > /dev/null
+; XFAIL: arm
+
+; The callees of @main are compiled on a background thread while @main runs;
+; whichever of them it reaches first is compiled on demand instead.
+
+define internal i32 @leaf(i32 %x) {
+entry:
+  %r = add i32 %x, 1
+  ret i32 %r
+}
+
+define internal i32 @middle(i32 %x) {
+entry:
+  %a = call i32 @leaf(i32 %x)
+  %b = call i32 @leaf(i32 %a)
+  ret i32 %b
+}
+
+define internal i32 @other(i32 %x) {
+entry:
+  %r = mul i32 %x, 3
+  ret i32 %r
+}
+
+define i32 @main() {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %sum = phi i32 [ 0, %entry ], [ %sum.next, %loop ]
+  %m = call i32 @middle(i32 %i)
+  %o = call i32 @other(i32 %m)
+  %sum.next = add i32 %sum, %o
+  %i.next = add i32 %i, 1
+  %done = icmp eq i32 %i.next, 100
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ; sum of 3 * (i + 2) for i < 100
+  %ok = icmp eq i32 %sum.next, 15450
+  %ret = select i1 %ok, i32 0, i32 1
+  ret i32 %ret
+}
@@ -0,0 +1,83 @@
+; RUN: lli -force-interpreter %s
+
+target datalayout = "e-p:64:64:64-i32:32:32-i64:64:64"
+
+; The interpreter lowers each function to register slots on its first call.
+; Lowering an intrinsic changes the function, and the frames still running it
+; must carry on with their values.
+
+declare i32 @llvm.ctpop.i32(i32)
+
+; popsum(n) = ctpop(1) + ... + ctpop(n), computed on the way back up so that
+; the outer frames are in the middle of a call when the innermost one lowers
+; the intrinsic.
+define i32 @popsum(i32 %n) {
+entry:
+  %done = icmp eq i32 %n, 0
+  br i1 %done, label %base, label %recurse
+base:
+  ret i32 0
+recurse:
+  %n1 = sub i32 %n, 1
+  %rest = call i32 @popsum(i32 %n1)
+  %bits = call i32 @llvm.ctpop.i32(i32 %n)
+  %sum = add i32 %rest, %bits
+  ret i32 %sum
+}
+
+; PHI nodes that read each other must see the values from before the branch.
+define i32 @fib(i32 %n) {
+entry:
+  br label %loop
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %a = phi i32 [ 0, %entry ], [ %b, %loop ]
+  %b = phi i32 [ 1, %entry ], [ %ab, %loop ]
+  %ab = add i32 %a, %b
+  %i.next = add i32 %i, 1
+  %more = icmp slt i32 %i.next, %n
+  br i1 %more, label %loop, label %exit
+exit:
+  ret i32 %b
+}
+
+define i32 @pick(i32 %x) {
+entry:
+  switch i32 %x, label %other [ i32 1, label %one
+                                i32 7, label %seven ]
+one:
+  ret i32 10
+seven:
+  ret i32 70
+other:
+  %neg = icmp slt i32 %x, 0
+  %r = select i1 %neg, i32 -1, i32 0
+  ret i32 %r
+}
+
+@table = global [4 x i32] [i32 3, i32 5, i32 7, i32 9]
+
+define i32 @main() {
+entry:
+  ; 1 + 1 + 2 + 1 + 2 + 2 + 3 + 1 = 13
+  %p = call i32 @popsum(i32 8)
+  %p.ok = icmp eq i32 %p, 13
+  ; Again, now that the function has been lowered once more.
+  %q = call i32 @popsum(i32 8)
+  %q.ok = icmp eq i32 %q, 13
+  %f = call i32 @fib(i32 10)
+  %f.ok = icmp eq i32 %f, 55
+  %s1 = call i32 @pick(i32 7)
+  %s2 = call i32 @pick(i32 -3)
+  %s = add i32 %s1, %s2
+  %s.ok = icmp eq i32 %s, 69
+  %addr = getelementptr [4 x i32]* @table, i32 0, i32 2
+  %t = load i32* %addr
+  %t.ok = icmp eq i32 %t, 7
+  %ok1 = and i1 %p.ok, %q.ok
+  %ok2 = and i1 %ok1, %f.ok
+  %ok3 = and i1 %ok2, %s.ok
+  %ok = and i1 %ok3, %t.ok
+  %r = select i1 %ok, i32 0, i32 1
+  ret i32 %r
+}
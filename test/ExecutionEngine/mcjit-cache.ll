@@ -0,0 +1,55 @@
+; RUN: rm -rf %t.cache %t.cold %t.warm %t.fp
+; RUN: lli -use-mcjit -mtriple=x86_64-apple-darwin -jit-cache-dir=%t.cache \
+; RUN:   -stats -info-output-file %t.cold %s
+; RUN: FileCheck -check-prefix=COLD %s < %t.cold
+; RUN: lli -use-mcjit -mtriple=x86_64-apple-darwin -jit-cache-dir=%t.cache \
+; RUN:   -stats -info-output-file %t.warm %s
+; RUN: FileCheck -check-prefix=WARM %s < %t.warm
+; RUN: lli -use-mcjit -mtriple=x86_64-apple-darwin -jit-cache-dir=%t.cache \
+; RUN:   -disable-fp-elim -stats -info-output-file %t.fp %s
+; RUN: FileCheck -check-prefix=COLD %s < %t.fp
+; XFAIL: arm, i386, i686, powerpc, ppc, sparc, mips
+
+; A cold start compiles and stores the code.  A warm start loads all of it
+; from the cache, unless a code generation option has changed.
+
+; COLD-NOT: loaded from the JIT code cache
+; COLD: lookups that missed
+; COLD: stored in the JIT code cache
+
+; WARM: loaded from the JIT code cache
+; WARM-NOT: lookups that missed
+; WARM-NOT: stored in the JIT code cache
+
+@count = global i32 0
+
+define internal i32 @fib(i32 %n) {
+entry:
+  %c = load i32* @count
+  %c.next = add i32 %c, 1
+  store i32 %c.next, i32* @count
+  %small = icmp slt i32 %n, 2
+  br i1 %small, label %done, label %recurse
+recurse:
+  %n1 = sub i32 %n, 1
+  %f1 = call i32 @fib(i32 %n1)
+  %n2 = sub i32 %n, 2
+  %f2 = call i32 @fib(i32 %n2)
+  %sum = add i32 %f1, %f2
+  ret i32 %sum
+done:
+  ret i32 %n
+}
+
+define i32 @main() {
+entry:
+  %f = call i32 @fib(i32 10)
+  %f.ok = icmp eq i32 %f, 55
+  br i1 %f.ok, label %pass, label %fail
+
+pass:
+  ret i32 0
+
+fail:
+  ret i32 1
+}
@@ -0,0 +1,72 @@
+; RUN: lli -use-mcjit -mtriple=x86_64-apple-darwin %s
+; RUN: lli -use-mcjit -mtriple=x86_64-apple-darwin -disable-lazy-compilation %s
+; XFAIL: arm, i386, i686, powerpc, ppc, sparc, mips
+
+; Functions are compiled one at a time, through stubs, or a module at a time.
+; Either way, calls between functions, calls into the program, globals, and
+; function addresses must all work.
+
+@count = global i32 0
+@fnptr = global i32 (i32)* null
+
+define internal i32 @fib(i32 %n) {
+entry:
+  %c = load i32* @count
+  %c.next = add i32 %c, 1
+  store i32 %c.next, i32* @count
+  %small = icmp slt i32 %n, 2
+  br i1 %small, label %done, label %recurse
+recurse:
+  %n1 = sub i32 %n, 1
+  %f1 = call i32 @fib(i32 %n1)
+  %n2 = sub i32 %n, 2
+  %f2 = call i32 @fib(i32 %n2)
+  %sum = add i32 %f1, %f2
+  ret i32 %sum
+done:
+  ret i32 %n
+}
+
+define i32 @negate(i32 %x) {
+entry:
+  %r = sub i32 0, %x
+  ret i32 %r
+}
+
+define i32 @never_called(i32 %x) {
+entry:
+  ret i32 %x
+}
+
+declare i32 @abs(i32)
+
+define i32 @main() {
+entry:
+  ; Take the address of a function before it is compiled, and compare it
+  ; with the one seen after it has been called.
+  store i32 (i32)* @negate, i32 (i32)** @fnptr
+  %m = call i32 @negate(i32 55)
+  %p = load i32 (i32)** @fnptr
+  %same = icmp eq i32 (i32)* %p, @negate
+  br i1 %same, label %call.fib, label %fail
+
+call.fib:
+  %f = call i32 @fib(i32 10)
+  %f.ok = icmp eq i32 %f, 55
+  %c = load i32* @count
+  %c.ok = icmp eq i32 %c, 177
+  %fc.ok = and i1 %f.ok, %c.ok
+  br i1 %fc.ok, label %call.abs, label %fail
+
+call.abs:
+  %a = call i32 @abs(i32 %m)
+  %through.ptr = call i32 %p(i32 %a)
+  %r.ok = icmp eq i32 %through.ptr, -55
+  br i1 %r.ok, label %pass, label %fail
+
+pass:
+  ret i32 0
+
+fail:
+  ret i32 1
+}
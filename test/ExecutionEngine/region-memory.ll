@@ -0,0 +1,41 @@
+; RUN: lli -jit-region-memory-manager %s > /dev/null
+; RUN: lli -jit-region-memory-manager -disable-lazy-compilation %s > /dev/null
+; RUN: lli -jit-region-memory-manager -jit-tier-up-threshold=10 %s > /dev/null
+; XFAIL: arm
+
+; Code is emitted onto pages that are never writable and executable at once;
+; globals and lazily resolved calls must keep working.
+
+@count = global i32 0
+
+define i32 @square(i32 %x) {
+entry:
+  %c = load i32* @count
+  %c.next = add i32 %c, 1
+  store i32 %c.next, i32* @count
+  %r = mul i32 %x, %x
+  ret i32 %r
+}
+
+define i32 @main() {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %sum = phi i32 [ 0, %entry ], [ %sum.next, %loop ]
+  %sq = call i32 @square(i32 %i)
+  %sum.next = add i32 %sum, %sq
+  %i.next = add i32 %i, 1
+  %done = icmp eq i32 %i.next, 1000
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ; sum of i*i for i < 1000, modulo 2^32
+  %ok = icmp eq i32 %sum.next, 332833500
+  %calls = load i32* @count
+  %ok.calls = icmp eq i32 %calls, 1000
+  %both = and i1 %ok, %ok.calls
+  %ret = select i1 %both, i32 0, i32 1
+  ret i32 %ret
+}
@@ -0,0 +1,31 @@
+; RUN: lli -jit-tier-up-threshold=10 %s > /dev/null
+; RUN: lli -jit-tier-up-threshold=10 -disable-lazy-compilation %s > /dev/null
+; XFAIL: arm
+
+; @square gets hot and is recompiled while main keeps calling it.
+
+define i32 @square(i32 %x) {
+entry:
+  %r = mul i32 %x, %x
+  ret i32 %r
+}
+
+define i32 @main() {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %sum = phi i32 [ 0, %entry ], [ %sum.next, %loop ]
+  %sq = call i32 @square(i32 %i)
+  %sum.next = add i32 %sum, %sq
+  %i.next = add i32 %i, 1
+  %done = icmp eq i32 %i.next, 1000
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ; sum of i*i for i < 1000, modulo 2^32
+  %ok = icmp eq i32 %sum.next, 332833500
+  %ret = select i1 %ok, i32 0, i32 1
+  ret i32 %ret
+}
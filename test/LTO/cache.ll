@@ -0,0 +1,59 @@
+; RUN: rm -rf %t.cache
+; RUN: llvm-as %s -o %t.o
+; RUN: echo garbage > %t.bad
+
+; The first link misses and adds an entry.  The second one uses it.
+; RUN: %ld_gold -plugin %gold_plugin -plugin-opt=cache-dir=%t.cache \
+; RUN:   -e main %t.o -o %t.1
+; RUN: find %t.cache -name entry | count 1
+; RUN: %ld_gold -plugin %gold_plugin -plugin-opt=cache-dir=%t.cache \
+; RUN:   -e main %t.o -o %t.2
+; RUN: cmp %t.1 %t.2
+; RUN: find %t.cache -name entry | count 1
+
+; A hit links the cached object, whatever it holds.
+; RUN: find %t.cache -name 0.o | xargs cp %t.bad
+; RUN: not %ld_gold -plugin %gold_plugin -plugin-opt=cache-dir=%t.cache \
+; RUN:   -e main %t.o -o %t.3 |& FileCheck %s -check-prefix=HIT
+; HIT: 0.o: not an object
+
+; A link with other options misses, and pruning to one byte then removes the
+; entry above, which was last used before this link started.
+; RUN: find %t.cache -name entry | xargs touch -t 200001010000
+; RUN: %ld_gold -plugin %gold_plugin -plugin-opt=cache-dir=%t.cache \
+; RUN:   -plugin-opt=cache-size=1 -plugin-opt=partitions=2 \
+; RUN:   -e main %t.o -o %t.4
+; RUN: find %t.cache -name entry | count 1
+; RUN: find %t.cache -name 1.o | count 1
+
+; A complete entry is pruned however recently it was used, since a hit only
+; hands gold private links to its objects.  An entry which another link is
+; still building is only pruned once it is stale.
+; RUN: mkdir %t.cache/0123456789abcdef0123456789abcdef.tmp-abcdef.d
+; RUN: echo building > %t.cache/0123456789abcdef0123456789abcdef.tmp-abcdef.d/0.o
+; RUN: %ld_gold -plugin %gold_plugin -plugin-opt=cache-dir=%t.cache \
+; RUN:   -plugin-opt=cache-size=1 -e main %t.o -o %t.5
+; RUN: find %t.cache -name entry | count 1
+; RUN: find %t.cache -name 0123456789abcdef0123456789abcdef.tmp-abcdef.d \
+; RUN:   | count 1
+; RUN: touch -t 200001010000 \
+; RUN:   %t.cache/0123456789abcdef0123456789abcdef.tmp-abcdef.d \
+; RUN:   %t.cache/0123456789abcdef0123456789abcdef.tmp-abcdef.d/0.o
+; RUN: %ld_gold -plugin %gold_plugin -plugin-opt=cache-dir=%t.cache \
+; RUN:   -plugin-opt=cache-size=1 -e main %t.o -o %t.6
+; RUN: find %t.cache -name 0123456789abcdef0123456789abcdef.tmp-abcdef.d \
+; RUN:   | count 0
+
+; REQUIRES: gold_plugin
+
+define i32 @main() {
+entry:
+  %r = call i32 @f(i32 3)
+  ret i32 %r
+}
+
+define internal i32 @f(i32 %x) {
+entry:
+  %a = mul i32 %x, 7
+  ret i32 %a
+}
@@ -0,0 +1,102 @@
+; RUN: opt < %s -simplifycfg -scalarrepl -early-cse -S > %t.serial
+; RUN: opt < %s -simplifycfg -scalarrepl -early-cse \
+; RUN:   -parallel-function-passes=4 -S > %t.parallel
+; RUN: diff %t.serial %t.parallel
+; RUN: opt < %s -O2 -S > %t.serial.O2
+; RUN: opt < %s -O2 -parallel-function-passes=4 -S > %t.parallel.O2
+; RUN: diff %t.serial.O2 %t.parallel.O2
+; RUN: not opt < %s -instcombine -parallel-function-passes=4 -S \
+; RUN:   |& FileCheck %s
+
+; Running the function passes on several threads gives the same module as
+; running them on one.  The functions share globals, constants and metadata,
+; and the passes fold them into new constants and constant expressions.
+
+; Passes which look at the use lists of globals, like -instcombine, would
+; race with the other threads and are rejected.
+; CHECK: -instcombine cannot be run with -parallel-function-passes
+
+@table = global [16 x i32] zeroinitializer
+@count = global i32 0
+
+define i32 @f0(i32 %x) {
+entry:
+  %a = mul i32 %x, 8
+  %b = add i32 %a, 0
+  %p = getelementptr [16 x i32]* @table, i32 0, i32 3
+  %v = load i32* %p, !tag !0
+  %r = add i32 %b, %v
+  ret i32 %r
+}
+
+define i32 @f1(i32 %x) {
+entry:
+  %a = mul i32 %x, 16
+  %b = xor i32 %a, -1
+  %p = getelementptr [16 x i32]* @table, i32 0, i32 3
+  store i32 %b, i32* %p, !tag !0
+  %c = load i32* @count
+  %d = add i32 %c, 1
+  store i32 %d, i32* @count
+  ret i32 %d
+}
+
+define i32 @f2(i32 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %s = phi i32 [ 0, %entry ], [ %s.next, %loop ]
+  %g = load i32* @count
+  %m = mul i32 %g, 4
+  %s.next = add i32 %s, %m
+  %i.next = add i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop, !tag !1
+
+exit:
+  ret i32 %s.next
+}
+
+define i64 @f3(i64 %x) {
+entry:
+  %a = shl i64 %x, 3
+  %b = lshr i64 %a, 3
+  %c = and i64 %b, 2305843009213693951
+  %d = add i64 %c, ptrtoint (i32* getelementptr ([16 x i32]* @table, i32 0, i32 5) to i64)
+  ret i64 %d
+}
+
+define i32 @f4(i32 %x, i32 %y) {
+entry:
+  %t = icmp sgt i32 %x, %y
+  br i1 %t, label %then, label %else
+
+then:
+  %a = mul i32 %x, 32
+  br label %join
+
+else:
+  %b = mul i32 %y, 32
+  br label %join
+
+join:
+  %r = phi i32 [ %a, %then ], [ %b, %else ]
+  %p = getelementptr [16 x i32]* @table, i32 0, i32 7
+  store i32 %r, i32* %p, !tag !1
+  ret i32 %r
+}
+
+define i32 @f5(i32 %x) {
+entry:
+  %a = call i32 @f0(i32 %x)
+  %b = call i32 @f1(i32 %a)
+  %c = mul i32 %b, 64
+  %d = sub i32 %c, %c
+  %e = or i32 %d, %a
+  ret i32 %e
+}
+
+!0 = metadata !{metadata !"table"}
+!1 = metadata !{metadata !"loop", i32 2}
@@ -0,0 +1,32 @@
+; RUN: opt -instcombine -inline -pass-report=%t -disable-output %s
+; RUN: FileCheck %s < %t
+; RUN: opt -instcombine -inline -pass-report=%t.csv -pass-report-format=csv \
+; RUN:   -disable-output %s
+; RUN: FileCheck %s -check-prefix=CSV < %t.csv
+
+; The report has an entry for each pass that runs on each function, SCC or
+; module, with the number of instructions before and after.
+
+; CHECK: [
+; CHECK: {"pass": "Combine redundant instructions", "arg": "instcombine", "kind": "function", "unit": "callee", "runs": 1, "wall": {{[0-9.]+}}, "user": {{[0-9.]+}}, "system": {{[0-9.]+}}, "heap_delta": {{-?[0-9]+}}, "heap_peak": {{-?[0-9]+}}, "ir_before": 3, "ir_after": 1}
+; CHECK: {"pass": "Combine redundant instructions", "arg": "instcombine", "kind": "function", "unit": "odd\"name", {{.*}} "ir_before": 2, "ir_after": 2}
+; CHECK: {"pass": "Basic CallGraph Construction", "arg": "basiccg", "kind": "module", "unit": "{{.*}}pass-report.ll", {{.*}} "ir_before": 3, "ir_after": 3}
+; CHECK: {"pass": "Function Integration/Inlining", "arg": "inline", "kind": "scc", "unit": "callee", "runs": 1, {{.*}} "ir_before": 1, "ir_after": 1}
+; CHECK: {"pass": "Function Integration/Inlining", "arg": "inline", "kind": "scc", "unit": "odd\"name", {{.*}} "ir_before": 2, "ir_after": 1}
+; CHECK: "unit": "<external node>"
+; CHECK: ]
+
+; CSV: pass,arg,kind,unit,runs,wall,user,system,heap_delta,heap_peak,ir_before,ir_after
+; CSV: Combine redundant instructions,instcombine,function,callee,1,{{[0-9.]+}},{{[0-9.]+}},{{[0-9.]+}},{{-?[0-9]+}},{{-?[0-9]+}},3,1
+; CSV: Function Integration/Inlining,inline,scc,"odd""name",1,{{.*}},2,1
+
+define internal i32 @callee(i32 %x) {
+  %a = add i32 %x, 0
+  %b = mul i32 %a, 1
+  ret i32 %b
+}
+
+define i32 @"odd\22name"(i32 %x) {
+  %r = call i32 @callee(i32 %x)
+  ret i32 %r
+}
@@ -0,0 +1,43 @@
+; RUN: opt -S -basicaa -gvn %s | FileCheck %s
+; RUN: opt -S -basicaa -gvn -gvn-max-nonlocal-blocks=4 %s | FileCheck %s -check-prefix=BUDGET
+; RUN: opt -basicaa -gvn -gvn-max-nonlocal-blocks=4 -stats -disable-output %s |& \
+; RUN:   FileCheck %s -check-prefix=STATS
+
+; The load in %m3 is fully redundant with the store in %entry, but finding
+; that out means walking back through three diamonds.  With a budget of four
+; blocks the query gives up and the load is left alone.
+
+define i32 @f(i32* %p, i32 %v, i1 %c) {
+entry:
+  store i32 %v, i32* %p
+  br i1 %c, label %a1, label %b1
+a1:
+  br label %m1
+b1:
+  br label %m1
+m1:
+  br i1 %c, label %a2, label %b2
+a2:
+  br label %m2
+b2:
+  br label %m2
+m2:
+  br i1 %c, label %a3, label %b3
+a3:
+  br label %m3
+b3:
+  br label %m3
+m3:
+  %x = load i32* %p
+  ret i32 %x
+; CHECK: @f
+; CHECK: m3:
+; CHECK-NEXT: ret i32 %v
+
+; BUDGET: @f
+; BUDGET: m3:
+; BUDGET-NEXT: %x = load i32* %p
+; BUDGET-NEXT: ret i32 %x
+}
+
+; STATS: 1 memdep - Number of non-local ptr walks stopped by the block budget
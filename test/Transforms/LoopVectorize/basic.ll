@@ -0,0 +1,99 @@
+; RUN: opt < %s -loop-vectorize -S | FileCheck %s
+target datalayout = "e-p:64:64:64-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:64:64-f32:32:32-f64:64:64-v64:64:64-v128:128:128-a0:0:64-s0:64:64-f80:128:128-n8:16:32:64"
+target triple = "x86_64-apple-darwin10.0.0"
+
+; a[i] = b[i] + c[i]
+define void @add(i32* %a, i32* %b, i32* %c, i64 %n) nounwind ssp {
+entry:
+  %cmp6 = icmp sgt i64 %n, 0
+  br i1 %cmp6, label %for.body, label %for.end
+
+for.body:
+  %i.07 = phi i64 [ %inc, %for.body ], [ 0, %entry ]
+  %arrayidx = getelementptr inbounds i32* %b, i64 %i.07
+  %0 = load i32* %arrayidx, align 4
+  %arrayidx1 = getelementptr inbounds i32* %c, i64 %i.07
+  %1 = load i32* %arrayidx1, align 4
+  %add = add nsw i32 %1, %0
+  %arrayidx2 = getelementptr inbounds i32* %a, i64 %i.07
+  store i32 %add, i32* %arrayidx2, align 4
+  %inc = add nsw i64 %i.07, 1
+  %exitcond = icmp eq i64 %inc, %n
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+; CHECK: @add
+; CHECK: %n.vec = and i64 %trip.count, -4
+; CHECK: vector.memcheck:
+; CHECK: found.conflict
+; CHECK: br i1 %{{.*}}, label %scalar.ph, label %vector.ph
+; CHECK: vector.body:
+; CHECK: %index = phi i64 [ 0, %vector.ph ], [ %index.next, %vector.body ]
+; CHECK: load <4 x i32>* %{{.*}}, align 4
+; CHECK: load <4 x i32>* %{{.*}}, align 4
+; CHECK: add <4 x i32>
+; CHECK: store <4 x i32> %{{.*}}, align 4
+; CHECK: %index.next = add i64 %index, 4
+; CHECK: middle.block:
+; CHECK: br i1 %cmp.n, label %exit.merge, label %scalar.ph
+; CHECK: scalar.ph:
+; CHECK: %resume = phi i64 [ %resume.val, %middle.block ], [ 0, %for.body.preheader ], [ 0, %vector.memcheck ]
+; CHECK: for.body:
+; CHECK: load i32*
+; CHECK: store i32
+}
+
+; The induction variable itself is stored, widened to <0, 1, 2, 3> + i.
+; The i32 vector index is zero-extended before it is used to address memory.
+; A single pointer needs no runtime check.
+define void @iota(float* %a, i32 %n) nounwind ssp {
+entry:
+  %cmp4 = icmp sgt i32 %n, 0
+  br i1 %cmp4, label %for.body, label %for.end
+
+for.body:
+  %i.05 = phi i32 [ %inc, %for.body ], [ 0, %entry ]
+  %conv = sitofp i32 %i.05 to float
+  %idxprom = sext i32 %i.05 to i64
+  %arrayidx = getelementptr inbounds float* %a, i64 %idxprom
+  store float %conv, float* %arrayidx, align 4
+  %inc = add nsw i32 %i.05, 1
+  %exitcond = icmp eq i32 %inc, %n
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+; CHECK: @iota
+; CHECK-NOT: vector.memcheck
+; CHECK: vector.body:
+; CHECK: %vec.ind = add <4 x i32> %{{.*}}, <i32 0, i32 1, i32 2, i32 3>
+; CHECK: sitofp <4 x i32> %vec.ind to <4 x float>
+; CHECK: %index.ext = zext i32 %index to i64
+; CHECK: getelementptr float* %{{.*}}, i64 %index.ext
+; CHECK: store <4 x float>
+}
+
+; Loops with calls are left alone.
+declare i32 @f(i32)
+
+define void @call(i32* %a, i64 %n) nounwind ssp {
+entry:
+  br label %for.body
+
+for.body:
+  %i = phi i64 [ %inc, %for.body ], [ 0, %entry ]
+  %arrayidx = getelementptr inbounds i32* %a, i64 %i
+  %0 = load i32* %arrayidx, align 4
+  %call = call i32 @f(i32 %0)
+  store i32 %call, i32* %arrayidx, align 4
+  %inc = add i64 %i, 1
+  %exitcond = icmp eq i64 %inc, %n
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+; CHECK: @call
+; CHECK-NOT: <4 x i32>
+; CHECK: ret void
+}
@@ -0,0 +1,67 @@
+; RUN: opt < %s -loop-vectorize -S | FileCheck %s
+; RUN: opt < %s -loop-vectorize -loop-vectorize-width=8 -S | FileCheck %s -check-prefix=WIDE
+target datalayout = "e-p:64:64:64-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:64:64-f32:32:32-f64:64:64-v64:64:64-v128:128:128-a0:0:64-s0:64:64-f80:128:128-n8:16:32:64"
+target triple = "x86_64-apple-darwin10.0.0"
+
+; sum += a[i] * b[i]
+define i32 @dot(i32* %a, i32* %b, i64 %n) nounwind readonly ssp {
+entry:
+  %cmp7 = icmp sgt i64 %n, 0
+  br i1 %cmp7, label %for.body, label %for.end
+
+for.body:
+  %i.09 = phi i64 [ %inc, %for.body ], [ 0, %entry ]
+  %sum.08 = phi i32 [ %add, %for.body ], [ 0, %entry ]
+  %arrayidx = getelementptr inbounds i32* %a, i64 %i.09
+  %0 = load i32* %arrayidx, align 4
+  %arrayidx1 = getelementptr inbounds i32* %b, i64 %i.09
+  %1 = load i32* %arrayidx1, align 4
+  %mul = mul nsw i32 %1, %0
+  %add = add nsw i32 %mul, %sum.08
+  %inc = add nsw i64 %i.09, 1
+  %exitcond = icmp eq i64 %inc, %n
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  %sum.0.lcssa = phi i32 [ 0, %entry ], [ %add, %for.body ]
+  ret i32 %sum.0.lcssa
+; Only loads, so no runtime checks are needed.
+; CHECK: @dot
+; CHECK-NOT: vector.memcheck
+; CHECK: vector.body:
+; CHECK: %vec.phi = phi <4 x i32> [ zeroinitializer, %vector.ph ]
+; CHECK: mul <4 x i32>
+; CHECK: add <4 x i32>
+; CHECK: middle.block:
+; CHECK: extractelement <4 x i32> %rdx.vec.exit, i32 3
+; CHECK: exit.merge:
+; CHECK: phi i32 [ %{{.*}}, %for.end{{.*}} ], [ %rdx, %middle.block ]
+; CHECK: ret i32
+
+; WIDE: @dot
+; WIDE: mul <8 x i32>
+; WIDE: add <8 x i32>
+; WIDE: extractelement <8 x i32> %rdx.vec.exit, i32 7
+}
+
+; Floating point reductions would need reassociation and are not widened.
+define float @fsum(float* %a, i64 %n) nounwind readonly ssp {
+entry:
+  br label %for.body
+
+for.body:
+  %i = phi i64 [ %inc, %for.body ], [ 0, %entry ]
+  %sum = phi float [ %add, %for.body ], [ 0.0, %entry ]
+  %arrayidx = getelementptr inbounds float* %a, i64 %i
+  %0 = load float* %arrayidx, align 4
+  %add = fadd float %sum, %0
+  %inc = add i64 %i, 1
+  %exitcond = icmp eq i64 %inc, %n
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret float %add
+; CHECK: @fsum
+; CHECK-NOT: <4 x float>
+; CHECK: ret float
+}
@@ -0,0 +1,132 @@
+; RUN: opt < %s -basicaa -slp-vectorizer -S | FileCheck %s
+target datalayout = "e-p:64:64:64-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:64:64-f32:32:32-f64:64:64-v64:64:64-v128:128:128-a0:0:64-s0:64:64-f80:128:128-n8:16:32:64"
+target triple = "x86_64-apple-darwin10.0.0"
+
+%struct.vec4 = type { float, float, float, float }
+
+; p->x = a->x + b->x; ... p->w = a->w + b->w;
+define void @add4(%struct.vec4* noalias %p, %struct.vec4* noalias %a, %struct.vec4* noalias %b) nounwind ssp {
+entry:
+  %ax = getelementptr inbounds %struct.vec4* %a, i64 0, i32 0
+  %0 = load float* %ax, align 4
+  %bx = getelementptr inbounds %struct.vec4* %b, i64 0, i32 0
+  %1 = load float* %bx, align 4
+  %addx = fadd float %0, %1
+  %px = getelementptr inbounds %struct.vec4* %p, i64 0, i32 0
+  store float %addx, float* %px, align 4
+  %ay = getelementptr inbounds %struct.vec4* %a, i64 0, i32 1
+  %2 = load float* %ay, align 4
+  %by = getelementptr inbounds %struct.vec4* %b, i64 0, i32 1
+  %3 = load float* %by, align 4
+  %addy = fadd float %2, %3
+  %py = getelementptr inbounds %struct.vec4* %p, i64 0, i32 1
+  store float %addy, float* %py, align 4
+  %az = getelementptr inbounds %struct.vec4* %a, i64 0, i32 2
+  %4 = load float* %az, align 4
+  %bz = getelementptr inbounds %struct.vec4* %b, i64 0, i32 2
+  %5 = load float* %bz, align 4
+  %addz = fadd float %4, %5
+  %pz = getelementptr inbounds %struct.vec4* %p, i64 0, i32 2
+  store float %addz, float* %pz, align 4
+  %aw = getelementptr inbounds %struct.vec4* %a, i64 0, i32 3
+  %6 = load float* %aw, align 4
+  %bw = getelementptr inbounds %struct.vec4* %b, i64 0, i32 3
+  %7 = load float* %bw, align 4
+  %addw = fadd float %6, %7
+  %pw = getelementptr inbounds %struct.vec4* %p, i64 0, i32 3
+  store float %addw, float* %pw, align 4
+  ret void
+; CHECK: @add4
+; CHECK: load <4 x float>* %{{.*}}, align 4
+; CHECK: load <4 x float>* %{{.*}}, align 4
+; CHECK: fadd <4 x float>
+; CHECK: store <4 x float> %{{.*}}, align 4
+; CHECK-NOT: store float
+; CHECK: ret void
+}
+
+; Scaling by a scalar gathers it into a vector; the first product is still
+; needed afterwards and is extracted again.
+define float @scale4(float* noalias %p, float* noalias %a, float %s) nounwind ssp {
+entry:
+  %0 = load float* %a, align 4
+  %mul0 = fmul float %0, %s
+  store float %mul0, float* %p, align 4
+  %a1 = getelementptr inbounds float* %a, i64 1
+  %1 = load float* %a1, align 4
+  %mul1 = fmul float %1, %s
+  %p1 = getelementptr inbounds float* %p, i64 1
+  store float %mul1, float* %p1, align 4
+  %a2 = getelementptr inbounds float* %a, i64 2
+  %2 = load float* %a2, align 4
+  %mul2 = fmul float %2, %s
+  %p2 = getelementptr inbounds float* %p, i64 2
+  store float %mul2, float* %p2, align 4
+  %a3 = getelementptr inbounds float* %a, i64 3
+  %3 = load float* %a3, align 4
+  %mul3 = fmul float %3, %s
+  %p3 = getelementptr inbounds float* %p, i64 3
+  store float %mul3, float* %p3, align 4
+  ret float %mul0
+; CHECK: @scale4
+; CHECK: insertelement <4 x float> undef, float %s, i32 0
+; CHECK: [[MUL:%[a-z0-9]+]] = fmul <4 x float>
+; CHECK: [[X:%[a-z0-9]+]] = extractelement <4 x float> [[MUL]], i32 0
+; CHECK: store <4 x float> [[MUL]]
+; CHECK-NOT: store float
+; CHECK: ret float [[X]]
+}
+
+; The second load reads the value written by the first store, so the loads
+; cannot be sunk past it.
+define void @dependent(i32* %p) nounwind ssp {
+entry:
+  %0 = load i32* %p, align 4
+  %add0 = add i32 %0, 1
+  %p1 = getelementptr inbounds i32* %p, i64 1
+  store i32 %add0, i32* %p1, align 4
+  %1 = load i32* %p1, align 4
+  %add1 = add i32 %1, 1
+  %p2 = getelementptr inbounds i32* %p, i64 2
+  store i32 %add1, i32* %p2, align 4
+  %2 = load i32* %p2, align 4
+  %add2 = add i32 %2, 1
+  %p3 = getelementptr inbounds i32* %p, i64 3
+  store i32 %add2, i32* %p3, align 4
+  %3 = load i32* %p3, align 4
+  %add3 = add i32 %3, 1
+  %p4 = getelementptr inbounds i32* %p, i64 4
+  store i32 %add3, i32* %p4, align 4
+  ret void
+; CHECK: @dependent
+; CHECK-NOT: <4 x i32>
+; CHECK: ret void
+}
+
+; Vector integer division is not available, and packing the operands would
+; only add work.
+define void @divide(i32* noalias %p, i32* noalias %a, i32 %d) nounwind ssp {
+entry:
+  %0 = load i32* %a, align 4
+  %div0 = sdiv i32 %0, %d
+  store i32 %div0, i32* %p, align 4
+  %a1 = getelementptr inbounds i32* %a, i64 1
+  %1 = load i32* %a1, align 4
+  %div1 = sdiv i32 %1, %d
+  %p1 = getelementptr inbounds i32* %p, i64 1
+  store i32 %div1, i32* %p1, align 4
+  %a2 = getelementptr inbounds i32* %a, i64 2
+  %2 = load i32* %a2, align 4
+  %div2 = sdiv i32 %2, %d
+  %p2 = getelementptr inbounds i32* %p, i64 2
+  store i32 %div2, i32* %p2, align 4
+  %a3 = getelementptr inbounds i32* %a, i64 3
+  %3 = load i32* %a3, align 4
+  %div3 = sdiv i32 %3, %d
+  %p3 = getelementptr inbounds i32* %p, i64 3
+  store i32 %div3, i32* %p3, align 4
+  ret void
+; CHECK: @divide
+; CHECK-NOT: sdiv <4 x i32>
+; CHECK: ret void
+}
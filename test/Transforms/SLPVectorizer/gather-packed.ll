@@ -0,0 +1,22 @@
+; RUN: opt < %s -basicaa -slp-vectorizer -slp-vector-bits=64 -S | FileCheck %s
+target datalayout = "e-p:64:64:64-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:64:64-f32:32:32-f64:64:64-v64:64:64-v128:128:128-a0:0:64-s0:64:64-f80:128:128-n8:16:32:64"
+target triple = "x86_64-apple-darwin10.0.0"
+
+; %l1 is gathered with %x for the first operands and packed with %l0 for the
+; second ones.  The gather would use the value extracted from the packed
+; load before its definition, so the tree is left alone.
+define void @shared(i32* noalias %p, i32* noalias %q, i32 %x) nounwind ssp {
+entry:
+  %q1 = getelementptr inbounds i32* %q, i64 1
+  %l0 = load i32* %q, align 4
+  %l1 = load i32* %q1, align 4
+  %a0 = add i32 %x, %l0
+  %a1 = add i32 %l1, %l1
+  %p1 = getelementptr inbounds i32* %p, i64 1
+  store i32 %a0, i32* %p, align 4
+  store i32 %a1, i32* %p1, align 4
+  ret void
+}
+; CHECK: @shared
+; CHECK-NOT: <2 x i32>
+; CHECK: ret void
@@ -17,16 +17,26 @@
 
 #include "llvm-c/lto.h"
 
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/Twine.h"
 #include "llvm/Support/ToolOutputFile.h"
 #include "llvm/Support/Errno.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/Program.h"
+#include "llvm/Support/system_error.h"
 
+#include <algorithm>
 #include <cerrno>
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <fstream>
 #include <list>
+#include <set>
 #include <vector>
 
 // Support Windows/MinGW crazyness.
@@ -77,6 +87,11 @@ namespace options {
   static std::string extra_library_path;
   static std::string triple;
   static std::string mcpu;
+  static unsigned partitions = 1;
+  // Directory holding previously generated objects, and the size in bytes it
+  // is pruned to after each link.  A size of zero means no limit.
+  static std::string cache_dir;
+  static unsigned long long cache_size = 0;
   // Additional options to pass into the code generator.
   // Note: This array will contain all plugin options which are not claimed
   // as plugin exclusive to pass to the code generator.
@@ -94,10 +109,23 @@ namespace options {
       generate_api_file = true;
     } else if (opt.startswith("mcpu=")) {
       mcpu = opt.substr(strlen("mcpu="));
+    } else if (opt.startswith("partitions=")) {
+      if (opt.substr(strlen("partitions=")).getAsInteger(10, partitions) ||
+          partitions == 0) {
+        (*message)(LDPL_WARNING, "Invalid number of partitions: %s", opt_);
+        partitions = 1;
+      }
     } else if (opt.startswith("extra-library-path=")) {
       extra_library_path = opt.substr(strlen("extra_library_path="));
     } else if (opt.startswith("mtriple=")) {
       triple = opt.substr(strlen("mtriple="));
+    } else if (opt.startswith("cache-dir=")) {
+      cache_dir = opt.substr(strlen("cache-dir="));
+    } else if (opt.startswith("cache-size=")) {
+      if (opt.substr(strlen("cache-size=")).getAsInteger(10, cache_size)) {
+        (*message)(LDPL_WARNING, "Invalid cache size: %s", opt_);
+        cache_size = 0;
+      }
     } else if (opt.startswith("obj-path=")) {
       obj_path = opt.substr(strlen("obj-path="));
     } else if (opt == "emit-llvm") {
@@ -120,6 +148,263 @@ namespace options {
   }
 }
 
+/// The object cache lets a relink skip optimization and code generation when
+/// nothing that affects them has changed.  Each entry is a directory named by
+/// a hash of the claimed bitcode, the symbols which must be preserved and the
+/// code generation options.  It holds the objects (N.o) and a marker (entry)
+/// with the number of objects, which is rewritten on every hit so that its
+/// age tells how recently the entry was used.  An entry is built in a
+/// directory of its own and renamed into place, so other links see either
+/// all of it or nothing.  A hit links the objects under private names before
+/// handing them to gold, so a concurrent link may prune the entry while gold
+/// still has to open them.
+namespace cache {
+  /// Key - Two FNV-1a hashes with different offset bases, giving a 128 bit
+  /// name.  This only has to tell builds apart, not resist deliberate
+  /// collisions.
+  class Key {
+    uint64_t A, B;
+
+    void add(const unsigned char *P, size_t Len) {
+      for (size_t i = 0; i != Len; ++i) {
+        A = (A ^ P[i]) * 1099511628211ULL;
+        B = (B ^ P[i]) * 1099511628211ULL;
+      }
+    }
+  public:
+    Key() : A(14695981039346656037ULL), B(0x84222325CBF29CE4ULL) {}
+
+    /// add - Add a field.  Fields are length prefixed so that their
+    /// boundaries are part of the key.
+    void add(const void *Data, size_t Len) {
+      uint64_t L = Len;
+      unsigned char LenBytes[8];
+      for (unsigned i = 0; i != 8; ++i)
+        LenBytes[i] = (unsigned char)(L >> (i * 8));
+      add(LenBytes, 8);
+      add(static_cast<const unsigned char*>(Data), Len);
+    }
+    void add(StringRef S) { add(S.data(), S.size()); }
+
+    std::string str() const {
+      char Buf[33];
+      snprintf(Buf, sizeof(Buf), "%016llx%016llx", (unsigned long long)A,
+               (unsigned long long)B);
+      return Buf;
+    }
+  };
+
+  static Key key;
+
+  /// StaleSeconds - How long an entry which is still being built has to be
+  /// left untouched before it is taken to be left behind by a failed link,
+  /// and pruned.
+  static const int64_t StaleSeconds = 60 * 60;
+
+  static std::string getPath(const std::string &Name) {
+    sys::Path P(options::cache_dir);
+    P.appendComponent(Name);
+    return P.str();
+  }
+
+  static std::string getFilePath(const std::string &Dir, const Twine &Name) {
+    sys::Path P(Dir);
+    P.appendComponent(Name.str());
+    return P.str();
+  }
+
+  static std::string getObjectPath(const std::string &Dir, unsigned i) {
+    return getFilePath(Dir, Twine(i) + ".o");
+  }
+
+  /// writeMarker - Write the marker of the entry in Dir.
+  static bool writeMarker(const std::string &Dir, unsigned NumObjects) {
+    std::string Path = getFilePath(Dir, "entry");
+    int FD;
+    SmallString<128> TmpPath;
+    if (sys::fs::unique_file(Path + ".tmp-%%%%%%", FD, TmpPath))
+      return false;
+    {
+      raw_fd_ostream OS(FD, /*shouldClose=*/true);
+      OS << NumObjects << '\n';
+      OS.close();
+      if (OS.has_error()) {
+        OS.clear_error();
+        bool Existed;
+        sys::fs::remove(TmpPath.str(), Existed);
+        return false;
+      }
+    }
+    return !sys::fs::rename(TmpPath.str(), Path);
+  }
+
+  /// linkPrivateCopy - Make Path a new temporary file with the contents of the
+  /// object Obj, hard linked to it where possible.
+  static bool linkPrivateCopy(const std::string &Obj, unsigned i,
+                              std::string &Path) {
+    int FD;
+    SmallString<128> TmpPath;
+    if (sys::fs::unique_file(Twine("lto-cache-%%%%%%-") + Twine(i) + ".o", FD,
+                             TmpPath))
+      return false;
+    { raw_fd_ostream Close(FD, /*shouldClose=*/true); }
+    Path = TmpPath.str().str();
+    bool Existed;
+    if (sys::fs::remove(Path, Existed))
+      return false;
+    return !sys::fs::create_hard_link(Obj, Path) ||
+           !sys::fs::copy_file(Obj, Path, sys::fs::copy_option::fail_if_exists);
+  }
+
+  /// lookup - If the cache holds an entry for K, fill in the paths of private
+  /// copies of its objects, mark it as recently used and return true.  The
+  /// caller has to remove the copies.
+  static bool lookup(const std::string &K, std::vector<std::string> &Objs) {
+    std::string Dir = getPath(K);
+    OwningPtr<MemoryBuffer> Marker;
+    if (MemoryBuffer::getFile(getFilePath(Dir, "entry"), Marker))
+      return false;
+    unsigned NumObjects;
+    StringRef Count = Marker->getBuffer();
+    Count = Count.substr(0, Count.find('\n'));
+    if (Count.getAsInteger(10, NumObjects) || NumObjects == 0)
+      return false;
+
+    // If a concurrent link prunes the entry meanwhile, this is a miss.
+    std::vector<std::string> Paths;
+    for (unsigned i = 0; i != NumObjects; ++i) {
+      std::string Path;
+      if (!linkPrivateCopy(getObjectPath(Dir, i), i, Path)) {
+        bool Existed;
+        for (unsigned j = 0, je = Paths.size(); j != je; ++j)
+          sys::fs::remove(Paths[j], Existed);
+        return false;
+      }
+      Paths.push_back(Path);
+    }
+
+    writeMarker(Dir, NumObjects);
+    Objs.swap(Paths);
+    return true;
+  }
+
+  /// store - Add the objects generated for K to the cache.  They are copied
+  /// into a new directory, which is then renamed to K.
+  static void store(const std::string &K,
+                    const std::vector<std::string> &Objs) {
+    bool Existed;
+    if (sys::fs::create_directories(options::cache_dir, Existed)) {
+      (*message)(LDPL_WARNING, "Unable to create cache directory %s",
+                 options::cache_dir.c_str());
+      return;
+    }
+
+    // Reserve a unique name with a file, and build the entry in a directory
+    // named after it.
+    int FD;
+    SmallString<128> Reserved;
+    if (sys::fs::unique_file(getPath(K + ".tmp-%%%%%%"), FD, Reserved)) {
+      (*message)(LDPL_WARNING, "Unable to add %s to the cache", K.c_str());
+      return;
+    }
+    { raw_fd_ostream Close(FD, /*shouldClose=*/true); }
+    sys::Path TmpDir(Reserved.str().str() + ".d");
+    bool Stored = !TmpDir.createDirectoryOnDisk(false, 0);
+    for (unsigned i = 0, e = Objs.size(); Stored && i != e; ++i)
+      Stored = !sys::fs::copy_file(Objs[i], getObjectPath(TmpDir.str(), i),
+                                   sys::fs::copy_option::fail_if_exists);
+    Stored = Stored && writeMarker(TmpDir.str(), Objs.size());
+
+    // If another link has added the same entry meanwhile, keep that one.
+    if (Stored && sys::fs::rename(TmpDir.str(), getPath(K))) {
+      bool Exists;
+      Stored = !sys::fs::exists(getPath(K), Exists) && Exists;
+    }
+    if (!Stored)
+      (*message)(LDPL_WARNING, "Unable to add %s to the cache", K.c_str());
+    TmpDir.eraseFromDisk(true);
+    sys::fs::remove(Reserved.str(), Existed);
+  }
+
+  struct Entry {
+    sys::TimeValue LastUse;
+    uint64_t Size;
+    std::vector<sys::Path> Files;
+    Entry() : LastUse(0, 0), Size(0) {}
+  };
+
+  static bool isOlder(const Entry *A, const Entry *B) {
+    return A->LastUse < B->LastUse;
+  }
+
+  /// addFile - Add the file or directory at P to Ent.  The age of an entry is
+  /// the age of its marker; anything else is aged by its newest file.
+  static void addFile(Entry &Ent, const sys::Path &P, bool IsEntry) {
+    const sys::FileStatus *Status =
+      sys::PathWithStatus(P).getFileStatus(false, 0);
+    if (!Status)
+      return;
+    if (!Status->isDir) {
+      Ent.Size += Status->getSize();
+      if (!IsEntry || sys::path::filename(P.str()) == "entry")
+        Ent.LastUse = std::max(Ent.LastUse, Status->getTimestamp());
+      return;
+    }
+    if (!IsEntry)
+      Ent.LastUse = std::max(Ent.LastUse, Status->getTimestamp());
+    std::set<sys::Path> Contents;
+    if (P.getDirectoryContents(Contents, 0))
+      return;
+    for (std::set<sys::Path>::iterator I = Contents.begin(),
+         E = Contents.end(); I != E; ++I)
+      addFile(Ent, *I, IsEntry);
+  }
+
+  /// prune - Remove the least recently used entries, other than Keep, until
+  /// the cache is no bigger than the cache-size option.  Entries which are
+  /// still being built are left alone unless they are stale.
+  static void prune(const std::string &Keep) {
+    if (options::cache_size == 0)
+      return;
+
+    std::set<sys::Path> Contents;
+    if (sys::Path(options::cache_dir).getDirectoryContents(Contents, 0))
+      return;
+
+    // Entries are named by their 32 digit key.  Entries being built, or left
+    // behind by a link which failed, have a longer name starting with it.
+    StringMap<Entry> Entries;
+    uint64_t TotalSize = 0;
+    for (std::set<sys::Path>::iterator I = Contents.begin(),
+         E = Contents.end(); I != E; ++I) {
+      StringRef Name = sys::path::filename(I->str());
+      if (Name.size() < 32 || (Name.size() > 32 && Name[32] != '.'))
+        continue;
+      Entry &Ent = Entries[Name];
+      Ent.Files.push_back(*I);
+      addFile(Ent, *I, Name.size() == 32);
+      TotalSize += Ent.Size;
+    }
+
+    sys::TimeValue Stale = sys::TimeValue::now();
+    Stale -= sys::TimeValue(StaleSeconds, 0);
+    std::vector<Entry*> ByAge;
+    for (StringMap<Entry>::iterator I = Entries.begin(), E = Entries.end();
+         I != E; ++I)
+      if (I->getKey() != Keep &&
+          (I->getKey().size() == 32 || I->getValue().LastUse < Stale))
+        ByAge.push_back(&I->getValue());
+    std::sort(ByAge.begin(), ByAge.end(), isOlder);
+
+    for (unsigned i = 0, e = ByAge.size();
+         i != e && TotalSize > options::cache_size; ++i) {
+      for (unsigned j = 0, je = ByAge[i]->Files.size(); j != je; ++j)
+        ByAge[i]->Files[j].eraseFromDisk(true);
+      TotalSize -= ByAge[i]->Size;
+    }
+  }
+}
+
 static ld_plugin_status claim_file_hook(const ld_plugin_input_file *file,
                                         int *claimed);
 static ld_plugin_status all_symbols_read_hook(void);
@@ -235,9 +520,9 @@ ld_plugin_status onload(ld_plugin_tv *tv) {
 static ld_plugin_status claim_file_hook(const ld_plugin_input_file *file,
                                         int *claimed) {
   lto_module_t M;
+  const void *view = NULL;
 
   if (get_view) {
-    const void *view;
     if (get_view(file->handle, &view) != LDPS_OK) {
       (*message)(LDPL_ERROR, "Failed to get a view of %s", file->name);
       return LDPS_ERR;
@@ -254,6 +539,23 @@ static ld_plugin_status claim_file_hook(const ld_plugin_input_file *file,
   if (!M)
     return LDPS_OK;
 
+  if (!options::cache_dir.empty()) {
+    // The cache key covers the contents of every claimed file, in order.
+    if (view) {
+      cache::key.add(view, file->filesize);
+    } else {
+      OwningPtr<MemoryBuffer> Buffer;
+      if (error_code ec = MemoryBuffer::getOpenFile(file->fd, file->name,
+                                                    Buffer, file->filesize,
+                                                    -1, file->offset, false)) {
+        (*message)(LDPL_ERROR, "Failed to read %s: %s", file->name,
+                   ec.message().c_str());
+        return LDPS_ERR;
+      }
+      cache::key.add(Buffer->getBufferStart(), Buffer->getBufferSize());
+    }
+  }
+
   *claimed = 1;
   Modules.resize(Modules.size() + 1);
   claimed_file &cf = Modules.back();
@@ -365,6 +667,7 @@ static ld_plugin_status all_symbols_read_hook(void) {
       if (I->syms[i].resolution == LDPR_PREVAILING_DEF) {
         lto_codegen_add_must_preserve_symbol(code_gen, I->syms[i].name);
         anySymbolsPreserved = true;
+        cache::key.add(I->syms[i].name);
 
         if (options::generate_api_file)
           api_file << I->syms[i].name << "\n";
@@ -385,6 +688,7 @@ static ld_plugin_status all_symbols_read_hook(void) {
   lto_codegen_set_debug_model(code_gen, LTO_DEBUG_MODEL_DWARF);
   if (!options::mcpu.empty())
     lto_codegen_set_cpu(code_gen, options::mcpu.c_str());
+  lto_codegen_set_num_partitions(code_gen, options::partitions);
 
   // Pass through extra options to the code generator.
   if (!options::extra.empty()) {
@@ -408,11 +712,43 @@ static ld_plugin_status all_symbols_read_hook(void) {
     if (options::generate_bc_file == options::BC_ONLY)
       exit(0);
   }
-  size_t bufsize = 0;
-  const char *objPath;
-  if (lto_codegen_compile_to_file(code_gen, &objPath)) {
-    (*message)(LDPL_ERROR, "Could not produce a combined object file\n");
+  // Everything else which affects the generated code goes into the cache key.
+  std::string cacheKey;
+  bool cacheHit = false;
+  std::vector<std::string> objPaths;
+  if (!options::cache_dir.empty()) {
+    cache::key.add(lto_get_version());
+    cache::key.add(&output_type, sizeof(output_type));
+    cache::key.add(&options::partitions, sizeof(options::partitions));
+    cache::key.add(options::mcpu);
+    cache::key.add(options::triple);
+    for (unsigned i = 0, e = options::extra.size(); i != e; ++i)
+      cache::key.add(options::extra[i]);
+    cacheKey = cache::key.str();
+    cacheHit = cache::lookup(cacheKey, objPaths);
+    // The private copies of the cached objects are always removed.
+    for (unsigned i = 0; cacheHit && i != objPaths.size(); ++i)
+      Cleanup.push_back(sys::Path(objPaths[i]));
+  }
+
+  if (!cacheHit) {
+    // The names belong to code_gen, so copy them before it is disposed of.
+    const char **objNames;
+    unsigned numObjs;
+    if (lto_codegen_compile_to_files(code_gen, &objNames, &numObjs)) {
+      // One failed partition means there is no complete set of objects, so
+      // the link must fail rather than go on with missing definitions.
+      (*message)(LDPL_ERROR, "Could not produce a combined object file: %s",
+                 lto_get_error_message());
+      lto_codegen_dispose(code_gen);
+      return LDPS_ERR;
+    }
+    objPaths.assign(objNames, objNames + numObjs);
+    if (!cacheKey.empty())
+      cache::store(cacheKey, objPaths);
   }
+  if (!cacheKey.empty())
+    cache::prune(cacheKey);
 
   lto_codegen_dispose(code_gen);
   for (std::list<claimed_file>::iterator I = Modules.begin(),
@@ -423,10 +759,12 @@ static ld_plugin_status all_symbols_read_hook(void) {
     }
   }
 
-  if ((*add_input_file)(objPath) != LDPS_OK) {
-    (*message)(LDPL_ERROR, "Unable to add .o file to the link.");
-    (*message)(LDPL_ERROR, "File left behind in: %s", objPath);
-    return LDPS_ERR;
+  for (unsigned i = 0, e = objPaths.size(); i != e; ++i) {
+    if ((*add_input_file)(objPaths[i].c_str()) != LDPS_OK) {
+      (*message)(LDPL_ERROR, "Unable to add .o file to the link.");
+      (*message)(LDPL_ERROR, "File left behind in: %s", objPaths[i].c_str());
+      return LDPS_ERR;
+    }
   }
 
   if (!options::extra_library_path.empty() &&
@@ -435,8 +773,10 @@ static ld_plugin_status all_symbols_read_hook(void) {
     return LDPS_ERR;
   }
 
-  if (options::obj_path.empty())
-    Cleanup.push_back(sys::Path(objPath));
+  // Objects from the cache stay there for the next link.
+  if (options::obj_path.empty() && !cacheHit)
+    for (unsigned i = 0, e = objPaths.size(); i != e; ++i)
+      Cleanup.push_back(sys::Path(objPaths[i]));
 
   return LDPS_OK;
 }
@@ -21,8 +21,10 @@
 #include "llvm/CodeGen/LinkAllCodegenComponents.h"
 #include "llvm/ExecutionEngine/GenericValue.h"
 #include "llvm/ExecutionEngine/Interpreter.h"
+#include "llvm/ExecutionEngine/JITCodeCache.h"
 #include "llvm/ExecutionEngine/JIT.h"
 #include "llvm/ExecutionEngine/JITEventListener.h"
+#include "llvm/ExecutionEngine/JITMemoryManager.h"
 #include "llvm/ExecutionEngine/MCJIT.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/IRReader.h"
@@ -108,14 +110,46 @@ namespace {
   NoLazyCompilation("disable-lazy-compilation",
                   cl::desc("Disable JIT lazy compilation"),
                   cl::init(false));
+
+  cl::opt<bool>
+  BackgroundCompilation("jit-background-compile",
+                  cl::desc("Compile the callees of lazily compiled functions "
+                           "on a background thread"),
+                  cl::init(false));
+
+  cl::opt<unsigned>
+  TierUpThreshold("jit-tier-up-threshold",
+                  cl::desc("Compile functions at -O0 first and recompile "
+                           "them after this many calls (0 = off)"),
+                  cl::init(0));
+
+  cl::opt<bool>
+  RegionMemoryManager("jit-region-memory-manager",
+                  cl::desc("Allocate JIT code in per-module regions that are "
+                           "never writable and executable at once"),
+                  cl::init(false));
+
+  cl::opt<std::string>
+  CodeCacheDir("jit-cache-dir",
+               cl::desc("Load and save generated code in this directory "
+                        "(MC-based JIT only)"),
+               cl::value_desc("directory"));
+
+  cl::opt<unsigned>
+  CodeCacheSizeLimit("jit-cache-size-limit",
+                     cl::desc("Maximum size of the JIT code cache in "
+                              "kilobytes (0 = unlimited)"),
+                     cl::init(0));
 }
 
 static ExecutionEngine *EE = 0;
+static JITCodeCache *CodeCache = 0;
 
 static void do_shutdown() {
   // Cygwin-1.5 invokes DLL's dtors before atexit handler.
 #ifndef DO_NOTHING_ATEXIT
   delete EE;
+  delete CodeCache;
   llvm_shutdown();
 #endif
 }
@@ -177,6 +211,9 @@ int main(int argc, char **argv, char * const *envp) {
   if (UseMCJIT)
     builder.setUseMCJIT(true);
 
+  if (RegionMemoryManager)
+    builder.setJITMemoryManager(JITMemoryManager::CreateRegionMemManager());
+
   CodeGenOpt::Level OLvl = CodeGenOpt::Default;
   switch (OptLevel) {
   default:
@@ -202,6 +239,14 @@ int main(int argc, char **argv, char * const *envp) {
   EE->RegisterJITEventListener(createOProfileJITEventListener());
 
   EE->DisableLazyCompilation(NoLazyCompilation);
+  EE->EnableBackgroundCompilation(BackgroundCompilation);
+  if (TierUpThreshold)
+    EE->EnableTieredCompilation(TierUpThreshold);
+  if (!CodeCacheDir.empty()) {
+    CodeCache = new JITCodeCache(CodeCacheDir,
+                                 uint64_t(CodeCacheSizeLimit) * 1024);
+    EE->setCodeCache(CodeCache);
+  }
 
   // If the user specifically requested an argv[0] to pass into the program,
   // do it now.
@@ -21,6 +21,7 @@
 #include "llvm/LLVMContext.h"
 #include "llvm/Module.h"
 #include "llvm/PassManager.h"
+#include "llvm/ADT/OwningPtr.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/Triple.h"
 #include "llvm/Analysis/Passes.h"
@@ -34,6 +35,7 @@
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/Target/TargetRegistry.h"
 #include "llvm/Target/TargetSelect.h"
+#include "llvm/Transforms/Utils/SplitModule.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/FormattedStream.h"
 #include "llvm/Support/MemoryBuffer.h"
@@ -43,6 +45,7 @@
 #include "llvm/Support/Host.h"
 #include "llvm/Support/Program.h"
 #include "llvm/Support/Signals.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/system_error.h"
 #include "llvm/Config/config.h"
 #include <cstdlib>
@@ -71,7 +74,7 @@ LTOCodeGenerator::LTOCodeGenerator()
       _linker("LinkTimeOptimizer", "ld-temp.o", _context), _target(NULL),
       _emitDwarfDebugInfo(false), _scopeRestrictionsDone(false),
       _codeModel(LTO_CODEGEN_PIC_MODEL_DYNAMIC),
-      _nativeObjectFile(NULL)
+      _nativeObjectFile(NULL), _numPartitions(1)
 {
     InitializeAllTargets();
     InitializeAllAsmPrinters();
@@ -136,6 +139,11 @@ void LTOCodeGenerator::setCpu(const char* mCpu)
   _mCpu = mCpu;
 }
 
+void LTOCodeGenerator::setNumPartitions(unsigned num)
+{
+  _numPartitions = num ? num : 1;
+}
+
 void LTOCodeGenerator::addMustPreserveSymbol(const char* sym)
 {
     _mustPreserveSymbols[sym] = 1;
@@ -266,6 +274,8 @@ bool LTOCodeGenerator::determineTarget(std::string& errMsg)
         Features.getDefaultSubtargetFeatures(_mCpu, llvm::Triple(Triple));
         std::string FeatureStr = Features.getString();
         _target = march->createTargetMachine(Triple, FeatureStr);
+        _targetTriple = Triple;
+        _targetFeatures = FeatureStr;
     }
     return false;
 }
@@ -354,9 +364,35 @@ void LTOCodeGenerator::applyScopeRestrictions() {
   _scopeRestrictionsDone = true;
 }
 
+/// emitObjectFile - Run the code generator over every function in M and write
+/// the resulting object file to out.
+static bool emitObjectFile(Module &M, TargetMachine &TM, raw_ostream &out,
+                           std::string &errMsg) {
+  // The stream must outlive the passes, which may flush to it as they are
+  // destroyed.
+  formatted_raw_ostream Out(out);
+
+  FunctionPassManager codeGenPasses(&M);
+  codeGenPasses.add(new TargetData(*TM.getTargetData()));
+
+  if (TM.addPassesToEmitFile(codeGenPasses, Out,
+                             TargetMachine::CGFT_ObjectFile,
+                             CodeGenOpt::Aggressive)) {
+    errMsg = "target file type not supported";
+    return true;
+  }
+
+  // Run the code generator, and write the object file.
+  codeGenPasses.doInitialization();
+  for (Module::iterator it = M.begin(), e = M.end(); it != e; ++it)
+    if (!it->isDeclaration())
+      codeGenPasses.run(*it);
+  codeGenPasses.doFinalization();
+  return false;
+}
+
 /// Optimize merged modules using various IPO passes
-bool LTOCodeGenerator::generateObjectFile(raw_ostream& out,
-                                          std::string& errMsg)
+bool LTOCodeGenerator::optimizeMergedModule(std::string& errMsg)
 {
     if ( this->determineTarget(errMsg) ) 
         return true;
@@ -386,34 +422,171 @@ bool LTOCodeGenerator::generateObjectFile(raw_ostream& out,
     // Make sure everything is still good.
     passes.add(createVerifierPass());
 
-    FunctionPassManager* codeGenPasses = new FunctionPassManager(mergedModule);
+    // Run our queue of passes all at once now, efficiently.
+    passes.run(*mergedModule);
+
+    return false; // success
+}
+
+bool LTOCodeGenerator::generateObjectFile(raw_ostream& out,
+                                          std::string& errMsg)
+{
+    if ( this->optimizeMergedModule(errMsg) )
+        return true;
+
+    return emitObjectFile(*_linker.getModule(), *_target, out, errMsg);
+}
+
+//===----------------------------------------------------------------------===//
+// Partitioned code generation
+//===----------------------------------------------------------------------===//
+//
+// The optimized merged module can be split into several partitions, see
+// SplitModule.h, which are code generated on separate threads.  LLVMContexts
+// are not thread safe, so each partition is handed to its thread as bitcode
+// and read into a context of its own.
+//
+
+namespace {
+/// PartitionJob - The input and output of code generation for one partition.
+struct PartitionJob {
+  const Target *March;
+  std::string Triple;
+  std::string Features;
+  std::string Bitcode;
+  std::string Object;
+  std::string ErrMsg;
+  bool Failed;
+
+  PartitionJob() : March(0), Failed(false) {}
+};
+}
+
+/// generatePartition - Code generate one partition, possibly on its own
+/// thread.
+static void generatePartition(void *Arg) {
+  PartitionJob &Job = *static_cast<PartitionJob*>(Arg);
+
+  LLVMContext Context;
+  OwningPtr<MemoryBuffer> Buffer(
+    MemoryBuffer::getMemBuffer(Job.Bitcode, "ld-temp.o", false));
+  OwningPtr<Module> M(ParseBitcodeFile(Buffer.get(), Context, &Job.ErrMsg));
+  if (!M) {
+    Job.Failed = true;
+    return;
+  }
+  std::string().swap(Job.Bitcode);
+
+  OwningPtr<TargetMachine> TM(
+    Job.March->createTargetMachine(Job.Triple, Job.Features));
+  raw_string_ostream OS(Job.Object);
+  Job.Failed = emitObjectFile(*M, *TM, OS, Job.ErrMsg);
+  OS.flush();
+}
+
+/// Optimize the merged modules and generate one object file per partition
+bool LTOCodeGenerator::generatePartitionedObjects(
+                                           std::vector<std::string>& objects,
+                                           std::string& errMsg) {
+  if (optimizeMergedModule(errMsg))
+    return true;
+
+  Module *mergedModule = _linker.getModule();
+  objects.clear();
+
+  ModulePartitionMap Owner;
+  if (_numPartitions <= 1 ||
+      !AssignModulePartitions(*mergedModule, _numPartitions, Owner)) {
+    objects.resize(1);
+    raw_string_ostream OS(objects[0]);
+    bool Failed = emitObjectFile(*mergedModule, *_target, OS, errMsg);
+    OS.flush();
+    return Failed;
+  }
+
+  PromoteCrossPartitionLocals(*mergedModule, Owner);
+
+  std::vector<PartitionJob> Jobs(_numPartitions);
+  for (unsigned i = 0; i != _numPartitions; ++i) {
+    OwningPtr<Module> Clone(ExtractModulePartition(*mergedModule, i, Owner));
+
+    raw_string_ostream OS(Jobs[i].Bitcode);
+    WriteBitcodeToFile(Clone.get(), OS);
+    OS.flush();
 
-    codeGenPasses->add(new TargetData(*_target->getTargetData()));
+    Jobs[i].March = &_target->getTarget();
+    Jobs[i].Triple = _targetTriple;
+    Jobs[i].Features = _targetFeatures;
+  }
+
+  // The code generator keeps global state, such as statistics and managed
+  // statics, which is only guarded once LLVM is in multithreaded mode.
+  bool Threaded = llvm_is_multithreaded() || llvm_start_multithreaded();
 
-    formatted_raw_ostream Out(out);
+  std::vector<llvm_thread*> Threads;
+  for (unsigned i = 0; i != _numPartitions; ++i) {
+    if (Threaded)
+      Threads.push_back(llvm_start_thread(generatePartition, &Jobs[i]));
+    else
+      generatePartition(&Jobs[i]);
+  }
+  for (unsigned i = 0, e = Threads.size(); i != e; ++i)
+    llvm_join_thread(Threads[i]);
 
-    if (_target->addPassesToEmitFile(*codeGenPasses, Out,
-                                     TargetMachine::CGFT_ObjectFile,
-                                     CodeGenOpt::Aggressive)) {
-      errMsg = "target file type not supported";
+  for (unsigned i = 0; i != _numPartitions; ++i) {
+    if (Jobs[i].Failed) {
+      errMsg = Jobs[i].ErrMsg;
+      objects.clear();
       return true;
     }
+    objects.push_back(std::string());
+    objects.back().swap(Jobs[i].Object);
+  }
+  return false;
+}
 
-    // Run our queue of passes all at once now, efficiently.
-    passes.run(*mergedModule);
+bool LTOCodeGenerator::compile_to_files(const char*** names, unsigned* count,
+                                        std::string& errMsg)
+{
+  std::vector<std::string> objects;
+  if (generatePartitionedObjects(objects, errMsg))
+    return true;
 
-    // Run the code generator, and write assembly file
-    codeGenPasses->doInitialization();
+  _nativeObjectPaths.clear();
+  _nativeObjectNames.clear();
 
-    for (Module::iterator
-           it = mergedModule->begin(), e = mergedModule->end(); it != e; ++it)
-      if (!it->isDeclaration())
-        codeGenPasses->run(*it);
+  for (unsigned i = 0, e = objects.size(); i != e; ++i) {
+    // make unique temp .o file to put generated object file
+    sys::PathWithStatus uniqueObjPath("lto-llvm.o");
+    if ( uniqueObjPath.createTemporaryFileOnDisk(false, &errMsg) ) {
+      uniqueObjPath.eraseFromDisk();
+      return true;
+    }
+    sys::RemoveFileOnSignal(uniqueObjPath);
 
-    codeGenPasses->doFinalization();
-    delete codeGenPasses;
+    std::string ErrInfo;
+    tool_output_file objFile(uniqueObjPath.c_str(), ErrInfo,
+                             raw_fd_ostream::F_Binary);
+    if (!ErrInfo.empty()) {
+      errMsg = ErrInfo;
+      return true;
+    }
+    objFile.os() << objects[i];
+    objFile.os().close();
+    if (objFile.os().has_error()) {
+      errMsg = "could not write object file: " + uniqueObjPath.str();
+      objFile.os().clear_error();
+      return true;
+    }
+    objFile.keep();
+    _nativeObjectPaths.push_back(uniqueObjPath.str());
+  }
 
-    return false; // success
+  for (unsigned i = 0, e = _nativeObjectPaths.size(); i != e; ++i)
+    _nativeObjectNames.push_back(_nativeObjectPaths[i].c_str());
+  *names = &_nativeObjectNames[0];
+  *count = _nativeObjectNames.size();
+  return false;
 }
 
 
@@ -38,15 +38,22 @@ struct LTOCodeGenerator {
     bool                setDebugInfo(lto_debug_model, std::string& errMsg);
     bool                setCodePICModel(lto_codegen_model, std::string& errMsg);
     void                setCpu(const char *cpu);
+    void                setNumPartitions(unsigned num);
     void                addMustPreserveSymbol(const char* sym);
     bool                writeMergedModules(const char* path, 
                                                            std::string& errMsg);
     bool                compile_to_file(const char** name, std::string& errMsg);
+    bool                compile_to_files(const char*** names, unsigned* count,
+                                         std::string& errMsg);
     const void*         compile(size_t* length, std::string& errMsg);
     void                setCodeGenDebugOptions(const char *opts); 
 private:
     bool                generateObjectFile(llvm::raw_ostream& out, 
                                            std::string& errMsg);
+    bool                generatePartitionedObjects(
+                                           std::vector<std::string>& objects,
+                                           std::string& errMsg);
+    bool                optimizeMergedModule(std::string& errMsg);
     void                applyScopeRestrictions();
     void                applyRestriction(llvm::GlobalValue &GV,
                                      std::vector<const char*> &mustPreserveList,
@@ -67,7 +74,12 @@ private:
     llvm::MemoryBuffer*         _nativeObjectFile;
     std::vector<const char*>    _codegenOptions;
     std::string                 _mCpu;
+    std::string                 _targetTriple;
+    std::string                 _targetFeatures;
+    unsigned                    _numPartitions;
     std::string                 _nativeObjectPath;
+    std::vector<std::string>    _nativeObjectPaths;
+    std::vector<const char*>    _nativeObjectNames;
 };
 
 #endif // LTO_CODE_GENERATOR_H
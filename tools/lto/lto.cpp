@@ -239,6 +239,14 @@ void lto_codegen_set_cpu(lto_code_gen_t cg, const char* cpu)
   return cg->setCpu(cpu);
 }
 
+//
+// sets the number of partitions to code generate in parallel
+//
+void lto_codegen_set_num_partitions(lto_code_gen_t cg, unsigned num)
+{
+  cg->setNumPartitions(num);
+}
+
 //
 // sets the path to the assembler tool
 //
@@ -299,6 +307,18 @@ lto_codegen_compile_to_file(lto_code_gen_t cg, const char **name)
   return cg->compile_to_file(name, sLastErrorString);
 }
 
+//
+// Generates code for all added modules into one native object file per
+// partition.  The names of the files are written to names.
+// Returns true on error.
+//
+extern bool
+lto_codegen_compile_to_files(lto_code_gen_t cg, const char ***names,
+                             unsigned *count)
+{
+  return cg->compile_to_files(names, count, sLastErrorString);
+}
+
 
 //
 // Used to pass extra options to the code generator
@@ -26,6 +26,7 @@
 #include "llvm/Target/TargetData.h"
 #include "llvm/Target/TargetLibraryInfo.h"
 #include "llvm/Target/TargetMachine.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/StringSet.h"
 #include "llvm/ADT/Triple.h"
 #include "llvm/Support/PassNameParser.h"
@@ -40,6 +41,7 @@
 #include "llvm/Support/ToolOutputFile.h"
 #include "llvm/LinkAllPasses.h"
 #include "llvm/LinkAllVMCore.h"
+#include <cstring>
 #include <memory>
 #include <algorithm>
 using namespace llvm;
@@ -141,6 +143,12 @@ DefaultDataLayout("default-data-layout",
           cl::desc("data layout string to use if not specified by module"),
           cl::value_desc("layout-string"), cl::init(""));
 
+static cl::opt<unsigned>
+ParallelFunctionPasses("parallel-function-passes",
+  cl::desc("Run the -O1/-O2/-O3 function passes, or a list of passes which "
+           "are safe to run concurrently, on this many threads"),
+  cl::value_desc("N"), cl::init(0));
+
 // ---------- Define Printers for module and function passes ------------
 namespace {
 
@@ -390,6 +398,17 @@ struct BreakpointPrinter : public ModulePass {
 
 char BreakpointPrinter::ID = 0;
 
+/// ParallelPipeline - The function passes run by runFunctionPassesInParallel
+/// when -parallel-function-passes is given: the standard function passes of
+/// each -O level, or the passes named on the command line.
+struct ParallelPipeline {
+  Module *M;
+  const TargetData *TD;
+  bool AddLibraryInfo;
+  std::vector<unsigned> OptLevels;
+  std::vector<const PassInfo*> Passes;
+};
+
 inline void addPass(PassManagerBase &PM, Pass *P) {
   // Add the pass to the pass manager...
   PM.add(P);
@@ -398,14 +417,54 @@ inline void addPass(PassManagerBase &PM, Pass *P) {
   if (VerifyEach) PM.add(createVerifierPass());
 }
 
+/// PopulateParallelPipeline - Add the passes of a ParallelPipeline to the pass
+/// manager of one thread.
+void PopulateParallelPipeline(FunctionPassManager &FPM, void *Data) {
+  ParallelPipeline &PP = *static_cast<ParallelPipeline*>(Data);
+  if (PP.AddLibraryInfo) {
+    TargetLibraryInfo *TLI =
+      new TargetLibraryInfo(Triple(PP.M->getTargetTriple()));
+    if (DisableSimplifyLibCalls)
+      TLI->disableAllFunctions();
+    FPM.add(TLI);
+  }
+  if (PP.TD)
+    FPM.add(new TargetData(*PP.TD));
+
+  for (unsigned i = 0, e = PP.OptLevels.size(); i != e; ++i)
+    createStandardFunctionPasses(&FPM, PP.OptLevels[i]);
+  for (unsigned i = 0, e = PP.Passes.size(); i != e; ++i)
+    addPass(FPM, PP.Passes[i]->createPass());
+}
+
+/// ParallelSafePasses - The passes which may be run by
+/// runFunctionPassesInParallel.  Each of them, and the analyses it requires,
+/// has been checked to only walk the use lists of instructions, arguments and
+/// function-local metadata, never those of constants and globals, which other
+/// threads modify.  These are the function passes of the -O levels, the alias
+/// analyses they use and the verifier.
+const char *const ParallelSafePasses[] = {
+  "basicaa", "early-cse", "no-aa", "scalarrepl", "simplifycfg", "tbaa",
+  "verify"
+};
+
+/// isParallelSafePass - Return true if the pass is one of ParallelSafePasses.
+bool isParallelSafePass(const PassInfo *PI) {
+  for (unsigned i = 0, e = array_lengthof(ParallelSafePasses); i != e; ++i)
+    if (!strcmp(PI->getPassArgument(), ParallelSafePasses[i]))
+      return true;
+  return false;
+}
+
 /// AddOptimizationPasses - This routine adds optimization passes
 /// based on selected optimization level, OptLevel. This routine
 /// duplicates llvm-gcc behaviour.
 ///
 /// OptLevel - Optimization Level
 void AddOptimizationPasses(PassManagerBase &MPM, PassManagerBase &FPM,
-                           unsigned OptLevel) {
+                           ParallelPipeline &Pipeline, unsigned OptLevel) {
   createStandardFunctionPasses(&FPM, OptLevel);
+  Pipeline.OptLevels.push_back(OptLevel);
 
   llvm::Pass *InliningPass = 0;
   if (DisableInline) {
@@ -573,6 +632,25 @@ int main(int argc, char **argv) {
       FPasses->add(new TargetData(*TD));
   }
 
+  ParallelPipeline Pipeline;
+  Pipeline.M = M.get();
+  Pipeline.TD = TD;
+  Pipeline.AddLibraryInfo = false;
+
+  // A command line made up only of passes which are safe to run concurrently
+  // can have them run on several threads, ahead of the verifier and the
+  // output passes.  Any other pass could race with the other threads.
+  bool ParallelPassList = ParallelFunctionPasses > 1 && PassList.size() &&
+    !OptLevelO1 && !OptLevelO2 && !OptLevelO3 && !StandardCompileOpts &&
+    !StandardLinkOpts && !StripDebug && !AnalyzeOnly && !PrintEachXForm &&
+    !PrintBreakpoints;
+  for (unsigned i = 0; ParallelPassList && i < PassList.size(); ++i)
+    if (!isParallelSafePass(PassList[i])) {
+      errs() << argv[0] << ": -" << PassList[i]->getPassArgument()
+             << " cannot be run with -parallel-function-passes\n";
+      return 1;
+    }
+
   if (PrintBreakpoints) {
     // Default to standard output.
     if (!Out) {
@@ -613,21 +691,26 @@ int main(int argc, char **argv) {
     }
 
     if (OptLevelO1 && OptLevelO1.getPosition() < PassList.getPosition(i)) {
-      AddOptimizationPasses(Passes, *FPasses, 1);
+      AddOptimizationPasses(Passes, *FPasses, Pipeline, 1);
       OptLevelO1 = false;
     }
 
     if (OptLevelO2 && OptLevelO2.getPosition() < PassList.getPosition(i)) {
-      AddOptimizationPasses(Passes, *FPasses, 2);
+      AddOptimizationPasses(Passes, *FPasses, Pipeline, 2);
       OptLevelO2 = false;
     }
 
     if (OptLevelO3 && OptLevelO3.getPosition() < PassList.getPosition(i)) {
-      AddOptimizationPasses(Passes, *FPasses, 3);
+      AddOptimizationPasses(Passes, *FPasses, Pipeline, 3);
       OptLevelO3 = false;
     }
 
     const PassInfo *PassInf = PassList[i];
+    if (ParallelPassList) {
+      Pipeline.Passes.push_back(PassInf);
+      continue;
+    }
+
     Pass *P = 0;
     if (PassInf->getNormalCtor())
       P = PassInf->getNormalCtor()();
@@ -678,16 +761,27 @@ int main(int argc, char **argv) {
   }
 
   if (OptLevelO1)
-    AddOptimizationPasses(Passes, *FPasses, 1);
+    AddOptimizationPasses(Passes, *FPasses, Pipeline, 1);
 
   if (OptLevelO2)
-    AddOptimizationPasses(Passes, *FPasses, 2);
+    AddOptimizationPasses(Passes, *FPasses, Pipeline, 2);
 
   if (OptLevelO3)
-    AddOptimizationPasses(Passes, *FPasses, 3);
+    AddOptimizationPasses(Passes, *FPasses, Pipeline, 3);
 
-  if (OptLevelO1 || OptLevelO2 || OptLevelO3)
-    FPasses->run(*M.get());
+  if (OptLevelO1 || OptLevelO2 || OptLevelO3) {
+    if (ParallelFunctionPasses > 1)
+      runFunctionPassesInParallel(*M.get(), ParallelFunctionPasses,
+                                  PopulateParallelPipeline, &Pipeline);
+    else
+      FPasses->run(*M.get());
+  }
+
+  if (ParallelPassList) {
+    Pipeline.AddLibraryInfo = true;
+    runFunctionPassesInParallel(*M.get(), ParallelFunctionPasses,
+                                PopulateParallelPipeline, &Pipeline);
+  }
 
   // Check that the module is well formed on completion of optimization
   if (!NoVerify && !VerifyEach)
@@ -0,0 +1,123 @@
+//===- llvm/unittest/ADT/StatisticTest.cpp - Statistic unit tests ---------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "unittest"
+#include "gtest/gtest.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Support/Threading.h"
+#include "llvm/Support/raw_ostream.h"
+#include <cstring>
+
+using namespace llvm;
+
+STATISTIC(Counter, "Counts things");
+STATISTIC(Other, "Counts \"other\" things");
+
+namespace {
+
+/// findValue - Return the value GetStatistics reports for the statistic with
+/// the given description, or -1 if there is none.
+int findValue(const std::vector<StatisticValue> &Values, const char *Desc) {
+  for (unsigned i = 0, e = Values.size(); i != e; ++i)
+    if (std::strcmp(Values[i].Desc, Desc) == 0)
+      return Values[i].Value;
+  return -1;
+}
+
+void bumpCounter(void *Times) {
+  for (unsigned i = 0, e = *(unsigned*)Times; i != e; ++i)
+    ++Counter;
+}
+
+class StatisticTest : public testing::Test {
+protected:
+  virtual void SetUp() {
+    if (!llvm_is_multithreaded())
+      llvm_start_multithreaded();
+    ResetStatistics();
+  }
+};
+
+TEST_F(StatisticTest, Operators) {
+  ++Counter;
+  Counter += 10;
+  Counter--;
+  EXPECT_EQ(10U, Counter.getValue());
+  Counter++;
+  EXPECT_EQ(11U, Counter.getValue());
+  Counter *= 2;
+  EXPECT_EQ(22U, Counter.getValue());
+  Counter /= 11;
+  EXPECT_EQ(2U, Counter.getValue());
+  Counter = 7;
+  EXPECT_EQ(7U, (unsigned)Counter);
+}
+
+TEST_F(StatisticTest, ThreadsAreAddedUp) {
+  unsigned Times = 1000;
+  llvm_thread *Threads[4];
+  for (unsigned i = 0; i != 4; ++i)
+    Threads[i] = llvm_start_thread(bumpCounter, &Times);
+  bumpCounter(&Times);
+  for (unsigned i = 0; i != 4; ++i)
+    llvm_join_thread(Threads[i]);
+
+  EXPECT_EQ(5000U, Counter.getValue());
+
+  // The threads are gone, but what they counted is not.
+  Counter = 3;
+  EXPECT_EQ(3U, Counter.getValue());
+}
+
+TEST_F(StatisticTest, ExitedThreadsAreFolded) {
+  // Each thread's counters are freed when it exits, after adding them to the
+  // statistic.
+  unsigned Times = 100;
+  for (unsigned i = 0; i != 3; ++i)
+    llvm_join_thread(llvm_start_thread(bumpCounter, &Times));
+  EXPECT_EQ(300U, Counter.getValue());
+
+  ResetStatistics();
+  EXPECT_EQ(0U, Counter.getValue());
+  llvm_join_thread(llvm_start_thread(bumpCounter, &Times));
+  EXPECT_EQ(100U, Counter.getValue());
+}
+
+TEST_F(StatisticTest, GetAndReset) {
+  Counter += 5;
+  ++Other;
+
+  std::vector<StatisticValue> Values;
+  GetStatistics(Values, /*Reset=*/true);
+  EXPECT_EQ(5, findValue(Values, "Counts things"));
+  EXPECT_EQ(1, findValue(Values, "Counts \"other\" things"));
+
+  // Only what is counted after the reset shows up in the next reading.
+  ++Counter;
+  GetStatistics(Values);
+  EXPECT_EQ(1, findValue(Values, "Counts things"));
+  EXPECT_EQ(0, findValue(Values, "Counts \"other\" things"));
+  EXPECT_EQ(1U, Counter.getValue());
+}
+
+TEST_F(StatisticTest, JSON) {
+  Counter += 2;
+  ++Other;
+
+  std::string Str;
+  raw_string_ostream OS(Str);
+  PrintStatisticsJSON(OS);
+  EXPECT_NE(std::string::npos, OS.str().find(
+    "{\"name\": \"unittest\", \"desc\": \"Counts things\", \"value\": 2}"));
+  EXPECT_NE(std::string::npos, OS.str().find(
+    "{\"name\": \"unittest\", \"desc\": \"Counts \\\"other\\\" things\", "
+    "\"value\": 1}"));
+}
+
+}
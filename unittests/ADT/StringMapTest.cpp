@@ -8,8 +8,12 @@
 //===----------------------------------------------------------------------===//
 
 #include "gtest/gtest.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/Support/DataTypes.h"
+#include <cstdlib>
+#include <cstring>
+#include <vector>
 using namespace llvm;
 
 namespace {
@@ -204,4 +208,55 @@ TEST_F(StringMapTest, InsertTest) {
   assertSingleItemMap();
 }
 
+// Keys of every length up to a few words, some differing only in their first
+// or last byte, must all be told apart.
+TEST_F(StringMapTest, ManyKeysTest) {
+  std::vector<std::string> Keys;
+  for (unsigned Len = 0; Len != 40; ++Len) {
+    std::string Key(Len, 'x');
+    Keys.push_back(Key);
+    if (Len) {
+      Key[0] = 'y';
+      Keys.push_back(Key);
+      Key[Len - 1] = 'z';
+      Keys.push_back(Key);
+    }
+  }
+  for (unsigned i = 0, e = Keys.size(); i != e; ++i)
+    EXPECT_TRUE(testMap.GetOrCreateValue(Keys[i], i).getValue() == i);
+  EXPECT_EQ(Keys.size(), testMap.size());
+  for (unsigned i = 0, e = Keys.size(); i != e; ++i)
+    EXPECT_EQ(i, testMap.lookup(Keys[i]));
+  EXPECT_EQ(0u, testMap.count(std::string(40, 'x')));
+}
+
+// The hash depends only on the contents of the string, not on where in
+// memory it is.
+TEST(HashStringFastTest, Alignment) {
+  char Buffer[64];
+  for (unsigned Len = 0; Len != 33; ++Len) {
+    memset(Buffer, 0, sizeof(Buffer));
+    for (unsigned i = 0; i != Len; ++i)
+      Buffer[i] = 'a' + i % 26;
+    unsigned Hash = HashStringFast(StringRef(Buffer, Len));
+    for (unsigned Offset = 1; Offset != 8; ++Offset) {
+      memmove(Buffer + Offset, Buffer + Offset - 1, Len);
+      Buffer[Offset - 1] = 0;
+      EXPECT_EQ(Hash, HashStringFast(StringRef(Buffer + Offset, Len)));
+    }
+  }
+  // Strings of zeros hash differently by length.
+  EXPECT_NE(HashStringFast(StringRef("\0", 1)),
+            HashStringFast(StringRef("\0\0", 2)));
+}
+
+// The hash is the same on every host, so that output written in StringMap
+// order is too.
+TEST(HashStringFastTest, HostIndependent) {
+  EXPECT_EQ(0u, HashStringFast(""));
+  EXPECT_EQ(3756904931u, HashStringFast("a"));
+  EXPECT_EQ(2844864083u, HashStringFast("printf"));
+  EXPECT_EQ(2476298013u, HashStringFast("_ZN4llvm9StringMapIjE"));
+}
+
 } // end anonymous namespace
@@ -0,0 +1,173 @@
+//===- llvm/unittest/ADT/SwissMapTest.cpp - SwissMap unit tests -----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+#include "llvm/ADT/SwissMap.h"
+#include <map>
+#include <string>
+
+using namespace llvm;
+
+namespace {
+
+// Test fixture
+class SwissMapTest : public testing::Test {
+protected:
+  SwissMap<uint32_t, uint32_t> uintMap;
+  SwissMap<uint32_t *, uint32_t *> uintPtrMap;
+  uint32_t dummyInt;
+};
+
+// Empty map tests
+TEST_F(SwissMapTest, EmptyIntMapTest) {
+  EXPECT_EQ(0u, uintMap.size());
+  EXPECT_TRUE(uintMap.empty());
+  EXPECT_TRUE(uintMap.begin() == uintMap.end());
+  EXPECT_FALSE(uintMap.count(0u));
+  EXPECT_TRUE(uintMap.find(0u) == uintMap.end());
+  EXPECT_EQ(0u, uintMap.lookup(0u));
+}
+
+// Empty map tests for pointer map
+TEST_F(SwissMapTest, EmptyPtrMapTest) {
+  EXPECT_EQ(0u, uintPtrMap.size());
+  EXPECT_TRUE(uintPtrMap.empty());
+  EXPECT_TRUE(uintPtrMap.begin() == uintPtrMap.end());
+  EXPECT_FALSE(uintPtrMap.count(&dummyInt));
+  EXPECT_TRUE(uintPtrMap.find(&dummyInt) == uintPtrMap.begin());
+  EXPECT_EQ(0, uintPtrMap.lookup(&dummyInt));
+}
+
+// A map with a single entry
+TEST_F(SwissMapTest, SingleEntryMapTest) {
+  uintMap[0] = 1;
+
+  EXPECT_EQ(1u, uintMap.size());
+  EXPECT_FALSE(uintMap.begin() == uintMap.end());
+  EXPECT_FALSE(uintMap.empty());
+
+  SwissMap<uint32_t, uint32_t>::iterator it = uintMap.begin();
+  EXPECT_EQ(0u, it->first);
+  EXPECT_EQ(1u, it->second);
+  ++it;
+  EXPECT_TRUE(it == uintMap.end());
+
+  EXPECT_TRUE(uintMap.count(0u));
+  EXPECT_TRUE(uintMap.find(0u) == uintMap.begin());
+  EXPECT_EQ(1u, uintMap.lookup(0u));
+  EXPECT_EQ(1u, uintMap[0]);
+}
+
+// The keys DenseMapInfo reserves for empty and erased buckets are ordinary
+// keys to a SwissMap.
+TEST_F(SwissMapTest, ReservedKeysTest) {
+  uintMap[~0U] = 1;
+  uintMap[~0U - 1] = 2;
+  EXPECT_EQ(2u, uintMap.size());
+  EXPECT_EQ(1u, uintMap.lookup(~0U));
+  EXPECT_EQ(2u, uintMap.lookup(~0U - 1));
+}
+
+TEST_F(SwissMapTest, ClearTest) {
+  uintMap[0] = 1;
+  uintMap.clear();
+
+  EXPECT_EQ(0u, uintMap.size());
+  EXPECT_TRUE(uintMap.empty());
+  EXPECT_TRUE(uintMap.begin() == uintMap.end());
+}
+
+TEST_F(SwissMapTest, EraseTest) {
+  uintMap[0] = 1;
+  uintMap.erase(uintMap.begin());
+  EXPECT_TRUE(uintMap.empty());
+  EXPECT_TRUE(uintMap.begin() == uintMap.end());
+
+  uintMap[0] = 1;
+  EXPECT_TRUE(uintMap.erase(0));
+  EXPECT_FALSE(uintMap.erase(0));
+  EXPECT_TRUE(uintMap.empty());
+}
+
+TEST_F(SwissMapTest, InsertTest) {
+  EXPECT_TRUE(uintMap.insert(std::make_pair(0u, 1u)).second);
+  EXPECT_FALSE(uintMap.insert(std::make_pair(0u, 2u)).second);
+  EXPECT_EQ(1u, uintMap.size());
+  EXPECT_EQ(1u, uintMap[0]);
+}
+
+TEST_F(SwissMapTest, CopyAndSwapTest) {
+  for (uint32_t i = 0; i != 100; ++i)
+    uintMap[i] = i + 1;
+  SwissMap<uint32_t, uint32_t> copyMap(uintMap);
+  EXPECT_EQ(100u, copyMap.size());
+  EXPECT_EQ(51u, copyMap[50]);
+
+  SwissMap<uint32_t, uint32_t> assigned;
+  assigned[1000] = 1;
+  assigned = uintMap;
+  EXPECT_EQ(100u, assigned.size());
+  EXPECT_FALSE(assigned.count(1000));
+
+  SwissMap<uint32_t, uint32_t> other;
+  other[7] = 8;
+  other.swap(uintMap);
+  EXPECT_EQ(1u, uintMap.size());
+  EXPECT_EQ(100u, other.size());
+  EXPECT_EQ(8u, uintMap[7]);
+}
+
+TEST_F(SwissMapTest, ConstIteratorTest) {
+  SwissMap<uint32_t, uint32_t>::iterator it = uintMap.begin();
+  SwissMap<uint32_t, uint32_t>::const_iterator cit(it);
+  EXPECT_TRUE(it == cit);
+
+  SwissMap<uint32_t, uint32_t>::const_iterator cit2(cit);
+  EXPECT_TRUE(cit == cit2);
+}
+
+// Values that are not PODs are constructed and destroyed once each.
+TEST_F(SwissMapTest, StringValueTest) {
+  SwissMap<uint32_t, std::string> Map;
+  for (uint32_t i = 0; i != 1000; ++i)
+    Map[i] = std::string(i % 50, 'a');
+  for (uint32_t i = 0; i != 1000; i += 2)
+    Map.erase(i);
+  SwissMap<uint32_t, std::string> Copy(Map);
+  Map.clear();
+  EXPECT_EQ(500u, Copy.size());
+  for (uint32_t i = 1; i < 1000; i += 2)
+    EXPECT_EQ(std::string(i % 50, 'a'), Copy.lookup(i));
+}
+
+// Check a long run of insertions and erasures, which leave erased buckets
+// behind, against std::map.
+TEST_F(SwissMapTest, RandomOperationsTest) {
+  std::map<uint32_t, uint32_t> Reference;
+  uint32_t Seed = 1;
+  for (unsigned i = 0; i != 100000; ++i) {
+    Seed = Seed * 1103515245 + 12345;
+    uint32_t Key = (Seed >> 8) % 5000;
+    if (Seed & 1) {
+      uintMap[Key] = i;
+      Reference[Key] = i;
+    } else {
+      EXPECT_EQ(Reference.erase(Key) != 0, uintMap.erase(Key));
+    }
+  }
+
+  EXPECT_EQ(Reference.size(), uintMap.size());
+  unsigned Visited = 0;
+  for (SwissMap<uint32_t, uint32_t>::iterator I = uintMap.begin(),
+       E = uintMap.end(); I != E; ++I, ++Visited)
+    EXPECT_EQ(Reference[I->first], I->second);
+  EXPECT_EQ(Reference.size(), Visited);
+}
+
+}
@@ -0,0 +1,104 @@
+//===- BasicAliasAnalysisTest.cpp - BasicAliasAnalysis unit tests ---------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include <llvm/Analysis/AliasAnalysis.h>
+#include <llvm/Analysis/Passes.h>
+#include <llvm/Assembly/Parser.h>
+#include <llvm/InitializePasses.h>
+#include <llvm/Instructions.h>
+#include <llvm/LLVMContext.h>
+#include <llvm/Module.h>
+#include <llvm/PassManager.h>
+#include <llvm/Support/SourceMgr.h>
+#include <llvm/Target/TargetData.h>
+#include <llvm/ValueSymbolTable.h>
+#include "gtest/gtest.h"
+#include <vector>
+
+namespace llvm {
+namespace {
+
+typedef std::vector<AliasAnalysis::AliasResult> AliasResults;
+
+/// getGEP - Return the GEP of the given name in F.
+GetElementPtrInst *getGEP(Function &F, const char *Name) {
+  return cast<GetElementPtrInst>(F.getValueSymbolTable().lookup(Name));
+}
+
+/// QueryGEPs - Ask the alias analysis whether %g and %h alias.
+struct QueryGEPs : public FunctionPass {
+  static char ID;
+  AliasResults &Results;
+
+  QueryGEPs(AliasResults &results) : FunctionPass(ID), Results(results) {}
+
+  virtual void getAnalysisUsage(AnalysisUsage &AU) const {
+    AU.addRequired<AliasAnalysis>();
+    AU.setPreservesAll();
+  }
+
+  virtual bool runOnFunction(Function &F) {
+    AliasAnalysis &AA = getAnalysis<AliasAnalysis>();
+    Results.push_back(AA.alias(getGEP(F, "g"), 4, getGEP(F, "h"), 4));
+    return false;
+  }
+};
+
+char QueryGEPs::ID = 0;
+
+/// RewriteGEP - Make %h index the same element as %g by changing its operand
+/// in place, without telling the alias analysis.  Nothing is deleted or
+/// replaced, so only analyses that answer from the IR as it is now notice.
+struct RewriteGEP : public FunctionPass {
+  static char ID;
+
+  RewriteGEP() : FunctionPass(ID) {}
+
+  virtual bool runOnFunction(Function &F) {
+    GetElementPtrInst *G = getGEP(F, "g");
+    getGEP(F, "h")->setOperand(2, G->getOperand(2));
+    return true;
+  }
+};
+
+char RewriteGEP::ID = 0;
+
+TEST(BasicAliasAnalysisTest, QueriesAfterInPlaceChange) {
+  LLVMContext Context;
+  Module M("alias", Context);
+  initializeAnalysis(*PassRegistry::getPassRegistry());
+  SMDiagnostic Error;
+  ASSERT_TRUE(ParseAssemblyString(
+    "target datalayout = \"e-p:64:64:64-i32:32:32-i64:64:64\"\n"
+    "define void @f(i64 %i) {\n"
+    "  %a = alloca [8 x i32]\n"
+    "  %i1 = add i64 %i, 1\n"
+    "  %g = getelementptr [8 x i32]* %a, i64 0, i64 %i\n"
+    "  %h = getelementptr [8 x i32]* %a, i64 0, i64 %i1\n"
+    "  store i32 0, i32* %g\n"
+    "  store i32 1, i32* %h\n"
+    "  ret void\n"
+    "}\n", &M, Error, Context));
+
+  AliasResults Results;
+  PassManager PM;
+  PM.add(new TargetData(&M));
+  PM.add(createBasicAliasAnalysisPass());
+  PM.add(new QueryGEPs(Results));
+  PM.add(new RewriteGEP());
+  PM.add(new QueryGEPs(Results));
+  PM.run(M);
+
+  ASSERT_EQ(2u, Results.size());
+  EXPECT_EQ(AliasAnalysis::NoAlias, Results[0]);
+  EXPECT_EQ(AliasAnalysis::MustAlias, Results[1]);
+}
+
+}  // end anonymous namespace
+}  // end namespace llvm
@@ -8,11 +8,17 @@
 //===----------------------------------------------------------------------===//
 
 #include <llvm/Analysis/ScalarEvolutionExpressions.h>
+#include <llvm/Analysis/LoopInfo.h>
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Assembly/Parser.h>
 #include <llvm/GlobalVariable.h>
 #include <llvm/Constants.h>
+#include <llvm/InitializePasses.h>
 #include <llvm/LLVMContext.h>
 #include <llvm/Module.h>
 #include <llvm/PassManager.h>
+#include <llvm/Support/InstIterator.h>
+#include <llvm/Support/SourceMgr.h>
 #include "gtest/gtest.h"
 
 namespace llvm {
@@ -78,5 +84,115 @@ TEST(ScalarEvolutionsTest, SCEVUnknownRAUW) {
   SE.releaseMemory();
 }
 
+/// getLoopNest - Return the assembly for a function @nest with a nest of
+/// Depth counted loops.  Each loop has an induction variable and a running
+/// offset that the loop inside it starts from, and the innermost loop stores
+/// to the sum of the two, the way a multi-dimensional array is walked.
+std::string getLoopNest(unsigned Depth) {
+  std::string IR = "define void @nest(i64* %p, i64 %n) {\n"
+                   "entry:\n"
+                   "  br label %h0\n";
+  for (unsigned k = 0; k != Depth; ++k) {
+    std::string K = utostr(k), Prev = utostr(k - 1);
+    std::string Pred = k ? "%h" + Prev : "%entry";
+    std::string Start = k ? "%a" + Prev : "0";
+    IR += "h" + K + ":\n"
+          "  %i" + K + " = phi i64 [ 0, " + Pred + " ], [ %i" + K +
+            ".next, %latch" + K + " ]\n"
+          "  %a" + K + " = phi i64 [ " + Start + ", " + Pred + " ], [ %a" + K +
+            ".next, %latch" + K + " ]\n";
+    if (k + 1 != Depth) {
+      IR += "  br label %h" + utostr(k + 1) + "\n";
+      continue;
+    }
+    IR += "  %idx = add i64 %a" + K + ", %i" + K + "\n"
+          "  %addr = getelementptr i64* %p, i64 %idx\n"
+          "  store i64 %idx, i64* %addr\n"
+          "  br label %latch" + K + "\n";
+  }
+  for (unsigned k = Depth; k-- != 0; ) {
+    std::string K = utostr(k);
+    std::string Exit = k ? "%latch" + utostr(k - 1) : "%exit";
+    IR += "latch" + K + ":\n"
+          "  %i" + K + ".next = add i64 %i" + K + ", 1\n"
+          "  %a" + K + ".next = add i64 %a" + K + ", %n\n"
+          "  %c" + K + " = icmp slt i64 %i" + K + ".next, %n\n"
+          "  br i1 %c" + K + ", label %h" + K + ", label " + Exit + "\n";
+  }
+  IR += "exit:\n"
+        "  ret void\n"
+        "}\n";
+  return IR;
+}
+
+/// SCEVQueries - Ask ScalarEvolution what IndVarSimplify and LSR ask of it:
+/// the expression for every instruction, its value at every enclosing scope,
+/// whether it is invariant in each loop, whether it dominates each block, and
+/// the trip count of every loop.
+struct SCEVQueries : public FunctionPass {
+  static char ID;
+  unsigned Rounds;
+
+  explicit SCEVQueries(unsigned Rounds) : FunctionPass(ID), Rounds(Rounds) {}
+
+  virtual void getAnalysisUsage(AnalysisUsage &AU) const {
+    AU.addRequired<LoopInfo>();
+    AU.addRequired<ScalarEvolution>();
+    AU.setPreservesAll();
+  }
+
+  virtual bool runOnFunction(Function &F) {
+    LoopInfo &LI = getAnalysis<LoopInfo>();
+    ScalarEvolution &SE = getAnalysis<ScalarEvolution>();
+    std::vector<const Loop *> Loops;
+    for (Function::iterator BB = F.begin(), E = F.end(); BB != E; ++BB)
+      if (LI.isLoopHeader(BB))
+        Loops.push_back(LI.getLoopFor(BB));
+
+    // The values at scope of the first round, which later rounds, answered
+    // from the caches, must agree with.
+    std::vector<const SCEV *> AtScope;
+
+    for (unsigned Round = 0; Round != Rounds; ++Round) {
+      for (unsigned i = 0, e = Loops.size(); i != e; ++i)
+        EXPECT_FALSE(isa<SCEVCouldNotCompute>(
+                       SE.getBackedgeTakenCount(Loops[i])));
+      unsigned Index = 0;
+      for (inst_iterator I = inst_begin(F), E = inst_end(F); I != E; ++I) {
+        if (!SE.isSCEVable(I->getType()))
+          continue;
+        const SCEV *S = SE.getSCEV(&*I);
+        for (const Loop *L = LI.getLoopFor(I->getParent()); L;
+             L = L->getParentLoop(), ++Index) {
+          const SCEV *Exit = SE.getSCEVAtScope(S, L->getParentLoop());
+          if (Round == 0)
+            AtScope.push_back(Exit);
+          else
+            EXPECT_EQ(AtScope[Index], Exit);
+        }
+        for (unsigned i = 0, e = Loops.size(); i != e; ++i)
+          SE.isLoopInvariant(S, Loops[i]);
+        for (Function::iterator BB = F.begin(), E = F.end(); BB != E; ++BB)
+          SE.dominates(S, BB);
+      }
+    }
+    return false;
+  }
+};
+
+char SCEVQueries::ID = 0;
+
+// The answers come out of the caches the second time around.
+TEST(ScalarEvolutionsTest, LoopNestQueries) {
+  initializeAnalysis(*PassRegistry::getPassRegistry());
+  LLVMContext Context;
+  Module M("nest", Context);
+  SMDiagnostic Error;
+  ASSERT_TRUE(ParseAssemblyString(getLoopNest(3).c_str(), &M, Error, Context));
+  PassManager PM;
+  PM.add(new SCEVQueries(2));
+  PM.run(M);
+}
+
 }  // end anonymous namespace
 }  // end namespace llvm
@@ -14,16 +14,18 @@
 #include "llvm/Function.h"
 #include "llvm/GlobalValue.h"
 #include "llvm/LLVMContext.h"
+#include "llvm/Module.h"
+#include "llvm/Support/Process.h"
 
 using namespace llvm;
 
 namespace {
 
-Function *makeFakeFunction() {
+Function *makeFakeFunction(Module *M = 0) {
   std::vector<const Type*> params;
   const FunctionType *FTy =
       FunctionType::get(Type::getVoidTy(getGlobalContext()), params, false);
-  return Function::Create(FTy, GlobalValue::ExternalLinkage);
+  return Function::Create(FTy, GlobalValue::ExternalLinkage, "", M);
 }
 
 // Allocate three simple functions that fit in the initial slab.  This exercises
@@ -276,4 +278,190 @@ TEST(JITMemoryManagerTest, TestManyStubs) {
   EXPECT_EQ(3U, MemMgr->GetNumStubSlabs());
 }
 
+// Emit functions from two modules with the region memory manager, and check
+// that each module's code is kept apart, on whole pages, and unmapped once all
+// of the module's functions are gone.
+TEST(JITMemoryManagerTest, RegionManagerFreesModules) {
+  OwningPtr<JITMemoryManager> MemMgr(
+      JITMemoryManager::CreateRegionMemManager());
+  EXPECT_FALSE(MemMgr->allowsCodePatching());
+  uintptr_t PageSize = sys::Process::GetPageSize();
+  std::string Error;
+
+  Module M1("M1", getGlobalContext());
+  Module M2("M2", getGlobalContext());
+  Function *F1 = makeFakeFunction(&M1);
+  Function *F2 = makeFakeFunction(&M1);
+  Function *F3 = makeFakeFunction(&M2);
+
+  uint8_t *Bodies[3];
+  Function *Fns[3] = { F1, F2, F3 };
+  for (unsigned i = 0; i != 3; ++i) {
+    uintptr_t Size = 0;
+    MemMgr->setMemoryWritable();
+    Bodies[i] = MemMgr->startFunctionBody(Fns[i], Size);
+    EXPECT_LE(PageSize, Size);
+    EXPECT_EQ(0U, (uintptr_t)Bodies[i] % PageSize);
+    memset(Bodies[i], 0xC3, 100);
+    MemMgr->endFunctionBody(Fns[i], Bodies[i], Bodies[i] + 100);
+    MemMgr->setMemoryExecutable();
+    EXPECT_TRUE(MemMgr->CheckInvariants(Error)) << Error;
+  }
+
+  // Functions never share a page, even within a module.
+  EXPECT_EQ(Bodies[0] + PageSize, Bodies[1]);
+
+  JITMemoryStats Stats;
+  ASSERT_TRUE(MemMgr->getMemoryStats(Stats));
+  EXPECT_EQ(2U, Stats.NumRegions);
+  EXPECT_EQ(300U, Stats.LiveCodeBytes);
+  uint64_t TwoModules = Stats.CodeBytes;
+  EXPECT_LT(0.9, Stats.getFragmentation());
+
+  // Freeing one function of M1 keeps its region.
+  MemMgr->deallocateFunctionBody(Bodies[0]);
+  EXPECT_TRUE(MemMgr->CheckInvariants(Error)) << Error;
+  ASSERT_TRUE(MemMgr->getMemoryStats(Stats));
+  EXPECT_EQ(2U, Stats.NumRegions);
+  EXPECT_EQ(200U, Stats.LiveCodeBytes);
+  EXPECT_EQ(TwoModules, Stats.CodeBytes);
+
+  // Freeing the other one returns M1's memory to the OS.
+  MemMgr->deallocateFunctionBody(Bodies[1]);
+  EXPECT_TRUE(MemMgr->CheckInvariants(Error)) << Error;
+  ASSERT_TRUE(MemMgr->getMemoryStats(Stats));
+  EXPECT_EQ(1U, Stats.NumRegions);
+  EXPECT_EQ(100U, Stats.LiveCodeBytes);
+  EXPECT_GT(TwoModules, Stats.CodeBytes);
+
+  MemMgr->deallocateFunctionBody(Bodies[2]);
+  ASSERT_TRUE(MemMgr->getMemoryStats(Stats));
+  EXPECT_EQ(0U, Stats.NumRegions);
+  EXPECT_EQ(0U, Stats.CodeBytes);
+}
+
+// A function that is freed before it was made executable, as when the JIT runs
+// out of space and starts over with a bigger buffer, gives its pages back.
+TEST(JITMemoryManagerTest, RegionManagerRetry) {
+  OwningPtr<JITMemoryManager> MemMgr(
+      JITMemoryManager::CreateRegionMemManager());
+  uintptr_t PageSize = sys::Process::GetPageSize();
+  std::string Error;
+
+  Module M("M", getGlobalContext());
+  Function *F1 = makeFakeFunction(&M);
+  Function *F2 = makeFakeFunction(&M);
+
+  // Keep the region alive.
+  uintptr_t Size = 0;
+  uint8_t *Body1 = MemMgr->startFunctionBody(F1, Size);
+  MemMgr->endFunctionBody(F1, Body1, Body1 + 16);
+  MemMgr->setMemoryExecutable();
+
+  Size = 0;
+  uint8_t *Body2 = MemMgr->startFunctionBody(F2, Size);
+  MemMgr->endFunctionBody(F2, Body2, Body2 + Size);
+  MemMgr->deallocateFunctionBody(Body2);
+  EXPECT_TRUE(MemMgr->CheckInvariants(Error)) << Error;
+
+  // The retry asks for twice as much, which needs a new chunk.
+  uintptr_t Bigger = 2 * Size;
+  uint8_t *Retry = MemMgr->startFunctionBody(F2, Bigger);
+  EXPECT_LE(2 * Size, Bigger);
+  EXPECT_EQ(0U, (uintptr_t)Retry % PageSize);
+  memset(Retry, 0xC3, Bigger);
+  MemMgr->endFunctionBody(F2, Retry, Retry + Size + 1);
+  MemMgr->setMemoryExecutable();
+  EXPECT_TRUE(MemMgr->CheckInvariants(Error)) << Error;
+
+  JITMemoryStats Stats;
+  ASSERT_TRUE(MemMgr->getMemoryStats(Stats));
+  EXPECT_EQ(16U + Size + 1, Stats.LiveCodeBytes);
+}
+
+// Function bodies finished together share pages, and exception tables are
+// packed after one another on pages that stay writable.
+TEST(JITMemoryManagerTest, RegionManagerPacksBlocks) {
+  OwningPtr<JITMemoryManager> MemMgr(
+      JITMemoryManager::CreateRegionMemManager());
+  uintptr_t PageSize = sys::Process::GetPageSize();
+  std::string Error;
+
+  Module M("M", getGlobalContext());
+  Function *F1 = makeFakeFunction(&M);
+  Function *F2 = makeFakeFunction(&M);
+  Function *F3 = makeFakeFunction(&M);
+
+  uintptr_t Size = 0;
+  uint8_t *Body1 = MemMgr->startFunctionBody(F1, Size);
+  memset(Body1, 0xC3, 100);
+  MemMgr->endFunctionBody(F1, Body1, Body1 + 100);
+  Size = 0;
+  uint8_t *Body2 = MemMgr->startFunctionBody(F2, Size);
+  EXPECT_EQ(Body1 + 112, Body2);
+  memset(Body2, 0xC3, 50);
+  MemMgr->endFunctionBody(F2, Body2, Body2 + 50);
+  MemMgr->setMemoryExecutable();
+  EXPECT_TRUE(MemMgr->CheckInvariants(Error)) << Error;
+
+  // The page holding Body1 and Body2 is executable now, so the next body
+  // starts on the page after it.
+  Size = 0;
+  uint8_t *Body3 = MemMgr->startFunctionBody(F3, Size);
+  EXPECT_EQ(0U, (uintptr_t)Body3 % PageSize);
+  EXPECT_EQ(Body1 + PageSize, Body3);
+  memset(Body3, 0xC3, 10);
+  MemMgr->endFunctionBody(F3, Body3, Body3 + 10);
+  MemMgr->setMemoryExecutable();
+
+  Size = 0;
+  uint8_t *Table1 = MemMgr->startExceptionTable(F1, Size);
+  MemMgr->endExceptionTable(F1, Table1, Table1 + 40, 0);
+  Size = 0;
+  uint8_t *Table2 = MemMgr->startExceptionTable(F2, Size);
+  EXPECT_EQ(Table1 + 48, Table2);
+  MemMgr->endExceptionTable(F2, Table2, Table2 + 40, 0);
+  MemMgr->setMemoryExecutable();
+  memset(Table1, 0x1, 40);
+  EXPECT_TRUE(MemMgr->CheckInvariants(Error)) << Error;
+
+  JITMemoryStats Stats;
+  ASSERT_TRUE(MemMgr->getMemoryStats(Stats));
+  EXPECT_EQ(1U, Stats.NumRegions);
+  EXPECT_EQ(100U + 50U + 10U + 40U + 40U, Stats.LiveCodeBytes);
+
+  // Freeing the last table makes its memory available to the next one.
+  MemMgr->deallocateExceptionTable(Table2);
+  Size = 0;
+  EXPECT_EQ(Table2, MemMgr->startExceptionTable(F2, Size));
+  MemMgr->endExceptionTable(F2, Table2, Table2 + 8, 0);
+  EXPECT_TRUE(MemMgr->CheckInvariants(Error)) << Error;
+}
+
+// Globals and stubs are counted separately from code.
+TEST(JITMemoryManagerTest, RegionManagerStubsAndGlobals) {
+  OwningPtr<JITMemoryManager> MemMgr(
+      JITMemoryManager::CreateRegionMemManager());
+  JITMemoryStats Stats;
+  ASSERT_TRUE(MemMgr->getMemoryStats(Stats));
+  EXPECT_EQ(0U, Stats.getResidentBytes());
+
+  uint8_t *G = MemMgr->allocateGlobal(64, 8);
+  memset(G, 0x1, 64);
+  uint8_t *S = MemMgr->allocateStub(NULL, 16, 8);
+  memset(S, 0x2, 16);
+
+  ASSERT_TRUE(MemMgr->getMemoryStats(Stats));
+  EXPECT_LE(64U, Stats.DataBytes);
+  EXPECT_LE(16U, Stats.StubBytes);
+  EXPECT_EQ(0U, Stats.CodeBytes);
+  EXPECT_EQ(Stats.DataBytes + Stats.StubBytes, Stats.getResidentBytes());
+
+  // The default memory manager doesn't keep these statistics.
+  OwningPtr<JITMemoryManager> Default(
+      JITMemoryManager::CreateDefaultMemManager());
+  EXPECT_FALSE(Default->getMemoryStats(Stats));
+  EXPECT_TRUE(Default->allowsCodePatching());
+}
+
 }
@@ -10,6 +10,7 @@
 #include "gtest/gtest.h"
 #include "llvm/ADT/OwningPtr.h"
 #include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/Assembly/Parser.h"
 #include "llvm/BasicBlock.h"
 #include "llvm/Bitcode/ReaderWriter.h"
@@ -17,6 +18,7 @@
 #include "llvm/Constants.h"
 #include "llvm/DerivedTypes.h"
 #include "llvm/ExecutionEngine/JIT.h"
+#include "llvm/ExecutionEngine/JITEventListener.h"
 #include "llvm/ExecutionEngine/JITMemoryManager.h"
 #include "llvm/Function.h"
 #include "llvm/GlobalValue.h"
@@ -25,6 +27,7 @@
 #include "llvm/Module.h"
 #include "llvm/Support/IRBuilder.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Process.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/TypeBuilder.h"
 #include "llvm/Target/TargetSelect.h"
@@ -280,6 +283,47 @@ TEST(JIT, GlobalInFunction) {
   EXPECT_EQ(3, *GPtr);
 }
 
+// Functions compiled together are made executable together, so the region
+// memory manager can pack them onto the same pages.
+TEST(JIT, RegionManagerPacksFunctionsCompiledTogether) {
+  LLVMContext Context;
+  Module *M = new Module("<main>", Context);
+  std::string Error;
+  OwningPtr<ExecutionEngine> JIT(EngineBuilder(M)
+                                 .setEngineKind(EngineKind::JIT)
+                                 .setErrorStr(&Error)
+                                 .setJITMemoryManager(
+                                   JITMemoryManager::CreateRegionMemManager())
+                                 .create());
+  ASSERT_TRUE(JIT.get() != NULL) << Error;
+  JIT->DisableLazyCompilation(true);
+
+  LoadAssemblyInto(M,
+    "define internal i32 @one() { "
+    "  ret i32 1 "
+    "} "
+    "define internal i32 @two() { "
+    "  ret i32 2 "
+    "} "
+    "define i32 @sum() { "
+    "  %a = call i32 @one() "
+    "  %b = call i32 @two() "
+    "  %s = add i32 %a, %b "
+    "  ret i32 %s "
+    "} ");
+  int32_t (*Sum)() = reinterpret_cast<int32_t(*)()>(
+    (intptr_t)JIT->getPointerToFunction(M->getFunction("sum")));
+  EXPECT_EQ(3, Sum());
+
+  uintptr_t PageMask = ~(uintptr_t)(sys::Process::GetPageSize() - 1);
+  uintptr_t One =
+    (uintptr_t)JIT->getPointerToGlobalIfAvailable(M->getFunction("one"));
+  uintptr_t Two =
+    (uintptr_t)JIT->getPointerToGlobalIfAvailable(M->getFunction("two"));
+  EXPECT_EQ((uintptr_t)Sum & PageMask, One & PageMask);
+  EXPECT_EQ((uintptr_t)Sum & PageMask, Two & PageMask);
+}
+
 int PlusOne(int arg) {
   return arg + 1;
 }
@@ -572,6 +616,167 @@ TEST_F(JITTest, FunctionIsRecompiledAndRelinked) {
   EXPECT_EQ(2, OrigFPtr())
     << "The old pointer's target should now jump to the new version";
 }
+
+class EmissionCounter : public JITEventListener {
+public:
+  unsigned Count;
+  EmissionCounter() : Count(0) {}
+  virtual void NotifyFunctionEmitted(const Function &, void *, size_t,
+                                     const EmittedFunctionDetails &) {
+    ++Count;
+  }
+};
+
+TEST_F(JITTest, HotFunctionIsTieredUp) {
+  EmissionCounter Emissions;
+  TheJIT->RegisterJITEventListener(&Emissions);
+  TheJIT->EnableTieredCompilation(3);
+  LoadAssembly("define i32 @hot(i32 %n) { "
+               "entry: "
+               "  %slot = alloca i32 "
+               "  store i32 0, i32* %slot "
+               "  br label %loop "
+               "loop: "
+               "  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ] "
+               "  %i.next = add i32 %i, 1 "
+               "  %done = icmp sge i32 %i.next, %n "
+               "  br i1 %done, label %exit, label %loop "
+               "exit: "
+               "  ret i32 %i.next "
+               "} ");
+  Function *HotIR = M->getFunction("hot");
+
+  int32_t (*Hot)(int32_t) = reinterpret_cast<int32_t(*)(int32_t)>(
+    (intptr_t)TheJIT->getPointerToFunction(HotIR));
+  EXPECT_EQ(1u, Emissions.Count);
+  EXPECT_EQ(10, Hot(10));
+
+  // The entry counter is only in the generated code, not in the IR.
+  EXPECT_EQ(3u, HotIR->size());
+  EXPECT_EQ("entry", HotIR->getEntryBlock().getName());
+
+  // The third call starts the recompile, and the old code stays callable
+  // while it runs and after it is done.
+  for (int i = 0; i < 5; ++i)
+    EXPECT_EQ(i + 1, Hot(i + 1));
+
+  // Keep calling the old code while its entry is patched to jump to the new
+  // code.
+  for (unsigned i = 0; i != 1000000 && Emissions.Count != 2; ++i)
+    ASSERT_EQ(7, Hot(7));
+  for (int i = 0; i < 1000; ++i)
+    ASSERT_EQ(7, Hot(7));
+
+  // Destroying the JIT waits for the background recompile.
+  TheJIT.reset();
+  EXPECT_EQ(2u, Emissions.Count);
+}
+
+TEST_F(JITTest, HotFunctionsAreTieredUpInTurn) {
+  EmissionCounter Emissions;
+  TheJIT->RegisterJITEventListener(&Emissions);
+  TheJIT->EnableTieredCompilation(2);
+  LoadAssembly("define i32 @first(i32 %n) { "
+               "  %r = add i32 %n, 1 "
+               "  ret i32 %r "
+               "} "
+               "define i32 @second(i32 %n) { "
+               "  %r = add i32 %n, 2 "
+               "  ret i32 %r "
+               "} "
+               "define i32 @third(i32 %n) { "
+               "  %r = add i32 %n, 3 "
+               "  ret i32 %r "
+               "} ");
+  const char *Names[] = { "first", "second", "third" };
+  int32_t (*Fns[3])(int32_t);
+  for (int i = 0; i < 3; ++i)
+    Fns[i] = reinterpret_cast<int32_t(*)(int32_t)>(
+      (intptr_t)TheJIT->getPointerToFunction(M->getFunction(Names[i])));
+  EXPECT_EQ(3u, Emissions.Count);
+
+  // All three get hot at once and are recompiled one after another by the
+  // same tier-up thread.
+  for (int i = 0; i < 5; ++i)
+    for (int j = 0; j < 3; ++j)
+      ASSERT_EQ(i + j + 1, Fns[j](i));
+
+  for (unsigned i = 0; i != 1000000 && Emissions.Count != 6; ++i)
+    for (int j = 0; j < 3; ++j)
+      ASSERT_EQ(j + 8, Fns[j](7));
+
+  TheJIT.reset();
+  EXPECT_EQ(6u, Emissions.Count);
+}
+
+TEST_F(JITTest, BackgroundCompilationCompilesEachCalleeOnce) {
+  EmissionCounter Emissions;
+  TheJIT->RegisterJITEventListener(&Emissions);
+  TheJIT->DisableLazyCompilation(false);
+  TheJIT->EnableBackgroundCompilation(true);
+  LoadAssembly("define internal i32 @leaf() { "
+               "  ret i32 1 "
+               "} "
+               "define internal i32 @middle() { "
+               "  %a = call i32 @leaf() "
+               "  %b = add i32 %a, 1 "
+               "  ret i32 %b "
+               "} "
+               "define i32 @top() { "
+               "  %a = call i32 @middle() "
+               "  %b = call i32 @leaf() "
+               "  %c = add i32 %a, %b "
+               "  ret i32 %c "
+               "} ");
+  Function *TopIR = M->getFunction("top");
+
+  int32_t (*Top)() = reinterpret_cast<int32_t(*)()>(
+    (intptr_t)TheJIT->getPointerToFunction(TopIR));
+  // The callees are compiled either in the background or through their stubs,
+  // whichever gets there first, but never twice.
+  EXPECT_EQ(3, Top());
+  EXPECT_EQ(3, Top());
+  EXPECT_EQ(3u, Emissions.Count);
+
+  TheJIT.reset();
+  EXPECT_EQ(3u, Emissions.Count);
+}
+
+TEST_F(JITTest, StubsAreCalledWhileBackgroundCompilationUpdatesThem) {
+  EmissionCounter Emissions;
+  TheJIT->RegisterJITEventListener(&Emissions);
+  TheJIT->DisableLazyCompilation(false);
+  TheJIT->EnableBackgroundCompilation(true);
+  std::string Assembly;
+  std::string Calls;
+  const unsigned NumCallees = 32;
+  for (unsigned i = 0; i != NumCallees; ++i) {
+    std::string N = utostr(i);
+    Assembly += "define internal i32 @callee" + N + "() { "
+                "  ret i32 1 "
+                "} ";
+    Calls += "  %c" + N + " = call i32 @callee" + N + "() "
+             "  %s" + utostr(i + 1) + " = add i32 %s" + N + ", %c" + N + " ";
+  }
+  Assembly += "define i32 @top() { "
+              "entry: "
+              "  %s0 = add i32 0, 0 " + Calls +
+              "  ret i32 %s" + utostr(NumCallees) + " "
+              "} ";
+  LoadAssembly(Assembly.c_str());
+  Function *TopIR = M->getFunction("top");
+
+  int32_t (*Top)() = reinterpret_cast<int32_t(*)()>(
+    (intptr_t)TheJIT->getPointerToFunction(TopIR));
+  // Call through the stubs while the background thread points them at the
+  // code it compiles.
+  for (unsigned i = 0; i != 1000000 && Emissions.Count != NumCallees + 1; ++i)
+    ASSERT_EQ((int32_t)NumCallees, Top());
+  EXPECT_EQ((int32_t)NumCallees, Top());
+
+  TheJIT.reset();
+  EXPECT_EQ(NumCallees + 1, Emissions.Count);
+}
 #endif  // !defined(__arm__)
 
 }  // anonymous namespace
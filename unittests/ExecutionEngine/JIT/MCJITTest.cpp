@@ -0,0 +1,166 @@
+//===- MCJITTest.cpp - Unit tests for the MC-based JIT --------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+#include "llvm/LLVMContext.h"
+#include "llvm/Module.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/Assembly/Parser.h"
+#include "llvm/ExecutionEngine/GenericValue.h"
+#include "llvm/ExecutionEngine/MCJIT.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetSelect.h"
+#include <vector>
+
+using namespace llvm;
+
+// The RuntimeDyld only links MachO objects, so the code is generated for
+// Darwin, which only works where the processor is the same.
+#if defined(__x86_64__) || defined(_M_X64)
+
+namespace {
+
+Module *loadAssembly(LLVMContext &Context, const char *Name,
+                     const char *Assembly) {
+  Module *M = new Module(Name, Context);
+  M->setTargetTriple("x86_64-apple-darwin");
+  SMDiagnostic Error;
+  bool Success = ParseAssemblyString(Assembly, M, Error, Context) != 0;
+  std::string ErrMsg;
+  raw_string_ostream OS(ErrMsg);
+  Error.Print("", OS);
+  EXPECT_TRUE(Success) << OS.str();
+  return M;
+}
+
+class MCJITTest : public testing::Test {
+protected:
+  virtual void SetUp() {
+    InitializeNativeTarget();
+    InitializeNativeTargetAsmPrinter();
+    M1 = loadAssembly(Context, "m1",
+                      "@counter = global i32 0 "
+                      "define internal i32 @step() { "
+                      "  %c = load i32* @counter "
+                      "  %n = add i32 %c, 1 "
+                      "  store i32 %n, i32* @counter "
+                      "  ret i32 %n "
+                      "} "
+                      "define i32 @bump(i32 %x) { "
+                      "  %s = call i32 @step() "
+                      "  %r = add i32 %x, %s "
+                      "  ret i32 %r "
+                      "} ");
+    M2 = loadAssembly(Context, "m2",
+                      "@counter = external global i32 "
+                      "declare i32 @bump(i32) "
+                      "define internal i32 @step() { "
+                      "  ret i32 100 "
+                      "} "
+                      "define i32 @twice(i32 %x) { "
+                      "  %a = call i32 @bump(i32 %x) "
+                      "  %b = call i32 @bump(i32 %a) "
+                      "  %s = call i32 @step() "
+                      "  %c = load i32* @counter "
+                      "  %r1 = add i32 %b, %s "
+                      "  %r = add i32 %r1, %c "
+                      "  ret i32 %r "
+                      "} "
+                      "define i32 ()* @getStep() { "
+                      "  ret i32 ()* @step "
+                      "} ");
+  }
+
+  /// createJIT - Create an MCJIT over both modules.
+  void createJIT(bool Lazy) {
+    std::string Error;
+    EE.reset(EngineBuilder(M1).setUseMCJIT(true)
+                              .setErrorStr(&Error)
+                              .setEngineKind(EngineKind::JIT)
+                              .create());
+    ASSERT_TRUE(EE.get()) << Error;
+    EE->DisableLazyCompilation(!Lazy);
+    EE->addModule(M2);
+  }
+
+  /// checkCrossModuleReferences - Run the code in the second module, which
+  /// calls into the first.
+  void checkCrossModuleReferences();
+
+  LLVMContext Context;
+  Module *M1;
+  Module *M2;
+  OwningPtr<ExecutionEngine> EE;
+};
+
+void MCJITTest::checkCrossModuleReferences() {
+  // @twice in the second module calls @bump in the first, which updates the
+  // first module's @counter, declared in the second.  Each module's internal
+  // @step stays its own.
+  std::vector<GenericValue> Args(1);
+  Args[0].IntVal = APInt(32, 10);
+  GenericValue Result = EE->runFunction(M2->getFunction("twice"), Args);
+  // (10 + 1) + 2 = 13, plus 100 from the second @step, plus @counter.
+  EXPECT_EQ(115, Result.IntVal.getSExtValue());
+
+  int32_t *Counter = (int32_t*)EE->getPointerToGlobal(
+    M1->getGlobalVariable("counter"));
+  EXPECT_EQ(2, *Counter);
+
+  // Compiling the rest of the second module later must find the same code.
+  int32_t (*(*GetStep)())() =
+    (int32_t (*(*)())())(intptr_t)EE->getPointerToFunction(
+      M2->getFunction("getStep"));
+  EXPECT_EQ((void*)GetStep(),
+            EE->getPointerToFunction(M2->getFunction("step")));
+  EXPECT_EQ(100, GetStep()());
+}
+
+TEST_F(MCJITTest, CrossModuleReferencesLazy) {
+  createJIT(/*Lazy=*/true);
+  checkCrossModuleReferences();
+}
+
+TEST_F(MCJITTest, CrossModuleReferencesEager) {
+  createJIT(/*Lazy=*/false);
+  checkCrossModuleReferences();
+}
+
+TEST_F(MCJITTest, AddressesAreStable) {
+  createJIT(/*Lazy=*/true);
+  Function *Bump = M1->getFunction("bump");
+  void *Before = EE->getPointerToFunction(Bump);
+  ASSERT_TRUE(Before != 0);
+
+  std::vector<GenericValue> Args(1);
+  Args[0].IntVal = APInt(32, 1);
+  EE->runFunction(M2->getFunction("twice"), Args);
+  EXPECT_EQ(Before, EE->getPointerToFunction(Bump));
+  EXPECT_EQ(Before, EE->getPointerToGlobalIfAvailable(Bump));
+}
+
+TEST_F(MCJITTest, RemovedModuleIsForgotten) {
+  createJIT(/*Lazy=*/true);
+  std::vector<GenericValue> Args(1);
+  Args[0].IntVal = APInt(32, 0);
+  EE->runFunction(M1->getFunction("bump"), Args);
+
+  ASSERT_TRUE(EE->removeModule(M2));
+  EXPECT_TRUE(EE->FindFunctionNamed("twice") == 0);
+  delete M2;
+
+  // The first module still works on its own.
+  GenericValue Result = EE->runFunction(M1->getFunction("bump"), Args);
+  EXPECT_EQ(2, Result.IntVal.getSExtValue());
+}
+
+}
+
+#endif
@@ -0,0 +1,195 @@
+//===- JITCodeCacheTest.cpp - Unit tests for the JIT code cache -----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/JITCodeCache.h"
+#include "llvm/DerivedTypes.h"
+#include "llvm/Function.h"
+#include "llvm/LLVMContext.h"
+#include "llvm/Module.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetOptions.h"
+#include "gtest/gtest.h"
+#include <string>
+
+using namespace llvm;
+
+namespace {
+
+class JITCodeCacheTest : public testing::Test {
+protected:
+  virtual void SetUp() {
+    std::string ErrMsg;
+    Dir = sys::Path::GetTemporaryDirectory(&ErrMsg);
+    ASSERT_TRUE(ErrMsg.empty()) << ErrMsg;
+  }
+
+  virtual void TearDown() {
+    Dir.eraseFromDisk(/*destroy_contents=*/true);
+  }
+
+  /// lookupString - Look up Key in Cache and return the object as a string,
+  /// or "<miss>".
+  static std::string lookupString(JITCodeCache &Cache, StringRef Key) {
+    OwningPtr<MemoryBuffer> MB(Cache.lookup(Key));
+    if (!MB)
+      return "<miss>";
+    return MB->getBuffer();
+  }
+
+  /// getOnlyEntry - Return the path of the single entry in the cache.
+  std::string getOnlyEntry() {
+    std::string Found;
+    error_code EC;
+    for (sys::fs::directory_iterator I(Dir.str(), EC), E; I != E && !EC;
+         I.increment(EC)) {
+      EXPECT_TRUE(Found.empty()) << "more than one cache entry";
+      Found = I->path();
+    }
+    return Found;
+  }
+
+  sys::Path Dir;
+};
+
+TEST_F(JITCodeCacheTest, StoreAndLookup) {
+  JITCodeCache Cache(Dir.str());
+  EXPECT_EQ("<miss>", lookupString(Cache, "key1"));
+
+  EXPECT_FALSE(Cache.store("key1", "object one"));
+  EXPECT_FALSE(Cache.store("key2", StringRef("object\0two", 10)));
+  EXPECT_EQ("object one", lookupString(Cache, "key1"));
+  EXPECT_EQ(std::string("object\0two", 10), lookupString(Cache, "key2"));
+
+  // A second cache over the same directory, as in a later process, sees the
+  // same entries.
+  JITCodeCache Later(Dir.str());
+  EXPECT_EQ("object one", lookupString(Later, "key1"));
+
+  // Storing under an existing key replaces the entry.
+  EXPECT_FALSE(Later.store("key1", "object three"));
+  EXPECT_EQ("object three", lookupString(Cache, "key1"));
+}
+
+TEST_F(JITCodeCacheTest, CorruptEntryIsRemoved) {
+  JITCodeCache Cache(Dir.str());
+  ASSERT_FALSE(Cache.store("key", "some object code"));
+  std::string Path = getOnlyEntry();
+  ASSERT_FALSE(Path.empty());
+
+  // Flip the last byte of the object; the checksum no longer matches.
+  OwningPtr<MemoryBuffer> Entry;
+  ASSERT_FALSE(MemoryBuffer::getFile(Path, Entry));
+  std::string Contents = Entry->getBuffer();
+  Contents[Contents.size() - 1] ^= 1;
+  {
+    std::string ErrorInfo;
+    raw_fd_ostream OS(Path.c_str(), ErrorInfo, raw_fd_ostream::F_Binary);
+    ASSERT_TRUE(ErrorInfo.empty()) << ErrorInfo;
+    OS << Contents;
+  }
+
+  EXPECT_EQ("<miss>", lookupString(Cache, "key"));
+  bool Exists;
+  ASSERT_FALSE(sys::fs::exists(Path, Exists));
+  EXPECT_FALSE(Exists);
+
+  // A truncated entry is rejected too.
+  ASSERT_FALSE(Cache.store("key", "some object code"));
+  {
+    std::string ErrorInfo;
+    raw_fd_ostream OS(Path.c_str(), ErrorInfo, raw_fd_ostream::F_Binary);
+    OS << Contents.substr(0, 12);
+  }
+  EXPECT_EQ("<miss>", lookupString(Cache, "key"));
+}
+
+TEST_F(JITCodeCacheTest, SizeLimit) {
+  std::string Object(1000, 'x');
+  JITCodeCache Cache(Dir.str(), 2500);
+
+  EXPECT_FALSE(Cache.store("key1", Object));
+  EXPECT_FALSE(Cache.store("key2", Object));
+  EXPECT_FALSE(Cache.store("key3", Object));
+  EXPECT_GE(2500u, Cache.getSize());
+
+  // The entry that was just stored is never the one pruned.
+  EXPECT_EQ(Object, lookupString(Cache, "key3"));
+  unsigned Hits = 0;
+  Hits += lookupString(Cache, "key1") != "<miss>";
+  Hits += lookupString(Cache, "key2") != "<miss>";
+  EXPECT_EQ(1u, Hits);
+
+  // Objects that could never fit are not stored at all.
+  std::string ErrMsg;
+  EXPECT_TRUE(Cache.store("huge", std::string(3000, 'x'), &ErrMsg));
+  EXPECT_FALSE(ErrMsg.empty());
+  EXPECT_EQ("<miss>", lookupString(Cache, "huge"));
+  EXPECT_EQ(Object, lookupString(Cache, "key3"));
+}
+
+TEST_F(JITCodeCacheTest, KeyCoversModuleAndOptions) {
+  LLVMContext Context;
+  Module M("cached", Context);
+  std::vector<const Type*> NoParams;
+  Function::Create(FunctionType::get(Type::getVoidTy(Context), NoParams,
+                                     false),
+                   GlobalValue::ExternalLinkage, "f", &M);
+
+  SmallVector<std::string, 2> Attrs;
+  std::string Key = JITCodeCache::getKey(M, "x86_64-unknown-linux-gnu", "",
+                                         Attrs, CodeGenOpt::Default,
+                                         CodeModel::Default);
+  EXPECT_EQ(Key, JITCodeCache::getKey(M, "x86_64-unknown-linux-gnu", "",
+                                      Attrs, CodeGenOpt::Default,
+                                      CodeModel::Default));
+  EXPECT_NE(Key, JITCodeCache::getKey(M, "i386-unknown-linux-gnu", "",
+                                      Attrs, CodeGenOpt::Default,
+                                      CodeModel::Default));
+  EXPECT_NE(Key, JITCodeCache::getKey(M, "x86_64-unknown-linux-gnu",
+                                      "core2", Attrs, CodeGenOpt::Default,
+                                      CodeModel::Default));
+  EXPECT_NE(Key, JITCodeCache::getKey(M, "x86_64-unknown-linux-gnu", "",
+                                      Attrs, CodeGenOpt::None,
+                                      CodeModel::Default));
+  EXPECT_NE(Key, JITCodeCache::getKey(M, "x86_64-unknown-linux-gnu", "",
+                                      Attrs, CodeGenOpt::Default,
+                                      CodeModel::Large));
+  Attrs.push_back("+sse3");
+  EXPECT_NE(Key, JITCodeCache::getKey(M, "x86_64-unknown-linux-gnu", "",
+                                      Attrs, CodeGenOpt::Default,
+                                      CodeModel::Default));
+  Attrs.clear();
+
+  // Options which are held in globals are part of the key too.
+  UnsafeFPMath = !UnsafeFPMath;
+  std::string UnsafeFPKey =
+    JITCodeCache::getKey(M, "x86_64-unknown-linux-gnu", "", Attrs,
+                         CodeGenOpt::Default, CodeModel::Default);
+  UnsafeFPMath = !UnsafeFPMath;
+  EXPECT_NE(Key, UnsafeFPKey);
+  NoFramePointerElim = !NoFramePointerElim;
+  std::string NoFPElimKey =
+    JITCodeCache::getKey(M, "x86_64-unknown-linux-gnu", "", Attrs,
+                         CodeGenOpt::Default, CodeModel::Default);
+  NoFramePointerElim = !NoFramePointerElim;
+  EXPECT_NE(Key, NoFPElimKey);
+
+  Function::Create(FunctionType::get(Type::getVoidTy(Context), NoParams,
+                                     false),
+                   GlobalValue::ExternalLinkage, "g", &M);
+  EXPECT_NE(Key, JITCodeCache::getKey(M, "x86_64-unknown-linux-gnu", "",
+                                      Attrs, CodeGenOpt::Default,
+                                      CodeModel::Default));
+}
+
+}
@@ -0,0 +1,118 @@
+//===- SplitModule.cpp - Unit tests for splitting modules -----------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+#include "llvm/Function.h"
+#include "llvm/GlobalVariable.h"
+#include "llvm/LLVMContext.h"
+#include "llvm/Module.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/Analysis/Verifier.h"
+#include "llvm/Assembly/Parser.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Transforms/Utils/SplitModule.h"
+
+using namespace llvm;
+
+namespace {
+
+// @f1 and @f2 are about the same size, so they end up in different
+// partitions.  @helper follows its first caller @f1, and both functions use
+// @helper and @counter.  @f2 only refers to @table through a constant
+// getelementptr.
+static const char *const SplitModuleSource =
+  "@counter = internal global i32 0\n"
+  "@table = internal global [4 x i32] zeroinitializer\n"
+  "define i32 @f1(i32 %x) {\n"
+  "  %a = call i32 @helper(i32 %x)\n"
+  "  %b = volatile load i32* @counter\n"
+  "  %c = add i32 %a, %b\n"
+  "  %d = mul i32 %c, 3\n"
+  "  ret i32 %d\n"
+  "}\n"
+  "define internal i32 @helper(i32 %x) {\n"
+  "  %a = add i32 %x, 1\n"
+  "  ret i32 %a\n"
+  "}\n"
+  "define i32 @f2(i32 %x) {\n"
+  "  %a = call i32 @helper(i32 %x)\n"
+  "  %b = volatile load i32* @counter\n"
+  "  %c = load i32* getelementptr ([4 x i32]* @table, i32 0, i32 2)\n"
+  "  %d = add i32 %b, %c\n"
+  "  ret i32 %d\n"
+  "}\n";
+
+TEST(SplitModule, CrossPartitionReferences) {
+  LLVMContext Context;
+  SMDiagnostic Err;
+  OwningPtr<Module> M(ParseAssemblyString(SplitModuleSource, 0, Err,
+                                          Context));
+  ASSERT_TRUE(M.get() != 0);
+  Function *F1 = M->getFunction("f1");
+  Function *F2 = M->getFunction("f2");
+  Function *Helper = M->getFunction("helper");
+  GlobalVariable *Counter = M->getGlobalVariable("counter", true);
+  GlobalVariable *Table = M->getGlobalVariable("table", true);
+
+  ModulePartitionMap Owner;
+  ASSERT_TRUE(AssignModulePartitions(*M, 2, Owner));
+  EXPECT_EQ(0u, Owner.lookup(F1));
+  EXPECT_EQ(0u, Owner.lookup(Helper));
+  EXPECT_EQ(0u, Owner.lookup(Counter));
+  EXPECT_EQ(1u, Owner.lookup(F2));
+  EXPECT_EQ(1u, Owner.lookup(Table));
+
+  // @helper and @counter are used from both partitions, @table only from the
+  // one which owns it.
+  PromoteCrossPartitionLocals(*M, Owner);
+  EXPECT_EQ("helper.lto_priv", Helper->getName());
+  EXPECT_TRUE(Helper->hasExternalLinkage());
+  EXPECT_TRUE(Helper->hasHiddenVisibility());
+  EXPECT_EQ("counter.lto_priv", Counter->getName());
+  EXPECT_TRUE(Counter->hasHiddenVisibility());
+  EXPECT_EQ("table", Table->getName());
+  EXPECT_TRUE(Table->hasLocalLinkage());
+
+  OwningPtr<Module> P0(ExtractModulePartition(*M, 0, Owner));
+  EXPECT_FALSE(verifyModule(*P0, ReturnStatusAction));
+  EXPECT_FALSE(P0->getFunction("f1")->isDeclaration());
+  EXPECT_FALSE(P0->getFunction("helper.lto_priv")->isDeclaration());
+  EXPECT_FALSE(P0->getGlobalVariable("counter.lto_priv")->isDeclaration());
+  EXPECT_TRUE(P0->getFunction("f2")->isDeclaration());
+  EXPECT_TRUE(P0->getGlobalVariable("table", true) == 0);
+
+  OwningPtr<Module> P1(ExtractModulePartition(*M, 1, Owner));
+  EXPECT_FALSE(verifyModule(*P1, ReturnStatusAction));
+  EXPECT_FALSE(P1->getFunction("f2")->isDeclaration());
+  EXPECT_FALSE(P1->getGlobalVariable("table", true)->isDeclaration());
+  EXPECT_TRUE(P1->getFunction("helper.lto_priv")->isDeclaration());
+  EXPECT_TRUE(P1->getGlobalVariable("counter.lto_priv")->isDeclaration());
+  EXPECT_TRUE(P1->getFunction("f1")->isDeclaration());
+}
+
+TEST(SplitModule, BlockAddressIsNotSplit) {
+  LLVMContext Context;
+  SMDiagnostic Err;
+  OwningPtr<Module> M(ParseAssemblyString(
+    "define i8* @f() {\n"
+    "entry:\n"
+    "  br label %next\n"
+    "next:\n"
+    "  ret i8* blockaddress(@f, %next)\n"
+    "}\n"
+    "define i32 @g() {\n"
+    "  ret i32 0\n"
+    "}\n", 0, Err, Context));
+  ASSERT_TRUE(M.get() != 0);
+
+  ModulePartitionMap Owner;
+  EXPECT_FALSE(AssignModulePartitions(*M, 2, Owner));
+}
+
+}
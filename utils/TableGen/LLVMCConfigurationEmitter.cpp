@@ -21,6 +21,7 @@
 #include <algorithm>
 #include <cassert>
 #include <functional>
+#include <map>
 #include <stdexcept>
 #include <string>
 #include <typeinfo>
@@ -444,11 +445,15 @@ std::string OptionDescription::GenOptionType() const {
 /// OptionDescriptions - An OptionDescription array plus some helper
 /// functions.
 class OptionDescriptions {
-  typedef StringMap<OptionDescription> container_type;
+  typedef std::vector<OptionDescription> container_type;
 
-  /// Descriptions - A list of OptionDescriptions.
+  /// Descriptions - A list of OptionDescriptions, in the order in which they
+  /// were first seen, which is the order they are emitted in.
   container_type Descriptions;
 
+  /// Index - The position of each option in Descriptions, by name.
+  StringMap<unsigned> Index;
+
 public:
   /// FindOption - exception-throwing wrapper for find().
   const OptionDescription& FindOption(const std::string& OptName) const;
@@ -475,9 +480,9 @@ public:
 
 const OptionDescription&
 OptionDescriptions::FindOption(const std::string& OptName) const {
-  const_iterator I = Descriptions.find(OptName);
-  if (I != Descriptions.end())
-    return I->second;
+  StringMap<unsigned>::const_iterator I = Index.find(OptName);
+  if (I != Index.end())
+    return Descriptions[I->second];
   else
     throw OptName + ": no such option!";
 }
@@ -526,13 +531,14 @@ OptionDescriptions::FindParameterListOrParameter
 }
 
 void OptionDescriptions::InsertDescription (const OptionDescription& o) {
-  container_type::iterator I = Descriptions.find(o.Name);
-  if (I != Descriptions.end()) {
-    OptionDescription& D = I->second;
+  StringMap<unsigned>::iterator I = Index.find(o.Name);
+  if (I != Index.end()) {
+    OptionDescription& D = Descriptions[I->second];
     D.Merge(o);
   }
   else {
-    Descriptions[o.Name] = o;
+    Index[o.Name] = Descriptions.size();
+    Descriptions.push_back(o);
   }
 }
 
@@ -1267,7 +1273,7 @@ void CheckForSuperfluousOptions (const DagVector& EdgeVector,
   // non-superfluous options.
   for (OptionDescriptions::const_iterator B = OptDescs.begin(),
          E = OptDescs.end(); B != E; ++B) {
-    const OptionDescription& Val = B->second;
+    const OptionDescription& Val = *B;
     if (!nonSuperfluousOptions.count(Val.Name)
         && Val.Type != OptionType::Alias)
       llvm::errs() << "Warning: option '-" << Val.Name << "' has no effect! "
@@ -2346,7 +2352,7 @@ void EmitOptionDefinitions (const OptionDescriptions& descs,
   // Emit static cl::Option variables.
   for (OptionDescriptions::const_iterator B = descs.begin(),
          E = descs.end(); B!=E; ++B) {
-    const OptionDescription& val = B->second;
+    const OptionDescription& val = *B;
 
     if (val.Type == OptionType::Alias) {
       Aliases.push_back(val);
@@ -2811,7 +2817,8 @@ struct HookInfo {
   {}
 };
 
-typedef llvm::StringMap<HookInfo> HookInfoMap;
+// Hooks are declared in the order of their names.
+typedef std::map<std::string, HookInfo> HookInfoMap;
 
 /// ExtractHookNames - Extract the hook names from all instances of
 /// $CALL(HookName) in the provided command line string/action. Helper
@@ -2942,7 +2949,7 @@ void EmitHookDeclarations(const ToolDescriptions& ToolDescs,
 
   for (HookInfoMap::const_iterator B = HookNames.begin(),
          E = HookNames.end(); B != E; ++B) {
-    const char* HookName = B->first();
+    const char* HookName = B->first.c_str();
     const HookInfo& Info = B->second;
 
     O.indent(Indent1) << "std::string " << HookName << "(";
@@ -0,0 +1,82 @@
+#!/usr/bin/env python
+
+"""
+gvn-scaling.py - Compile-time scaling benchmark for GVN.
+
+Generates functions of increasing size and reports how long 'opt -gvn' takes
+on each.  Every function is a chain of diamonds.  Each merge block loads a
+different pointer that was stored to in the entry block, so every load needs a
+non-local dependency query that walks back to the entry block, and each block
+also does some arithmetic for the value table to number.
+
+Without a block budget the total work is quadratic in the number of diamonds;
+with one (-gvn-max-nonlocal-blocks) the time per instruction should stay flat.
+
+Usage: gvn-scaling.py [--opt=path/to/opt] [--sizes=100,1000,...] [opt flags]
+"""
+
+import os
+import subprocess
+import sys
+import tempfile
+import time
+
+def generate(num_diamonds):
+    lines = []
+    lines.append('define i32 @f(i32* %p, i32 %v, i1 %c) {')
+    lines.append('entry:')
+    for i in range(num_diamonds):
+        lines.append('  %%p%d = getelementptr i32* %%p, i32 %d' % (i, i))
+        lines.append('  store i32 %%v, i32* %%p%d' % i)
+    lines.append('  br label %m0')
+    lines.append('m0:')
+    lines.append('  %s0 = add i32 %v, 1')
+    for i in range(num_diamonds):
+        lines.append('  br i1 %%c, label %%a%d, label %%b%d' % (i, i))
+        lines.append('a%d:' % i)
+        lines.append('  %%x%d = mul i32 %%s%d, 3' % (i, i))
+        lines.append('  br label %%m%d' % (i + 1))
+        lines.append('b%d:' % i)
+        lines.append('  %%y%d = mul i32 %%s%d, 3' % (i, i))
+        lines.append('  br label %%m%d' % (i + 1))
+        lines.append('m%d:' % (i + 1))
+        lines.append('  %%z%d = phi i32 [ %%x%d, %%a%d ], [ %%y%d, %%b%d ]' %
+                     (i, i, i, i, i))
+        lines.append('  %%l%d = load i32* %%p%d' % (i, i))
+        lines.append('  %%s%d = add i32 %%z%d, %%l%d' % (i + 1, i, i))
+    lines.append('  ret i32 %%s%d' % num_diamonds)
+    lines.append('}')
+    return '\n'.join(lines) + '\n'
+
+def main():
+    opt = 'opt'
+    sizes = [250, 500, 1000, 2000, 4000]
+    flags = []
+    for arg in sys.argv[1:]:
+        if arg.startswith('--opt='):
+            opt = arg[len('--opt='):]
+        elif arg.startswith('--sizes='):
+            sizes = [int(s) for s in arg[len('--sizes='):].split(',')]
+        else:
+            flags.append(arg)
+
+    print('%10s %12s %10s %14s' % ('diamonds', 'instructions', 'seconds',
+                                   'usec/inst'))
+    for size in sizes:
+        source = generate(size)
+        insts = len([l for l in source.splitlines() if l.startswith('  ')])
+        fd, path = tempfile.mkstemp(suffix='.ll')
+        os.write(fd, source.encode('ascii'))
+        os.close(fd)
+        try:
+            start = time.time()
+            subprocess.check_call([opt, '-gvn', '-disable-output', path] +
+                                  flags)
+            elapsed = time.time() - start
+        finally:
+            os.remove(path)
+        print('%10d %12d %10.3f %14.2f' % (size, insts, elapsed,
+                                           elapsed * 1e6 / insts))
+
+if __name__ == '__main__':
+    main()
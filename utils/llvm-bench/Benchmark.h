@@ -0,0 +1,38 @@
+//===- Benchmark.h - Benchmarks run by llvm-bench ---------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares the benchmarks llvm-bench runs, one per source file, and
+// the timing helper they share.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_BENCH_BENCHMARK_H
+#define LLVM_BENCH_BENCHMARK_H
+
+#include <string>
+
+namespace llvm {
+  class TimeRecord;
+
+  /// printTime - Print the wall time elapsed since Start, labelled What.
+  void printTime(const std::string &What, const TimeRecord &Start);
+
+  /// runStringMapBenchmark - Time hashing, inserting and looking up a corpus
+  /// of symbol names.
+  void runStringMapBenchmark();
+
+  /// runSwissMapBenchmark - Time SwissMap against DenseMap with pointer and
+  /// integer keys.
+  void runSwissMapBenchmark();
+
+  /// runScalarEvolutionBenchmark - Time the SCEV caches on deep loop nests.
+  void runScalarEvolutionBenchmark();
+}
+
+#endif
@@ -0,0 +1,141 @@
+//===- ScalarEvolutionBenchmark.cpp - SCEV queries on loop nests ----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This benchmark asks ScalarEvolution what IndVarSimplify and LSR ask of it
+// on ever deeper loop nests, and prints the time and memory the answers took.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Benchmark.h"
+#include "llvm/InitializePasses.h"
+#include "llvm/LLVMContext.h"
+#include "llvm/Module.h"
+#include "llvm/PassManager.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/Assembly/Parser.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/InstIterator.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
+using namespace llvm;
+
+/// getLoopNest - Return the assembly for a function @nest with a nest of
+/// Depth counted loops.  Each loop has an induction variable and a running
+/// offset that the loop inside it starts from, and the innermost loop stores
+/// to the sum of the two, the way a multi-dimensional array is walked.
+static std::string getLoopNest(unsigned Depth) {
+  std::string IR = "define void @nest(i64* %p, i64 %n) {\n"
+                   "entry:\n"
+                   "  br label %h0\n";
+  for (unsigned k = 0; k != Depth; ++k) {
+    std::string K = utostr(k), Prev = utostr(k - 1);
+    std::string Pred = k ? "%h" + Prev : "%entry";
+    std::string Start = k ? "%a" + Prev : "0";
+    IR += "h" + K + ":\n"
+          "  %i" + K + " = phi i64 [ 0, " + Pred + " ], [ %i" + K +
+            ".next, %latch" + K + " ]\n"
+          "  %a" + K + " = phi i64 [ " + Start + ", " + Pred + " ], [ %a" + K +
+            ".next, %latch" + K + " ]\n";
+    if (k + 1 != Depth) {
+      IR += "  br label %h" + utostr(k + 1) + "\n";
+      continue;
+    }
+    IR += "  %idx = add i64 %a" + K + ", %i" + K + "\n"
+          "  %addr = getelementptr i64* %p, i64 %idx\n"
+          "  store i64 %idx, i64* %addr\n"
+          "  br label %latch" + K + "\n";
+  }
+  for (unsigned k = Depth; k-- != 0; ) {
+    std::string K = utostr(k);
+    std::string Exit = k ? "%latch" + utostr(k - 1) : "%exit";
+    IR += "latch" + K + ":\n"
+          "  %i" + K + ".next = add i64 %i" + K + ", 1\n"
+          "  %a" + K + ".next = add i64 %a" + K + ", %n\n"
+          "  %c" + K + " = icmp slt i64 %i" + K + ".next, %n\n"
+          "  br i1 %c" + K + ", label %h" + K + ", label " + Exit + "\n";
+  }
+  IR += "exit:\n"
+        "  ret void\n"
+        "}\n";
+  return IR;
+}
+
+namespace {
+  /// SCEVQueries - Time the expression for every instruction, its value at
+  /// every enclosing scope, whether it is invariant in each loop, whether it
+  /// dominates each block, and the trip count of every loop, asked Rounds
+  /// times over.
+  struct SCEVQueries : public FunctionPass {
+    static char ID;
+    unsigned Depth;
+
+    explicit SCEVQueries(unsigned Depth) : FunctionPass(ID), Depth(Depth) {}
+
+    virtual void getAnalysisUsage(AnalysisUsage &AU) const {
+      AU.addRequired<LoopInfo>();
+      AU.addRequired<ScalarEvolution>();
+      AU.setPreservesAll();
+    }
+
+    virtual bool runOnFunction(Function &F) {
+      LoopInfo &LI = getAnalysis<LoopInfo>();
+      ScalarEvolution &SE = getAnalysis<ScalarEvolution>();
+      std::vector<const Loop *> Loops;
+      for (Function::iterator BB = F.begin(), E = F.end(); BB != E; ++BB)
+        if (LI.isLoopHeader(BB))
+          Loops.push_back(LI.getLoopFor(BB));
+
+      unsigned NumQueries = 0;
+      size_t MemUsed = sys::Process::GetMallocUsage();
+      TimeRecord Start = TimeRecord::getCurrentTime(true);
+      for (unsigned Round = 0; Round != 10; ++Round) {
+        for (unsigned i = 0, e = Loops.size(); i != e; ++i)
+          SE.getBackedgeTakenCount(Loops[i]);
+        for (inst_iterator I = inst_begin(F), E = inst_end(F); I != E; ++I) {
+          if (!SE.isSCEVable(I->getType()))
+            continue;
+          const SCEV *S = SE.getSCEV(&*I);
+          for (const Loop *L = LI.getLoopFor(I->getParent()); L;
+               L = L->getParentLoop(), ++NumQueries)
+            SE.getSCEVAtScope(S, L->getParentLoop());
+          for (unsigned i = 0, e = Loops.size(); i != e; ++i)
+            SE.isLoopInvariant(S, Loops[i]);
+          for (Function::iterator BB = F.begin(), E = F.end(); BB != E; ++BB)
+            SE.dominates(S, BB);
+          NumQueries += Loops.size() + F.size();
+        }
+      }
+      MemUsed = sys::Process::GetMallocUsage() - MemUsed;
+      printTime("depth " + utostr(Depth) + ", " + utostr(NumQueries) +
+                " queries, " + utostr(MemUsed / 1024) + " KB", Start);
+      return false;
+    }
+  };
+}
+
+char SCEVQueries::ID = 0;
+
+void llvm::runScalarEvolutionBenchmark() {
+  initializeAnalysis(*PassRegistry::getPassRegistry());
+  for (unsigned Depth = 8; Depth <= 64; Depth *= 2) {
+    LLVMContext Context;
+    Module M("nest", Context);
+    SMDiagnostic Error;
+    if (!ParseAssemblyString(getLoopNest(Depth).c_str(), &M, Error, Context))
+      report_fatal_error("could not parse the loop nest: " +
+                         Error.getMessage());
+    PassManager PM;
+    PM.add(new SCEVQueries(Depth));
+    PM.run(M);
+  }
+}
@@ -0,0 +1,109 @@
+//===- StringMapBenchmark.cpp - StringMap and string hashing --------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This benchmark hashes a corpus of symbol names, and inserts and looks them
+// up in a StringMap.  The corpus is read from the file given with -corpus, one
+// symbol per line (for instance the output of "nm -j" on a large library).
+// Without it, a corpus of synthetic C++ mangled names is used.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Benchmark.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/DataTypes.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/system_error.h"
+#include <cstring>
+#include <vector>
+using namespace llvm;
+
+static cl::opt<std::string>
+CorpusFilename("corpus", cl::desc("Symbol names for the stringmap benchmark"),
+               cl::value_desc("filename"));
+
+static void getSyntheticCorpus(std::vector<std::string> &Corpus) {
+  static const char *const Names[] = {
+    "llvm", "clang", "std", "SmallVector", "DenseMap", "Value", "Instruction",
+    "BasicBlock", "Function", "getOperand", "setName", "runOnFunction",
+    "iterator", "allocator", "basic_string", "char_traits", "operator"
+  };
+  const unsigned NumNames = sizeof(Names) / sizeof(Names[0]);
+  uint32_t Seed = 1;
+  for (unsigned i = 0; i != 200000; ++i) {
+    std::string Sym = "_ZN";
+    unsigned Depth = 1 + i % 4;
+    for (unsigned d = 0; d != Depth; ++d) {
+      Seed = Seed * 1103515245 + 12345;
+      const char *Name = Names[(Seed >> 8) % NumNames];
+      Sym += utostr(strlen(Name)) + Name;
+    }
+    Sym += utostr(i) + "E";
+    Sym += (i & 1) ? "PKc" : "RKNS_5ValueEj";
+    Corpus.push_back(Sym);
+  }
+}
+
+static void getCorpus(std::vector<std::string> &Corpus) {
+  if (!CorpusFilename.empty()) {
+    OwningPtr<MemoryBuffer> Buffer;
+    if (!MemoryBuffer::getFile(CorpusFilename, Buffer)) {
+      SmallVector<StringRef, 16> Lines;
+      Buffer->getBuffer().split(Lines, "\n", -1, false);
+      for (unsigned i = 0, e = Lines.size(); i != e; ++i)
+        Corpus.push_back(Lines[i]);
+      return;
+    }
+    errs() << "could not read " << CorpusFilename
+           << ", using synthetic names\n";
+  }
+  getSyntheticCorpus(Corpus);
+}
+
+void llvm::runStringMapBenchmark() {
+  std::vector<std::string> Corpus;
+  getCorpus(Corpus);
+  size_t Bytes = 0;
+  for (unsigned i = 0, e = Corpus.size(); i != e; ++i)
+    Bytes += Corpus[i].size();
+  outs() << Corpus.size() << " symbols, " << Bytes << " bytes\n";
+
+  unsigned Sum = 0;
+  TimeRecord Start = TimeRecord::getCurrentTime(true);
+  for (unsigned Round = 0; Round != 10; ++Round)
+    for (unsigned i = 0, e = Corpus.size(); i != e; ++i)
+      Sum += HashString(Corpus[i]);
+  printTime("HashString x10", Start);
+
+  Start = TimeRecord::getCurrentTime(true);
+  for (unsigned Round = 0; Round != 10; ++Round)
+    for (unsigned i = 0, e = Corpus.size(); i != e; ++i)
+      Sum += HashStringFast(Corpus[i]);
+  printTime("HashStringFast x10", Start);
+
+  StringMap<unsigned> Map;
+  Start = TimeRecord::getCurrentTime(true);
+  for (unsigned i = 0, e = Corpus.size(); i != e; ++i)
+    Map[Corpus[i]] = i;
+  printTime("StringMap insert", Start);
+
+  Start = TimeRecord::getCurrentTime(true);
+  for (unsigned Round = 0; Round != 10; ++Round)
+    for (unsigned i = 0, e = Corpus.size(); i != e; ++i)
+      Sum += Map.lookup(Corpus[i]);
+  printTime("StringMap lookup x10", Start);
+
+  // Keep the loops above from being optimized away.
+  outs() << "(" << Sum << ")\n";
+}
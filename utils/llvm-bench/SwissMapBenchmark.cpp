@@ -0,0 +1,93 @@
+//===- SwissMapBenchmark.cpp - SwissMap against DenseMap ------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This benchmark fills, probes and partly refills SwissMaps and DenseMaps of
+// the sizes the big Value* maps in the optimizers reach.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Benchmark.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/SwissMap.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
+#include <vector>
+using namespace llvm;
+
+/// getKeys - Return pointers to N objects the size of a small IR value, the
+/// way the keys of the big maps from Value* look.
+static std::vector<void*> getKeys(unsigned N) {
+  static std::vector<void*> Keys;
+  while (Keys.size() < N)
+    Keys.push_back(operator new(48));
+  return std::vector<void*>(Keys.begin(), Keys.begin() + N);
+}
+
+template<typename MapT>
+static uint64_t runPointerKeys(const char *Name, const std::vector<void*> &Keys,
+                               const std::vector<void*> &Misses) {
+  TimeRecord Start = TimeRecord::getCurrentTime(true);
+  uint64_t Sum = 0;
+  {
+    MapT Map;
+    for (unsigned i = 0, e = Keys.size(); i != e; ++i)
+      Map[Keys[i]] = i;
+    for (unsigned Round = 0; Round != 10; ++Round) {
+      for (unsigned i = 0, e = Keys.size(); i != e; ++i)
+        Sum += Map.find(Keys[i])->second;
+      for (unsigned i = 0, e = Misses.size(); i != e; ++i)
+        Sum += Map.count(Misses[i]);
+    }
+    for (unsigned i = 0, e = Keys.size(); i < e; i += 2)
+      Map.erase(Keys[i]);
+    for (unsigned i = 0, e = Keys.size(); i < e; i += 2)
+      Map[Keys[i]] = i;
+    Sum += Map.size();
+  }
+  printTime(std::string(Name) + " pointers, " + utostr(Keys.size()) + " keys",
+            Start);
+  return Sum;
+}
+
+template<typename MapT>
+static uint64_t runIntegerKeys(const char *Name, unsigned N) {
+  TimeRecord Start = TimeRecord::getCurrentTime(true);
+  uint64_t Sum = 0;
+  {
+    MapT Map;
+    // Sequential integers, such as value numbers, with DenseMapInfo's hash of
+    // Val*37.
+    for (unsigned i = 0; i != N; ++i)
+      Map[i] = i;
+    for (unsigned Round = 0; Round != 10; ++Round)
+      for (unsigned i = 0; i != 2 * N; ++i)
+        Sum += Map.lookup(i);
+  }
+  printTime(std::string(Name) + " integers, " + utostr(N) + " keys", Start);
+  return Sum;
+}
+
+void llvm::runSwissMapBenchmark() {
+  uint64_t Sum = 0;
+  for (unsigned N = 1000; N <= 1000000; N *= 10) {
+    std::vector<void*> All = getKeys(2 * N);
+    std::vector<void*> Keys(All.begin(), All.begin() + N);
+    std::vector<void*> Misses(All.begin() + N, All.end());
+    Sum += runPointerKeys<DenseMap<void*, unsigned> >("DenseMap", Keys, Misses);
+    Sum += runPointerKeys<SwissMap<void*, unsigned> >("SwissMap", Keys, Misses);
+  }
+  for (unsigned N = 1000; N <= 1000000; N *= 10) {
+    Sum += runIntegerKeys<DenseMap<unsigned, unsigned> >("DenseMap", N);
+    Sum += runIntegerKeys<SwissMap<unsigned, unsigned> >("SwissMap", N);
+  }
+
+  // Keep the loops above from being optimized away.
+  outs() << "(" << Sum << ")\n";
+}
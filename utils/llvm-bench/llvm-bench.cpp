@@ -0,0 +1,85 @@
+//===- llvm-bench.cpp - Run LLVM's micro-benchmarks -----------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This utility runs the micro-benchmarks of data structures and analyses
+// which are too slow for the unit tests, and prints how long each step took:
+//  llvm-bench [options]                - Run every benchmark
+//  llvm-bench [options] -swissmap ...  - Run the given benchmarks
+//
+//===----------------------------------------------------------------------===//
+
+#include "Benchmark.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/PrettyStackTrace.h"
+#include "llvm/Support/Signals.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
+using namespace llvm;
+
+enum BenchmarkKind {
+  StringMapBench,
+  SwissMapBench,
+  ScalarEvolutionBench
+};
+
+static cl::list<BenchmarkKind>
+Benchmarks(cl::desc("Benchmarks to run:"),
+  cl::values(
+    clEnumValN(StringMapBench, "stringmap",
+               "String hashing and StringMap on symbol names"),
+    clEnumValN(SwissMapBench, "swissmap",
+               "SwissMap against DenseMap"),
+    clEnumValN(ScalarEvolutionBench, "scev",
+               "ScalarEvolution queries on deep loop nests"),
+    clEnumValEnd));
+
+void llvm::printTime(const std::string &What, const TimeRecord &Start) {
+  TimeRecord Time = TimeRecord::getCurrentTime(false);
+  Time -= Start;
+  outs() << format("%-40s %9.3f ms\n", What.c_str(),
+                   Time.getWallTime() * 1000.0);
+}
+
+static void runBenchmark(BenchmarkKind Kind) {
+  switch (Kind) {
+  case StringMapBench:
+    outs() << "=== stringmap ===\n";
+    runStringMapBenchmark();
+    break;
+  case SwissMapBench:
+    outs() << "=== swissmap ===\n";
+    runSwissMapBenchmark();
+    break;
+  case ScalarEvolutionBench:
+    outs() << "=== scev ===\n";
+    runScalarEvolutionBenchmark();
+    break;
+  }
+}
+
+int main(int argc, char **argv) {
+  // Print a stack trace if we signal out.
+  sys::PrintStackTraceOnErrorSignal();
+  PrettyStackTraceProgram X(argc, argv);
+  llvm_shutdown_obj Y;  // Call llvm_shutdown() on exit.
+
+  cl::ParseCommandLineOptions(argc, argv, "LLVM micro-benchmarks\n");
+
+  if (Benchmarks.empty()) {
+    runBenchmark(StringMapBench);
+    runBenchmark(SwissMapBench);
+    runBenchmark(ScalarEvolutionBench);
+    return 0;
+  }
+  for (unsigned i = 0, e = Benchmarks.size(); i != e; ++i)
+    runBenchmark(Benchmarks[i]);
+  return 0;
+}